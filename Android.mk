@@ -18,7 +18,8 @@ ifeq (google,$(TARGET_SOC_NAME))
 
 common_hal_dirs := \
 	libexynosutils \
-	videoapi
+	videoapi \
+	libexynosexif
 
 include $(call all-named-subdir-makefiles,$(common_hal_dirs))
 endif
@@ -1,11 +1,14 @@
-#define LOG_TAG "gralloc-V1-service"
+#define LOG_TAG "gralloc-V2-service"
 
 #include <android/binder_ibinder_platform.h>
 #include <android/binder_manager.h>
 #include <android/binder_process.h>
 #include <android/binder_status.h>
+#include <cutils/properties.h>
 #include <log/log.h>
 
+#include <algorithm>
+
 #include "aidl/GrallocAllocator.h"
 
 using namespace android;
@@ -13,10 +16,16 @@ using namespace android;
 using pixel::allocator::GrallocAllocator;
 
 int main() {
+    // Keep the one-time setup cost off the first allocation, which is on the boot critical path.
+    GrallocAllocator::warmUp();
+
     auto service = ndk::SharedRefBase::make<GrallocAllocator>();
     auto binder = service->asBinder();
 
-    AIBinder_setMinSchedulerPolicy(binder.get(), SCHED_NORMAL, -20);
+    // Nice value binder threads run at while serving a call, -20 (the init priority) unless a device
+    // lowers it with ro.vendor.gralloc.allocator.nice.
+    const int nice = std::clamp(property_get_int32("ro.vendor.gralloc.allocator.nice", -20), -20, 19);
+    AIBinder_setMinSchedulerPolicy(binder.get(), SCHED_NORMAL, nice);
 
     const auto instance = std::string() + GrallocAllocator::descriptor + "/default";
     auto status = AServiceManager_addServiceWithFlags(binder.get(), instance.c_str(),
@@ -26,7 +35,9 @@ int main() {
         return -EINVAL;
     }
 
-    ABinderProcess_setThreadPoolMaxThreadCount(4);
+    // The allocator grows the pool towards ro.vendor.gralloc.allocator.max_threads when every
+    // binder thread is busy allocating or slow allocations eat into the threads for fast ones.
+    ABinderProcess_setThreadPoolMaxThreadCount(service->initialThreadCount());
     ABinderProcess_startThreadPool();
     ABinderProcess_joinThreadPool();
 
@@ -3,11 +3,19 @@
 #include <aidl/android/hardware/graphics/allocator/AllocationError.h>
 #include <aidlcommonsupport/NativeHandle.h>
 #include <android/binder_ibinder.h>
+#include <android/binder_process.h>
 #include <android/binder_status.h>
+#include <cutils/properties.h>
 #include <hidl/HidlSupport.h>
+#include <inttypes.h>
+
+#include <algorithm>
+#include <cstring>
 
 #include "allocator/mali_gralloc_ion.h"
+#include "core/mali_gralloc_bufferallocation.h"
 #include "hidl_common/Allocator.h"
+#include "mali_gralloc_usages.h"
 
 namespace pixel::allocator {
 
@@ -22,10 +30,151 @@ unsigned long callingPid() {
     return static_cast<unsigned long>(AIBinder_getCallingPid());
 }
 
-GrallocAllocator::GrallocAllocator() {}
+// Same fields as the descriptor encoded by the HIDL mapper 4.0 createDescriptor.
+static bool toBufferDescriptor(const AidlAllocator::BufferDescriptorInfo& info,
+                               buffer_descriptor_t* out) {
+    if (info.width <= 0 || info.height <= 0 || info.layerCount <= 0 ||
+        static_cast<int32_t>(info.format) == 0 || info.reservedSize < 0) {
+        MALI_GRALLOC_LOGE("Invalid descriptor attributes for allocation");
+        return false;
+    }
+
+    // No vendor allocation options are understood.
+    if (!info.additionalOptions.empty()) {
+        MALI_GRALLOC_LOGE("Unsupported additional options in descriptor");
+        return false;
+    }
+
+    const char* name = reinterpret_cast<const char*>(info.name.data());
+    out->width = info.width;
+    out->height = info.height;
+    out->layer_count = info.layerCount;
+    out->hal_format = static_cast<uint64_t>(info.format);
+    out->producer_usage = static_cast<uint64_t>(info.usage);
+    out->consumer_usage = out->producer_usage;
+    out->format_type = MALI_GRALLOC_FORMAT_TYPE_USAGE;
+    out->signature = sizeof(buffer_descriptor_t);
+    out->reserved_size = info.reservedSize;
+    out->name = std::string(name, strnlen(name, info.name.size()));
+    return true;
+}
+
+static uint32_t readThreadProperty(const char* name, int32_t defaultValue) {
+    return static_cast<uint32_t>(std::max(1, property_get_int32(name, defaultValue)));
+}
+
+void LatencyHistogram::record(std::chrono::microseconds latency) {
+    const uint64_t us = static_cast<uint64_t>(std::max<int64_t>(0, latency.count()));
+    size_t bucket = 0;
+    while (bucket < kNumBuckets - 1 && us >= (1ull << bucket)) {
+        bucket++;
+    }
+
+    mBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    mTotalUs.fetch_add(us, std::memory_order_relaxed);
+
+    uint64_t max = mMaxUs.load(std::memory_order_relaxed);
+    while (us > max && !mMaxUs.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::dump(int fd, const char* name) const {
+    const uint64_t count = mCount.load(std::memory_order_relaxed);
+    const uint64_t total = mTotalUs.load(std::memory_order_relaxed);
+    dprintf(fd, "  %s: count=%" PRIu64 " avg=%" PRIu64 "us max=%" PRIu64 "us\n", name, count,
+            count ? total / count : 0, mMaxUs.load(std::memory_order_relaxed));
+    if (count == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < kNumBuckets; i++) {
+        const uint64_t value = mBuckets[i].load(std::memory_order_relaxed);
+        if (value == 0) {
+            continue;
+        }
+        if (i == kNumBuckets - 1) {
+            dprintf(fd, "    >= %8lluus: %" PRIu64 "\n", 1ull << (i - 1), value);
+        } else {
+            dprintf(fd, "    <  %8lluus: %" PRIu64 "\n", 1ull << i, value);
+        }
+    }
+}
+
+GrallocAllocator::GrallocAllocator()
+      : mInitialThreads(readThreadProperty("ro.vendor.gralloc.allocator.threads", 4)),
+        mMaxThreads(std::max(mInitialThreads,
+                             readThreadProperty("ro.vendor.gralloc.allocator.max_threads", 8))),
+        mSlowSizeBytes(static_cast<uint64_t>(readThreadProperty(
+                               "ro.vendor.gralloc.allocator.slow_size_mb", 32))
+                       << 20),
+        mCurrentThreads(mInitialThreads) {}
 
 GrallocAllocator::~GrallocAllocator() {}
 
+void GrallocAllocator::warmUp() {
+    const auto start = std::chrono::steady_clock::now();
+    arm::allocator::common::warm_up([](const char* step, std::chrono::microseconds elapsed) {
+        ALOGI("Warm-up step %s took %" PRId64 "us", step, static_cast<int64_t>(elapsed.count()));
+    });
+    const auto total = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+    ALOGI("Warm-up took %" PRId64 "us", static_cast<int64_t>(total.count()));
+}
+
+bool GrallocAllocator::isSlowAllocation(const buffer_descriptor_t& descriptor,
+                                        int32_t count) const {
+    const uint64_t usage = descriptor.producer_usage | descriptor.consumer_usage;
+
+    // Secure heaps have to migrate contiguous memory out of CMA.
+    if (usage & GRALLOC_USAGE_PROTECTED) {
+        return true;
+    }
+
+    // No format takes more than 16 bytes per pixel, so most buffers are fast without resolving
+    // the format a second time.
+    const uint64_t buffers = static_cast<uint64_t>(std::max(count, 1));
+    const uint64_t bound = static_cast<uint64_t>(descriptor.width) * descriptor.height *
+            std::max(descriptor.layer_count, 1u) * 16 * buffers;
+    if (bound < mSlowSizeBytes) {
+        return false;
+    }
+
+    buffer_descriptor_t resolved = descriptor;
+    if (mali_gralloc_derive_format_and_size(&resolved) != 0) {
+        return false;
+    }
+
+    uint64_t size = 0;
+    for (uint32_t i = 0; i < resolved.fd_count; i++) {
+        size += resolved.alloc_sizes[i];
+    }
+    return size * buffers >= mSlowSizeBytes;
+}
+
+void GrallocAllocator::maybeGrowThreadPool(uint32_t inFlight, uint32_t slowInFlight) {
+    std::lock_guard<std::mutex> lock(mThreadPoolMutex);
+
+    // Threads blocked in slow allocations do not count against the budget for fast ones.
+    uint32_t wanted = slowInFlight + mInitialThreads;
+    if (inFlight >= mCurrentThreads) {
+        wanted = std::max(wanted, mCurrentThreads * 2);
+    }
+
+    // The binder driver only spawns new looper threads on demand, so raising the ceiling is cheap
+    // when the service is idle. It can not be lowered again once the pool has started.
+    const uint32_t target = std::min(mMaxThreads, wanted);
+    if (target <= mCurrentThreads) {
+        return;
+    }
+
+    if (ABinderProcess_setThreadPoolMaxThreadCount(target)) {
+        MALI_GRALLOC_LOGV("Binder thread pool grown from %u to %u threads", mCurrentThreads,
+                          target);
+        mCurrentThreads = target;
+    }
+}
+
 ndk::ScopedAStatus GrallocAllocator::allocate(const std::vector<uint8_t>& descriptor, int32_t count,
                                               AidlAllocator::AllocationResult* result) {
     MALI_GRALLOC_LOGV("Allocation request from process: %lu", callingPid());
@@ -37,6 +186,71 @@ ndk::ScopedAStatus GrallocAllocator::allocate(const std::vector<uint8_t>& descri
                 static_cast<int32_t>(AidlAllocator::AllocationError::BAD_DESCRIPTOR));
     }
 
+    return allocateAndRecord(bufferDescriptor, count, result);
+}
+
+ndk::ScopedAStatus GrallocAllocator::allocate2(const AidlAllocator::BufferDescriptorInfo& descriptor,
+                                               int32_t count,
+                                               AidlAllocator::AllocationResult* result) {
+    MALI_GRALLOC_LOGV("Allocation request from process: %lu", callingPid());
+
+    buffer_descriptor_t bufferDescriptor;
+    if (!toBufferDescriptor(descriptor, &bufferDescriptor)) {
+        return ndk::ScopedAStatus::fromServiceSpecificError(
+                static_cast<int32_t>(AidlAllocator::AllocationError::BAD_DESCRIPTOR));
+    }
+
+    return allocateAndRecord(bufferDescriptor, count, result);
+}
+
+ndk::ScopedAStatus GrallocAllocator::isSupported(
+        const AidlAllocator::BufferDescriptorInfo& descriptor, bool* result) {
+    buffer_descriptor_t bufferDescriptor;
+    if (!toBufferDescriptor(descriptor, &bufferDescriptor)) {
+        return ndk::ScopedAStatus::fromServiceSpecificError(
+                static_cast<int32_t>(AidlAllocator::AllocationError::BAD_DESCRIPTOR));
+    }
+
+    *result = mali_gralloc_derive_format_and_size(&bufferDescriptor) == 0;
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus GrallocAllocator::getIMapperLibrarySuffix(std::string* result) {
+    *result = "pixel";
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus GrallocAllocator::allocateAndRecord(const buffer_descriptor_t& bufferDescriptor,
+                                                       int32_t count,
+                                                       AidlAllocator::AllocationResult* result) {
+    const bool slow = isSlowAllocation(bufferDescriptor, count);
+    const uint32_t inFlight = mInFlight.fetch_add(1) + 1;
+    const uint32_t slowInFlight = slow ? mSlowInFlight.fetch_add(1) + 1 : mSlowInFlight.load();
+    uint32_t peak = mPeakInFlight.load(std::memory_order_relaxed);
+    while (inFlight > peak && !mPeakInFlight.compare_exchange_weak(peak, inFlight)) {
+    }
+    maybeGrowThreadPool(inFlight, slowInFlight);
+
+    const auto start = std::chrono::steady_clock::now();
+    ndk::ScopedAStatus status = allocateInternal(bufferDescriptor, count, result);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+    if (slow) {
+        mSlowCount++;
+        mSlowLatency.record(elapsed);
+        mSlowInFlight--;
+    } else {
+        mFastCount++;
+        mFastLatency.record(elapsed);
+    }
+
+    mInFlight--;
+    return status;
+}
+
+ndk::ScopedAStatus GrallocAllocator::allocateInternal(const buffer_descriptor_t& bufferDescriptor,
+                                                      int32_t count,
+                                                      AidlAllocator::AllocationResult* result) {
     // TODO(layog@): This dependency between AIDL and HIDL backends is not good.
     // Ideally common::allocate should return the result and it should be encoded
     // by this interface into HIDL or AIDL.
@@ -83,4 +297,24 @@ ndk::ScopedAStatus GrallocAllocator::allocate(const std::vector<uint8_t>& descri
     return ndk::ScopedAStatus::ok();
 }
 
+binder_status_t GrallocAllocator::dump(int fd, const char** /*args*/, uint32_t /*numArgs*/) {
+    uint32_t currentThreads;
+    {
+        std::lock_guard<std::mutex> lock(mThreadPoolMutex);
+        currentThreads = mCurrentThreads;
+    }
+
+    dprintf(fd, "Gralloc allocator:\n");
+    dprintf(fd, "  binder threads: %u (initial %u, max %u)\n", currentThreads, mInitialThreads,
+            mMaxThreads);
+    dprintf(fd, "  in-flight: %u (peak %u)\n", mInFlight.load(), mPeakInFlight.load());
+    dprintf(fd, "  allocations: fast=%" PRIu64 " slow=%" PRIu64 "\n", mFastCount.load(),
+            mSlowCount.load());
+    dprintf(fd, "  slow in-flight: %u\n", mSlowInFlight.load());
+    mFastLatency.dump(fd, "fast allocation");
+    mSlowLatency.dump(fd, "slow allocation");
+
+    return STATUS_OK;
+}
+
 } // namespace pixel::allocator
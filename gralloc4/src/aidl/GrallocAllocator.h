@@ -2,16 +2,41 @@
 
 #include <aidl/android/hardware/graphics/allocator/AllocationResult.h>
 #include <aidl/android/hardware/graphics/allocator/BnAllocator.h>
+#include <aidl/android/hardware/graphics/allocator/BufferDescriptorInfo.h>
 #include <aidlcommonsupport/NativeHandle.h>
+#include <android-base/thread_annotations.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <mutex>
+#include <string>
 #include <vector>
 
+struct buffer_descriptor_t;
+
 namespace pixel {
 namespace allocator {
 
 namespace AidlAllocator = aidl::android::hardware::graphics::allocator;
 
+// Power-of-two microsecond latency histogram. Recording is lock-free so it can be done from any
+// binder or worker thread without adding contention to the allocation path.
+class LatencyHistogram {
+public:
+    static constexpr size_t kNumBuckets = 18; // [0, 1us) ... [2^16us, inf)
+
+    void record(std::chrono::microseconds latency);
+    void dump(int fd, const char* name) const;
+
+private:
+    std::array<std::atomic<uint64_t>, kNumBuckets> mBuckets{};
+    std::atomic<uint64_t> mCount{0};
+    std::atomic<uint64_t> mTotalUs{0};
+    std::atomic<uint64_t> mMaxUs{0};
+};
+
 class GrallocAllocator : public AidlAllocator::BnAllocator {
 public:
     GrallocAllocator();
@@ -20,6 +45,54 @@ public:
 
     virtual ndk::ScopedAStatus allocate(const std::vector<uint8_t>& descriptor, int32_t count,
                                         AidlAllocator::AllocationResult* result) override;
+
+    virtual ndk::ScopedAStatus allocate2(const AidlAllocator::BufferDescriptorInfo& descriptor,
+                                         int32_t count,
+                                         AidlAllocator::AllocationResult* result) override;
+
+    virtual ndk::ScopedAStatus isSupported(const AidlAllocator::BufferDescriptorInfo& descriptor,
+                                           bool* result) override;
+
+    // Suffix of the stable-C mapper clients load from hw/mapper.<suffix>.so.
+    virtual ndk::ScopedAStatus getIMapperLibrarySuffix(std::string* result) override;
+
+    virtual binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
+    // Performs the lazy one-time initialisation of the allocation path up front, logging the time
+    // spent in each step. Meant to be called before the service is registered.
+    static void warmUp();
+
+    // Number of binder threads the service should start with. The pool is grown at runtime up to
+    // a configured ceiling when all threads are busy allocating, and so that this many threads are
+    // left for fast allocations while slow ones block in the kernel.
+    uint32_t initialThreadCount() const { return mInitialThreads; }
+
+private:
+    bool isSlowAllocation(const buffer_descriptor_t& descriptor, int32_t count) const;
+    void maybeGrowThreadPool(uint32_t inFlight, uint32_t slowInFlight);
+
+    ndk::ScopedAStatus allocateAndRecord(const buffer_descriptor_t& descriptor, int32_t count,
+                                         AidlAllocator::AllocationResult* result);
+
+    ndk::ScopedAStatus allocateInternal(const buffer_descriptor_t& descriptor, int32_t count,
+                                        AidlAllocator::AllocationResult* result);
+
+    const uint32_t mInitialThreads;
+    const uint32_t mMaxThreads;
+    const uint64_t mSlowSizeBytes;
+
+    std::mutex mThreadPoolMutex;
+    uint32_t mCurrentThreads GUARDED_BY(mThreadPoolMutex);
+
+    std::atomic<uint32_t> mInFlight{0};
+    std::atomic<uint32_t> mPeakInFlight{0};
+    std::atomic<uint32_t> mSlowInFlight{0};
+    std::atomic<uint64_t> mFastCount{0};
+    std::atomic<uint64_t> mSlowCount{0};
+
+    // Slow allocations run on the calling binder thread, so there is no queue wait to measure.
+    LatencyHistogram mFastLatency;
+    LatencyHistogram mSlowLatency;
 };
 
 } // namespace allocator
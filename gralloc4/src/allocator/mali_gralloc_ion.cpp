@@ -48,6 +48,7 @@
 #include "mali_gralloc_ion.h"
 
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <string>
 
@@ -279,6 +280,74 @@ int mali_gralloc_ion_sync(const private_handle_t * const hnd,
 }
 
 
+/*
+ * Android common kernels can sync part of a dmabuf. The UAPI headers used
+ * by userspace may predate it, so define it here when missing.
+ */
+#ifndef DMA_BUF_IOCTL_SYNC_PARTIAL
+struct dma_buf_sync_partial
+{
+	__u64 flags;
+	__u32 offset;
+	__u32 len;
+};
+#define DMA_BUF_IOCTL_SYNC_PARTIAL _IOW(DMA_BUF_BASE, 9, struct dma_buf_sync_partial)
+#endif
+
+static std::atomic<bool> partial_sync_unsupported(false);
+
+static int sync_partial(const int fd, const uint64_t offset, const uint64_t size,
+                        const bool read, const bool write, const bool start)
+{
+	if (partial_sync_unsupported.load(std::memory_order_relaxed) ||
+	    offset > UINT32_MAX || size > UINT32_MAX - offset)
+	{
+		return -EOPNOTSUPP;
+	}
+
+	struct dma_buf_sync_partial sync_partial = {};
+	sync_partial.flags = (start ? DMA_BUF_SYNC_START : DMA_BUF_SYNC_END) |
+	                     (read && !write ? DMA_BUF_SYNC_READ :
+	                      write && !read ? DMA_BUF_SYNC_WRITE : DMA_BUF_SYNC_RW);
+	sync_partial.offset = static_cast<__u32>(offset);
+	sync_partial.len = static_cast<__u32>(size);
+
+	int ret;
+	do
+	{
+		ret = ioctl(fd, DMA_BUF_IOCTL_SYNC_PARTIAL, &sync_partial);
+	} while (ret == -1 && (errno == EINTR || errno == EAGAIN));
+
+	if (ret == -1)
+	{
+		if (errno == ENOTTY)
+		{
+			partial_sync_unsupported.store(true, std::memory_order_relaxed);
+		}
+		return -errno;
+	}
+
+	return 0;
+}
+
+int mali_gralloc_ion_sync_range(const private_handle_t * const hnd, const uint64_t offset,
+                                const uint64_t size, const bool read, const bool write,
+                                const bool start)
+{
+	if (hnd == NULL)
+	{
+		return -EINVAL;
+	}
+
+	if (sync_partial(hnd->fds[0], offset, size, read, write, start) == 0)
+	{
+		return 0;
+	}
+
+	return mali_gralloc_ion_sync(hnd, read, write, start);
+}
+
+
 int mali_gralloc_ion_sync_start(const private_handle_t * const hnd,
                                 const bool read,
                                 const bool write)
@@ -295,6 +364,20 @@ int mali_gralloc_ion_sync_end(const private_handle_t * const hnd,
 }
 
 
+void mali_gralloc_ion_init_allocator(void)
+{
+	ATRACE_CALL();
+	get_allocator();
+}
+
+void mali_gralloc_ion_init_heap_tables(void)
+{
+	ATRACE_CALL();
+	/* The heap tables are function-local statics, filled on the first lookup. */
+	select_dmabuf_heap(0);
+}
+
+
 void mali_gralloc_ion_free(private_handle_t * const hnd)
 {
 	for (int i = 0; i < hnd->fd_count; i++)
@@ -533,3 +616,43 @@ void mali_gralloc_ion_unmap(private_handle_t *hnd, std::array<void*, MAX_BUFFER_
 	hnd->cpu_read = 0;
 	hnd->cpu_write = 0;
 }
+
+void *mali_gralloc_ion_map_range(private_handle_t *hnd, uint32_t fd_idx, uint64_t offset, uint64_t size)
+{
+	uint64_t usage = hnd->producer_usage | hnd->consumer_usage;
+	/* Do not allow cpu access to secure buffers */
+	if (usage & (GRALLOC_USAGE_PROTECTED | GRALLOC_USAGE_NOZEROED)
+			&& !(usage & GRALLOC_USAGE_PRIVATE_NONSECURE))
+	{
+		return nullptr;
+	}
+
+	if (fd_idx >= static_cast<uint32_t>(hnd->fd_count) || (offset & (PAGE_SIZE - 1)) != 0 ||
+	    offset + size > hnd->alloc_sizes[fd_idx])
+	{
+		MALI_GRALLOC_LOGE("Invalid map range fds[%u] offset:%" PRIu64 " size:%" PRIu64,
+				fd_idx, offset, size);
+		return nullptr;
+	}
+
+	void *mappedAddress = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+				hnd->fds[fd_idx], offset);
+	if (MAP_FAILED == mappedAddress)
+	{
+		int err = errno;
+		MALI_GRALLOC_LOGE("mmap( fds[%u]:%d offset:%" PRIu64 " size:%" PRIu64 " ) failed with %s",
+				fd_idx, hnd->fds[fd_idx], offset, size, strerror(err));
+		return nullptr;
+	}
+
+	return mappedAddress;
+}
+
+void mali_gralloc_ion_unmap_range(void *vaddr, uint64_t size)
+{
+	if (munmap(vaddr, size))
+	{
+		MALI_GRALLOC_LOGE("Could not munmap base:%p size:%" PRIu64 " '%s'",
+				vaddr, size, strerror(errno));
+	}
+}
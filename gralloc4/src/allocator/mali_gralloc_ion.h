@@ -30,8 +30,28 @@ int mali_gralloc_ion_sync_start(const private_handle_t * const hnd,
                                 const bool read, const bool write);
 int mali_gralloc_ion_sync_end(const private_handle_t * const hnd,
                               const bool read, const bool write);
+/*
+ * Start (start) or end CPU access to [offset, offset + size) of fds[0], e.g. a
+ * single layer. Syncs the whole buffer when the kernel has no partial sync.
+ */
+int mali_gralloc_ion_sync_range(const private_handle_t * const hnd, const uint64_t offset,
+                                const uint64_t size, const bool read, const bool write,
+                                const bool start);
 std::array<void*, MAX_BUFFER_FDS> mali_gralloc_ion_map(private_handle_t *hnd);
 void mali_gralloc_ion_unmap(private_handle_t *hnd, std::array<void*, MAX_BUFFER_FDS>& vaddrs);
+/*
+ * Map part of one fd, e.g. a single layer. offset must be page aligned.
+ * Returns nullptr on failure and for secure buffers.
+ */
+void *mali_gralloc_ion_map_range(private_handle_t *hnd, uint32_t fd_idx, uint64_t offset, uint64_t size);
+void mali_gralloc_ion_unmap_range(void *vaddr, uint64_t size);
 int mali_gralloc_attr_allocate(void);
 
+/*
+ * Construct the dmabuf BufferAllocator and build the usage to heap tables
+ * ahead of the first allocation. Both are otherwise initialised lazily.
+ */
+void mali_gralloc_ion_init_allocator(void);
+void mali_gralloc_ion_init_heap_tables(void);
+
 #endif /* MALI_GRALLOC_ION_H_ */
@@ -18,325 +18,434 @@
 
 #include <linux/videodev2_exynos_media.h>
 #include <gralloc_priv.h>
+#include <exynos_format.h>
+
+#include <cstdint>
 
 #define PLANE_SIZE(w, h)      ((w) * (h))
 #define S2B_PLANE_SIZE(w, h)  (GRALLOC_ALIGN((w) / 4, 16) * (GRALLOC_ALIGN(h, 16)))
 
+/* TODO: set S10B format align in BoardConfig.mk */
+#define BOARD_EXYNOS_S10B_FORMAT_ALIGN 64
+#if 0
+ifeq ($(BOARD_EXYNOS_S10B_FORMAT_ALIGN), 64)
+LOCAL_CFLAGS += -DBOARD_EXYNOS_S10B_FORMAT_ALIGN=$(BOARD_EXYNOS_S10B_FORMAT_ALIGN)
+else
+LOCAL_CFLAGS += -DBOARD_EXYNOS_S10B_FORMAT_ALIGN=16
+endif
+#endif
+
 /*
- * Compute SBWC buffer geometry for a buffer containing packed SBWC YUV data
- * with bits per pixel bpp, width w, and height h.
- * Returns a pair of { luma size, chroma size }.
+ * Parametric description of the Exynos YUV 4:2:0 layouts.
+ *
+ * Every Exynos YUV format is one luma plane followed by either an interleaved
+ * chroma plane or two planar chroma planes. What differs between formats is
+ * the packing of each plane, which is captured by yuv_layout_params. The plane
+ * geometry is then derived by compute_yuv_layout(), which is constexpr so that
+ * the sizes of fixed resolutions can be evaluated at compile time.
  */
-template <int bpp>
-static std::pair<size_t, size_t> sbwc_sizes(int w, int h) {
-	static_assert(bpp == 8 || bpp == 10, "Unexpected bit width");
-
-	const size_t luma_body_size = (bpp == 8) ?
-		SBWC_8B_Y_SIZE(w, h) : SBWC_10B_Y_SIZE(w, h);
-	const size_t luma_header_size = (bpp == 8) ?
-		SBWC_8B_Y_HEADER_SIZE(w, h) : SBWC_10B_Y_HEADER_SIZE(w, h);
+enum class yuv_layout_kind : uint8_t
+{
+	SP,          /* Semi-planar, linear */
+	SP_S10B,     /* Semi-planar 8-bit with separate 2-bit planes appended */
+	SP_TILED,    /* Semi-planar, 16x16 tiled */
+	P,           /* Planar with 16-byte aligned chroma stride */
+	SBWC,        /* Semi-planar lossless SBWC */
+	SBWC_LOSSY,  /* Semi-planar lossy SBWC */
+};
+
+struct yuv_layout_params
+{
+	yuv_layout_kind kind;
+	uint8_t bit_depth;     /* 8 or 10, for SBWC */
+	uint8_t lossy_rate;    /* Compression rate for lossy SBWC, 0 otherwise */
+	uint8_t sample_bytes;  /* Bytes per sample for linear layouts (2 for P010) */
+};
 
-	const size_t chroma_body_size = (bpp == 8) ?
-		SBWC_8B_CBCR_SIZE(w, h) : SBWC_10B_CBCR_SIZE(w, h);
-	const size_t chroma_header_size = (bpp == 8) ?
-		SBWC_8B_CBCR_HEADER_SIZE(w, h) : SBWC_10B_CBCR_HEADER_SIZE(w, h);
+struct yuv_plane_geometry
+{
+	uint64_t size;
+	uint64_t header_size;  /* Part of size taken by SBWC block headers */
+	uint32_t alloc_width;
+	uint32_t alloc_height;
+	uint32_t byte_stride;
+};
+
+struct yuv_layout
+{
+	/* Plane count reported to the allocator. Tiled layouts historically report 3. */
+	int plane_count;
+	/* Number of entries of plane[] that describe real planes. */
+	int num_planes;
+	yuv_plane_geometry plane[MAX_PLANES];
+};
 
-	MALI_GRALLOC_LOGV("SBWC luma body size 0x%zx, header size 0x%zx", luma_body_size, luma_header_size);
-	MALI_GRALLOC_LOGV("SBWC chroma body size 0x%zx, header size 0x%zx", chroma_body_size, chroma_header_size);
+/*
+ * Per-format layout table entry. align_w/align_h are applied to the requested
+ * dimensions before compute_yuv_layout() is invoked.
+ */
+struct yuv_format_layout
+{
+	uint32_t format;
+	uint16_t align_w;
+	uint16_t align_h;
+	yuv_layout_params params;
+};
 
-	return { luma_body_size + luma_header_size,
-	         chroma_body_size + chroma_header_size };
+static constexpr uint64_t sbwc_luma_header_size(uint8_t bit_depth, int w, int h)
+{
+	return bit_depth == 8 ? SBWC_8B_Y_HEADER_SIZE(w, h) : SBWC_10B_Y_HEADER_SIZE(w, h);
 }
 
-/*
- * All setup_<format> function will returns the plane_count
- */
+static constexpr uint64_t sbwc_chroma_header_size(uint8_t bit_depth, int w, int h)
+{
+	return bit_depth == 8 ? SBWC_8B_CBCR_HEADER_SIZE(w, h) : SBWC_10B_CBCR_HEADER_SIZE(w, h);
+}
 
-/* Sets up 8-bit SBWC semi planar and returns the plane count */
-int setup_sbwc_420_sp(int w, int h, int fd_count, plane_info_t *plane)
+static constexpr uint64_t sbwc_luma_size(uint8_t bit_depth, int w, int h)
 {
-	std::tie(plane[0].size, plane[1].size) = sbwc_sizes<8>(w, h);
+	return sbwc_luma_header_size(bit_depth, w, h) +
+		(bit_depth == 8 ? SBWC_8B_Y_SIZE(w, h) : SBWC_10B_Y_SIZE(w, h));
+}
 
-	plane[0].alloc_width = GRALLOC_ALIGN(w, 32);
-	plane[0].alloc_height = __ALIGN_UP(h, 16);
-	plane[0].byte_stride = SBWC_8B_STRIDE(w);
-	plane[0].fd_idx = 0;
+static constexpr uint64_t sbwc_chroma_size(uint8_t bit_depth, int w, int h)
+{
+	return sbwc_chroma_header_size(bit_depth, w, h) +
+		(bit_depth == 8 ? SBWC_8B_CBCR_SIZE(w, h) : SBWC_10B_CBCR_SIZE(w, h));
+}
 
-	plane[1].alloc_width = GRALLOC_ALIGN(w, 32);
-	plane[1].alloc_height = __ALIGN_UP(h, 16) / 2;
-	plane[1].byte_stride = SBWC_8B_STRIDE(w);
+static constexpr uint32_t sbwc_stride(uint8_t bit_depth, int w)
+{
+	return bit_depth == 8 ? SBWC_8B_STRIDE(w) : SBWC_10B_STRIDE(w);
+}
 
-	if (fd_count > 1)
-	{
-		plane[1].fd_idx = 1;
-	}
-	else
-	{
-		plane[1].fd_idx = 0;
-		plane[1].offset = plane[0].size;
-	}
+static constexpr uint64_t sbwc_lossy_luma_size(uint8_t bit_depth, int w, int h, int rate)
+{
+	return bit_depth == 8 ? SBWCL_8B_Y_SIZE(w, h, rate) : SBWCL_10B_Y_SIZE(w, h, rate);
+}
 
-	return 2;
+static constexpr uint64_t sbwc_lossy_chroma_size(uint8_t bit_depth, int w, int h, int rate)
+{
+	return bit_depth == 8 ? SBWCL_8B_CBCR_SIZE(w, h, rate) : SBWCL_10B_CBCR_SIZE(w, h, rate);
 }
 
-/* Sets up 10-bit SBWC semi planar and returns the plane count */
-int setup_sbwc_420_sp_10bit(int w, int h, int fd_count, plane_info_t *plane)
+static constexpr uint32_t sbwc_lossy_stride(uint8_t bit_depth, int w, int rate)
 {
-	std::tie(plane[0].size, plane[1].size) = sbwc_sizes<10>(w, h);
+	return bit_depth == 8 ? SBWCL_8B_STRIDE(w, rate) : SBWCL_10B_STRIDE(w, rate);
+}
 
-	plane[0].alloc_width = GRALLOC_ALIGN(w, 32);
-	plane[0].alloc_height = __ALIGN_UP(h, 16);
-	plane[0].byte_stride = SBWC_10B_STRIDE(w);
-	plane[0].fd_idx = 0;
+/*
+ * Computes the plane geometry of a layout for an already aligned width and
+ * height. fd_count only matters for layouts whose padding depends on whether
+ * planes share a dmabuf.
+ */
+static constexpr yuv_layout compute_yuv_layout(const yuv_layout_params &params, int width, int height, int fd_count)
+{
+	yuv_layout layout{};
+	layout.plane_count = 2;
+	layout.num_planes = 2;
 
-	plane[1].alloc_width = GRALLOC_ALIGN(w, 32);
-	plane[1].alloc_height = __ALIGN_UP(h, 16) / 2;
-	plane[1].byte_stride = SBWC_10B_STRIDE(w);
+	yuv_plane_geometry &luma = layout.plane[0];
+	yuv_plane_geometry &chroma = layout.plane[1];
 
-	if (fd_count > 1)
+	switch (params.kind)
 	{
-		plane[1].fd_idx = 1;
-	}
-	else
+	case yuv_layout_kind::SBWC:
+		luma.size = sbwc_luma_size(params.bit_depth, width, height);
+		luma.header_size = sbwc_luma_header_size(params.bit_depth, width, height);
+		luma.alloc_width = GRALLOC_ALIGN(width, 32);
+		luma.alloc_height = __ALIGN_UP(height, 16);
+		luma.byte_stride = sbwc_stride(params.bit_depth, width);
+
+		chroma.size = sbwc_chroma_size(params.bit_depth, width, height);
+		chroma.header_size = sbwc_chroma_header_size(params.bit_depth, width, height);
+		chroma.alloc_width = luma.alloc_width;
+		chroma.alloc_height = luma.alloc_height / 2;
+		chroma.byte_stride = luma.byte_stride;
+		break;
+
+	case yuv_layout_kind::SBWC_LOSSY:
+		luma.size = sbwc_lossy_luma_size(params.bit_depth, width, height, params.lossy_rate);
+		luma.alloc_width = GRALLOC_ALIGN(width, 32);
+		luma.alloc_height = __ALIGN_UP(height, 8);
+		luma.byte_stride = sbwc_lossy_stride(params.bit_depth, width, params.lossy_rate);
+
+		chroma.size = sbwc_lossy_chroma_size(params.bit_depth, width, height, params.lossy_rate);
+		chroma.alloc_width = luma.alloc_width;
+		chroma.alloc_height = luma.alloc_height / 2;
+		chroma.byte_stride = luma.byte_stride;
+		break;
+
+	case yuv_layout_kind::SP:
+	case yuv_layout_kind::SP_S10B:
 	{
-		plane[1].fd_idx = 0;
-		plane[1].offset = plane[0].size;
+		/* TODO: make this into an assert instead ? */
+		height = GRALLOC_ALIGN(height, 2);
+
+		const uint32_t stride = width * params.sample_bytes;
+
+		luma.size = PLANE_SIZE(static_cast<uint64_t>(stride), height);
+		luma.alloc_width = width;
+		luma.alloc_height = height;
+		luma.byte_stride = stride;
+
+		chroma.size = PLANE_SIZE(static_cast<uint64_t>(stride), height / 2);
+		chroma.alloc_width = width;
+		chroma.alloc_height = height / 2;
+		chroma.byte_stride = stride;
+
+		if (params.kind == yuv_layout_kind::SP_S10B)
+		{
+			/* HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_S10B have special padding requirement */
+			const int mscl_ext = (fd_count == 1) ? 64 : 256;
+
+			luma.size += S2B_PLANE_SIZE(width, height) + mscl_ext;
+			chroma.size += S2B_PLANE_SIZE(width, height / 2) + mscl_ext;
+		}
+		break;
 	}
 
-	return 2;
-}
-
-/* Sets up 8-bit Lossy SBWC semi planar and returns the plane count */
-int setup_sbwc_420_sp_lossy(int width, int height, int rate, int fd_count, plane_info_t *plane)
-{
-	plane[0].size = SBWCL_8B_Y_SIZE(width, height, rate);
-	plane[0].alloc_width = GRALLOC_ALIGN(width, 32);
-	plane[0].alloc_height = __ALIGN_UP(height, 8);
-	plane[0].byte_stride = SBWCL_8B_STRIDE(width, rate);
-	plane[0].fd_idx = 0;
-
-	plane[1].size = SBWCL_8B_CBCR_SIZE(width, height, rate);
-	plane[1].alloc_width = GRALLOC_ALIGN(width, 32);
-	plane[1].alloc_height = __ALIGN_UP(height, 8) / 2;
-	plane[1].byte_stride = SBWCL_8B_STRIDE(width, rate);
-
-	if (fd_count > 1)
-	{
-		plane[1].fd_idx = 1;
-	}
-	else
-	{
-		plane[1].fd_idx = 0;
-		plane[1].offset = plane[0].size;
+	case yuv_layout_kind::SP_TILED:
+		/* TODO: make this into an assert instead ? */
+		width = GRALLOC_ALIGN(width, 2);
+		height = GRALLOC_ALIGN(height, 2);
+
+		luma.size = PLANE_SIZE(static_cast<uint64_t>(width), height);
+		luma.alloc_width = width;
+		luma.alloc_height = height;
+		luma.byte_stride = width * 16;
+
+		chroma.alloc_width = width;
+		chroma.alloc_height = GRALLOC_ALIGN(height / 2, 32);
+		chroma.size = PLANE_SIZE(static_cast<uint64_t>(width), chroma.alloc_height);
+		chroma.byte_stride = width * 16;
+
+		layout.plane_count = 3;
+		break;
+
+	case yuv_layout_kind::P:
+		/* TODO: make this into an assert instead ? */
+		width = GRALLOC_ALIGN(width, 2);
+		height = GRALLOC_ALIGN(height, 2);
+
+		luma.size = PLANE_SIZE(static_cast<uint64_t>(width), height);
+		luma.alloc_width = width;
+		luma.alloc_height = height;
+		luma.byte_stride = width;
+
+		chroma.alloc_width = GRALLOC_ALIGN(width / 2, 16);
+		chroma.alloc_height = height / 2;
+		chroma.size = PLANE_SIZE(static_cast<uint64_t>(chroma.alloc_width), chroma.alloc_height);
+		chroma.byte_stride = chroma.alloc_width;
+
+		layout.plane[2] = chroma;
+		layout.plane_count = 3;
+		layout.num_planes = 3;
+		break;
 	}
 
-	return 2;
+	return layout;
 }
 
+static constexpr yuv_layout_params SP_8BIT = { yuv_layout_kind::SP, 8, 0, 1 };
+static constexpr yuv_layout_params SP_P010 = { yuv_layout_kind::SP, 10, 0, 2 };
+static constexpr yuv_layout_params SP_S10B = { yuv_layout_kind::SP_S10B, 10, 0, 1 };
+static constexpr yuv_layout_params SP_TILED = { yuv_layout_kind::SP_TILED, 8, 0, 1 };
+static constexpr yuv_layout_params P_8BIT = { yuv_layout_kind::P, 8, 0, 1 };
 
-/* Sets up 10-bit Lossy SBWC semi planar and returns the plane count */
-int setup_sbwc_420_sp_10bit_lossy(int width, int height, int rate, int fd_count, plane_info_t *plane)
+static constexpr yuv_layout_params sbwc_params(uint8_t bit_depth)
 {
-	plane[0].size = SBWCL_10B_Y_SIZE(width, height, rate);
-	plane[0].alloc_width = GRALLOC_ALIGN(width, 32);
-	plane[0].alloc_height = __ALIGN_UP(height, 8);
-	plane[0].byte_stride = SBWCL_10B_STRIDE(width, rate);
-	plane[0].fd_idx = 0;
-
-	plane[1].size = SBWCL_10B_CBCR_SIZE(width, height, rate);
-	plane[1].alloc_width = GRALLOC_ALIGN(width, 32);
-	plane[1].alloc_height = __ALIGN_UP(height, 8) / 2;
-	plane[1].byte_stride = SBWCL_10B_STRIDE(width, rate);
-
-	if (fd_count > 1)
-	{
-		plane[1].fd_idx = 1;
-	}
-	else
-	{
-		plane[1].fd_idx = 0;
-		plane[1].offset = plane[0].size;
-	}
-
-	return 2;
+	return { yuv_layout_kind::SBWC, bit_depth, 0, 0 };
 }
 
-int setup_420_sp(int width, int height, int fd_count, plane_info_t *plane)
+static constexpr yuv_layout_params sbwc_lossy_params(uint8_t bit_depth, uint8_t rate)
 {
-	/* TODO: make this into an assert instead ? */
-	height = GRALLOC_ALIGN(height, 2);
-
-	plane[0].size = PLANE_SIZE(width, height);
-	plane[0].alloc_width = width;
-	plane[0].alloc_height = height;
-	plane[0].byte_stride = width;
-	plane[0].fd_idx = 0;
+	return { yuv_layout_kind::SBWC_LOSSY, bit_depth, rate, 0 };
+}
 
-	int chroma_width = width;
-	int chroma_height = height / 2;
+/*
+ * Layout of every Exynos YUV format handled by prepare_descriptor_exynos_formats().
+ * New variants only need an entry here.
+ */
+static constexpr yuv_format_layout exynos_yuv_layouts[] =
+{
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_SBWC,         1,  1, sbwc_params(8) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCrCb_420_SP_M_SBWC,         1,  1, sbwc_params(8) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_SBWC,          1,  1, sbwc_params(8) },
 
-	plane[1].size = PLANE_SIZE(chroma_width, chroma_height);
-	plane[1].alloc_width = chroma_width;
-	plane[1].alloc_height = chroma_height;
-	plane[1].byte_stride = chroma_width;
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC,     1,  1, sbwc_params(10) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCrCb_420_SP_M_10B_SBWC,     1,  1, sbwc_params(10) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC,      1,  1, sbwc_params(10) },
 
-	if (fd_count > 1)
-	{
-		plane[1].fd_idx = 1;
-	}
-	else
-	{
-		plane[1].fd_idx = 0;
-		plane[1].offset = plane[0].size;
-	}
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_SBWC_L50,     1,  1, sbwc_lossy_params(8, 50) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_SBWC_L50,      1,  1, sbwc_lossy_params(8, 50) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_SBWC_L75,     1,  1, sbwc_lossy_params(8, 75) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_SBWC_L75,      1,  1, sbwc_lossy_params(8, 75) },
 
-	return 2;
-}
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC_L40, 1,  1, sbwc_lossy_params(10, 40) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC_L40,  1,  1, sbwc_lossy_params(10, 40) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC_L60, 1,  1, sbwc_lossy_params(10, 60) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC_L60,  1,  1, sbwc_lossy_params(10, 60) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC_L80, 1,  1, sbwc_lossy_params(10, 80) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC_L80,  1,  1, sbwc_lossy_params(10, 80) },
 
-int setup_420_sp_s10b(int width, int height, int fd_count, plane_info_t *plane)
-{
-	/* TODO: make this into an assert instead ? */
-	/* TODO: assert height aligned to 16 ? */
-	height = GRALLOC_ALIGN(height, 2);
+	{ HAL_PIXEL_FORMAT_YCrCb_420_SP,                       1,  2, SP_8BIT },
 
-	int mscl_ext = 256;
+	{ HAL_PIXEL_FORMAT_EXYNOS_YV12_M,                      32, 16, P_8BIT },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_P_M,               32, 16, P_8BIT },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_P,                 16, 1,  P_8BIT },
 
-	/* HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_S10B have special padding requirement */
-	if (fd_count == 1)
-	{
-		mscl_ext = 64;
-	}
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_TILED,        16, 32, SP_TILED },
 
-	plane[0].size = PLANE_SIZE(width, height) + S2B_PLANE_SIZE(width, height) + mscl_ext;
-	plane[0].alloc_width = width;
-	plane[0].alloc_height = height;
-	plane[0].byte_stride = width;
-	plane[0].fd_idx = 0;
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCrCb_420_SP_M,              16, 32, SP_8BIT },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCrCb_420_SP_M_FULL,         16, 32, SP_8BIT },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M,              16, 32, SP_8BIT },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN,               64, 16, SP_8BIT },
 
-	int chroma_width = width;
-	int chroma_height = height / 2;
+	/* This is 64 pixel align for now */
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_S10B,         BOARD_EXYNOS_S10B_FORMAT_ALIGN, 16, SP_S10B },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_S10B,          BOARD_EXYNOS_S10B_FORMAT_ALIGN, 16, SP_S10B },
 
-	plane[1].size = PLANE_SIZE(chroma_width, chroma_height)
-		+ S2B_PLANE_SIZE(chroma_width, chroma_height) + mscl_ext;
-	plane[1].alloc_width = chroma_width;
-	plane[1].alloc_height = chroma_height;
-	plane[1].byte_stride = chroma_width;
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_P010_M,                16, 16, SP_P010 },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_P010_SPN,              64, 16, SP_P010 },
+};
 
-	if (fd_count > 1)
-	{
-		plane[1].fd_idx = 1;
-	}
-	else
+static constexpr const yuv_format_layout *find_exynos_yuv_layout(uint32_t format)
+{
+	for (const yuv_format_layout &entry : exynos_yuv_layouts)
 	{
-		plane[1].fd_idx = 0;
-		plane[1].offset = plane[0].size;
+		if (entry.format == format)
+		{
+			return &entry;
+		}
 	}
 
-	return 2;
+	return nullptr;
 }
 
-int setup_p010_sp(int width, int height, int fd_count, plane_info_t *plane)
+/*
+ * Lossy SBWC siblings of the lossless SBWC formats. Rates are listed in
+ * ascending order per lossless format; a lower rate means a smaller buffer.
+ */
+struct sbwc_lossy_variant
 {
-	/* TODO: make this into an assert instead ? */
-	height = GRALLOC_ALIGN(height, 2);
-
-	plane[0].size = PLANE_SIZE(width * 2, height);
-	plane[0].alloc_width = width;
-	plane[0].alloc_height = height;
-	plane[0].byte_stride = width * 2;
-	plane[0].fd_idx = 0;
+	uint32_t lossless_format;
+	uint8_t rate;
+	uint32_t lossy_format;
+};
 
-	int chroma_width = width;
-	int chroma_height = height / 2;
+static constexpr sbwc_lossy_variant sbwc_lossy_variants[] =
+{
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_SBWC,     50, HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_SBWC_L50 },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_SBWC,     75, HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_SBWC_L75 },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_SBWC,      50, HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_SBWC_L50 },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_SBWC,      75, HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_SBWC_L75 },
+
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC, 40, HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC_L40 },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC, 60, HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC_L60 },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC, 80, HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC_L80 },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC,  40, HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC_L40 },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC,  60, HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC_L60 },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC,  80, HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC_L80 },
+};
 
-	plane[1].size = PLANE_SIZE(chroma_width * 2, chroma_height);
-	plane[1].alloc_width = chroma_width;
-	plane[1].alloc_height = chroma_height;
-	plane[1].byte_stride = chroma_width * 2;
+/*
+ * Returns the lossy variant of a lossless SBWC format with the highest rate not
+ * above the requested one, falling back to the lowest available rate. Returns
+ * 0 if the format has no lossy variant.
+ */
+static constexpr uint32_t find_sbwc_lossy_variant(uint32_t lossless_format, uint8_t rate)
+{
+	uint32_t lowest = 0;
+	uint32_t best = 0;
 
-	if (fd_count > 1)
+	for (const sbwc_lossy_variant &variant : sbwc_lossy_variants)
 	{
-		plane[1].fd_idx = 1;
-	}
-	else
-	{
-		plane[1].fd_idx = 0;
-		plane[1].offset = plane[0].size;
+		if (variant.lossless_format != lossless_format)
+		{
+			continue;
+		}
+
+		if (lowest == 0)
+		{
+			lowest = variant.lossy_format;
+		}
+		if (variant.rate <= rate)
+		{
+			best = variant.lossy_format;
+		}
 	}
 
-	return 2;
+	return best != 0 ? best : lowest;
 }
 
-int setup_420_p(int width, int height, int fd_count, plane_info_t *plane)
+/*
+ * Total size of all planes of an Exynos YUV format, or 0 if the format has no
+ * layout.
+ */
+static constexpr uint64_t exynos_yuv_layout_size(uint32_t format, int width, int height, int fd_count)
 {
-	/* TODO: make this into an assert instead ? */
-	width = GRALLOC_ALIGN(width, 2);
-	height = GRALLOC_ALIGN(height, 2);
-
-	plane[0].size = PLANE_SIZE(width, height);
-	plane[0].alloc_width = width;
-	plane[0].alloc_height = height;
-	plane[0].byte_stride = width;
-	plane[0].fd_idx = 0;
-
-	int chroma_width = GRALLOC_ALIGN(width / 2, 16);
-	int chroma_height = height / 2;
-
-	plane[1].size = PLANE_SIZE(chroma_width, chroma_height);
-	plane[1].alloc_width = chroma_width;
-	plane[1].alloc_height = chroma_height;
-	plane[1].byte_stride = chroma_width;
-
-	plane[2].size = PLANE_SIZE(chroma_width, chroma_height);
-	plane[2].alloc_width = chroma_width;
-	plane[2].alloc_height = chroma_height;
-	plane[2].byte_stride = chroma_width;
-
-	if (fd_count > 1)
+	const yuv_format_layout *entry = find_exynos_yuv_layout(format);
+	if (entry == nullptr)
 	{
-		plane[1].fd_idx = 1;
-		plane[2].fd_idx = 2;
+		return 0;
 	}
-	else
+
+	const yuv_layout layout = compute_yuv_layout(entry->params,
+	                                             GRALLOC_ALIGN(width, entry->align_w),
+	                                             GRALLOC_ALIGN(height, entry->align_h),
+	                                             fd_count);
+	uint64_t size = 0;
+	for (int pidx = 0; pidx < layout.num_planes; pidx++)
 	{
-		plane[1].fd_idx = 0;
-		plane[2].fd_idx = 0;
-		plane[1].offset = plane[0].size;
-		plane[2].offset = plane[0].size + plane[1].size;
+		size += layout.plane[pidx].size;
 	}
 
-	return 3;
+	return size;
 }
 
-int setup_420_sp_tiled(int width, int height, int fd_count, plane_info_t *plane)
+/*
+ * Sets up the planes of an Exynos YUV format from its layout table entry and
+ * returns the plane count, or -1 if the format has no layout.
+ */
+inline int setup_exynos_yuv_layout(uint32_t format, int width, int height, int fd_count, plane_info_t *plane)
 {
-	/* TODO: make this into an assert instead ? */
-	width = GRALLOC_ALIGN(width, 2);
-	height = GRALLOC_ALIGN(height, 2);
-
-	plane[0].size = PLANE_SIZE(width, height);
-	plane[0].alloc_width = width;
-	plane[0].alloc_height = height;
-	plane[0].byte_stride = width * 16;
-	plane[0].fd_idx = 0;
-
-	int chroma_width = width;
-	int chroma_height = GRALLOC_ALIGN(height / 2, 32);
+	const yuv_format_layout *entry = find_exynos_yuv_layout(format);
+	if (entry == nullptr)
+	{
+		return -1;
+	}
 
-	plane[1].size = PLANE_SIZE(chroma_width, chroma_height);
-	plane[1].alloc_width = chroma_width;
-	plane[1].alloc_height = chroma_height;
-	plane[1].byte_stride = chroma_width * 16;
+	const yuv_layout layout = compute_yuv_layout(entry->params,
+	                                             GRALLOC_ALIGN(width, entry->align_w),
+	                                             GRALLOC_ALIGN(height, entry->align_h),
+	                                             fd_count);
 
-	if (fd_count > 1)
+	uint64_t offset = 0;
+	for (int pidx = 0; pidx < layout.num_planes; pidx++)
 	{
-		plane[1].fd_idx = 1;
+		plane[pidx].size = layout.plane[pidx].size;
+		plane[pidx].alloc_width = layout.plane[pidx].alloc_width;
+		plane[pidx].alloc_height = layout.plane[pidx].alloc_height;
+		plane[pidx].byte_stride = layout.plane[pidx].byte_stride;
+
+		if (fd_count > 1)
+		{
+			plane[pidx].fd_idx = pidx;
+		}
+		else
+		{
+			plane[pidx].fd_idx = 0;
+			plane[pidx].offset = offset;
+			offset += layout.plane[pidx].size;
+		}
 	}
-	else
+
+	if (entry->params.kind == yuv_layout_kind::SBWC || entry->params.kind == yuv_layout_kind::SBWC_LOSSY)
 	{
-		plane[1].fd_idx = 0;
-		plane[1].offset = plane[0].size;
+		MALI_GRALLOC_LOGV("SBWC luma size 0x%" PRIx64 ", chroma size 0x%" PRIx64,
+		                  layout.plane[0].size, layout.plane[1].size);
 	}
 
-	return 3;
+	return layout.plane_count;
 }
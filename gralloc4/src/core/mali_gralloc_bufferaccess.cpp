@@ -18,13 +18,17 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <inttypes.h>
+#include <map>
+#include <optional>
 /* For error codes. */
 #include <hardware/gralloc1.h>
 
 #include "mali_gralloc_buffer.h"
 #include "mali_gralloc_formats.h"
 #include "mali_gralloc_usages.h"
+#include "mali_gralloc_bufferallocation.h"
 #include "mali_gralloc_reference.h"
+#include "mali_gralloc_fingerprint.h"
 #include "allocator/mali_gralloc_ion.h"
 #include "gralloc_helper.h"
 #include "format_info.h"
@@ -61,8 +65,34 @@ static enum tx_direction get_tx_direction(const uint64_t usage)
 	return dir;
 }
 
+#if defined(GRALLOC_ION_SYNC_ON_LOCK) && GRALLOC_ION_SYNC_ON_LOCK == 1
+/*
+ * Layer whose range this thread synced at lock, so that unlock ends the same range. Keyed by
+ * backing store id, so a handle freed while locked cannot pass its layer to a later handle at the
+ * same address. Entries of buffers unlocked from another thread are never taken back; the map is
+ * cleared when it grows past MAX_SYNCED_LAYERS, and a missing entry only makes unlock end the
+ * whole buffer.
+ */
+#define MAX_SYNCED_LAYERS 64
+static thread_local std::map<uint64_t, uint32_t> synced_layers;
+
+static int buffer_sync_layer(const private_handle_t * const hnd, const int32_t layer,
+                             const bool read, const bool write, const bool start)
+{
+	if (layer < 0)
+	{
+		return start ? mali_gralloc_ion_sync_start(hnd, read, write)
+		             : mali_gralloc_ion_sync_end(hnd, read, write);
+	}
+
+	const uint64_t layer_size = mali_gralloc_get_layer_size(hnd);
+	return mali_gralloc_ion_sync_range(hnd, layer * layer_size, layer_size, read, write, start);
+}
+#endif
+
 static void buffer_sync(private_handle_t * const hnd,
-                        const enum tx_direction direction)
+                        const enum tx_direction direction,
+                        const int32_t layer = -1)
 {
 	if (direction != TX_NONE)
 	{
@@ -70,21 +100,42 @@ static void buffer_sync(private_handle_t * const hnd,
 		hnd->cpu_write = (direction == TX_TO_DEVICE || direction == TX_BOTH) ? 1 : 0;
 
 #if defined(GRALLOC_ION_SYNC_ON_LOCK) && GRALLOC_ION_SYNC_ON_LOCK == 1
-		const int status = mali_gralloc_ion_sync_start(hnd,
-		                                               hnd->cpu_read ? true : false,
-		                                               hnd->cpu_write ? true : false);
+		const int status = buffer_sync_layer(hnd, layer,
+		                                     hnd->cpu_read ? true : false,
+		                                     hnd->cpu_write ? true : false, true);
 		if (status < 0)
 		{
 			return;
 		}
+		if (layer < 0)
+		{
+			synced_layers.erase(hnd->backing_store_id);
+		}
+		else
+		{
+			if (synced_layers.size() >= MAX_SYNCED_LAYERS)
+			{
+				synced_layers.clear();
+			}
+			synced_layers[hnd->backing_store_id] = layer;
+		}
 #endif
 	}
 	else if (hnd->cpu_read || hnd->cpu_write)
 	{
 #if defined(GRALLOC_ION_SYNC_ON_LOCK) && GRALLOC_ION_SYNC_ON_LOCK == 1
-		const int status = mali_gralloc_ion_sync_end(hnd,
-		                                             hnd->cpu_read ? true : false,
-		                                             hnd->cpu_write ? true : false);
+		/* Unlocks from another thread do not know the layer and end the whole buffer */
+		int32_t synced_layer = -1;
+		auto it = synced_layers.find(hnd->backing_store_id);
+		if (it != synced_layers.end())
+		{
+			synced_layer = it->second;
+			synced_layers.erase(it);
+		}
+
+		const int status = buffer_sync_layer(hnd, synced_layer,
+		                                     hnd->cpu_read ? true : false,
+		                                     hnd->cpu_write ? true : false, false);
 		if (status < 0)
 		{
 			return;
@@ -221,29 +272,119 @@ int mali_gralloc_lock(buffer_handle_t buffer,
 			return -EINVAL;
 		}
 
-		if (mali_gralloc_reference_map(buffer) != 0) {
-			return -EINVAL;
+		/* Map only the layer this thread selected with GchipsMetadataType::LOCK_LAYER, if any */
+		int32_t layer = mali_gralloc_reference_take_lock_layer(buffer);
+		const bool view = (hnd->flags & private_handle_t::PRIV_FLAGS_VIEW) != 0;
+		if (view)
+		{
+			/* A view has a single layer and is reached through the whole mapping */
+			layer = -1;
+		}
+		std::optional<void*> buf_addr;
+		if (layer >= 0)
+		{
+			if (mali_gralloc_reference_map_layer(buffer, layer) != 0) {
+				return -EINVAL;
+			}
+			buf_addr = mali_gralloc_reference_get_layer_addr(buffer, layer);
+		}
+		else
+		{
+			if (mali_gralloc_reference_map(buffer) != 0) {
+				return -EINVAL;
+			}
+			buf_addr = mali_gralloc_reference_get_buf_addr(buffer, view ? hnd->plane_info[0].fd_idx : 0);
 		}
-
-		std::optional<void*> buf_addr = mali_gralloc_reference_get_buf_addr(buffer);
 		if (!buf_addr.has_value()) {
 			MALI_GRALLOC_LOGE("BUG: Invalid buffer address on a just mapped buffer");
 			return -EINVAL;
 		}
 		*vaddr = buf_addr.value();
 
-		buffer_sync(hnd, get_tx_direction(usage));
+		/* A view shares the dmabufs of its parent; return its first pixel, not the dmabuf start */
+		if (view)
+		{
+			*vaddr = static_cast<uint8_t *>(*vaddr) + hnd->plane_info[0].offset;
+		}
+
+		/* Unlock fingerprints every layer, so the CPU must own all of them */
+		const bool fingerprint = (hnd->get_usage() & GRALLOC_USAGE_CONTENT_FINGERPRINT) != 0;
+		buffer_sync(hnd, get_tx_direction(usage), fingerprint ? -1 : layer);
+
+		/* Remember what the CPU may write, published as the dirty region at unlock.
+		 * An empty or unchecked (blob) access region may cover the whole buffer.
+		 */
+		if (usage & GRALLOC_USAGE_SW_WRITE_MASK)
+		{
+			ARect region = { l, t, l + w, t + h };
+			if (w == 0 || h == 0 || hnd->get_alloc_format() == HAL_PIXEL_FORMAT_BLOB)
+			{
+				region = { 0, 0, hnd->width, hnd->height };
+			}
+			mali_gralloc_reference_add_write_region(buffer, region);
+		}
 	}
 
 	return 0;
 }
 
 
+/*
+ * Fingerprints the pixel data of every plane and layer of a mapped buffer.
+ * Returns std::nullopt if the buffer is not mapped in this process.
+ */
+static std::optional<uint64_t> fingerprint_buffer(const private_handle_t *hnd)
+{
+	const buffer_handle_t handle = hnd;
+	const uint32_t layer_count = hnd->layer_count > 0 ? hnd->layer_count : 1;
+	uint64_t h = 0;
+
+	for (int pidx = 0; pidx < MAX_PLANES && hnd->plane_info[pidx].byte_stride > 0; pidx++)
+	{
+		const plane_info_t &plane = hnd->plane_info[pidx];
+		/* Only the Exynos YUV layouts fill in the plane size */
+		const uint64_t plane_size = plane.size > 0 ? plane.size
+		                                           : static_cast<uint64_t>(plane.byte_stride) * plane.alloc_height;
+		if (plane.fd_idx >= MAX_BUFFER_FDS)
+		{
+			return std::nullopt;
+		}
+
+		std::optional<void *> base = mali_gralloc_reference_get_buf_addr(handle, plane.fd_idx);
+		if (!base.has_value())
+		{
+			return std::nullopt;
+		}
+
+		/* Padding between and after planes is not part of the content */
+		const uint64_t alloc_size = hnd->alloc_sizes[plane.fd_idx];
+		const uint64_t layer_size = plane.fd_idx == 0 ? mali_gralloc_get_layer_size(hnd)
+		                                              : alloc_size / layer_count;
+		for (uint32_t layer = 0; layer < layer_count; layer++)
+		{
+			const uint64_t offset = plane.offset + layer * layer_size;
+			if (offset + plane_size > alloc_size)
+			{
+				break;
+			}
+			h = mali_gralloc_fingerprint(static_cast<uint8_t *>(base.value()) + offset, plane_size, h);
+		}
+	}
+
+	return h != MALI_GRALLOC_FINGERPRINT_UNKNOWN ? h : ~MALI_GRALLOC_FINGERPRINT_UNKNOWN;
+}
+
+
 /*
  *  Unlocks the given buffer.
  *
  * @param m           [in]   Gralloc module.
  * @param buffer      [in]   The buffer to unlock.
+ * @param fingerprint [out]  Optional. Set to the content fingerprint, or to
+ *                           MALI_GRALLOC_FINGERPRINT_UNKNOWN if it could not
+ *                           be taken, when the buffer has
+ *                           GRALLOC_USAGE_CONTENT_FINGERPRINT and was locked
+ *                           for CPU write.
  *
  * @return 0, when the locking is successful;
  *         Appropriate error, otherwise
@@ -253,7 +394,7 @@ int mali_gralloc_lock(buffer_handle_t buffer,
  *       recognize erroneous conditions, it is expected of client to adhere to API
  *       call sequence
  */
-int mali_gralloc_unlock(buffer_handle_t buffer)
+int mali_gralloc_unlock(buffer_handle_t buffer, std::optional<uint64_t> *fingerprint)
 {
 	if (private_handle_t::validate(buffer) < 0)
 	{
@@ -262,6 +403,27 @@ int mali_gralloc_unlock(buffer_handle_t buffer)
 	}
 
 	private_handle_t *hnd = (private_handle_t *)buffer;
+
+	/* Hash while the CPU still owns the buffer, before the caches are handed back.
+	 * The fingerprint covers all layers, so a single layer lock of a fingerprinted
+	 * buffer still maps the whole buffer here and syncs all of it at lock.
+	 */
+	if (fingerprint != nullptr && hnd->cpu_write &&
+	    (hnd->get_usage() & GRALLOC_USAGE_CONTENT_FINGERPRINT))
+	{
+		/* The CPU may have written, so a stale fingerprint must not survive a failure */
+		std::optional<uint64_t> h;
+		if (mali_gralloc_reference_map(buffer) == 0)
+		{
+			h = fingerprint_buffer(hnd);
+		}
+		if (!h.has_value())
+		{
+			MALI_GRALLOC_LOGW("Could not fingerprint buffer %p, publishing unknown content", buffer);
+		}
+		*fingerprint = h.value_or(MALI_GRALLOC_FINGERPRINT_UNKNOWN);
+	}
+
 	buffer_sync(hnd, TX_NONE);
 
 	return 0;
@@ -19,13 +19,15 @@
 #ifndef MALI_GRALLOC_BUFFERACCESS_H_
 #define MALI_GRALLOC_BUFFERACCESS_H_
 
+#include <optional>
+
 #include "gralloc_priv.h"
 
 int mali_gralloc_lock(buffer_handle_t buffer, uint64_t usage, int l, int t, int w, int h,
                       void **vaddr);
 int mali_gralloc_lock_ycbcr(buffer_handle_t buffer, uint64_t usage, int l, int t, int w,
                             int h, android_ycbcr *ycbcr);
-int mali_gralloc_unlock(buffer_handle_t buffer);
+int mali_gralloc_unlock(buffer_handle_t buffer, std::optional<uint64_t> *fingerprint = nullptr);
 
 int mali_gralloc_get_num_flex_planes(buffer_handle_t buffer, uint32_t *num_planes);
 int mali_gralloc_lock_flex(buffer_handle_t buffer, uint64_t usage, int l, int t,
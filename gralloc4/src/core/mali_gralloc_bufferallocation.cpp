@@ -25,6 +25,7 @@
 #include <set>
 #include <utils/Trace.h>
 
+#include <cutils/properties.h>
 #include <hardware/hardware.h>
 #include <hardware/gralloc1.h>
 
@@ -56,16 +57,6 @@
 /* Realign YV12 format so that chroma stride is half of luma stride */
 #define REALIGN_YV12 1
 
-/* TODO: set S10B format align in BoardConfig.mk */
-#define BOARD_EXYNOS_S10B_FORMAT_ALIGN 64
-#if 0
-ifeq ($(BOARD_EXYNOS_S10B_FORMAT_ALIGN), 64)
-LOCAL_CFLAGS += -DBOARD_EXYNOS_S10B_FORMAT_ALIGN=$(BOARD_EXYNOS_S10B_FORMAT_ALIGN)
-else
-LOCAL_CFLAGS += -DBOARD_EXYNOS_S10B_FORMAT_ALIGN=16
-endif
-#endif
-
 #define AFBC_PIXELS_PER_BLOCK 256
 #define AFBC_HEADER_BUFFER_BYTES_PER_BLOCKENTRY 16
 
@@ -807,112 +798,13 @@ static int prepare_descriptor_exynos_formats(
 		bufDescriptor->consumer_usage |= GRALLOC_USAGE_VIDEO_PRIVATE_DATA;
 	}
 
-	/* SWBC Formats have special size requirements */
-	switch (format)
+	/* Plane geometry, including the special SBWC size requirements, comes from the layout table */
+	plane_count = setup_exynos_yuv_layout(format, w, h, fd_count, bufDescriptor->plane_info);
+	if (plane_count < 0)
 	{
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_SBWC:
-		case HAL_PIXEL_FORMAT_EXYNOS_YCrCb_420_SP_M_SBWC:
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_SBWC:
-			plane_count = setup_sbwc_420_sp(w, h, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC:
-		case HAL_PIXEL_FORMAT_EXYNOS_YCrCb_420_SP_M_10B_SBWC:
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC:
-			plane_count = setup_sbwc_420_sp_10bit(w, h, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_SBWC_L50:
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_SBWC_L50:
-			plane_count = setup_sbwc_420_sp_lossy(w, h, 50, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_SBWC_L75:
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_SBWC_L75:
-			plane_count = setup_sbwc_420_sp_lossy(w, h, 75, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC_L40:
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC_L40:
-			plane_count = setup_sbwc_420_sp_10bit_lossy(w, h, 40, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC_L60:
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC_L60:
-			plane_count = setup_sbwc_420_sp_10bit_lossy(w, h, 60, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC_L80:
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC_L80:
-			plane_count = setup_sbwc_420_sp_10bit_lossy(w, h, 80, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_YCrCb_420_SP:
-			h = GRALLOC_ALIGN(h, 2);
-			plane_count = setup_420_sp(w, h, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_EXYNOS_YV12_M:
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_P_M:
-			w = GRALLOC_ALIGN(w, 32);
-			h = GRALLOC_ALIGN(h, 16);
-			plane_count = setup_420_p(w, h, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_TILED:
-			w = GRALLOC_ALIGN(w, 16);
-			h = GRALLOC_ALIGN(h, 32);
-			plane_count = setup_420_sp_tiled(w, h, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_P:
-			w = GRALLOC_ALIGN(w, 16);
-			plane_count = setup_420_p(w, h, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_EXYNOS_YCrCb_420_SP_M:
-		case HAL_PIXEL_FORMAT_EXYNOS_YCrCb_420_SP_M_FULL:
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M:
-			w = GRALLOC_ALIGN(w, 16);
-			h = GRALLOC_ALIGN(h, 32);
-			plane_count = setup_420_sp(w, h, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN:
-			w = GRALLOC_ALIGN(w, 64);
-			h = GRALLOC_ALIGN(h, 16);
-			plane_count = setup_420_sp(w, h, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_S10B:
-			/* This is 64 pixel align for now */
-			w = GRALLOC_ALIGN(w, BOARD_EXYNOS_S10B_FORMAT_ALIGN);
-			h = GRALLOC_ALIGN(h, 16);
-			plane_count = setup_420_sp_s10b(w, h, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_S10B:
-			w = GRALLOC_ALIGN(w, BOARD_EXYNOS_S10B_FORMAT_ALIGN);
-			h = GRALLOC_ALIGN(h, 16);
-			plane_count = setup_420_sp_s10b(w, h, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_P010_M:
-			w = GRALLOC_ALIGN(w, 16);
-			h = GRALLOC_ALIGN(h, 16);
-			plane_count = setup_p010_sp(w, h, fd_count, bufDescriptor->plane_info);
-			break;
-
-		case HAL_PIXEL_FORMAT_EXYNOS_YCbCr_P010_SPN:
-			w = GRALLOC_ALIGN(w, 64);
-			h = GRALLOC_ALIGN(h, 16);
-			plane_count = setup_p010_sp(w, h, fd_count, bufDescriptor->plane_info);
-			break;
-
-		default:
-			MALI_GRALLOC_LOGE("invalid yuv format (%s %" PRIx64 ")", format_name(bufDescriptor->alloc_format),
-				bufDescriptor->alloc_format);
-			return -1;
+		MALI_GRALLOC_LOGE("invalid yuv format (%s %" PRIx64 ")", format_name(bufDescriptor->alloc_format),
+			bufDescriptor->alloc_format);
+		return -1;
 	}
 
 	plane_info_t *plane = bufDescriptor->plane_info;
@@ -982,6 +874,148 @@ static int prepare_descriptor_exynos_formats(
 	return 0;
 }
 
+/*
+ * Lossy SBWC auto-selection.
+ *
+ * mali_gralloc_select_format() only resolves to lossless SBWC for
+ * IMPLEMENTATION_DEFINED buffers that the camera produces for MFC alone. Such
+ * a buffer may instead be allocated in a lossy SBWC format when:
+ * - a lossy rate is configured for camera buffers,
+ * - no other user needs the exact pixel values (CPU, GPU, camera reprocessing),
+ * - the bandwidth of this one buffer, lossless size times frame rate, exceeds
+ *   the threshold. The allocator frees its handles once they are returned, so
+ *   it cannot account for the buffers that are alive across the device.
+ *
+ * The policy is configured with these properties and is disabled unless a threshold is set:
+ * ro.vendor.gralloc.sbwc_lossy.buffer_mbps  Per buffer bandwidth in MB/s above which it is made lossy.
+ * ro.vendor.gralloc.sbwc_lossy.fps          Frame rate assumed when estimating bandwidth.
+ * ro.vendor.gralloc.sbwc_lossy.camera_rate  Rate for camera buffers, 0 to never make them lossy.
+ */
+struct sbwc_lossy_policy
+{
+	uint64_t buffer_bytes_per_sec;
+	uint32_t fps;
+	uint8_t camera_rate;
+};
+
+static const sbwc_lossy_policy &get_sbwc_lossy_policy()
+{
+	static const sbwc_lossy_policy policy = []() {
+		sbwc_lossy_policy p{};
+		p.buffer_bytes_per_sec =
+			static_cast<uint64_t>(std::max(0, property_get_int32("ro.vendor.gralloc.sbwc_lossy.buffer_mbps", 0))) << 20;
+		p.fps = std::max(1, property_get_int32("ro.vendor.gralloc.sbwc_lossy.fps", 30));
+		p.camera_rate = static_cast<uint8_t>(
+			std::clamp(property_get_int32("ro.vendor.gralloc.sbwc_lossy.camera_rate", 50), 0, 100));
+		return p;
+	}();
+
+	return policy;
+}
+
+/*
+ * Returns the lossy SBWC format the buffer should be allocated with instead of
+ * base_format, or base_format if the policy does not apply.
+ */
+static uint32_t apply_sbwc_lossy_policy(const buffer_descriptor_t *bufDescriptor, uint32_t base_format,
+                                        uint64_t usage)
+{
+	const sbwc_lossy_policy &policy = get_sbwc_lossy_policy();
+	if (policy.buffer_bytes_per_sec == 0 || policy.camera_rate == 0)
+	{
+		return base_format;
+	}
+
+	/* Only buffers whose format gralloc picked on behalf of the client. */
+	if (bufDescriptor->hal_format != HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED ||
+	    !is_sbwc_format(base_format) || !(usage & GRALLOC_USAGE_HW_CAMERA_WRITE))
+	{
+		return base_format;
+	}
+
+	const uint64_t lossless_users = GRALLOC_USAGE_SW_READ_MASK | GRALLOC_USAGE_SW_WRITE_MASK |
+	                                GRALLOC_USAGE_HW_CAMERA_READ | GRALLOC_USAGE_PROTECTED;
+	if (usage & lossless_users)
+	{
+		return base_format;
+	}
+
+	const uint32_t lossy_format = find_sbwc_lossy_variant(base_format, policy.camera_rate);
+	if (lossy_format == 0)
+	{
+		return base_format;
+	}
+
+	const uint64_t frame_bytes = exynos_yuv_layout_size(base_format, bufDescriptor->width, bufDescriptor->height,
+	                                                    get_exynos_fd_count(base_format)) *
+	                             std::max(bufDescriptor->layer_count, 1u);
+	if (frame_bytes * policy.fps <= policy.buffer_bytes_per_sec)
+	{
+		return base_format;
+	}
+
+	MALI_GRALLOC_LOGV("SBWC lossy policy: (%s 0x%" PRIx32 ") -> (%s 0x%" PRIx32 ") for %ux%u, "
+	                  "size %" PRIu64 " -> %" PRIu64,
+	                  format_name(base_format), base_format, format_name(lossy_format), lossy_format,
+	                  bufDescriptor->width, bufDescriptor->height, frame_bytes,
+	                  exynos_yuv_layout_size(lossy_format, bufDescriptor->width, bufDescriptor->height,
+	                                         get_exynos_fd_count(lossy_format)) *
+	                      std::max(bufDescriptor->layer_count, 1u));
+
+	return lossy_format;
+}
+
+bool mali_gralloc_get_sbwc_info(const private_handle_t *hnd, sbwc_info_t *info)
+{
+	const uint32_t format = hnd->alloc_format & MALI_GRALLOC_INTFMT_FMT_MASK;
+	if (!is_sbwc_format(format))
+	{
+		return false;
+	}
+
+	const yuv_format_layout *entry = find_exynos_yuv_layout(format);
+	if (entry == nullptr)
+	{
+		return false;
+	}
+
+	const yuv_layout layout = compute_yuv_layout(entry->params,
+	                                             GRALLOC_ALIGN(hnd->width, entry->align_w),
+	                                             GRALLOC_ALIGN(hnd->height, entry->align_h),
+	                                             get_exynos_fd_count(format));
+
+	*info = {};
+	info->lossy_rate = entry->params.lossy_rate;
+	info->bit_depth = entry->params.bit_depth;
+	for (int pidx = 0; pidx < 2; pidx++)
+	{
+		info->header_size[pidx] = layout.plane[pidx].header_size;
+		info->body_size[pidx] = layout.plane[pidx].size - layout.plane[pidx].header_size;
+		info->sbwc_size += layout.plane[pidx].size;
+	}
+
+	const uint32_t linear_format = entry->params.bit_depth == 8 ?
+		HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN : HAL_PIXEL_FORMAT_EXYNOS_YCbCr_P010_SPN;
+	info->linear_size = exynos_yuv_layout_size(linear_format, hnd->width, hnd->height, 1);
+
+	return true;
+}
+
+uint64_t mali_gralloc_get_layer_size(const private_handle_t *hnd)
+{
+	uint64_t size = hnd->alloc_sizes[0];
+
+	/* Undo the padding mali_gralloc_derive_format_and_size() adds after the last layer */
+	const uint64_t usage = hnd->get_usage();
+	if ((usage & GRALLOC_USAGE_HW_VIDEO_ENCODER) && (usage & GRALLOC_USAGE_GOOGLE_IP_BW))
+	{
+		size -= BW_EXT_SIZE;
+	}
+	size -= EXT_SIZE;
+
+	return size / std::max(hnd->layer_count, 1u);
+}
+
 int mali_gralloc_derive_format_and_size(buffer_descriptor_t * const bufDescriptor)
 {
 	ATRACE_CALL();
@@ -1001,6 +1035,13 @@ int mali_gralloc_derive_format_and_size(buffer_descriptor_t * const bufDescripto
 
 	int base_format = bufDescriptor->alloc_format & MALI_GRALLOC_INTFMT_FMT_MASK;
 
+	const uint32_t policy_format = apply_sbwc_lossy_policy(bufDescriptor, base_format, usage);
+	if (policy_format != static_cast<uint32_t>(base_format))
+	{
+		base_format = policy_format;
+		bufDescriptor->alloc_format = (bufDescriptor->alloc_format & ~MALI_GRALLOC_INTFMT_FMT_MASK) | policy_format;
+	}
+
 	// TODO(b/182885532): Delete all multi-fd related dead code from gralloc
 	if (is_exynos_format(base_format) && get_exynos_fd_count(base_format) != 1)
 	{
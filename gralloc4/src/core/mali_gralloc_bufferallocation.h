@@ -108,6 +108,36 @@ void init_afbc(uint8_t *buf, uint64_t internal_format, const bool is_multi_plane
 
 uint32_t lcm(uint32_t a, uint32_t b);
 
+/*
+ * SBWC compression figures of a buffer, for telemetry.
+ */
+struct sbwc_info_t
+{
+	/* Lossy compression rate, 0 for lossless SBWC */
+	uint32_t lossy_rate;
+	uint32_t bit_depth;
+	/* Per plane (luma, chroma) body and block header sizes */
+	uint64_t body_size[2];
+	uint64_t header_size[2];
+	/* Total plane bytes of the SBWC layout */
+	uint64_t sbwc_size;
+	/* Plane bytes of the equivalent linear NV12 (8-bit) or P010 (10-bit) layout */
+	uint64_t linear_size;
+};
+
+/*
+ * Fills in the SBWC figures of a buffer.
+ *
+ * @return true if the buffer uses an SBWC format; false otherwise.
+ */
+bool mali_gralloc_get_sbwc_info(const private_handle_t *hnd, sbwc_info_t *info);
+
+/*
+ * Size of one layer of a buffer, without the padding after the last layer.
+ * Layer n of a multi-layer buffer starts at n times this size in fds[0].
+ */
+uint64_t mali_gralloc_get_layer_size(const private_handle_t *hnd);
+
 bool get_alloc_type(const uint64_t format_ext,
                     const uint32_t format_idx,
                     const uint64_t usage,
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2020 ARM Limited. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string.h>
+
+#include "mali_gralloc_fingerprint.h"
+
+#define FP_STRIPE_SIZE 64
+#define FP_STRIPES_PER_BLOCK 16
+
+typedef uint64_t fp_vec __attribute__((vector_size(FP_STRIPE_SIZE)));
+
+static const uint64_t FP_PRIME32_1 = 0x9E3779B1ULL;
+static const uint64_t FP_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t FP_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t FP_PRIME64_3 = 0x165667B19E3779F9ULL;
+
+/* Per lane keys, from the xxHash default secret */
+static const fp_vec fp_key = {
+	0xbe4ba423396cfeb8ULL, 0x1cad21f72c81017cULL, 0xdb979083e96dd4deULL, 0x1f67b3b7a4a44072ULL,
+	0x78e5c0cc4ee679cbULL, 0x2172ffcc7dd05a82ULL, 0x8e2443f7744608b8ULL, 0x4c263a81e69035e0ULL,
+};
+
+static inline fp_vec fp_load(const uint8_t *p)
+{
+	fp_vec v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void fp_accumulate(fp_vec *acc, const uint8_t *p, uint64_t tweak)
+{
+	const fp_vec data = fp_load(p);
+	const fp_vec dk = data ^ (fp_key + tweak * FP_PRIME64_2);
+
+	*acc += __builtin_shufflevector(data, data, 1, 0, 3, 2, 5, 4, 7, 6);
+	*acc += (dk & 0xFFFFFFFFULL) * (dk >> 32);
+}
+
+static inline void fp_scramble(fp_vec *acc)
+{
+	*acc ^= *acc >> 47;
+	*acc ^= fp_key;
+	*acc *= FP_PRIME32_1;
+}
+
+static inline uint64_t fp_avalanche(uint64_t h)
+{
+	h ^= h >> 37;
+	h *= 0x165667919E3779F9ULL;
+	h ^= h >> 32;
+	return h;
+}
+
+uint64_t mali_gralloc_fingerprint(const void *data, size_t size, uint64_t seed)
+{
+	const uint8_t *p = static_cast<const uint8_t *>(data);
+	const size_t length = size;
+	fp_vec acc = { FP_PRIME32_1, FP_PRIME64_1, FP_PRIME64_2, FP_PRIME64_3,
+	               FP_PRIME64_1 ^ seed, FP_PRIME64_2 ^ seed, FP_PRIME64_3 ^ seed, FP_PRIME32_1 ^ seed };
+
+	while (size >= FP_STRIPE_SIZE * FP_STRIPES_PER_BLOCK)
+	{
+		for (int i = 0; i < FP_STRIPES_PER_BLOCK; i++)
+		{
+			fp_accumulate(&acc, p + i * FP_STRIPE_SIZE, i);
+		}
+		fp_scramble(&acc);
+		p += FP_STRIPE_SIZE * FP_STRIPES_PER_BLOCK;
+		size -= FP_STRIPE_SIZE * FP_STRIPES_PER_BLOCK;
+	}
+
+	for (uint64_t i = 0; size >= FP_STRIPE_SIZE; i++)
+	{
+		fp_accumulate(&acc, p, i);
+		p += FP_STRIPE_SIZE;
+		size -= FP_STRIPE_SIZE;
+	}
+
+	if (size > 0)
+	{
+		uint8_t last[FP_STRIPE_SIZE] = {};
+		memcpy(last, p, size);
+		fp_accumulate(&acc, last, FP_STRIPES_PER_BLOCK);
+	}
+
+	uint64_t h = length * FP_PRIME64_1 ^ seed;
+	for (int i = 0; i < 8; i++)
+	{
+		h ^= fp_avalanche(acc[i] * FP_PRIME64_2);
+		h = ((h << 27) | (h >> 37)) * FP_PRIME64_1 + FP_PRIME64_3;
+	}
+
+	return fp_avalanche(h);
+}
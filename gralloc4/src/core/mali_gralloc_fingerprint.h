@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2020 ARM Limited. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MALI_GRALLOC_FINGERPRINT_H_
+#define MALI_GRALLOC_FINGERPRINT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Hashes size bytes at data. XXH3-style: 64 byte stripes feed eight 64-bit
+ * lanes with 32x32->64 multiplies, which compile to vector code (UMULL on
+ * arm64, PMULUDQ on x86) without intrinsics. Not compatible with xxHash;
+ * only compare fingerprints produced by this function.
+ */
+uint64_t mali_gralloc_fingerprint(const void *data, size_t size, uint64_t seed);
+
+/*
+ * Published instead of a fingerprint when the content could not be hashed.
+ * Consumers must treat it as changed content; no fingerprint takes this value.
+ */
+#define MALI_GRALLOC_FINGERPRINT_UNKNOWN UINT64_C(0)
+
+#endif /* MALI_GRALLOC_FINGERPRINT_H_ */
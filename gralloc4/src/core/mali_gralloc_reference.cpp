@@ -24,9 +24,11 @@
 #include <algorithm>
 #include <map>
 #include <mutex>
+#include <utility>
 
 #include "allocator/mali_gralloc_ion.h"
 #include "mali_gralloc_buffer.h"
+#include "mali_gralloc_bufferallocation.h"
 
 class BufferManager {
 private:
@@ -42,6 +44,18 @@ private:
         size_t metadata_size;
 
         uint64_t ref_count = 0;
+
+        // Union of the CPU write lock regions not yet published to the shared metadata
+        std::optional<ARect> write_region;
+
+        // Mappings of single layers, only made while the whole buffer is unmapped
+        struct LayerMapping {
+            void *base;
+            uint64_t size;
+            // From base to the first byte of the layer, which need not be page aligned
+            uint64_t delta;
+        };
+        std::map<uint32_t, LayerMapping> layer_maps;
     };
 
     BufferManager() = default;
@@ -49,6 +63,15 @@ private:
     std::mutex lock;
     std::map<const private_handle_t *, std::unique_ptr<MappedData>> buffer_map GUARDED_BY(lock);
 
+    // Layer selected for the next CPU lock of a buffer on this thread. The backing store id
+    // keeps a selection left by a thread that never locked from applying to a later handle
+    // at the same address.
+    struct LockLayer {
+        uint64_t backing_store_id;
+        int32_t layer;
+    };
+    static inline thread_local std::map<const private_handle_t *, LockLayer> lock_layers;
+
     static off_t get_buffer_size(unsigned int fd) {
         off_t current = lseek(fd, 0, SEEK_CUR);
         off_t size = lseek(fd, 0, SEEK_END);
@@ -132,6 +155,46 @@ private:
         return true;
     }
 
+    bool map_layer_locked(buffer_handle_t handle, uint32_t layer) REQUIRES(lock) {
+        auto data_oe = get_validated_data_locked(handle);
+        if (!data_oe.has_value()) {
+            return false;
+        }
+        MappedData &data = data_oe.value();
+
+        // Return early if the whole buffer or this layer is already mapped
+        if (data.bases[0] != nullptr || data.layer_maps.count(layer) != 0) {
+            return true;
+        }
+
+        if (!dmabuf_sanity_check(handle)) {
+            return false;
+        }
+
+        private_handle_t *hnd =
+                reinterpret_cast<private_handle_t *>(const_cast<native_handle *>(handle));
+        if (layer >= std::max(hnd->layer_count, 1u)) {
+            MALI_GRALLOC_LOGE("%s: layer %u out of range", __func__, layer);
+            return false;
+        }
+
+        // mmap needs a page aligned offset, layers are only aligned to the stride
+        const uint64_t layer_size = mali_gralloc_get_layer_size(hnd);
+        const uint64_t offset = layer * layer_size;
+        const uint64_t map_offset = offset & ~static_cast<uint64_t>(PAGE_SIZE - 1);
+
+        MappedData::LayerMapping mapping;
+        mapping.size = offset + layer_size - map_offset;
+        mapping.delta = offset - map_offset;
+        mapping.base = mali_gralloc_ion_map_range(hnd, 0, map_offset, mapping.size);
+        if (mapping.base == nullptr) {
+            return false;
+        }
+
+        data.layer_maps.emplace(layer, mapping);
+        return true;
+    }
+
     bool map_metadata_locked(buffer_handle_t handle) REQUIRES(lock) {
         auto data_oe = get_validated_data_locked(handle);
         if (!data_oe.has_value()) {
@@ -284,6 +347,11 @@ public:
                 mali_gralloc_ion_unmap(hnd, data.bases);
             }
 
+            for (const auto &[layer, mapping] : data.layer_maps) {
+                mali_gralloc_ion_unmap_range(mapping.base, mapping.size);
+            }
+            lock_layers.erase(hnd);
+
             if (data.metadata_vaddr != nullptr) {
                 munmap(data.metadata_vaddr, data.metadata_size);
                 data.metadata_vaddr = nullptr;
@@ -305,9 +373,13 @@ public:
         return 0;
     }
 
-    std::optional<void *> get_buf_addr(buffer_handle_t handle) {
+    std::optional<void *> get_buf_addr(buffer_handle_t handle, uint32_t fd_idx) {
         std::lock_guard<std::mutex> _l(lock);
 
+        if (fd_idx >= MAX_BUFFER_FDS) {
+            return {};
+        }
+
         auto data_oe = get_validated_data_locked(handle);
         if (!data_oe.has_value()) {
             return {};
@@ -319,7 +391,85 @@ public:
             return {};
         }
 
-        return data.bases[0];
+        if (data.bases[fd_idx] == nullptr) {
+            MALI_GRALLOC_LOGE("%s: buffer has no fd %u", __FUNCTION__, fd_idx);
+            return {};
+        }
+
+        return data.bases[fd_idx];
+    }
+
+    int map_layer(buffer_handle_t handle, uint32_t layer) EXCLUDES(lock) {
+        std::lock_guard<std::mutex> _l(lock);
+        if (!map_layer_locked(handle, layer)) {
+            return -EINVAL;
+        }
+
+        return 0;
+    }
+
+    std::optional<void *> get_layer_addr(buffer_handle_t handle, uint32_t layer) {
+        std::lock_guard<std::mutex> _l(lock);
+
+        auto data_oe = get_validated_data_locked(handle);
+        if (!data_oe.has_value()) {
+            return {};
+        }
+        MappedData &data = data_oe.value();
+
+        const auto *hnd = reinterpret_cast<const private_handle_t *>(handle);
+        if (data.bases[0] != nullptr) {
+            return static_cast<uint8_t *>(data.bases[0]) + layer * mali_gralloc_get_layer_size(hnd);
+        }
+
+        auto it = data.layer_maps.find(layer);
+        if (it == data.layer_maps.end()) {
+            MALI_GRALLOC_LOGE("BUG: Called %s for an un-mapped layer %u", __FUNCTION__, layer);
+            return {};
+        }
+
+        return static_cast<uint8_t *>(it->second.base) + it->second.delta;
+    }
+
+    int set_lock_layer(buffer_handle_t handle, int32_t layer) EXCLUDES(lock) {
+        {
+            std::lock_guard<std::mutex> _l(lock);
+            if (!get_validated_data_locked(handle).has_value()) {
+                return -EINVAL;
+            }
+        }
+
+        // Only fds[0] holds the layers
+        const auto *hnd = reinterpret_cast<const private_handle_t *>(handle);
+        if (layer < -1 || (layer >= 0 && (static_cast<uint32_t>(layer) >= hnd->layer_count ||
+                                          hnd->fd_count != 1))) {
+            MALI_GRALLOC_LOGE("%s: invalid layer %d (layer_count %u, fd_count %d)", __FUNCTION__,
+                              layer, hnd->layer_count, hnd->fd_count);
+            return -EINVAL;
+        }
+
+        if (layer < 0) {
+            lock_layers.erase(hnd);
+        } else {
+            lock_layers[hnd] = {hnd->backing_store_id, layer};
+        }
+        return 0;
+    }
+
+    int32_t get_lock_layer(buffer_handle_t handle) {
+        const auto *hnd = reinterpret_cast<const private_handle_t *>(handle);
+        auto it = lock_layers.find(hnd);
+        if (it == lock_layers.end() || it->second.backing_store_id != hnd->backing_store_id) {
+            return -1;
+        }
+
+        return it->second.layer;
+    }
+
+    int32_t take_lock_layer(buffer_handle_t handle) {
+        const int32_t layer = get_lock_layer(handle);
+        lock_layers.erase(reinterpret_cast<const private_handle_t *>(handle));
+        return layer;
     }
 
     std::optional<void *> get_metadata_addr(buffer_handle_t handle) {
@@ -339,6 +489,40 @@ public:
 
         return data.metadata_vaddr;
     }
+
+    int add_write_region(buffer_handle_t handle, const ARect &region) EXCLUDES(lock) {
+        std::lock_guard<std::mutex> _l(lock);
+
+        auto data_oe = get_validated_data_locked(handle);
+        if (!data_oe.has_value()) {
+            return -EINVAL;
+        }
+        MappedData &data = data_oe.value();
+
+        if (!data.write_region.has_value()) {
+            data.write_region = region;
+        } else {
+            ARect &r = data.write_region.value();
+            r.left = std::min(r.left, region.left);
+            r.top = std::min(r.top, region.top);
+            r.right = std::max(r.right, region.right);
+            r.bottom = std::max(r.bottom, region.bottom);
+        }
+
+        return 0;
+    }
+
+    std::optional<ARect> take_write_region(buffer_handle_t handle) EXCLUDES(lock) {
+        std::lock_guard<std::mutex> _l(lock);
+
+        auto data_oe = get_validated_data_locked(handle);
+        if (!data_oe.has_value()) {
+            return {};
+        }
+        MappedData &data = data_oe.value();
+
+        return std::exchange(data.write_region, std::nullopt);
+    }
 };
 
 int mali_gralloc_reference_retain(buffer_handle_t handle) {
@@ -357,10 +541,38 @@ int mali_gralloc_reference_validate(buffer_handle_t handle) {
     return BufferManager::getInstance().validate(handle);
 }
 
-std::optional<void *> mali_gralloc_reference_get_buf_addr(buffer_handle_t handle) {
-    return BufferManager::getInstance().get_buf_addr(handle);
+std::optional<void *> mali_gralloc_reference_get_buf_addr(buffer_handle_t handle, uint32_t fd_idx) {
+    return BufferManager::getInstance().get_buf_addr(handle, fd_idx);
+}
+
+int mali_gralloc_reference_map_layer(buffer_handle_t handle, uint32_t layer) {
+    return BufferManager::getInstance().map_layer(handle, layer);
+}
+
+std::optional<void *> mali_gralloc_reference_get_layer_addr(buffer_handle_t handle, uint32_t layer) {
+    return BufferManager::getInstance().get_layer_addr(handle, layer);
+}
+
+int mali_gralloc_reference_set_lock_layer(buffer_handle_t handle, int32_t layer) {
+    return BufferManager::getInstance().set_lock_layer(handle, layer);
+}
+
+int32_t mali_gralloc_reference_get_lock_layer(buffer_handle_t handle) {
+    return BufferManager::getInstance().get_lock_layer(handle);
+}
+
+int32_t mali_gralloc_reference_take_lock_layer(buffer_handle_t handle) {
+    return BufferManager::getInstance().take_lock_layer(handle);
 }
 
 std::optional<void *> mali_gralloc_reference_get_metadata_addr(buffer_handle_t handle) {
     return BufferManager::getInstance().get_metadata_addr(handle);
 }
+
+int mali_gralloc_reference_add_write_region(buffer_handle_t handle, const ARect &region) {
+    return BufferManager::getInstance().add_write_region(handle, region);
+}
+
+std::optional<ARect> mali_gralloc_reference_take_write_region(buffer_handle_t handle) {
+    return BufferManager::getInstance().take_write_region(handle);
+}
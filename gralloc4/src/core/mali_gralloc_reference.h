@@ -19,15 +19,33 @@
 #ifndef MALI_GRALLOC_REFERENCE_H_
 #define MALI_GRALLOC_REFERENCE_H_
 
+#include <android/rect.h>
 #include <cutils/native_handle.h>
 #include <optional>
+#include <stdint.h>
 
 int mali_gralloc_reference_retain(buffer_handle_t handle);
 int mali_gralloc_reference_release(buffer_handle_t handle);
 int mali_gralloc_reference_validate(buffer_handle_t handle);
 int mali_gralloc_reference_map(buffer_handle_t handle);
 
-std::optional<void*> mali_gralloc_reference_get_buf_addr(buffer_handle_t handle);
+std::optional<void*> mali_gralloc_reference_get_buf_addr(buffer_handle_t handle, uint32_t fd_idx = 0);
 std::optional<void*> mali_gralloc_reference_get_metadata_addr(buffer_handle_t handle);
 
+/* Single layer mapping of a multi-layer buffer, the whole buffer mapping is used when present */
+int mali_gralloc_reference_map_layer(buffer_handle_t handle, uint32_t layer);
+std::optional<void*> mali_gralloc_reference_get_layer_addr(buffer_handle_t handle, uint32_t layer);
+
+/*
+ * Layer that the next CPU lock of the buffer on the calling thread maps, -1 (default) for the
+ * whole buffer. Other threads are not affected; the lock takes the selection.
+ */
+int mali_gralloc_reference_set_lock_layer(buffer_handle_t handle, int32_t layer);
+int32_t mali_gralloc_reference_get_lock_layer(buffer_handle_t handle);
+int32_t mali_gralloc_reference_take_lock_layer(buffer_handle_t handle);
+
+/* Region written by the CPU through this process since the last take */
+int mali_gralloc_reference_add_write_region(buffer_handle_t handle, const ARect &region);
+std::optional<ARect> mali_gralloc_reference_take_write_region(buffer_handle_t handle);
+
 #endif /* MALI_GRALLOC_REFERENCE_H_ */
@@ -0,0 +1,479 @@
+/*
+ * Copyright (C) 2020 Samsung Electronics Co. Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <tuple>
+#include <utility>
+
+#include "exynos_format_allocation.h"
+
+/*
+ * Cross-checks the parametric layout engine against the per-format setup
+ * functions it replaced, kept here (renamed, without logging) as the reference.
+ */
+namespace {
+
+/*
+ * Compute SBWC buffer geometry for a buffer containing packed SBWC YUV data
+ * with bits per pixel bpp, width w, and height h.
+ * Returns a pair of { luma size, chroma size }.
+ */
+template <int bpp>
+static std::pair<size_t, size_t> reference_sbwc_sizes(int w, int h) {
+	static_assert(bpp == 8 || bpp == 10, "Unexpected bit width");
+
+	const size_t luma_body_size = (bpp == 8) ?
+		SBWC_8B_Y_SIZE(w, h) : SBWC_10B_Y_SIZE(w, h);
+	const size_t luma_header_size = (bpp == 8) ?
+		SBWC_8B_Y_HEADER_SIZE(w, h) : SBWC_10B_Y_HEADER_SIZE(w, h);
+
+	const size_t chroma_body_size = (bpp == 8) ?
+		SBWC_8B_CBCR_SIZE(w, h) : SBWC_10B_CBCR_SIZE(w, h);
+	const size_t chroma_header_size = (bpp == 8) ?
+		SBWC_8B_CBCR_HEADER_SIZE(w, h) : SBWC_10B_CBCR_HEADER_SIZE(w, h);
+
+	return { luma_body_size + luma_header_size,
+	         chroma_body_size + chroma_header_size };
+}
+
+/*
+ * All setup_<format> function will returns the plane_count
+ */
+
+/* Sets up 8-bit SBWC semi planar and returns the plane count */
+static int reference_setup_sbwc_420_sp(int w, int h, int fd_count, plane_info_t *plane)
+{
+	std::tie(plane[0].size, plane[1].size) = reference_sbwc_sizes<8>(w, h);
+
+	plane[0].alloc_width = GRALLOC_ALIGN(w, 32);
+	plane[0].alloc_height = __ALIGN_UP(h, 16);
+	plane[0].byte_stride = SBWC_8B_STRIDE(w);
+	plane[0].fd_idx = 0;
+
+	plane[1].alloc_width = GRALLOC_ALIGN(w, 32);
+	plane[1].alloc_height = __ALIGN_UP(h, 16) / 2;
+	plane[1].byte_stride = SBWC_8B_STRIDE(w);
+
+	if (fd_count > 1)
+	{
+		plane[1].fd_idx = 1;
+	}
+	else
+	{
+		plane[1].fd_idx = 0;
+		plane[1].offset = plane[0].size;
+	}
+
+	return 2;
+}
+
+/* Sets up 10-bit SBWC semi planar and returns the plane count */
+static int reference_setup_sbwc_420_sp_10bit(int w, int h, int fd_count, plane_info_t *plane)
+{
+	std::tie(plane[0].size, plane[1].size) = reference_sbwc_sizes<10>(w, h);
+
+	plane[0].alloc_width = GRALLOC_ALIGN(w, 32);
+	plane[0].alloc_height = __ALIGN_UP(h, 16);
+	plane[0].byte_stride = SBWC_10B_STRIDE(w);
+	plane[0].fd_idx = 0;
+
+	plane[1].alloc_width = GRALLOC_ALIGN(w, 32);
+	plane[1].alloc_height = __ALIGN_UP(h, 16) / 2;
+	plane[1].byte_stride = SBWC_10B_STRIDE(w);
+
+	if (fd_count > 1)
+	{
+		plane[1].fd_idx = 1;
+	}
+	else
+	{
+		plane[1].fd_idx = 0;
+		plane[1].offset = plane[0].size;
+	}
+
+	return 2;
+}
+
+/* Sets up 8-bit Lossy SBWC semi planar and returns the plane count */
+static int reference_setup_sbwc_420_sp_lossy(int width, int height, int rate, int fd_count, plane_info_t *plane)
+{
+	plane[0].size = SBWCL_8B_Y_SIZE(width, height, rate);
+	plane[0].alloc_width = GRALLOC_ALIGN(width, 32);
+	plane[0].alloc_height = __ALIGN_UP(height, 8);
+	plane[0].byte_stride = SBWCL_8B_STRIDE(width, rate);
+	plane[0].fd_idx = 0;
+
+	plane[1].size = SBWCL_8B_CBCR_SIZE(width, height, rate);
+	plane[1].alloc_width = GRALLOC_ALIGN(width, 32);
+	plane[1].alloc_height = __ALIGN_UP(height, 8) / 2;
+	plane[1].byte_stride = SBWCL_8B_STRIDE(width, rate);
+
+	if (fd_count > 1)
+	{
+		plane[1].fd_idx = 1;
+	}
+	else
+	{
+		plane[1].fd_idx = 0;
+		plane[1].offset = plane[0].size;
+	}
+
+	return 2;
+}
+
+
+/* Sets up 10-bit Lossy SBWC semi planar and returns the plane count */
+static int reference_setup_sbwc_420_sp_10bit_lossy(int width, int height, int rate, int fd_count, plane_info_t *plane)
+{
+	plane[0].size = SBWCL_10B_Y_SIZE(width, height, rate);
+	plane[0].alloc_width = GRALLOC_ALIGN(width, 32);
+	plane[0].alloc_height = __ALIGN_UP(height, 8);
+	plane[0].byte_stride = SBWCL_10B_STRIDE(width, rate);
+	plane[0].fd_idx = 0;
+
+	plane[1].size = SBWCL_10B_CBCR_SIZE(width, height, rate);
+	plane[1].alloc_width = GRALLOC_ALIGN(width, 32);
+	plane[1].alloc_height = __ALIGN_UP(height, 8) / 2;
+	plane[1].byte_stride = SBWCL_10B_STRIDE(width, rate);
+
+	if (fd_count > 1)
+	{
+		plane[1].fd_idx = 1;
+	}
+	else
+	{
+		plane[1].fd_idx = 0;
+		plane[1].offset = plane[0].size;
+	}
+
+	return 2;
+}
+
+static int reference_setup_420_sp(int width, int height, int fd_count, plane_info_t *plane)
+{
+	/* TODO: make this into an assert instead ? */
+	height = GRALLOC_ALIGN(height, 2);
+
+	plane[0].size = PLANE_SIZE(width, height);
+	plane[0].alloc_width = width;
+	plane[0].alloc_height = height;
+	plane[0].byte_stride = width;
+	plane[0].fd_idx = 0;
+
+	int chroma_width = width;
+	int chroma_height = height / 2;
+
+	plane[1].size = PLANE_SIZE(chroma_width, chroma_height);
+	plane[1].alloc_width = chroma_width;
+	plane[1].alloc_height = chroma_height;
+	plane[1].byte_stride = chroma_width;
+
+	if (fd_count > 1)
+	{
+		plane[1].fd_idx = 1;
+	}
+	else
+	{
+		plane[1].fd_idx = 0;
+		plane[1].offset = plane[0].size;
+	}
+
+	return 2;
+}
+
+static int reference_setup_420_sp_s10b(int width, int height, int fd_count, plane_info_t *plane)
+{
+	/* TODO: make this into an assert instead ? */
+	/* TODO: assert height aligned to 16 ? */
+	height = GRALLOC_ALIGN(height, 2);
+
+	int mscl_ext = 256;
+
+	/* HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_S10B have special padding requirement */
+	if (fd_count == 1)
+	{
+		mscl_ext = 64;
+	}
+
+	plane[0].size = PLANE_SIZE(width, height) + S2B_PLANE_SIZE(width, height) + mscl_ext;
+	plane[0].alloc_width = width;
+	plane[0].alloc_height = height;
+	plane[0].byte_stride = width;
+	plane[0].fd_idx = 0;
+
+	int chroma_width = width;
+	int chroma_height = height / 2;
+
+	plane[1].size = PLANE_SIZE(chroma_width, chroma_height)
+		+ S2B_PLANE_SIZE(chroma_width, chroma_height) + mscl_ext;
+	plane[1].alloc_width = chroma_width;
+	plane[1].alloc_height = chroma_height;
+	plane[1].byte_stride = chroma_width;
+
+	if (fd_count > 1)
+	{
+		plane[1].fd_idx = 1;
+	}
+	else
+	{
+		plane[1].fd_idx = 0;
+		plane[1].offset = plane[0].size;
+	}
+
+	return 2;
+}
+
+static int reference_setup_p010_sp(int width, int height, int fd_count, plane_info_t *plane)
+{
+	/* TODO: make this into an assert instead ? */
+	height = GRALLOC_ALIGN(height, 2);
+
+	plane[0].size = PLANE_SIZE(width * 2, height);
+	plane[0].alloc_width = width;
+	plane[0].alloc_height = height;
+	plane[0].byte_stride = width * 2;
+	plane[0].fd_idx = 0;
+
+	int chroma_width = width;
+	int chroma_height = height / 2;
+
+	plane[1].size = PLANE_SIZE(chroma_width * 2, chroma_height);
+	plane[1].alloc_width = chroma_width;
+	plane[1].alloc_height = chroma_height;
+	plane[1].byte_stride = chroma_width * 2;
+
+	if (fd_count > 1)
+	{
+		plane[1].fd_idx = 1;
+	}
+	else
+	{
+		plane[1].fd_idx = 0;
+		plane[1].offset = plane[0].size;
+	}
+
+	return 2;
+}
+
+static int reference_setup_420_p(int width, int height, int fd_count, plane_info_t *plane)
+{
+	/* TODO: make this into an assert instead ? */
+	width = GRALLOC_ALIGN(width, 2);
+	height = GRALLOC_ALIGN(height, 2);
+
+	plane[0].size = PLANE_SIZE(width, height);
+	plane[0].alloc_width = width;
+	plane[0].alloc_height = height;
+	plane[0].byte_stride = width;
+	plane[0].fd_idx = 0;
+
+	int chroma_width = GRALLOC_ALIGN(width / 2, 16);
+	int chroma_height = height / 2;
+
+	plane[1].size = PLANE_SIZE(chroma_width, chroma_height);
+	plane[1].alloc_width = chroma_width;
+	plane[1].alloc_height = chroma_height;
+	plane[1].byte_stride = chroma_width;
+
+	plane[2].size = PLANE_SIZE(chroma_width, chroma_height);
+	plane[2].alloc_width = chroma_width;
+	plane[2].alloc_height = chroma_height;
+	plane[2].byte_stride = chroma_width;
+
+	if (fd_count > 1)
+	{
+		plane[1].fd_idx = 1;
+		plane[2].fd_idx = 2;
+	}
+	else
+	{
+		plane[1].fd_idx = 0;
+		plane[2].fd_idx = 0;
+		plane[1].offset = plane[0].size;
+		plane[2].offset = plane[0].size + plane[1].size;
+	}
+
+	return 3;
+}
+
+static int reference_setup_420_sp_tiled(int width, int height, int fd_count, plane_info_t *plane)
+{
+	/* TODO: make this into an assert instead ? */
+	width = GRALLOC_ALIGN(width, 2);
+	height = GRALLOC_ALIGN(height, 2);
+
+	plane[0].size = PLANE_SIZE(width, height);
+	plane[0].alloc_width = width;
+	plane[0].alloc_height = height;
+	plane[0].byte_stride = width * 16;
+	plane[0].fd_idx = 0;
+
+	int chroma_width = width;
+	int chroma_height = GRALLOC_ALIGN(height / 2, 32);
+
+	plane[1].size = PLANE_SIZE(chroma_width, chroma_height);
+	plane[1].alloc_width = chroma_width;
+	plane[1].alloc_height = chroma_height;
+	plane[1].byte_stride = chroma_width * 16;
+
+	if (fd_count > 1)
+	{
+		plane[1].fd_idx = 1;
+	}
+	else
+	{
+		plane[1].fd_idx = 0;
+		plane[1].offset = plane[0].size;
+	}
+
+	return 3;
+}
+
+struct reference_layout
+{
+	uint32_t format;
+	const char *name;
+	/* Alignment prepare_descriptor_exynos_formats() applied before calling the setup function */
+	int align_w;
+	int align_h;
+	std::function<int(int, int, int, plane_info_t *)> setup;
+};
+
+#define LOSSY(fn, rate) [](int w, int h, int fd_count, plane_info_t *plane) { return fn(w, h, rate, fd_count, plane); }
+
+const reference_layout reference_layouts[] =
+{
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_SBWC,         "420_SP_M_SBWC",         1,  1,  reference_setup_sbwc_420_sp },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCrCb_420_SP_M_SBWC,         "YCrCb_420_SP_M_SBWC",   1,  1,  reference_setup_sbwc_420_sp },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_SBWC,          "420_SPN_SBWC",          1,  1,  reference_setup_sbwc_420_sp },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC,     "420_SP_M_10B_SBWC",     1,  1,  reference_setup_sbwc_420_sp_10bit },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCrCb_420_SP_M_10B_SBWC,     "YCrCb_420_SP_M_10B_SBWC", 1, 1, reference_setup_sbwc_420_sp_10bit },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC,      "420_SPN_10B_SBWC",      1,  1,  reference_setup_sbwc_420_sp_10bit },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_SBWC_L50,     "420_SP_M_SBWC_L50",     1,  1,  LOSSY(reference_setup_sbwc_420_sp_lossy, 50) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_SBWC_L50,      "420_SPN_SBWC_L50",      1,  1,  LOSSY(reference_setup_sbwc_420_sp_lossy, 50) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_SBWC_L75,     "420_SP_M_SBWC_L75",     1,  1,  LOSSY(reference_setup_sbwc_420_sp_lossy, 75) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_SBWC_L75,      "420_SPN_SBWC_L75",      1,  1,  LOSSY(reference_setup_sbwc_420_sp_lossy, 75) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC_L40, "420_SP_M_10B_SBWC_L40", 1,  1,  LOSSY(reference_setup_sbwc_420_sp_10bit_lossy, 40) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC_L40,  "420_SPN_10B_SBWC_L40",  1,  1,  LOSSY(reference_setup_sbwc_420_sp_10bit_lossy, 40) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC_L60, "420_SP_M_10B_SBWC_L60", 1,  1,  LOSSY(reference_setup_sbwc_420_sp_10bit_lossy, 60) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC_L60,  "420_SPN_10B_SBWC_L60",  1,  1,  LOSSY(reference_setup_sbwc_420_sp_10bit_lossy, 60) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_10B_SBWC_L80, "420_SP_M_10B_SBWC_L80", 1,  1,  LOSSY(reference_setup_sbwc_420_sp_10bit_lossy, 80) },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC_L80,  "420_SPN_10B_SBWC_L80",  1,  1,  LOSSY(reference_setup_sbwc_420_sp_10bit_lossy, 80) },
+	{ HAL_PIXEL_FORMAT_YCrCb_420_SP,                       "YCrCb_420_SP",          1,  2,  reference_setup_420_sp },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YV12_M,                      "YV12_M",                32, 16, reference_setup_420_p },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_P_M,               "420_P_M",               32, 16, reference_setup_420_p },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_P,                 "420_P",                 16, 1,  reference_setup_420_p },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_TILED,        "420_SP_M_TILED",        16, 32, reference_setup_420_sp_tiled },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCrCb_420_SP_M,              "YCrCb_420_SP_M",        16, 32, reference_setup_420_sp },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCrCb_420_SP_M_FULL,         "YCrCb_420_SP_M_FULL",   16, 32, reference_setup_420_sp },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M,              "420_SP_M",              16, 32, reference_setup_420_sp },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN,               "420_SPN",               64, 16, reference_setup_420_sp },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SP_M_S10B,         "420_SP_M_S10B",         BOARD_EXYNOS_S10B_FORMAT_ALIGN, 16, reference_setup_420_sp_s10b },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_S10B,          "420_SPN_S10B",          BOARD_EXYNOS_S10B_FORMAT_ALIGN, 16, reference_setup_420_sp_s10b },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_P010_M,                "P010_M",                16, 16, reference_setup_p010_sp },
+	{ HAL_PIXEL_FORMAT_EXYNOS_YCbCr_P010_SPN,              "P010_SPN",              64, 16, reference_setup_p010_sp },
+};
+
+#undef LOSSY
+
+/* Odd sizes, every alignment boundary around the common sensor and video sizes */
+std::vector<std::pair<int, int>> sweep_resolutions()
+{
+	std::vector<std::pair<int, int>> resolutions;
+	for (int w = 1; w <= 4200; w += 37)
+	{
+		for (int h = 1; h <= 2400; h += 41)
+		{
+			resolutions.emplace_back(w, h);
+		}
+	}
+
+	const std::pair<int, int> common[] = {
+		{ 176, 144 }, { 640, 480 }, { 1280, 720 }, { 1920, 1080 }, { 2560, 1440 },
+		{ 3840, 2160 }, { 4000, 3000 }, { 4032, 3024 }, { 7680, 4320 }, { 8192, 8192 },
+	};
+	for (const auto &[w, h] : common)
+	{
+		for (int dw = -1; dw <= 1; dw++)
+		{
+			for (int dh = -1; dh <= 1; dh++)
+			{
+				resolutions.emplace_back(w + dw, h + dh);
+			}
+		}
+	}
+
+	return resolutions;
+}
+
+} // namespace
+
+TEST(ExynosFormatAllocation, EveryTableEntryHasAReference)
+{
+	for (const yuv_format_layout &entry : exynos_yuv_layouts)
+	{
+		bool found = false;
+		for (const reference_layout &reference : reference_layouts)
+		{
+			found |= reference.format == entry.format;
+		}
+		EXPECT_TRUE(found) << "format 0x" << std::hex << entry.format;
+	}
+}
+
+TEST(ExynosFormatAllocation, MatchesReferenceSetup)
+{
+	const auto resolutions = sweep_resolutions();
+
+	for (const reference_layout &reference : reference_layouts)
+	{
+		for (const auto &[w, h] : resolutions)
+		{
+			for (int fd_count = 1; fd_count <= 3; fd_count++)
+			{
+				plane_info_t actual[MAX_PLANES] = {};
+				plane_info_t expected[MAX_PLANES] = {};
+
+				const int actual_count = setup_exynos_yuv_layout(reference.format, w, h, fd_count, actual);
+				const int expected_count = reference.setup(GRALLOC_ALIGN(w, reference.align_w),
+				                                           GRALLOC_ALIGN(h, reference.align_h),
+				                                           fd_count, expected);
+
+				SCOPED_TRACE(testing::Message() << reference.name << " " << w << "x" << h
+				                                << " fd_count " << fd_count);
+				ASSERT_EQ(expected_count, actual_count);
+				for (int pidx = 0; pidx < MAX_PLANES; pidx++)
+				{
+					SCOPED_TRACE(testing::Message() << "plane " << pidx);
+					ASSERT_EQ(expected[pidx].offset, actual[pidx].offset);
+					ASSERT_EQ(expected[pidx].fd_idx, actual[pidx].fd_idx);
+					ASSERT_EQ(expected[pidx].size, actual[pidx].size);
+					ASSERT_EQ(expected[pidx].byte_stride, actual[pidx].byte_stride);
+					ASSERT_EQ(expected[pidx].alloc_width, actual[pidx].alloc_width);
+					ASSERT_EQ(expected[pidx].alloc_height, actual[pidx].alloc_height);
+				}
+			}
+		}
+	}
+}
+
+/* The engine is constexpr, so sizes of fixed resolutions are known at compile time */
+static_assert(exynos_yuv_layout_size(HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN, 1920, 1080, 1) ==
+              1920 * 1088 * 3 / 2);
+static_assert(exynos_yuv_layout_size(HAL_PIXEL_FORMAT_EXYNOS_YCbCr_P010_SPN, 1920, 1080, 1) ==
+              1920 * 1088 * 3);
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2020 ARM Limited. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "mali_gralloc_fingerprint.h"
+
+/*
+ * Content fingerprint throughput per format, hashing plane by plane the way
+ * unlock does. Plane sizes are the packed content; stride padding is left out.
+ */
+namespace {
+
+struct fingerprint_format
+{
+	const char *name;
+	/* Bytes per pixel of each plane, in 1/4 bytes, at full resolution */
+	int plane_quarter_bytes[3];
+};
+
+const fingerprint_format formats[] = {
+	{ "RGBA_8888", { 16, 0, 0 } },
+	{ "RGB_565", { 8, 0, 0 } },
+	{ "RGBA_1010102", { 16, 0, 0 } },
+	{ "RGBA_FP16", { 32, 0, 0 } },
+	{ "YCbCr_420_SP", { 4, 2, 0 } },
+	{ "YV12", { 4, 1, 1 } },
+	{ "YCBCR_P010", { 8, 4, 0 } },
+};
+
+const struct
+{
+	int width;
+	int height;
+} resolutions[] = {
+	{ 1920, 1080 },
+	{ 3840, 2160 },
+};
+
+void BM_fingerprint(benchmark::State &state, const fingerprint_format &format, int width, int height)
+{
+	std::vector<std::vector<uint8_t>> planes;
+	size_t total = 0;
+	for (int quarter_bytes : format.plane_quarter_bytes)
+	{
+		if (quarter_bytes == 0)
+		{
+			break;
+		}
+		const size_t size = static_cast<size_t>(width) * height * quarter_bytes / 4;
+		std::vector<uint8_t> plane(size);
+		for (size_t i = 0; i < size; i++)
+		{
+			plane[i] = static_cast<uint8_t>(i * 131 + (i >> 12));
+		}
+		planes.push_back(std::move(plane));
+		total += size;
+	}
+
+	for (auto _ : state)
+	{
+		uint64_t h = 0;
+		for (const auto &plane : planes)
+		{
+			h = mali_gralloc_fingerprint(plane.data(), plane.size(), h);
+		}
+		benchmark::DoNotOptimize(h);
+	}
+
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * total);
+}
+
+int register_benchmarks()
+{
+	for (const auto &format : formats)
+	{
+		for (const auto &resolution : resolutions)
+		{
+			const std::string name = std::string("BM_fingerprint/") + format.name + "/" +
+			                         std::to_string(resolution.width) + "x" + std::to_string(resolution.height);
+			benchmark::RegisterBenchmark(name.c_str(), BM_fingerprint, format, resolution.width, resolution.height)
+			    ->Unit(benchmark::kMicrosecond);
+		}
+	}
+	return 0;
+}
+
+[[maybe_unused]] const int registered = register_benchmarks();
+
+} // namespace
+
+BENCHMARK_MAIN();
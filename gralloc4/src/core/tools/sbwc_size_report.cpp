@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2020 Samsung Electronics Co. Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Prints the allocation size of every lossless SBWC format and of each of its
+ * lossy variants, as chosen by the lossy SBWC policy, for common resolutions.
+ *
+ * Usage: gralloc_sbwc_size_report [<width>x<height> ...]
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <utility>
+#include <vector>
+
+#include "exynos_format_allocation.h"
+
+static void report(uint32_t lossless_format, int width, int height)
+{
+	/* SBWC plane sizes do not depend on whether the planes share a dmabuf */
+	const int fd_count = 1;
+	const uint64_t lossless_size = exynos_yuv_layout_size(lossless_format, width, height, fd_count);
+	const yuv_format_layout *entry = find_exynos_yuv_layout(lossless_format);
+
+	printf("%5dx%-5d 0x%-5" PRIx32 " %2u-bit  lossless %10" PRIu64 "\n", width, height,
+	       lossless_format, entry->params.bit_depth, lossless_size);
+
+	for (const sbwc_lossy_variant &variant : sbwc_lossy_variants)
+	{
+		if (variant.lossless_format != lossless_format)
+		{
+			continue;
+		}
+
+		const uint64_t lossy_size = exynos_yuv_layout_size(variant.lossy_format, width, height, fd_count);
+		printf("%20s L%-2u 0x%-5" PRIx32 " %10" PRIu64 "  %5.1f%% of lossless\n", "", variant.rate,
+		       variant.lossy_format, lossy_size, 100.0 * lossy_size / lossless_size);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::pair<int, int>> resolutions;
+	for (int i = 1; i < argc; i++)
+	{
+		int width, height;
+		if (sscanf(argv[i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+		{
+			fprintf(stderr, "Invalid resolution '%s', expected <width>x<height>\n", argv[i]);
+			return 1;
+		}
+		resolutions.emplace_back(width, height);
+	}
+	if (resolutions.empty())
+	{
+		resolutions = { { 1920, 1080 }, { 3840, 2160 }, { 4032, 3024 }, { 7680, 4320 } };
+	}
+
+	for (const auto &[width, height] : resolutions)
+	{
+		uint32_t previous = 0;
+		for (const sbwc_lossy_variant &variant : sbwc_lossy_variants)
+		{
+			if (variant.lossless_format != previous)
+			{
+				report(variant.lossless_format, width, height);
+				previous = variant.lossless_format;
+			}
+		}
+		printf("\n");
+	}
+
+	return 0;
+}
@@ -27,6 +27,7 @@
 #include "allocator/mali_gralloc_ion.h"
 #include "gralloc_priv.h"
 #include "SharedMetadata.h"
+#include "capabilities/gralloc_capabilities.h"
 
 namespace arm
 {
@@ -157,6 +158,28 @@ void allocate(const buffer_descriptor_t &bufferDescriptor, uint32_t count, IAllo
 	}
 }
 
+void warm_up(std::function<void(const char *, std::chrono::microseconds)> step_cb)
+{
+	ATRACE_CALL();
+
+	const auto run_step = [&step_cb](const char *name, const std::function<void()> &step) {
+		ATRACE_NAME(name);
+		const auto start = std::chrono::steady_clock::now();
+		step();
+		const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+		        std::chrono::steady_clock::now() - start);
+		if (step_cb)
+		{
+			step_cb(name, elapsed);
+		}
+	};
+
+	run_step("ip_capabilities", [] { get_ip_capabilities(); });
+	run_step("format_names", [] { format_name(MALI_GRALLOC_FORMAT_INTERNAL_RGBA_8888); });
+	run_step("buffer_allocator", [] { mali_gralloc_ion_init_allocator(); });
+	run_step("heap_tables", [] { mali_gralloc_ion_init_heap_tables(); });
+}
+
 } // namespace common
 } // namespace allocator
 } // namespace arm
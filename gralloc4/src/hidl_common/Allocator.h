@@ -20,6 +20,7 @@
 
 #include "4.x/gralloc_allocator_hidl_header.h"
 
+#include <chrono>
 #include <functional>
 
 #include "core/mali_gralloc_bufferdescriptor.h"
@@ -54,6 +55,16 @@ using android::hardware::hidl_vec;
 void allocate(const buffer_descriptor_t &bufferDescriptor, uint32_t count, IAllocator::allocate_cb hidl_cb,
               std::function<int(const buffer_descriptor_t *, buffer_handle_t *)> fb_allocator = nullptr);
 
+/*
+ * Initialises everything that is otherwise set up lazily by the first allocation:
+ * IP capabilities and format sanitisation, the format name map, the dmabuf
+ * BufferAllocator and the usage to heap tables.
+ *
+ * @param step_cb [in] Optional callback invoked after each step with its name and
+ *                     duration.
+ */
+void warm_up(std::function<void(const char *, std::chrono::microseconds)> step_cb = nullptr);
+
 } // namespace common
 } // namespace allocator
 } // namespace arm
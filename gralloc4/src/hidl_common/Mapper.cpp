@@ -29,6 +29,7 @@
 #include "core/format_info.h"
 #include "allocator/mali_gralloc_ion.h"
 #include "mali_gralloc_buffer.h"
+#include "mali_gralloc_usages.h"
 #include "mali_gralloc_log.h"
 
 #include "MapperMetadata.h"
@@ -246,33 +247,46 @@ static Error unlockBuffer(buffer_handle_t bufferHandle,
 
 	auto private_handle = private_handle_t::dynamicCast(bufferHandle);
 
-	const int result = mali_gralloc_unlock(bufferHandle);
+	std::optional<uint64_t> fingerprint;
+	const int result = mali_gralloc_unlock(bufferHandle, &fingerprint);
 	if (result)
 	{
 		MALI_GRALLOC_LOGE("Unlocking failed with error: %d", result);
 		return Error::BAD_VALUE;
 	}
 
+	if (fingerprint.has_value())
+	{
+		publish_content_fingerprint(private_handle, fingerprint.value());
+	}
+
+	/* Publish what the CPU wrote since lock for the consumer */
+	const std::optional<ARect> write_region = mali_gralloc_reference_take_write_region(bufferHandle);
+	if (write_region.has_value())
+	{
+		add_dirty_region(private_handle, Rect{ write_region->left, write_region->top,
+		                                       write_region->right, write_region->bottom });
+	}
+
 	*outFenceFd = -1;
 
 	return Error::NONE;
 }
 
-void importBuffer(const hidl_handle& rawHandle, IMapper::importBuffer_cb hidl_cb)
+Error importBuffer(const native_handle_t *rawHandle, buffer_handle_t *outBuffer)
 {
-	if (!rawHandle.getNativeHandle())
+	*outBuffer = nullptr;
+	if (!rawHandle)
 	{
 		MALI_GRALLOC_LOGE("Invalid buffer handle to import");
-		hidl_cb(Error::BAD_BUFFER, nullptr);
-		return;
+		return Error::BAD_BUFFER;
 	}
 
-	native_handle_t* bufferHandle = native_handle_clone(rawHandle.getNativeHandle());
+	native_handle_t* bufferHandle = native_handle_clone(rawHandle);
 	if (!bufferHandle)
 	{
 		MALI_GRALLOC_LOGE("Failed to clone buffer handle");
-		hidl_cb(Error::NO_RESOURCES, nullptr);
-		return;
+		return Error::NO_RESOURCES;
 	}
 
 	const Error error = registerBuffer(bufferHandle);
@@ -281,12 +295,9 @@ void importBuffer(const hidl_handle& rawHandle, IMapper::importBuffer_cb hidl_cb
 		native_handle_close(bufferHandle);
 		native_handle_delete(bufferHandle);
 
-		hidl_cb(error, nullptr);
-		return;
+		return error;
 	}
 
-	auto *private_handle = static_cast<private_handle_t *>(bufferHandle);
-
 	if (gRegisteredHandles->add(bufferHandle) == false)
 	{
 		/* The newly cloned handle is already registered. This can only happen
@@ -299,11 +310,19 @@ void importBuffer(const hidl_handle& rawHandle, IMapper::importBuffer_cb hidl_cb
 		native_handle_close(bufferHandle);
 		native_handle_delete(bufferHandle);
 
-		hidl_cb(Error::NO_RESOURCES, nullptr);
-		return;
+		return Error::NO_RESOURCES;
 	}
 
-	hidl_cb(Error::NONE, bufferHandle);
+	*outBuffer = bufferHandle;
+	return Error::NONE;
+}
+
+void importBuffer(const hidl_handle& rawHandle, IMapper::importBuffer_cb hidl_cb)
+{
+	buffer_handle_t bufferHandle = nullptr;
+	const Error error = importBuffer(rawHandle.getNativeHandle(), &bufferHandle);
+
+	hidl_cb(error, const_cast<native_handle_t *>(bufferHandle));
 }
 
 Error freeBuffer(void* buffer)
@@ -327,17 +346,23 @@ Error freeBuffer(void* buffer)
 	return Error::NONE;
 }
 
-void lock(void* buffer, uint64_t cpuUsage, const IMapper::Rect& accessRegion,
-          const hidl_handle& acquireFence, IMapper::lock_cb hidl_cb)
+Error lock(void* buffer, uint64_t cpuUsage, const IMapper::Rect& accessRegion, int acquireFence, void** outData)
 {
+	*outData = nullptr;
+
 	buffer_handle_t bufferHandle = gRegisteredHandles->get(buffer);
 	if (!bufferHandle || private_handle_t::validate(bufferHandle) < 0)
 	{
 		MALI_GRALLOC_LOGE("Buffer to lock: %p is not valid", buffer);
-		hidl_cb(Error::BAD_BUFFER, nullptr);
-		return;
+		return Error::BAD_BUFFER;
 	}
 
+	return lockBuffer(bufferHandle, cpuUsage, accessRegion, acquireFence, outData);
+}
+
+void lock(void* buffer, uint64_t cpuUsage, const IMapper::Rect& accessRegion,
+          const hidl_handle& acquireFence, IMapper::lock_cb hidl_cb)
+{
 	int fenceFd;
 	if (!getFenceFd(acquireFence, &fenceFd))
 	{
@@ -346,23 +371,29 @@ void lock(void* buffer, uint64_t cpuUsage, const IMapper::Rect& accessRegion,
 	}
 
 	void* data = nullptr;
-	const Error error = lockBuffer(bufferHandle, cpuUsage, accessRegion, fenceFd, &data);
+	const Error error = lock(buffer, cpuUsage, accessRegion, fenceFd, &data);
 
 	hidl_cb(error, data);
 }
 
-void unlock(void* buffer, IMapper::unlock_cb hidl_cb)
+Error unlock(void* buffer, int* releaseFence)
 {
+	*releaseFence = -1;
+
 	buffer_handle_t bufferHandle = gRegisteredHandles->get(buffer);
 	if (!bufferHandle)
 	{
 		MALI_GRALLOC_LOGE("Buffer to unlock: %p has not been registered with Gralloc", buffer);
-		hidl_cb(Error::BAD_BUFFER, nullptr);
-		return;
+		return Error::BAD_BUFFER;
 	}
 
+	return unlockBuffer(bufferHandle, releaseFence);
+}
+
+void unlock(void* buffer, IMapper::unlock_cb hidl_cb)
+{
 	int fenceFd;
-	const Error error = unlockBuffer(bufferHandle, &fenceFd);
+	const Error error = unlock(buffer, &fenceFd);
 	if (error == Error::NONE)
 	{
 		NATIVE_HANDLE_DECLARE_STORAGE(fenceStorage, 1, 0);
@@ -500,24 +531,37 @@ Error validateBufferSize(void* buffer,
 	return Error::NONE;
 }
 
-void getTransportSize(void* buffer, IMapper::getTransportSize_cb hidl_cb)
+Error getTransportSize(void* buffer, uint32_t* outNumFds, uint32_t* outNumInts)
 {
 	/* The buffer must have been allocated by Gralloc */
 	buffer_handle_t bufferHandle = gRegisteredHandles->get(buffer);
 	if (!bufferHandle)
 	{
-		MALI_GRALLOC_LOGE("Buffer %p is not registered with Gralloc", bufferHandle);
-		hidl_cb(Error::BAD_BUFFER, -1, -1);
-		return;
+		MALI_GRALLOC_LOGE("Buffer %p is not registered with Gralloc", buffer);
+		return Error::BAD_BUFFER;
 	}
 
 	if (private_handle_t::validate(bufferHandle) < 0)
 	{
 		MALI_GRALLOC_LOGE("Buffer %p is corrupted", buffer);
-		hidl_cb(Error::BAD_BUFFER, -1, -1);
+		return Error::BAD_BUFFER;
+	}
+
+	*outNumFds = bufferHandle->numFds;
+	*outNumInts = bufferHandle->numInts;
+	return Error::NONE;
+}
+
+void getTransportSize(void* buffer, IMapper::getTransportSize_cb hidl_cb)
+{
+	uint32_t numFds = 0, numInts = 0;
+	const Error error = getTransportSize(buffer, &numFds, &numInts);
+	if (error != Error::NONE)
+	{
+		hidl_cb(error, -1, -1);
 		return;
 	}
-	hidl_cb(Error::NONE, bufferHandle->numFds, bufferHandle->numInts);
+	hidl_cb(Error::NONE, numFds, numInts);
 }
 
 void isSupported(const IMapper::BufferDescriptorInfo& description, IMapper::isSupported_cb hidl_cb)
@@ -544,26 +588,29 @@ void isSupported(const IMapper::BufferDescriptorInfo& description, IMapper::isSu
 	}
 }
 
-void flushLockedBuffer(void *buffer, IMapper::flushLockedBuffer_cb hidl_cb)
+Error flushLockedBuffer(void *buffer)
 {
 	buffer_handle_t handle = gRegisteredHandles->get(buffer);
 	if (private_handle_t::validate(handle) < 0)
 	{
 		MALI_GRALLOC_LOGE("Bandle: %p is corrupted", handle);
-		hidl_cb(Error::BAD_BUFFER, hidl_handle{});
-		return;
+		return Error::BAD_BUFFER;
 	}
 
 	auto private_handle = static_cast<const private_handle_t *>(handle);
 	if (!private_handle->cpu_write && !private_handle->cpu_read)
 	{
 		MALI_GRALLOC_LOGE("Attempt to call flushLockedBuffer() on an unlocked buffer (%p)", handle);
-		hidl_cb(Error::BAD_BUFFER, hidl_handle{});
-		return;
+		return Error::BAD_BUFFER;
 	}
 
 	mali_gralloc_ion_sync_end(private_handle, false, true);
-	hidl_cb(Error::NONE, hidl_handle{});
+	return Error::NONE;
+}
+
+void flushLockedBuffer(void *buffer, IMapper::flushLockedBuffer_cb hidl_cb)
+{
+	hidl_cb(flushLockedBuffer(buffer), hidl_handle{});
 }
 
 Error rereadLockedBuffer(void *buffer)
@@ -656,13 +703,24 @@ void listSupportedMetadataTypes(IMapper::listSupportedMetadataTypes_cb hidl_cb)
 		/* Arm vendor metadata */
 		{ ArmMetadataType_PLANE_FDS,
 			"Vector of file descriptors of each plane", true, false },
+		/* Gchips vendor metadata */
+		{ GchipsMetadataType_SBWC_INFO,
+			"SBWC lossy rate, per plane header/body sizes and bytes saved versus linear", true, false },
+		{ GchipsMetadataType_DIRTY_REGION,
+			"Union of the CPU write lock regions since the consumer last cleared it", true, true },
+		{ GchipsMetadataType_CONTENT_FINGERPRINT,
+			"Content hash and generation, updated at CPU write unlock", true, false },
+		{ GchipsMetadataType_LAYER_OFFSETS,
+			"Byte offset of each layer, to add to the plane layout offsets", true, false },
+		{ GchipsMetadataType_LOCK_LAYER,
+			"Layer mapped by the next CPU lock on the calling thread, -1 for all layers", true, true },
 	};
 	hidl_cb(Error::NONE, descriptions);
 	return;
 }
 
 
-static hidl_vec<IMapper::MetadataDump> dumpBufferHelper(const private_handle_t* handle)
+static void dumpBufferMetadata(const private_handle_t* handle, const MetadataDumpFn& dumpFn)
 {
 	hidl_vec<IMapper::MetadataType> standardMetadataTypes = {
 		android::gralloc4::MetadataType_BufferId,
@@ -686,16 +744,19 @@ static hidl_vec<IMapper::MetadataDump> dumpBufferHelper(const private_handle_t*
 		android::gralloc4::MetadataType_Cta861_3,
 		android::gralloc4::MetadataType_Smpte2094_40,
 		android::gralloc4::MetadataType_Crop,
+		GchipsMetadataType_SBWC_INFO,
+		GchipsMetadataType_DIRTY_REGION,
+		GchipsMetadataType_CONTENT_FINGERPRINT,
+		GchipsMetadataType_LAYER_OFFSETS,
 	};
 
-	std::vector<IMapper::MetadataDump> metadataDumps;
 	for (const auto& metadataType: standardMetadataTypes)
 	{
-		get_metadata(handle, metadataType, [&metadataDumps, &metadataType](Error error, hidl_vec<uint8_t> metadata) {
+		get_metadata(handle, metadataType, [&dumpFn, &metadataType](Error error, hidl_vec<uint8_t> metadata) {
 			switch(error)
 			{
 			case Error::NONE:
-				metadataDumps.push_back({metadataType, metadata});
+				dumpFn(metadataType, metadata);
 				break;
 			case Error::UNSUPPORTED:
 			default:
@@ -703,9 +764,31 @@ static hidl_vec<IMapper::MetadataDump> dumpBufferHelper(const private_handle_t*
 			}
 		});
 	}
+}
+
+static hidl_vec<IMapper::MetadataDump> dumpBufferHelper(const private_handle_t* handle)
+{
+	std::vector<IMapper::MetadataDump> metadataDumps;
+	dumpBufferMetadata(handle, [&metadataDumps](const IMapper::MetadataType& metadataType,
+	                                            const hidl_vec<uint8_t>& metadata) {
+		metadataDumps.push_back({metadataType, metadata});
+	});
 	return hidl_vec<IMapper::MetadataDump>(metadataDumps);
 }
 
+Error dumpBuffer(void *buffer, const MetadataDumpFn& dumpFn)
+{
+	auto handle = static_cast<const private_handle_t *>(gRegisteredHandles->get(buffer));
+	if (handle == nullptr)
+	{
+		MALI_GRALLOC_LOGE("Buffer: %p has not been registered with Gralloc", buffer);
+		return Error::BAD_BUFFER;
+	}
+
+	dumpBufferMetadata(handle, dumpFn);
+	return Error::NONE;
+}
+
 void dumpBuffer(void *buffer, IMapper::dumpBuffer_cb hidl_cb)
 {
 	IMapper::BufferDump bufferDump{};
@@ -721,40 +804,112 @@ void dumpBuffer(void *buffer, IMapper::dumpBuffer_cb hidl_cb)
 	hidl_cb(Error::NONE, bufferDump);
 }
 
+/* SBWC usage of all buffers imported by this process */
+struct SbwcSummary
+{
+	uint32_t lossless_count = 0;
+	uint32_t lossy_count = 0;
+	uint64_t sbwc_bytes = 0;
+	uint64_t linear_bytes = 0;
+	/* Video buffers that could have used SBWC but did not */
+	uint32_t uncompressed_video_count = 0;
+	uint64_t uncompressed_video_bytes = 0;
+
+	void add(const private_handle_t *handle)
+	{
+		sbwc_info_t info;
+		if (mali_gralloc_get_sbwc_info(handle, &info))
+		{
+			(info.lossy_rate ? lossy_count : lossless_count)++;
+			sbwc_bytes += info.sbwc_size;
+			linear_bytes += info.linear_size;
+		}
+		else if ((handle->producer_usage | handle->consumer_usage) &
+		         (GRALLOC_USAGE_HW_VIDEO_ENCODER | GRALLOC_USAGE_HW_VIDEO_DECODER))
+		{
+			uncompressed_video_count++;
+			for (int fidx = 0; fidx < handle->fd_count; fidx++)
+			{
+				uncompressed_video_bytes += handle->alloc_sizes[fidx];
+			}
+		}
+	}
+
+	/* Logs the totals; they are not about any one buffer, so they stay out of the dump entries */
+	void log() const
+	{
+		MALI_GRALLOC_LOGI("SBWC process summary: sbwc_buffers=%u (lossless=%u lossy=%u) sbwc_bytes=%" PRIu64
+		                  " linear_bytes=%" PRIu64 " saved_bytes=%" PRId64
+		                  " uncompressed_video_buffers=%u uncompressed_video_bytes=%" PRIu64,
+		                  lossless_count + lossy_count, lossless_count, lossy_count, sbwc_bytes, linear_bytes,
+		                  static_cast<int64_t>(linear_bytes) - static_cast<int64_t>(sbwc_bytes),
+		                  uncompressed_video_count, uncompressed_video_bytes);
+	}
+};
+
 void dumpBuffers(IMapper::dumpBuffers_cb hidl_cb)
 {
 	std::vector<IMapper::BufferDump> bufferDumps;
-	gRegisteredHandles->for_each([&bufferDumps](buffer_handle_t buffer) {
-		IMapper::BufferDump bufferDump { dumpBufferHelper(static_cast<const private_handle_t *>(buffer)) };
+	SbwcSummary sbwcSummary;
+	gRegisteredHandles->for_each([&bufferDumps, &sbwcSummary](buffer_handle_t buffer) {
+		const auto handle = static_cast<const private_handle_t *>(buffer);
+		IMapper::BufferDump bufferDump { dumpBufferHelper(handle) };
 		bufferDumps.push_back(bufferDump);
+		sbwcSummary.add(handle);
 	});
+
+	sbwcSummary.log();
 	hidl_cb(Error::NONE, hidl_vec<IMapper::BufferDump>(bufferDumps));
 }
 
-void getReservedRegion(void *buffer, IMapper::getReservedRegion_cb hidl_cb)
+void dumpBuffers(const std::function<void()>& beginBufferFn, const MetadataDumpFn& dumpFn)
+{
+	SbwcSummary sbwcSummary;
+	gRegisteredHandles->for_each([&](buffer_handle_t buffer) {
+		const auto handle = static_cast<const private_handle_t *>(buffer);
+		beginBufferFn();
+		dumpBufferMetadata(handle, dumpFn);
+		sbwcSummary.add(handle);
+	});
+
+	sbwcSummary.log();
+}
+
+Error getReservedRegion(void *buffer, void **outReservedRegion, uint64_t *outReservedSize)
 {
+	*outReservedRegion = nullptr;
+	*outReservedSize = 0;
+
 	auto handle = static_cast<const private_handle_t *>(gRegisteredHandles->get(buffer));
 	if (handle == nullptr)
 	{
 		MALI_GRALLOC_LOGE("Buffer: %p has not been registered with Gralloc", buffer);
-		hidl_cb(Error::BAD_BUFFER, 0, 0);
-		return;
+		return Error::BAD_BUFFER;
 	}
 	else if (handle->reserved_region_size == 0)
 	{
 		MALI_GRALLOC_LOGE("Buffer: %p has no reserved region", buffer);
-		hidl_cb(Error::BAD_BUFFER, 0, 0);
-		return;
+		return Error::BAD_BUFFER;
 	}
 
 	auto metadata_addr_oe = mali_gralloc_reference_get_metadata_addr(handle);
 	if (!metadata_addr_oe.has_value()) {
-		hidl_cb(Error::BAD_BUFFER, 0, 0);
+		return Error::BAD_BUFFER;
 	}
 
-	void *reserved_region = static_cast<std::byte *>(metadata_addr_oe.value())
+	*outReservedRegion = static_cast<std::byte *>(metadata_addr_oe.value())
 	    + mapper::common::shared_metadata_size();
-	hidl_cb(Error::NONE, reserved_region, handle->reserved_region_size);
+	*outReservedSize = handle->reserved_region_size;
+	return Error::NONE;
+}
+
+void getReservedRegion(void *buffer, IMapper::getReservedRegion_cb hidl_cb)
+{
+	void *reserved_region = nullptr;
+	uint64_t reserved_size = 0;
+	const Error error = getReservedRegion(buffer, &reserved_region, &reserved_size);
+
+	hidl_cb(error, reserved_region, reserved_size);
 }
 
 } // namespace common
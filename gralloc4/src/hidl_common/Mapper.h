@@ -19,6 +19,7 @@
 #ifndef GRALLOC_COMMON_MAPPER_H
 #define GRALLOC_COMMON_MAPPER_H
 
+#include <functional>
 #include <inttypes.h>
 #include "mali_gralloc_log.h"
 #include "core/mali_gralloc_bufferdescriptor.h"
@@ -245,6 +246,38 @@ void dumpBuffers(IMapper::dumpBuffers_cb hidl_cb);
  */
 void getReservedRegion(void *buffer, IMapper::getReservedRegion_cb _hidl_cb);
 
+/*
+ * Callback free variants of the functions above, for the stable-C (AIMapper)
+ * mapper. Parameters and errors are the same as for the HIDL versions; the
+ * results are returned through the out parameters instead of hidl_cb.
+ */
+
+/* The returned handle is nullptr on error */
+Error importBuffer(const native_handle_t *rawHandle, buffer_handle_t *outBuffer);
+
+/* acquireFence is not consumed; the caller keeps ownership of it */
+Error lock(void *buffer, uint64_t cpuUsage, const IMapper::Rect &accessRegion, int acquireFence, void **outData);
+
+/* releaseFence is -1 or a fence owned by the caller */
+Error unlock(void *buffer, int *releaseFence);
+
+Error getTransportSize(void *buffer, uint32_t *outNumFds, uint32_t *outNumInts);
+
+Error flushLockedBuffer(void *buffer);
+
+Error getReservedRegion(void *buffer, void **outReservedRegion, uint64_t *outReservedSize);
+
+/* Called once per metadata value of a dumped buffer */
+using MetadataDumpFn = std::function<void(const IMapper::MetadataType &, const hidl_vec<uint8_t> &)>;
+
+Error dumpBuffer(void *buffer, const MetadataDumpFn &dumpFn);
+
+/*
+ * Streams the metadata of every buffer imported by the process:
+ * beginBufferFn is called before the metadata of each buffer.
+ */
+void dumpBuffers(const std::function<void()> &beginBufferFn, const MetadataDumpFn &dumpFn);
+
 } // namespace common
 } // namespace mapper
 } // namespace arm
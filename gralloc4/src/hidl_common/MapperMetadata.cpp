@@ -20,6 +20,7 @@
 #include "SharedMetadata.h"
 #include "core/format_info.h"
 #include "core/mali_gralloc_bufferallocation.h"
+#include "core/mali_gralloc_reference.h"
 #include "mali_gralloc_buffer.h"
 #include "mali_gralloc_log.h"
 #include "drmutils.h"
@@ -27,9 +28,11 @@
 
 #include "exynos_format.h"
 #include "mali_gralloc_formats.h"
+#include "mali_gralloc_usages.h"
 
 #include <pixel-gralloc/metadata.h>
 
+#include <algorithm>
 #include <vector>
 
 namespace arm
@@ -340,7 +343,7 @@ static android::status_t get_plane_layouts(const private_handle_t *handle, std::
 			}
 			else
 			{
-				int64_t layer_size = handle->alloc_sizes[0] / handle->layer_count;
+				int64_t layer_size = mali_gralloc_get_layer_size(handle);
 				plane_size = layer_size - handle->plane_info[plane_index].offset;
 			}
 
@@ -395,6 +398,27 @@ static hidl_vec<uint8_t> encodePointer(void* ptr) {
 	return output;
 }
 
+bool describe_sbwc(const private_handle_t *handle, std::string *out)
+{
+	sbwc_info_t info;
+	if (!mali_gralloc_get_sbwc_info(handle, &info))
+	{
+		return false;
+	}
+
+	const int64_t saved = static_cast<int64_t>(info.linear_size) - static_cast<int64_t>(info.sbwc_size);
+	char buf[512];
+	snprintf(buf, sizeof(buf),
+	         "%u-bit %s rate=%u luma(header=%" PRIu64 " body=%" PRIu64 ") chroma(header=%" PRIu64
+	         " body=%" PRIu64 ") sbwc=%" PRIu64 " linear=%" PRIu64 " saved=%" PRId64,
+	         info.bit_depth, info.lossy_rate ? "lossy" : "lossless", info.lossy_rate,
+	         info.header_size[0], info.body_size[0], info.header_size[1], info.body_size[1],
+	         info.sbwc_size, info.linear_size, saved);
+	*out = buf;
+
+	return true;
+}
+
 void get_metadata(const private_handle_t *handle, const IMapper::MetadataType &metadataType, IMapper::get_cb hidl_cb)
 {
 	android::status_t err = android::OK;
@@ -588,6 +612,76 @@ void get_metadata(const private_handle_t *handle, const IMapper::MetadataType &m
 				err = android::BAD_VALUE;
 		}
 	}
+	else if (metadataType.name == GRALLOC_GCHIPS_METADATA_TYPE_NAME)
+	{
+		switch (static_cast<GchipsMetadataType>(metadataType.value))
+		{
+		case GchipsMetadataType::SBWC_INFO:
+		{
+			std::string description;
+			if (describe_sbwc(handle, &description))
+			{
+				vec = hidl_vec<uint8_t>(description.begin(), description.end());
+			}
+			else
+			{
+				err = android::BAD_VALUE;
+			}
+			break;
+		}
+		case GchipsMetadataType::DIRTY_REGION:
+		{
+			std::optional<Rect> dirty_region;
+			get_dirty_region(handle, &dirty_region);
+
+			std::vector<Rect> regions;
+			if (dirty_region.has_value())
+			{
+				regions.push_back(dirty_region.value());
+			}
+			err = android::gralloc4::encodeCrop(regions, &vec);
+			break;
+		}
+		case GchipsMetadataType::CONTENT_FINGERPRINT:
+		{
+			if (!(handle->get_usage() & GRALLOC_USAGE_CONTENT_FINGERPRINT))
+			{
+				err = android::BAD_VALUE;
+				break;
+			}
+
+			uint64_t value[2];
+			get_content_fingerprint(handle, &value[0], &value[1]);
+
+			const uint8_t *begin = reinterpret_cast<const uint8_t *>(value);
+			vec = hidl_vec<uint8_t>(begin, begin + sizeof(value));
+			break;
+		}
+		case GchipsMetadataType::LAYER_OFFSETS:
+		{
+			const int64_t layer_size = mali_gralloc_get_layer_size(handle);
+			std::vector<int64_t> offsets(std::max(handle->layer_count, 1u));
+			for (size_t layer = 0; layer < offsets.size(); layer++)
+			{
+				offsets[layer] = static_cast<int64_t>(layer) * layer_size;
+			}
+
+			const uint8_t *begin = reinterpret_cast<const uint8_t *>(offsets.data());
+			vec = hidl_vec<uint8_t>(begin, begin + offsets.size() * sizeof(int64_t));
+			break;
+		}
+		case GchipsMetadataType::LOCK_LAYER:
+		{
+			const int32_t layer = mali_gralloc_reference_get_lock_layer(handle);
+
+			const uint8_t *begin = reinterpret_cast<const uint8_t *>(&layer);
+			vec = hidl_vec<uint8_t>(begin, begin + sizeof(layer));
+			break;
+		}
+		default:
+			err = android::BAD_VALUE;
+		}
+	}
 	else
 	{
 		err = android::BAD_VALUE;
@@ -688,9 +782,39 @@ Error set_metadata(const private_handle_t *handle, const IMapper::MetadataType &
 		}
 		return ((err) ? Error::UNSUPPORTED : Error::NONE);
 	}
+	else if (metadataType.name == GRALLOC_GCHIPS_METADATA_TYPE_NAME)
+	{
+		switch (static_cast<GchipsMetadataType>(metadataType.value))
+		{
+		case GchipsMetadataType::DIRTY_REGION:
+		{
+			std::vector<Rect> regions;
+			if (android::gralloc4::decodeCrop(metadata, &regions) || regions.size() > 1)
+			{
+				return Error::BAD_VALUE;
+			}
+
+			set_dirty_region(handle, regions.empty() ? std::nullopt : std::make_optional(regions[0]));
+			return Error::NONE;
+		}
+		case GchipsMetadataType::LOCK_LAYER:
+		{
+			int32_t layer;
+			if (metadata.size() != sizeof(layer))
+			{
+				return Error::BAD_VALUE;
+			}
+			std::memcpy(&layer, metadata.data(), sizeof(layer));
+
+			return mali_gralloc_reference_set_lock_layer(handle, layer) ? Error::BAD_VALUE : Error::NONE;
+		}
+		default:
+			return Error::UNSUPPORTED;
+		}
+	}
 	else
 	{
-		/* None of the vendor types support set. */
+		/* None of the other vendor types support set. */
 		return Error::UNSUPPORTED;
 	}
 }
@@ -47,6 +47,58 @@ const static ExtendableType Compression_AFBC{ GRALLOC_ARM_COMPRESSION_TYPE_NAME,
 const static IMapper::MetadataType ArmMetadataType_PLANE_FDS{ GRALLOC_ARM_METADATA_TYPE_NAME,
                                                   static_cast<int64_t>(aidl::arm::graphics::ArmMetadataType::PLANE_FDS) };
 
+/*
+ * Vendor metadata types specific to this gralloc implementation. Types are told
+ * apart by name first, but the values also start well above those of
+ * StandardMetadataType so that no code matching on the value alone can mistake
+ * one for a standard type.
+ */
+#define GRALLOC_GCHIPS_METADATA_TYPE_NAME "vendor.google.gchips.GchipsMetadataType"
+#define GRALLOC_GCHIPS_METADATA_TYPE_BASE 0x10000
+enum class GchipsMetadataType : int64_t
+{
+	INVALID = 0,
+	/* Human readable SBWC compression figures of the buffer (get only) */
+	SBWC_INFO = GRALLOC_GCHIPS_METADATA_TYPE_BASE + 1,
+	/*
+	 * Union of the regions locked for CPU write since the consumer last reset it, encoded
+	 * like StandardMetadataType::CROP with zero (clean) or one rectangle. Setting it
+	 * replaces the value; consumers set an empty list after acquiring the buffer.
+	 */
+	DIRTY_REGION = GRALLOC_GCHIPS_METADATA_TYPE_BASE + 2,
+	/*
+	 * Content fingerprint of a GRALLOC_USAGE_CONTENT_FINGERPRINT buffer, taken at each CPU
+	 * write unlock: two uint64_t, the hash then a generation counting the fingerprints taken
+	 * (get only). Equal hashes mean the content very likely did not change. A hash of 0
+	 * means the fingerprint could not be taken and the content must be treated as changed.
+	 */
+	CONTENT_FINGERPRINT = GRALLOC_GCHIPS_METADATA_TYPE_BASE + 3,
+	/*
+	 * Byte offset of each layer in the first fd, as int64_t (get only). The plane layouts
+	 * describe layer 0; add the layer offset for the others.
+	 */
+	LAYER_OFFSETS = GRALLOC_GCHIPS_METADATA_TYPE_BASE + 4,
+	/*
+	 * Layer that the next CPU lock of a single fd multi-layer buffer on the calling thread
+	 * maps, as int32_t; that lock returns the address of the layer and resets the selection
+	 * to -1, which maps all layers. Unlike other metadata this is an argument of the next
+	 * lock call rather than a property of the buffer: it is not seen by other threads or
+	 * processes. VendorGraphicBufferMeta::lock_layer() sets it and locks in one call.
+	 */
+	LOCK_LAYER = GRALLOC_GCHIPS_METADATA_TYPE_BASE + 5,
+};
+
+const static IMapper::MetadataType GchipsMetadataType_SBWC_INFO{ GRALLOC_GCHIPS_METADATA_TYPE_NAME,
+                                                  static_cast<int64_t>(GchipsMetadataType::SBWC_INFO) };
+const static IMapper::MetadataType GchipsMetadataType_DIRTY_REGION{ GRALLOC_GCHIPS_METADATA_TYPE_NAME,
+                                                  static_cast<int64_t>(GchipsMetadataType::DIRTY_REGION) };
+const static IMapper::MetadataType GchipsMetadataType_CONTENT_FINGERPRINT{ GRALLOC_GCHIPS_METADATA_TYPE_NAME,
+                                                  static_cast<int64_t>(GchipsMetadataType::CONTENT_FINGERPRINT) };
+const static IMapper::MetadataType GchipsMetadataType_LAYER_OFFSETS{ GRALLOC_GCHIPS_METADATA_TYPE_NAME,
+                                                  static_cast<int64_t>(GchipsMetadataType::LAYER_OFFSETS) };
+const static IMapper::MetadataType GchipsMetadataType_LOCK_LAYER{ GRALLOC_GCHIPS_METADATA_TYPE_NAME,
+                                                  static_cast<int64_t>(GchipsMetadataType::LOCK_LAYER) };
+
 /**
  * Retrieves a Buffer's metadata value.
  *
@@ -59,6 +111,17 @@ const static IMapper::MetadataType ArmMetadataType_PLANE_FDS{ GRALLOC_ARM_METADA
  */
 void get_metadata(const private_handle_t *handle, const IMapper::MetadataType &metadataType, IMapper::get_cb hidl_cb);
 
+/**
+ * Describes the SBWC compression of a buffer as a human readable string.
+ *
+ * @param handle [in]  The private handle of the buffer.
+ * @param out    [out] Lossy rate, header/body size of each plane and the bytes saved
+ *                     versus the equivalent linear NV12/P010 allocation.
+ *
+ * @return true if the buffer uses an SBWC format; false otherwise.
+ */
+bool describe_sbwc(const private_handle_t *handle, std::string *out);
+
 /**
  * Sets a Buffer's metadata value.
  *
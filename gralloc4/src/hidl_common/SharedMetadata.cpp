@@ -16,7 +16,10 @@
  * limitations under the License.
  */
 
+#include <sched.h>
+
 #include "SharedMetadata.h"
+#include "core/mali_gralloc_fingerprint.h"
 #include "core/mali_gralloc_reference.h"
 #include "mali_gralloc_log.h"
 #include "mali_gralloc_usages.h"
@@ -29,6 +32,83 @@ namespace mapper
 namespace common
 {
 
+/*
+ * Attempts to get the seq guarded fields before giving up. A producer that dies
+ * or stalls inside its critical section leaves the count odd; no process, in
+ * particular composition, may wait on another for longer than this.
+ */
+#define SHARED_METADATA_MAX_RETRIES 1000
+
+/*
+ * Runs fn as the only writer of the seq guarded fields. The buffer can be
+ * imported by several processes, so a process mutex cannot serialise them;
+ * the sequence count doubles as a spin lock while it is odd.
+ *
+ * @return false, without running fn, if another writer held the count for
+ *         SHARED_METADATA_MAX_RETRIES attempts.
+ */
+template <typename F>
+static bool shared_metadata_write(shared_metadata *metadata, F fn)
+{
+	uint32_t seq = metadata->seq.load(std::memory_order_relaxed);
+	for (int retries = 0;; retries++)
+	{
+		if ((seq & 1) == 0 &&
+		    metadata->seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire,
+		                                        std::memory_order_relaxed))
+		{
+			break;
+		}
+		if (retries == SHARED_METADATA_MAX_RETRIES)
+		{
+			MALI_GRALLOC_LOGE("Shared metadata writer stuck at sequence %u, dropping the update", seq);
+			return false;
+		}
+		if (seq & 1)
+		{
+			sched_yield();
+			seq = metadata->seq.load(std::memory_order_relaxed);
+		}
+	}
+	std::atomic_thread_fence(std::memory_order_release);
+
+	fn();
+
+	metadata->seq.store(seq + 2, std::memory_order_release);
+	return true;
+}
+
+/*
+ * Runs fn until it reads the seq guarded fields without a writer interleaving.
+ *
+ * @return false if no consistent read was made in SHARED_METADATA_MAX_RETRIES
+ *         attempts; the output of fn must then be discarded.
+ */
+template <typename F>
+static bool shared_metadata_read(const shared_metadata *metadata, F fn)
+{
+	for (int retries = 0; retries < SHARED_METADATA_MAX_RETRIES; retries++)
+	{
+		const uint32_t seq = metadata->seq.load(std::memory_order_acquire);
+		if (seq & 1)
+		{
+			sched_yield();
+			continue;
+		}
+
+		fn();
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (metadata->seq.load(std::memory_order_relaxed) == seq)
+		{
+			return true;
+		}
+	}
+
+	MALI_GRALLOC_LOGE("Shared metadata writer stuck at sequence %u", metadata->seq.load(std::memory_order_relaxed));
+	return false;
+}
+
 void shared_metadata_init(void *memory, std::string_view name)
 {
 	new(memory) shared_metadata(name);
@@ -162,6 +242,66 @@ android::status_t set_smpte2094_40(const private_handle_t *hnd, const std::optio
 	return android::OK;
 }
 
+void get_dirty_region(const private_handle_t *hnd, std::optional<Rect> *dirty_region)
+{
+	auto *metadata = reinterpret_cast<shared_metadata *>(mali_gralloc_reference_get_metadata_addr(hnd).value());
+	if (!shared_metadata_read(metadata, [&]() { *dirty_region = metadata->dirty_region.to_std_optional(); }))
+	{
+		/* Nothing is known about what the producer wrote */
+		*dirty_region = Rect{ 0, 0, hnd->width, hnd->height };
+	}
+}
+
+void set_dirty_region(const private_handle_t *hnd, const std::optional<Rect> &dirty_region)
+{
+	auto *metadata = reinterpret_cast<shared_metadata *>(mali_gralloc_reference_get_metadata_addr(hnd).value());
+	shared_metadata_write(metadata, [&]() { metadata->dirty_region = aligned_optional(dirty_region); });
+}
+
+void add_dirty_region(const private_handle_t *hnd, const Rect &region)
+{
+	auto *metadata = reinterpret_cast<shared_metadata *>(mali_gralloc_reference_get_metadata_addr(hnd).value());
+
+	/* Producer unlocks and the consumer reset can race from different processes */
+	shared_metadata_write(metadata, [&]() {
+		std::optional<Rect> dirty_region = metadata->dirty_region.to_std_optional();
+		if (dirty_region.has_value())
+		{
+			dirty_region->left = std::min(dirty_region->left, region.left);
+			dirty_region->top = std::min(dirty_region->top, region.top);
+			dirty_region->right = std::max(dirty_region->right, region.right);
+			dirty_region->bottom = std::max(dirty_region->bottom, region.bottom);
+		}
+		else
+		{
+			dirty_region = region;
+		}
+		metadata->dirty_region = aligned_optional(dirty_region);
+	});
+}
+
+void get_content_fingerprint(const private_handle_t *hnd, uint64_t *fingerprint, uint64_t *generation)
+{
+	auto *metadata = reinterpret_cast<shared_metadata *>(mali_gralloc_reference_get_metadata_addr(hnd).value());
+	if (!shared_metadata_read(metadata, [&]() {
+		    *fingerprint = metadata->fingerprint;
+		    *generation = metadata->fingerprint_generation;
+	    }))
+	{
+		*fingerprint = MALI_GRALLOC_FINGERPRINT_UNKNOWN;
+		*generation = 0;
+	}
+}
+
+void publish_content_fingerprint(const private_handle_t *hnd, uint64_t fingerprint)
+{
+	auto *metadata = reinterpret_cast<shared_metadata *>(mali_gralloc_reference_get_metadata_addr(hnd).value());
+	shared_metadata_write(metadata, [&]() {
+		metadata->fingerprint = fingerprint;
+		metadata->fingerprint_generation++;
+	});
+}
+
 void* get_video_hdr(const private_handle_t *hnd) {
 	auto *metadata = reinterpret_cast<shared_metadata *>(mali_gralloc_reference_get_metadata_addr(hnd).value());
 	return &(metadata->video_private_data);
@@ -67,6 +67,13 @@ android::status_t set_cta861_3(const private_handle_t *hnd, const std::optional<
 void get_smpte2094_40(const private_handle_t *hnd, std::optional<std::vector<uint8_t>> *smpte2094_40);
 android::status_t set_smpte2094_40(const private_handle_t *hnd, const std::optional<std::vector<uint8_t>> &smpte2094_40);
 
+void get_dirty_region(const private_handle_t *hnd, std::optional<Rect> *dirty_region);
+void set_dirty_region(const private_handle_t *hnd, const std::optional<Rect> &dirty_region);
+void add_dirty_region(const private_handle_t *hnd, const Rect &region);
+
+void get_content_fingerprint(const private_handle_t *hnd, uint64_t *fingerprint, uint64_t *generation);
+void publish_content_fingerprint(const private_handle_t *hnd, uint64_t fingerprint);
+
 void* get_video_hdr(const private_handle_t *hnd);
 
 void* get_video_roiinfo(const private_handle_t *hnd);
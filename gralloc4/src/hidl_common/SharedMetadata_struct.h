@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <optional>
 #include <vector>
 #include <VendorVideoAPI.h>
@@ -108,6 +109,16 @@ struct shared_metadata
 	aligned_optional<Smpte2086> smpte2086 {};
 	aligned_inline_vector<uint8_t, 2048> smpte2094_40 {};
 	aligned_inline_vector<char, 256> name {};
+	/*
+	 * Sequence count guarding the fields below, which processes update with
+	 * read-modify-write. Odd while a writer is in its critical section.
+	 */
+	std::atomic<uint32_t> seq {0};
+	/* Union of the CPU write lock regions since the consumer last reset it */
+	aligned_optional<Rect> dirty_region {};
+	/* Content fingerprint and the number of times it was published, see GRALLOC_USAGE_CONTENT_FINGERPRINT */
+	uint64_t fingerprint {};
+	uint64_t fingerprint_generation {};
 
 	shared_metadata() = default;
 
@@ -125,6 +136,8 @@ struct shared_metadata
 	}
 };
 
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared_metadata::seq is shared between processes");
+
 /* TODO: convert alignment assert taking video metadata into account */
 #if 0
 static_assert(offsetof(shared_metadata, blend_mode) == 0, "bad alignment");
@@ -153,6 +153,8 @@ struct private_handle_t
 	{
 		PRIV_FLAGS_USES_2PRIVATE_DATA = 1U << 4,
 		PRIV_FLAGS_USES_3PRIVATE_DATA = 1U << 5,
+		/* Handle aliasing part of another buffer, see VendorGraphicBufferView */
+		PRIV_FLAGS_VIEW = 1U << 6,
 	};
 
 	enum
@@ -222,8 +224,9 @@ struct private_handle_t
 	 * layer_count:  Number of layers allocated to buffer.
 	 *               All layers are the same size (in bytes).
 	 *               Multi-layers supported in v1.0, where GRALLOC1_CAPABILITY_LAYERED_BUFFERS is enabled.
-	 *               Layer size: 'size' / 'layer_count'.
-	 *               Layer (n) offset: n * ('size' / 'layer_count'), n=0 for the first layer.
+	 *               'size' also holds padding after the last layer, so use
+	 *               mali_gralloc_get_layer_size() for the layer size.
+	 *               Layer (n) offset: n * layer size, n=0 for the first layer.
 	 *
 	 */
 	uint64_t alloc_format DEFAULT_INITIALIZER(0);
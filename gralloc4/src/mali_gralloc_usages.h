@@ -78,6 +78,8 @@ typedef enum
 	GRALLOC_USAGE_GOOGLE_IP_BW                             = GRALLOC_USAGE_PRIVATE_16, /* Alias to BO */
 	GRALLOC_USAGE_GOOGLE_IP_BIG                            = GRALLOC_USAGE_PRIVATE_16, /* Alias to BO/BW */
 	GRALLOC_USAGE_GOOGLE_IP_MFC                            = GRALLOC_USAGE_PRIVATE_17,
+	/* Fingerprint the content at CPU write unlock, see GchipsMetadataType::CONTENT_FINGERPRINT */
+	GRALLOC_USAGE_CONTENT_FINGERPRINT                      = GRALLOC_USAGE_PRIVATE_19,
 
 	/* FaceAuth specific usages. */
 	GS101_GRALLOC_USAGE_TPU_INPUT                          = GRALLOC_USAGE_PRIVATE_5,
@@ -144,6 +146,7 @@ static const uint64_t VALID_USAGE =
     /* Google specific usages */
     GRALLOC_USAGE_GOOGLE_IP_BIG |           /* 1U << 51 */
     GRALLOC_USAGE_GOOGLE_IP_MFC |           /* 1U << 50 */
+    GRALLOC_USAGE_CONTENT_FINGERPRINT |     /* 1U << 48 */
 
     GS101_GRALLOC_USAGE_TPU_INPUT |         /* 1U << 62 */
     GS101_GRALLOC_USAGE_TPU_OUTPUT |        /* 1U << 31 */
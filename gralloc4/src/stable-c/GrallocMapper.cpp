@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2020 Arm Limited. All rights reserved.
+ *
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stable-C (AIMapper, Mapper 5) front end of the common mapper core.
+ *
+ * Calls go straight to hidl_common/Mapper.cpp: no binder or passthrough
+ * shim, no Return<> wrappers, results written to the caller's memory, and
+ * metadata types passed by pointer instead of being copied into hidl types.
+ */
+
+#include <android/hardware/graphics/mapper/IMapper.h>
+#include <android/hardware/graphics/mapper/utils/IMapperProvider.h>
+
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "hidl_common/Mapper.h"
+#include "hidl_common/MapperMetadata.h"
+#include "mali_gralloc_buffer.h"
+#include "mali_gralloc_log.h"
+
+namespace arm
+{
+namespace mapper
+{
+
+using android::hardware::hidl_vec;
+
+static_assert(static_cast<int32_t>(Error::NONE) == AIMAPPER_ERROR_NONE);
+static_assert(static_cast<int32_t>(Error::BAD_DESCRIPTOR) == AIMAPPER_ERROR_BAD_DESCRIPTOR);
+static_assert(static_cast<int32_t>(Error::BAD_BUFFER) == AIMAPPER_ERROR_BAD_BUFFER);
+static_assert(static_cast<int32_t>(Error::BAD_VALUE) == AIMAPPER_ERROR_BAD_VALUE);
+static_assert(static_cast<int32_t>(Error::NO_RESOURCES) == AIMAPPER_ERROR_NO_RESOURCES);
+static_assert(static_cast<int32_t>(Error::UNSUPPORTED) == AIMAPPER_ERROR_UNSUPPORTED);
+
+static inline AIMapper_Error toAIMapperError(Error error)
+{
+	return static_cast<AIMapper_Error>(error);
+}
+
+/* Wraps the caller's name string without copying it */
+static IMapper::MetadataType toMetadataType(const char *name, int64_t value)
+{
+	IMapper::MetadataType metadataType;
+	metadataType.name.setToExternal(name, strlen(name));
+	metadataType.value = value;
+	return metadataType;
+}
+
+static inline void *toBuffer(buffer_handle_t buffer)
+{
+	return const_cast<native_handle_t *>(buffer);
+}
+
+class GrallocMapper final : public vendor::mapper::IMapperV5Impl
+{
+public:
+	AIMapper_Error importBuffer(const native_handle_t *handle, buffer_handle_t *outBufferHandle) override
+	{
+		return toAIMapperError(common::importBuffer(handle, outBufferHandle));
+	}
+
+	AIMapper_Error freeBuffer(buffer_handle_t buffer) override
+	{
+		return toAIMapperError(common::freeBuffer(toBuffer(buffer)));
+	}
+
+	AIMapper_Error getTransportSize(buffer_handle_t buffer, uint32_t *outNumFds, uint32_t *outNumInts) override
+	{
+		return toAIMapperError(common::getTransportSize(toBuffer(buffer), outNumFds, outNumInts));
+	}
+
+	AIMapper_Error lock(buffer_handle_t buffer, uint64_t cpuUsage, ARect accessRegion, int acquireFence,
+	                    void **outData) override
+	{
+		const IMapper::Rect rect = { accessRegion.left, accessRegion.top, accessRegion.right - accessRegion.left,
+		                             accessRegion.bottom - accessRegion.top };
+		const Error error = common::lock(toBuffer(buffer), cpuUsage, rect, acquireFence, outData);
+
+		/* Unlike IMapper 4.0, the acquire fence is owned by the mapper */
+		if (acquireFence >= 0)
+		{
+			close(acquireFence);
+		}
+		return toAIMapperError(error);
+	}
+
+	AIMapper_Error unlock(buffer_handle_t buffer, int *releaseFence) override
+	{
+		return toAIMapperError(common::unlock(toBuffer(buffer), releaseFence));
+	}
+
+	AIMapper_Error flushLockedBuffer(buffer_handle_t buffer) override
+	{
+		return toAIMapperError(common::flushLockedBuffer(toBuffer(buffer)));
+	}
+
+	AIMapper_Error rereadLockedBuffer(buffer_handle_t buffer) override
+	{
+		return toAIMapperError(common::rereadLockedBuffer(toBuffer(buffer)));
+	}
+
+	int32_t getMetadata(buffer_handle_t buffer, AIMapper_MetadataType metadataType, void *destBuffer,
+	                    size_t destBufferSize) override
+	{
+		return get(buffer, toMetadataType(metadataType.name, metadataType.value), destBuffer, destBufferSize);
+	}
+
+	int32_t getStandardMetadata(buffer_handle_t buffer, int64_t standardMetadataType, void *destBuffer,
+	                            size_t destBufferSize) override
+	{
+		return get(buffer, toMetadataType(GRALLOC4_STANDARD_METADATA_TYPE, standardMetadataType), destBuffer,
+		           destBufferSize);
+	}
+
+	AIMapper_Error setMetadata(buffer_handle_t buffer, AIMapper_MetadataType metadataType, const void *metadata,
+	                           size_t metadataSize) override
+	{
+		return set(buffer, toMetadataType(metadataType.name, metadataType.value), metadata, metadataSize);
+	}
+
+	AIMapper_Error setStandardMetadata(buffer_handle_t buffer, int64_t standardMetadataType, const void *metadata,
+	                                   size_t metadataSize) override
+	{
+		return set(buffer, toMetadataType(GRALLOC4_STANDARD_METADATA_TYPE, standardMetadataType), metadata,
+		           metadataSize);
+	}
+
+	AIMapper_Error listSupportedMetadataTypes(const AIMapper_MetadataTypeDescription **outDescriptionList,
+	                                          size_t *outNumberOfDescriptions) override
+	{
+		std::call_once(mDescriptionsOnce, [this]() { buildDescriptions(); });
+
+		*outDescriptionList = mDescriptions.data();
+		*outNumberOfDescriptions = mDescriptions.size();
+		return AIMAPPER_ERROR_NONE;
+	}
+
+	AIMapper_Error dumpBuffer(buffer_handle_t buffer, AIMapper_DumpBufferCallback dumpBufferCallback,
+	                          void *context) override
+	{
+		return toAIMapperError(common::dumpBuffer(toBuffer(buffer), [&](const IMapper::MetadataType &metadataType,
+		                                                                 const hidl_vec<uint8_t> &value) {
+			dumpBufferCallback(context, AIMapper_MetadataType{ metadataType.name.c_str(), metadataType.value },
+			                   value.data(), value.size());
+		}));
+	}
+
+	AIMapper_Error dumpAllBuffers(AIMapper_BeginDumpBufferCallback beginDumpBufferCallback,
+	                              AIMapper_DumpBufferCallback dumpBufferCallback, void *context) override
+	{
+		common::dumpBuffers([&]() { beginDumpBufferCallback(context); },
+		                    [&](const IMapper::MetadataType &metadataType, const hidl_vec<uint8_t> &value) {
+			dumpBufferCallback(context, AIMapper_MetadataType{ metadataType.name.c_str(), metadataType.value },
+			                   value.data(), value.size());
+		});
+		return AIMAPPER_ERROR_NONE;
+	}
+
+	AIMapper_Error getReservedRegion(buffer_handle_t buffer, void **outReservedRegion,
+	                                 uint64_t *outReservedSize) override
+	{
+		return toAIMapperError(common::getReservedRegion(toBuffer(buffer), outReservedRegion, outReservedSize));
+	}
+
+private:
+	/*
+	 * Returns the size of the encoded value, copied to destBuffer only if it
+	 * fits, or a negated AIMapper_Error.
+	 */
+	int32_t get(buffer_handle_t buffer, const IMapper::MetadataType &metadataType, void *destBuffer,
+	            size_t destBufferSize)
+	{
+		Error error = Error::NONE;
+		int32_t size = 0;
+
+		common::get(toBuffer(buffer), metadataType, [&](Error tmpError, const hidl_vec<uint8_t> &value) {
+			error = tmpError;
+			if (error != Error::NONE)
+			{
+				return;
+			}
+
+			size = static_cast<int32_t>(value.size());
+			if (destBuffer != nullptr && value.size() <= destBufferSize)
+			{
+				memcpy(destBuffer, value.data(), value.size());
+			}
+		});
+
+		return error == Error::NONE ? size : -static_cast<int32_t>(error);
+	}
+
+	AIMapper_Error set(buffer_handle_t buffer, const IMapper::MetadataType &metadataType, const void *metadata,
+	                   size_t metadataSize)
+	{
+		/* Wraps the caller's bytes; set_metadata only reads them */
+		hidl_vec<uint8_t> value;
+		value.setToExternal(static_cast<uint8_t *>(const_cast<void *>(metadata)), metadataSize);
+
+		return toAIMapperError(common::set(toBuffer(buffer), metadataType, value));
+	}
+
+	/* Same list as the HIDL mapper, kept in storage that outlives the call */
+	void buildDescriptions()
+	{
+		common::listSupportedMetadataTypes([this](Error, const hidl_vec<IMapper::MetadataTypeDescription> &list) {
+			mStrings.reserve(list.size() * 2);
+			for (const auto &entry : list)
+			{
+				mStrings.emplace_back(entry.metadataType.name);
+				mStrings.emplace_back(entry.description);
+			}
+
+			size_t i = 0;
+			for (const auto &entry : list)
+			{
+				AIMapper_MetadataTypeDescription description{};
+				description.metadataType.name = mStrings[i++].c_str();
+				description.metadataType.value = entry.metadataType.value;
+				description.description = mStrings[i++].c_str();
+				description.isGettable = entry.isGettable;
+				description.isSettable = entry.isSettable;
+				mDescriptions.push_back(description);
+			}
+		});
+	}
+
+	std::once_flag mDescriptionsOnce;
+	std::vector<std::string> mStrings;
+	std::vector<AIMapper_MetadataTypeDescription> mDescriptions;
+};
+
+} // namespace mapper
+} // namespace arm
+
+extern "C" uint32_t ANDROID_HAL_MAPPER_VERSION = AIMAPPER_VERSION_5;
+
+extern "C" AIMapper_Error AIMapper_loadIMapper(AIMapper **outImplementation)
+{
+	static vendor::mapper::IMapperProvider<arm::mapper::GrallocMapper> provider;
+
+	MALI_GRALLOC_LOGV("Arm Module AIMapper %d, pid = %d", AIMAPPER_VERSION_5, getpid());
+	return provider.load(outImplementation);
+}
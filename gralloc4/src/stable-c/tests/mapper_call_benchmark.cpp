@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2020 ARM Limited. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <aidl/android/hardware/graphics/common/StandardMetadataType.h>
+#include <android/hardware/graphics/mapper/4.0/IMapper.h>
+#include <android/hardware/graphics/mapper/IMapper.h>
+#include <android/hardware_buffer.h>
+#include <benchmark/benchmark.h>
+#include <dlfcn.h>
+#include <gralloctypes/Gralloc4.h>
+#include <unistd.h>
+#include <vndk/hardware_buffer.h>
+
+#include <cstdint>
+
+/*
+ * Per-call cost of the stable-C mapper (mapper.pixel) against the HIDL
+ * passthrough mapper 4.0, on the same buffer: import/free, a CPU lock/unlock
+ * cycle and a standard metadata get. Both end up in the same common mapper
+ * code, so the difference is the front end.
+ */
+namespace {
+
+using aidl::android::hardware::graphics::common::StandardMetadataType;
+using android::sp;
+using android::hardware::hidl_handle;
+using android::hardware::hidl_vec;
+using android::hardware::graphics::mapper::V4_0::Error;
+using android::hardware::graphics::mapper::V4_0::IMapper;
+
+#if defined(__LP64__)
+#define MAPPER_LIBRARY "/vendor/lib64/hw/mapper.pixel.so"
+#else
+#define MAPPER_LIBRARY "/vendor/lib/hw/mapper.pixel.so"
+#endif
+
+constexpr uint64_t kCpuUsage = AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN;
+
+struct mappers
+{
+	sp<IMapper> hidl;
+	AIMapper *stable_c = nullptr;
+	AHardwareBuffer *buffer = nullptr;
+	const native_handle_t *handle = nullptr;
+};
+
+const mappers &get_mappers()
+{
+	static const mappers m = []() {
+		mappers result;
+		result.hidl = IMapper::getService();
+
+		void *library = dlopen(MAPPER_LIBRARY, RTLD_LOCAL | RTLD_NOW);
+		auto load = library ? reinterpret_cast<decltype(&AIMapper_loadIMapper)>(dlsym(library, "AIMapper_loadIMapper"))
+		                    : nullptr;
+		if (load == nullptr || load(&result.stable_c) != AIMAPPER_ERROR_NONE)
+		{
+			result.stable_c = nullptr;
+		}
+
+		const AHardwareBuffer_Desc desc = {
+			.width = 1920,
+			.height = 1080,
+			.layers = 1,
+			.format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM,
+			.usage = kCpuUsage | AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE,
+		};
+		if (AHardwareBuffer_allocate(&desc, &result.buffer) == 0)
+		{
+			result.handle = AHardwareBuffer_getNativeHandle(result.buffer);
+		}
+		return result;
+	}();
+	return m;
+}
+
+void *hidl_import(const mappers &m)
+{
+	void *imported = nullptr;
+	m.hidl->importBuffer(hidl_handle(m.handle), [&](Error error, void *buffer) {
+		if (error == Error::NONE)
+		{
+			imported = buffer;
+		}
+	});
+	return imported;
+}
+
+buffer_handle_t stable_c_import(const mappers &m)
+{
+	buffer_handle_t imported = nullptr;
+	if (m.stable_c->v5.importBuffer(m.handle, &imported) != AIMAPPER_ERROR_NONE)
+	{
+		return nullptr;
+	}
+	return imported;
+}
+
+bool check_hidl(benchmark::State &state, const mappers &m)
+{
+	if (m.hidl == nullptr || m.handle == nullptr)
+	{
+		state.SkipWithError("HIDL mapper or buffer unavailable");
+		return false;
+	}
+	return true;
+}
+
+bool check_stable_c(benchmark::State &state, const mappers &m)
+{
+	if (m.stable_c == nullptr || m.handle == nullptr)
+	{
+		state.SkipWithError("Failed to load " MAPPER_LIBRARY " or buffer unavailable");
+		return false;
+	}
+	return true;
+}
+
+void BM_hidl_import_free(benchmark::State &state)
+{
+	const mappers &m = get_mappers();
+	if (!check_hidl(state, m))
+	{
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		void *buffer = hidl_import(m);
+		m.hidl->freeBuffer(buffer);
+	}
+}
+BENCHMARK(BM_hidl_import_free);
+
+void BM_stable_c_import_free(benchmark::State &state)
+{
+	const mappers &m = get_mappers();
+	if (!check_stable_c(state, m))
+	{
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		buffer_handle_t buffer = stable_c_import(m);
+		m.stable_c->v5.freeBuffer(buffer);
+	}
+}
+BENCHMARK(BM_stable_c_import_free);
+
+void BM_hidl_lock_unlock(benchmark::State &state)
+{
+	const mappers &m = get_mappers();
+	if (!check_hidl(state, m))
+	{
+		return;
+	}
+
+	void *buffer = hidl_import(m);
+	const IMapper::Rect region = { 0, 0, 1920, 1080 };
+	for (auto _ : state)
+	{
+		m.hidl->lock(buffer, kCpuUsage, region, hidl_handle(), [](Error, void *data) {
+			benchmark::DoNotOptimize(data);
+		});
+		/* The release fence, if any, is closed with the hidl_handle */
+		m.hidl->unlock(buffer, [](Error, const hidl_handle &) {});
+	}
+	m.hidl->freeBuffer(buffer);
+}
+BENCHMARK(BM_hidl_lock_unlock);
+
+void BM_stable_c_lock_unlock(benchmark::State &state)
+{
+	const mappers &m = get_mappers();
+	if (!check_stable_c(state, m))
+	{
+		return;
+	}
+
+	buffer_handle_t buffer = stable_c_import(m);
+	const ARect region = { 0, 0, 1920, 1080 };
+	for (auto _ : state)
+	{
+		void *data = nullptr;
+		int release_fence = -1;
+		m.stable_c->v5.lock(buffer, kCpuUsage, region, -1, &data);
+		benchmark::DoNotOptimize(data);
+		m.stable_c->v5.unlock(buffer, &release_fence);
+		if (release_fence >= 0)
+		{
+			close(release_fence);
+		}
+	}
+	m.stable_c->v5.freeBuffer(buffer);
+}
+BENCHMARK(BM_stable_c_lock_unlock);
+
+void BM_hidl_get_width(benchmark::State &state)
+{
+	const mappers &m = get_mappers();
+	if (!check_hidl(state, m))
+	{
+		return;
+	}
+
+	void *buffer = hidl_import(m);
+	for (auto _ : state)
+	{
+		uint64_t width = 0;
+		m.hidl->get(buffer, android::gralloc4::MetadataType_Width, [&](Error, const hidl_vec<uint8_t> &value) {
+			android::gralloc4::decodeWidth(value, &width);
+		});
+		benchmark::DoNotOptimize(width);
+	}
+	m.hidl->freeBuffer(buffer);
+}
+BENCHMARK(BM_hidl_get_width);
+
+void BM_stable_c_get_width(benchmark::State &state)
+{
+	const mappers &m = get_mappers();
+	if (!check_stable_c(state, m))
+	{
+		return;
+	}
+
+	buffer_handle_t buffer = stable_c_import(m);
+	for (auto _ : state)
+	{
+		uint64_t width = 0;
+		m.stable_c->v5.getStandardMetadata(buffer, static_cast<int64_t>(StandardMetadataType::WIDTH), &width,
+		                                   sizeof(width));
+		benchmark::DoNotOptimize(width);
+	}
+	m.stable_c->v5.freeBuffer(buffer);
+}
+BENCHMARK(BM_stable_c_get_width);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HARDWARE_EXYNOS_EXYNOS_EXIF_WRITER_H__
+#define __HARDWARE_EXYNOS_EXYNOS_EXIF_WRITER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "ExynosExif.h"
+
+/*
+ * Serializes exif_attribute_t into a JPEG APP1 segment.
+ *
+ * The IFD layout (tags, types, counts, offsets and constant values) only
+ * depends on which optional blocks are enabled and on the length of the
+ * variable sized fields, so it is built once into an internal template and
+ * reused while those stay the same. Each write copies the template into the
+ * destination, which is normally the mapped JPEG output buffer, and patches
+ * the per-shot values in place at precomputed positions. No heap memory is
+ * used on either path.
+ *
+ * The segment is written little endian and starts with the APP1 marker, so
+ * the caller places it right after SOI. The thumbnail, if enabled, follows
+ * the 1st IFD at thumbnailOffset().
+ *
+ * An instance is not thread safe; use one per capture session.
+ */
+class ExynosExifWriter {
+public:
+    ExynosExifWriter();
+
+    /* Drops the cached template; the next call rebuilds it */
+    void reset() { mValid = false; }
+
+    /*
+     * Returns the size of the APP1 segment for exif and a thumbnail of
+     * thumbSize bytes, marker included, or 0 if it cannot be encoded.
+     */
+    size_t getSize(const exif_attribute_t *exif, size_t thumbSize);
+
+    /*
+     * Returns the offset of the thumbnail data from the start of the
+     * segment for the layout of exif, or 0 when there is no thumbnail.
+     */
+    size_t thumbnailOffset(const exif_attribute_t *exif);
+
+    /*
+     * Writes the APP1 segment into dst and returns the number of bytes
+     * written, or a negative errno. When thumb is NULL and thumbSize is not
+     * zero, the thumbnail area is reserved but left untouched so that the
+     * thumbnail can be encoded into place.
+     */
+    ssize_t write(const exif_attribute_t *exif, const void *thumb, size_t thumbSize,
+                  void *dst, size_t dstSize);
+
+    enum { MAX_PATCHES = 96 };
+
+    struct Patch {
+        uint16_t pos;
+        uint16_t src;
+        uint16_t count;
+        uint8_t kind;
+    };
+
+private:
+    enum { NUM_ASCII_FIELDS = 10 };
+
+    struct LayoutKey {
+        bool enableGps;
+        bool enableThumb;
+        unsigned int maker_note_size;
+        unsigned int user_comment_size;
+        uint8_t ascii_len[NUM_ASCII_FIELDS];
+    };
+
+    static void makeKey(const exif_attribute_t *exif, LayoutKey *key);
+    bool prepare(const exif_attribute_t *exif);
+    /* Builds the template for the layout in mKey */
+    bool build();
+
+    bool mValid;
+    LayoutKey mKey;
+
+    size_t mFixedSize;
+    size_t mThumbOffset;
+    size_t mNumPatches;
+    Patch mPatches[MAX_PATCHES];
+    uint8_t mTemplate[EXIF_INFO_LIMIT_SIZE];
+};
+
+#endif /* __HARDWARE_EXYNOS_EXYNOS_EXIF_WRITER_H__ */
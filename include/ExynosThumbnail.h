@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HARDWARE_EXYNOS_EXYNOS_THUMBNAIL_H__
+#define __HARDWARE_EXYNOS_EXYNOS_THUMBNAIL_H__
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * A semi-planar 4:2:0 image (NV12 or NV21) as laid out by gralloc.
+ *
+ * base[] are the CPU mappings of the buffer fds; for single fd formats both
+ * point to the same mapping. offset[] and stride[] are the per-plane values
+ * reported by gralloc (plane_info / VendorGraphicBufferMeta), in bytes.
+ */
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    void *base[2];
+    uint32_t offset[2];
+    uint32_t stride[2];
+    bool nv21;
+} exynos_thumbnail_image_t;
+
+typedef struct {
+    uint32_t left;
+    uint32_t top;
+    uint32_t width;
+    uint32_t height;
+} exynos_thumbnail_crop_t;
+
+/*
+ * Area averaging downscaler producing the input of the thumbnail encoder.
+ *
+ * Every source row of the crop is read exactly once: rows are summed into a
+ * widened accumulator with NEON (SSE2 on host builds) and each output row is
+ * then reduced horizontally. The accumulator is kept between calls, so
+ * after the first shot of a session scaling does not allocate.
+ */
+class ExynosThumbnailScaler {
+public:
+    /*
+     * Scales the crop of src (the whole image when crop is NULL) into dst.
+     * The crop origin is rounded down to even coordinates. Returns 0 or a
+     * negative errno.
+     */
+    int scale(const exynos_thumbnail_image_t *src, const exynos_thumbnail_crop_t *crop,
+              const exynos_thumbnail_image_t *dst);
+
+private:
+    std::vector<uint16_t> mAccum;
+};
+
+/*
+ * Runs ExynosThumbnailScaler on a dedicated thread so that the thumbnail is
+ * prepared while the main image is being encoded.
+ */
+class ExynosThumbnailWorker {
+public:
+    ExynosThumbnailWorker();
+    ~ExynosThumbnailWorker();
+
+    /*
+     * Queues a scaling job. The buffers must stay mapped until wait()
+     * returns. Returns -EBUSY if the previous job has not been waited for,
+     * even when it has already finished.
+     */
+    int start(const exynos_thumbnail_image_t *src, const exynos_thumbnail_crop_t *crop,
+              const exynos_thumbnail_image_t *dst);
+
+    /*
+     * Blocks until the queued job is done and returns its result. Returns
+     * -EINVAL when no job was started since the last wait().
+     */
+    int wait();
+
+private:
+    void threadLoop();
+
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::thread mThread;
+
+    bool mQueued;   /* started, not yet picked up by the thread */
+    bool mBusy;     /* started, not yet finished */
+    bool mPending;  /* started, not yet waited for */
+    bool mExit;
+    int mResult;
+
+    exynos_thumbnail_image_t mSrc;
+    exynos_thumbnail_image_t mDst;
+    exynos_thumbnail_crop_t mCrop;
+    bool mHasCrop;
+
+    ExynosThumbnailScaler mScaler;
+};
+
+#endif /* __HARDWARE_EXYNOS_EXYNOS_THUMBNAIL_H__ */
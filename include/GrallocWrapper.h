@@ -17,6 +17,10 @@
 #ifndef ANDROID_SLSI_GRALLOC2WRAPPER_H
 #define ANDROID_SLSI_GRALLOC2WRAPPER_H
 
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
 #include <string>
 
 #include <android/hardware/graphics/allocator/2.0/IAllocator.h>
@@ -73,6 +77,47 @@ private:
     sp<IMapper> mMapper;
 };
 
+// An allocation started with Allocator::allocateAsync
+class AsyncAllocation {
+public:
+    // Called on the allocation thread for each buffer, in order, as soon as
+    // it is allocated and imported.  The callee owns the handle.
+    using BufferCallback = std::function<void(uint32_t index, buffer_handle_t handle, uint32_t stride)>;
+
+    // Waits for the allocation thread; the buffers not allocated yet are
+    // cancelled first.
+    ~AsyncAllocation()
+    {
+        cancel();
+        if (mResult.valid()) {
+            mResult.wait();
+        }
+    }
+
+    // Stops allocating.  The buffers already handed to the callback stay
+    // valid; the one being allocated, if any, is freed instead of delivered.
+    void cancel() { mCancelled.store(true, std::memory_order_relaxed); }
+
+    bool isCancelled() const { return mCancelled.load(std::memory_order_relaxed); }
+
+    // Number of buffers handed to the callback so far
+    uint32_t deliveredCount() const { return mDelivered.load(std::memory_order_acquire); }
+
+    // Blocks until the allocation completes, fails or is cancelled.  Returns
+    // the first allocation error, or Error::NONE (check isCancelled() and
+    // deliveredCount() after a cancellation).
+    Error wait() const { return mResult.get(); }
+
+    const std::shared_future<Error>& future() const { return mResult; }
+
+private:
+    friend class Allocator;
+
+    std::atomic<bool> mCancelled{false};
+    std::atomic<uint32_t> mDelivered{0};
+    std::shared_future<Error> mResult;
+};
+
 // A wrapper to IAllocator
 class Allocator {
 public:
@@ -113,6 +158,63 @@ public:
         return allocate(descriptorInfo, 1, outStride, outBufferHandle);
     }
 
+    /*
+     * Allocates "count" buffers one by one on a separate thread and hands
+     * each one to onBuffer as soon as it is imported, so the caller can
+     * start using the first buffers while the rest are still allocated.
+     * The allocator (and its mapper) must outlive the returned object;
+     * destroying it cancels the remaining buffers and waits for the thread.
+     */
+    std::unique_ptr<AsyncAllocation> allocateAsync(BufferDescriptor descriptor, uint32_t count,
+            AsyncAllocation::BufferCallback onBuffer) const
+    {
+        std::unique_ptr<AsyncAllocation> allocation(new AsyncAllocation());
+        AsyncAllocation* state = allocation.get();
+
+        allocation->mResult = std::async(std::launch::async,
+                [this, state, descriptor, count, onBuffer]() {
+                    for (uint32_t i = 0; i < count; i++) {
+                        if (state->isCancelled()) {
+                            break;
+                        }
+
+                        uint32_t stride = 0;
+                        buffer_handle_t handle = nullptr;
+                        Error error = allocate(descriptor, 1, &stride, &handle);
+                        if (error != Error::NONE) {
+                            return error;
+                        }
+
+                        // Cancelled while allocating: nobody expects this one
+                        if (state->isCancelled()) {
+                            mMapper.freeBuffer(handle);
+                            break;
+                        }
+
+                        onBuffer(i, handle, stride);
+                        state->mDelivered.fetch_add(1, std::memory_order_release);
+                    }
+                    return Error::NONE;
+                }).share();
+
+        return allocation;
+    }
+
+    std::unique_ptr<AsyncAllocation> allocateAsync(const IMapper::BufferDescriptorInfo& descriptorInfo,
+            uint32_t count, AsyncAllocation::BufferCallback onBuffer) const
+    {
+        BufferDescriptor descriptor;
+        Error error = mMapper.createDescriptor(descriptorInfo, &descriptor);
+        if (error != Error::NONE) {
+            std::unique_ptr<AsyncAllocation> allocation(new AsyncAllocation());
+            std::promise<Error> result;
+            result.set_value(error);
+            allocation->mResult = result.get_future().share();
+            return allocation;
+        }
+        return allocateAsync(descriptor, count, std::move(onBuffer));
+    }
+
 private:
     const Mapper& mMapper;
     sp<IAllocator> mAllocator;
@@ -0,0 +1,432 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXYNOS_AUDIOHAL_FORMAT_CONVERT_H__
+#define __EXYNOS_AUDIOHAL_FORMAT_CONVERT_H__
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <system/audio.h>
+
+/*
+ * Sample Format and Channel Conversion Kernels
+ *
+ * Used by the proxy write/read paths when the PCM device runs in another
+ * format or channel count than the stream (proxy_get_actual_format(),
+ * proxy_get_actual_channel_count()), e.g. 16-bit streams on a UHQA/SUHQA
+ * 24/32-bit device.
+ *
+ * The common 16/32/float conversions and the stereo/mono mixes have NEON
+ * kernels; every kernel has a scalar tail and a scalar fallback for host
+ * builds. audio_format_convert() picks a direct kernel when there is one,
+ * otherwise it converts in blocks through an int32 intermediate. The blocks
+ * are sized in samples, so the scratch on the stack of the stream thread
+ * stays at 2 KB whatever the channel count.
+ */
+
+#define AUDIO_CONVERT_MAX_CHANNELS  8
+#define AUDIO_CONVERT_BLOCK_SAMPLES 256     // Per int32 scratch block
+
+static inline int16_t convert_clamp16(int32_t v)
+{
+    return (v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : (int16_t)v;
+}
+
+static inline int32_t convert_float_to_i32(float f)
+{
+    /* NaN, converting it to an integer is undefined */
+    if (f != f)
+        return 0;
+    if (f >= 1.0f)
+        return INT32_MAX;
+    if (f <= -1.0f)
+        return INT32_MIN;
+    return (int32_t)(f * 2147483648.0f);
+}
+
+// Format Conversion Kernels (count is the number of samples)
+static inline void audio_convert_i16_to_i32(int32_t *dst, const int16_t *src, size_t count)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t v = vld1q_s16(src + i);
+        vst1q_s32(dst + i, vshll_n_s16(vget_low_s16(v), 16));
+        vst1q_s32(dst + i + 4, vshll_n_s16(vget_high_s16(v), 16));
+    }
+#endif
+    for (; i < count; i++)
+        dst[i] = (int32_t)((uint32_t)src[i] << 16);
+}
+
+static inline void audio_convert_i32_to_i16(int16_t *dst, const int32_t *src, size_t count)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 8 <= count; i += 8) {
+        int16x4_t lo = vqrshrn_n_s32(vld1q_s32(src + i), 16);
+        int16x4_t hi = vqrshrn_n_s32(vld1q_s32(src + i + 4), 16);
+        vst1q_s16(dst + i, vcombine_s16(lo, hi));
+    }
+#endif
+    for (; i < count; i++)
+        dst[i] = convert_clamp16((int32_t)(((int64_t)src[i] + 0x8000) >> 16));
+}
+
+static inline void audio_convert_i16_to_float(float *dst, const int16_t *src, size_t count)
+{
+    const float scale = 1.0f / 32768.0f;
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t v = vld1q_s16(src + i);
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+    }
+#endif
+    for (; i < count; i++)
+        dst[i] = src[i] * scale;
+}
+
+static inline void audio_convert_float_to_i16(int16_t *dst, const float *src, size_t count)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 8 <= count; i += 8) {
+        /* The fixed point conversion saturates, the narrowing rounds */
+        int32x4_t lo = vcvtq_n_s32_f32(vld1q_f32(src + i), 31);
+        int32x4_t hi = vcvtq_n_s32_f32(vld1q_f32(src + i + 4), 31);
+        vst1q_s16(dst + i, vcombine_s16(vqrshrn_n_s32(lo, 16), vqrshrn_n_s32(hi, 16)));
+    }
+#endif
+    for (; i < count; i++)
+        dst[i] = convert_clamp16((int32_t)(((int64_t)convert_float_to_i32(src[i]) + 0x8000) >> 16));
+}
+
+static inline void audio_convert_i32_to_float(float *dst, const int32_t *src, size_t count)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 4 <= count; i += 4)
+        vst1q_f32(dst + i, vcvtq_n_f32_s32(vld1q_s32(src + i), 31));
+#endif
+    for (; i < count; i++)
+        dst[i] = src[i] * (1.0f / 2147483648.0f);
+}
+
+static inline void audio_convert_float_to_i32(int32_t *dst, const float *src, size_t count)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 4 <= count; i += 4)
+        vst1q_s32(dst + i, vcvtq_n_s32_f32(vld1q_f32(src + i), 31));
+#endif
+    for (; i < count; i++)
+        dst[i] = convert_float_to_i32(src[i]);
+}
+
+/* AUDIO_FORMAT_PCM_8_24_BIT is Q8.23 in 32 bits */
+static inline void audio_convert_q8_23_to_i32(int32_t *dst, const int32_t *src, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        int32_t v = src[i];
+        dst[i] = (v > 0x7FFFFF) ? INT32_MAX : (v < -0x800000) ? INT32_MIN : (int32_t)((uint32_t)v << 8);
+    }
+}
+
+static inline void audio_convert_i32_to_q8_23(int32_t *dst, const int32_t *src, size_t count)
+{
+    /* Rounds like the packed 24 bit path */
+    for (size_t i = 0; i < count; i++) {
+        int64_t v = ((int64_t)src[i] + 0x80) >> 8;
+        dst[i] = (v > 0x7FFFFF) ? 0x7FFFFF : (int32_t)v;
+    }
+}
+
+static inline void audio_convert_p24_to_i32(int32_t *dst, const uint8_t *src, size_t count)
+{
+    for (size_t i = 0; i < count; i++, src += 3)
+        dst[i] = (int32_t)((uint32_t)src[0] << 8 | (uint32_t)src[1] << 16 | (uint32_t)src[2] << 24);
+}
+
+static inline void audio_convert_i32_to_p24(uint8_t *dst, const int32_t *src, size_t count)
+{
+    for (size_t i = 0; i < count; i++, dst += 3) {
+        int64_t v = ((int64_t)src[i] + 0x80) >> 8;
+        if (v > 0x7FFFFF)
+            v = 0x7FFFFF;
+        dst[0] = v & 0xFF;
+        dst[1] = (v >> 8) & 0xFF;
+        dst[2] = (v >> 16) & 0xFF;
+    }
+}
+
+// Channel Conversion Kernels (frames)
+static inline void audio_convert_mono_to_stereo_i16(int16_t *dst, const int16_t *src, size_t frames)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t v;
+        v.val[0] = v.val[1] = vld1q_s16(src + i);
+        vst2q_s16(dst + 2 * i, v);
+    }
+#endif
+    for (; i < frames; i++)
+        dst[2 * i] = dst[2 * i + 1] = src[i];
+}
+
+static inline void audio_convert_stereo_to_mono_i16(int16_t *dst, const int16_t *src, size_t frames)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t v = vld2q_s16(src + 2 * i);
+        vst1q_s16(dst + i, vhaddq_s16(v.val[0], v.val[1]));
+    }
+#endif
+    for (; i < frames; i++)
+        dst[i] = (int16_t)(((int32_t)src[2 * i] + src[2 * i + 1]) >> 1);
+}
+
+static inline void audio_deinterleave_stereo_i16(int16_t *left, int16_t *right, const int16_t *src, size_t frames)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t v = vld2q_s16(src + 2 * i);
+        vst1q_s16(left + i, v.val[0]);
+        vst1q_s16(right + i, v.val[1]);
+    }
+#endif
+    for (; i < frames; i++) {
+        left[i] = src[2 * i];
+        right[i] = src[2 * i + 1];
+    }
+}
+
+static inline void audio_interleave_stereo_i16(int16_t *dst, const int16_t *left, const int16_t *right, size_t frames)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t v;
+        v.val[0] = vld1q_s16(left + i);
+        v.val[1] = vld1q_s16(right + i);
+        vst2q_s16(dst + 2 * i, v);
+    }
+#endif
+    for (; i < frames; i++) {
+        dst[2 * i] = left[i];
+        dst[2 * i + 1] = right[i];
+    }
+}
+
+/*
+ * Generic int32 channel adaptation: mono is copied to the first two output
+ * channels, a mono output averages the first two inputs, otherwise common
+ * channels are copied and extra output channels are silent.
+ */
+static inline void audio_convert_channels_i32(int32_t *dst, uint32_t dst_ch, const int32_t *src,
+                                              uint32_t src_ch, size_t frames)
+{
+    for (size_t f = 0; f < frames; f++, dst += dst_ch, src += src_ch) {
+        uint32_t c = 0;
+
+        if (src_ch == 1) {
+            for (; c < dst_ch && c < 2; c++)
+                dst[c] = src[0];
+        } else if (dst_ch == 1) {
+            dst[c++] = (src[0] >> 1) + (src[1] >> 1);
+        } else {
+            for (; c < dst_ch && c < src_ch; c++)
+                dst[c] = src[c];
+        }
+
+        for (; c < dst_ch; c++)
+            dst[c] = 0;
+    }
+}
+
+// Dispatcher
+static inline int audio_convert_to_i32(int32_t *dst, audio_format_t format, const void *src, size_t count)
+{
+    switch (format) {
+    case AUDIO_FORMAT_PCM_16_BIT:
+        audio_convert_i16_to_i32(dst, (const int16_t *)src, count);
+        return 0;
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+        audio_convert_q8_23_to_i32(dst, (const int32_t *)src, count);
+        return 0;
+    case AUDIO_FORMAT_PCM_24_BIT_PACKED:
+        audio_convert_p24_to_i32(dst, (const uint8_t *)src, count);
+        return 0;
+    case AUDIO_FORMAT_PCM_32_BIT:
+        memcpy(dst, src, count * sizeof(int32_t));
+        return 0;
+    case AUDIO_FORMAT_PCM_FLOAT:
+        audio_convert_float_to_i32(dst, (const float *)src, count);
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+static inline int audio_convert_from_i32(void *dst, audio_format_t format, const int32_t *src, size_t count)
+{
+    switch (format) {
+    case AUDIO_FORMAT_PCM_16_BIT:
+        audio_convert_i32_to_i16((int16_t *)dst, src, count);
+        return 0;
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+        audio_convert_i32_to_q8_23((int32_t *)dst, src, count);
+        return 0;
+    case AUDIO_FORMAT_PCM_24_BIT_PACKED:
+        audio_convert_i32_to_p24((uint8_t *)dst, src, count);
+        return 0;
+    case AUDIO_FORMAT_PCM_32_BIT:
+        memcpy(dst, src, count * sizeof(int32_t));
+        return 0;
+    case AUDIO_FORMAT_PCM_FLOAT:
+        audio_convert_i32_to_float((float *)dst, src, count);
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+/* Formats audio_convert_to_i32() / audio_convert_from_i32() handle */
+static inline bool audio_convert_format_supported(audio_format_t format)
+{
+    switch (format) {
+    case AUDIO_FORMAT_PCM_16_BIT:
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+    case AUDIO_FORMAT_PCM_24_BIT_PACKED:
+    case AUDIO_FORMAT_PCM_32_BIT:
+    case AUDIO_FORMAT_PCM_FLOAT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*
+ * Converts frames of interleaved audio; returns 0 or -EINVAL. Only a plain
+ * copy (same format and channel count) accepts other formats, e.g. PCM_8_BIT.
+ */
+static inline int audio_format_convert(void *dst, audio_format_t dst_format, uint32_t dst_ch,
+                                       const void *src, audio_format_t src_format, uint32_t src_ch,
+                                       size_t frames)
+{
+    int32_t in[AUDIO_CONVERT_BLOCK_SAMPLES];
+    int32_t out[AUDIO_CONVERT_BLOCK_SAMPLES];
+    size_t src_frame, dst_frame, block;
+
+    if (dst_ch == 0 || src_ch == 0 || dst_ch > AUDIO_CONVERT_MAX_CHANNELS || src_ch > AUDIO_CONVERT_MAX_CHANNELS)
+        return -EINVAL;
+
+    src_frame = audio_bytes_per_sample(src_format) * src_ch;
+    dst_frame = audio_bytes_per_sample(dst_format) * dst_ch;
+    if (src_frame == 0 || dst_frame == 0)
+        return -EINVAL;
+
+    if (src_format == dst_format && src_ch == dst_ch) {
+        memmove(dst, src, frames * src_frame);
+        return 0;
+    }
+
+    /* Checked up front so that a failure leaves dst untouched */
+    if (!audio_convert_format_supported(src_format) || !audio_convert_format_supported(dst_format))
+        return -EINVAL;
+
+    /* Direct kernels */
+    if (src_ch == dst_ch) {
+        size_t count = frames * src_ch;
+
+        if (src_format == AUDIO_FORMAT_PCM_16_BIT && dst_format == AUDIO_FORMAT_PCM_32_BIT) {
+            audio_convert_i16_to_i32((int32_t *)dst, (const int16_t *)src, count);
+            return 0;
+        }
+        if (src_format == AUDIO_FORMAT_PCM_32_BIT && dst_format == AUDIO_FORMAT_PCM_16_BIT) {
+            audio_convert_i32_to_i16((int16_t *)dst, (const int32_t *)src, count);
+            return 0;
+        }
+        if (src_format == AUDIO_FORMAT_PCM_16_BIT && dst_format == AUDIO_FORMAT_PCM_FLOAT) {
+            audio_convert_i16_to_float((float *)dst, (const int16_t *)src, count);
+            return 0;
+        }
+        if (src_format == AUDIO_FORMAT_PCM_FLOAT && dst_format == AUDIO_FORMAT_PCM_16_BIT) {
+            audio_convert_float_to_i16((int16_t *)dst, (const float *)src, count);
+            return 0;
+        }
+    } else if (src_format == AUDIO_FORMAT_PCM_16_BIT && dst_format == AUDIO_FORMAT_PCM_16_BIT) {
+        if (src_ch == 1 && dst_ch == 2) {
+            audio_convert_mono_to_stereo_i16((int16_t *)dst, (const int16_t *)src, frames);
+            return 0;
+        }
+        if (src_ch == 2 && dst_ch == 1) {
+            audio_convert_stereo_to_mono_i16((int16_t *)dst, (const int16_t *)src, frames);
+            return 0;
+        }
+    }
+
+    /* Blocks through int32 */
+    const uint8_t *s = (const uint8_t *)src;
+    uint8_t *d = (uint8_t *)dst;
+
+    block = AUDIO_CONVERT_BLOCK_SAMPLES / (src_ch > dst_ch ? src_ch : dst_ch);
+    while (frames > 0) {
+        size_t n = frames < block ? frames : block;
+
+        int ret = audio_convert_to_i32(in, src_format, s, n * src_ch);
+        if (ret != 0)
+            return ret;
+        if (src_ch != dst_ch) {
+            audio_convert_channels_i32(out, dst_ch, in, src_ch, n);
+            ret = audio_convert_from_i32(d, dst_format, out, n * dst_ch);
+        } else {
+            ret = audio_convert_from_i32(d, dst_format, in, n * dst_ch);
+        }
+        if (ret != 0)
+            return ret;
+
+        s += n * src_frame;
+        d += n * dst_frame;
+        frames -= n;
+    }
+
+    return 0;
+}
+
+#endif  // __EXYNOS_AUDIOHAL_FORMAT_CONVERT_H__
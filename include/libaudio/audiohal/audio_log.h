@@ -17,19 +17,66 @@
 #ifndef __EXYNOS_AUDIOHAL_LOG_H__
 #define __EXYNOS_AUDIOHAL_LOG_H__
 
+#include <log/log.h>
 
-char * audiomode_table[AUDIO_MODE_CNT] = {
+/*
+ * AUDIO_MODE_CNT comes from the framework and grows with new releases, so
+ * these two tables are not checked for coverage like the ones in
+ * audio_tables.h; the lookups below return "unknown" for missing entries.
+ */
+__attribute__((weak, visibility("hidden"))) const char * const audiomode_table[AUDIO_MODE_CNT] = {
     [AUDIO_MODE_NORMAL]             = "normal mode",
     [AUDIO_MODE_RINGTONE]           = "ringtone mode",
     [AUDIO_MODE_IN_CALL]            = "in_call mode",
     [AUDIO_MODE_IN_COMMUNICATION]   = "in_comm mode",
 };
 
-char * callmode_table[CALL_MODE_CNT] = {
+__attribute__((weak, visibility("hidden"))) const char * const callmode_table[CALL_MODE_CNT] = {
     [CALL_OFF]      = "Call Off",
     [VOICE_CALL]    = "Voice Call Mode",
     [VOLTE_CALL]    = "VoLTE Call Mode",
     [VOWIFI_CALL]   = "VoWiFi Call Mode",
 };
 
-#endif  // __EXYNOS_AUDIOHAL_LOG_H__
\ No newline at end of file
+static inline const char *audio_mode_name(int mode)
+{
+    if (mode < 0 || mode >= AUDIO_MODE_CNT || audiomode_table[mode] == NULL)
+        return "unknown";
+    return audiomode_table[mode];
+}
+
+static inline const char *audio_call_mode_name(int mode)
+{
+    if (mode < 0 || mode >= CALL_MODE_CNT || callmode_table[mode] == NULL)
+        return "unknown";
+    return callmode_table[mode];
+}
+
+/*
+ * Log macros for hot paths. ALOGD/ALOGI evaluate their arguments even when
+ * the tag is filtered out; these ones skip the whole call, table lookups
+ * included, when the priority is disabled. Priorities below
+ * AUDIOHAL_LOG_MIN_PRIORITY are removed at compile time, the others are
+ * checked against the runtime log level of LOG_TAG first, with the same
+ * VERBOSE default as liblog so nothing ALOGD/ALOGV printed is lost.
+ */
+#ifndef AUDIOHAL_LOG_MIN_PRIORITY
+#if LOG_NDEBUG
+#define AUDIOHAL_LOG_MIN_PRIORITY   ANDROID_LOG_DEBUG
+#else
+#define AUDIOHAL_LOG_MIN_PRIORITY   ANDROID_LOG_VERBOSE
+#endif
+#endif
+
+#define AUDIOHAL_LOG_PRI(priority, ...)                                                     \
+    do {                                                                                    \
+        if ((priority) >= AUDIOHAL_LOG_MIN_PRIORITY &&                                      \
+            __android_log_is_loggable((priority), LOG_TAG, ANDROID_LOG_VERBOSE))            \
+            __android_log_print((priority), LOG_TAG, __VA_ARGS__);                          \
+    } while (0)
+
+#define AUDIOHAL_LOGV(...)  AUDIOHAL_LOG_PRI(ANDROID_LOG_VERBOSE, __VA_ARGS__)
+#define AUDIOHAL_LOGD(...)  AUDIOHAL_LOG_PRI(ANDROID_LOG_DEBUG, __VA_ARGS__)
+#define AUDIOHAL_LOGI(...)  AUDIOHAL_LOG_PRI(ANDROID_LOG_INFO, __VA_ARGS__)
+
+#endif  // __EXYNOS_AUDIOHAL_LOG_H__
@@ -0,0 +1,515 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXYNOS_AUDIOHAL_MIXER_CACHE_H__
+#define __EXYNOS_AUDIOHAL_MIXER_CACHE_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Name Indexed Mixer Control Cache
+ *
+ * Backs proxy_set_mixer_value_* / proxy_get_mixer_value_*. The control list
+ * is hashed once at init so a lookup no longer walks every control by name,
+ * and the last value written to each control is remembered so that writes
+ * of an unchanged value do not reach the driver.
+ *
+ * Writes issued between begin_batch and end_batch (one route change) are
+ * queued, deduplicated per control and applied together at end_batch, which
+ * also records how long the route change took. Reads of a control with a
+ * queued write return the queued value.
+ *
+ * The cache may be used from several threads. A batch holds the cache lock
+ * from begin_batch to end_batch, so other threads' mixer accesses wait for
+ * the route change to complete instead of joining it. Batches nest on the
+ * owning thread (e.g. a route change that calls a helper which batches its
+ * own writes): only the outermost begin_batch starts the queue and only the
+ * outermost end_batch applies it.
+ *
+ * The mixer is reached through audio_mixer_backend, so the cache can run on
+ * top of tinyalsa or of a fake backend on host.
+ */
+
+struct audio_mixer_backend {
+    void *mixer;
+    unsigned int (*get_num_ctls)(void *mixer);
+    void *(*get_ctl)(void *mixer, unsigned int id);
+    const char *(*get_ctl_name)(void *ctl);
+    int (*set_int)(void *ctl, int value);                   // Sets every value of the control
+    int (*set_string)(void *ctl, const char *value);
+    int (*set_array)(void *ctl, const void *value, size_t count);
+    int (*get_int)(void *ctl);
+    int (*get_array)(void *ctl, void *value, size_t count);
+};
+
+#define AUDIO_MIXER_BATCH_MAX       128
+#define AUDIO_MIXER_BATCH_ARENA     4096
+
+enum {
+    MIXER_MEMO_NONE = 0,
+    MIXER_MEMO_INT,
+    MIXER_MEMO_STRING,
+    MIXER_MEMO_ARRAY,
+};
+
+struct audio_mixer_cache_entry {
+    uint64_t hash;
+    void *ctl;
+    int memo_kind;
+    int memo_int;
+    void *memo_data;        // Bytes of the last string (without NUL) or array written
+    size_t memo_len;
+};
+
+struct audio_mixer_batch_op {
+    struct audio_mixer_cache_entry *entry;
+    int kind;
+    int value;
+    const void *data;       // Points into the batch arena
+    size_t count;
+};
+
+struct audio_mixer_cache_stats {
+    uint64_t lookups;
+    uint64_t misses;
+    uint64_t writes;
+    uint64_t skipped;
+    uint64_t batches;
+    uint32_t last_batch_writes;
+    uint32_t last_batch_skipped;
+    int64_t  last_batch_ns;
+    int64_t  max_batch_ns;
+};
+
+struct audio_mixer_cache {
+    struct audio_mixer_backend backend;
+    pthread_mutex_t lock;   // Recursive, held by the batch owner for the whole batch
+
+    struct audio_mixer_cache_entry *table;
+    size_t mask;
+
+    uint32_t batch_depth;   // Nesting level of begin_batch, 0 outside a batch
+    int64_t batch_start_ns;
+    uint32_t batch_count;
+    size_t arena_used;
+    struct audio_mixer_batch_op batch[AUDIO_MIXER_BATCH_MAX];
+    uint8_t arena[AUDIO_MIXER_BATCH_ARENA];
+
+    struct audio_mixer_cache_stats stats;
+};
+
+// Internal Utility Functions
+static inline uint64_t mixer_cache_hash(const void *data, size_t len, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    uint64_t hash = seed;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+#define MIXER_CACHE_HASH_SEED   0xcbf29ce484222325ULL
+
+static inline int64_t mixer_cache_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline struct audio_mixer_cache_entry *mixer_cache_find(struct audio_mixer_cache *cache,
+                                                               const char *name, bool insert)
+{
+    uint64_t hash = mixer_cache_hash(name, strlen(name), MIXER_CACHE_HASH_SEED);
+    size_t idx = hash & cache->mask;
+
+    while (cache->table[idx].ctl != NULL) {
+        struct audio_mixer_cache_entry *entry = &cache->table[idx];
+
+        if (entry->hash == hash && !strcmp(cache->backend.get_ctl_name(entry->ctl), name))
+            return insert ? NULL : entry;
+        idx = (idx + 1) & cache->mask;
+    }
+
+    if (insert) {
+        cache->table[idx].hash = hash;
+        return &cache->table[idx];
+    }
+
+    return NULL;
+}
+
+static inline struct audio_mixer_cache_entry *mixer_cache_lookup(struct audio_mixer_cache *cache,
+                                                                 const char *name)
+{
+    struct audio_mixer_cache_entry *entry;
+
+    cache->stats.lookups++;
+    entry = mixer_cache_find(cache, name, false);
+    if (entry == NULL)
+        cache->stats.misses++;
+
+    return entry;
+}
+
+// Returns true if the write reached the backend
+static inline bool mixer_cache_apply(struct audio_mixer_cache *cache, struct audio_mixer_cache_entry *entry,
+                                     int kind, int value, const void *data, size_t count)
+{
+    size_t len = 0;
+    int ret;
+
+    if (kind == MIXER_MEMO_STRING)
+        len = strlen((const char *)data);
+    else if (kind == MIXER_MEMO_ARRAY)
+        len = count;
+
+    /* Compare the bytes themselves, a hash collision must not drop a write */
+    if (entry->memo_kind == kind &&
+        ((kind == MIXER_MEMO_INT && entry->memo_int == value) ||
+         (kind != MIXER_MEMO_INT && entry->memo_len == len &&
+          (len == 0 || !memcmp(entry->memo_data, data, len))))) {
+        cache->stats.skipped++;
+        return false;
+    }
+
+    if (kind == MIXER_MEMO_INT)
+        ret = cache->backend.set_int(entry->ctl, value);
+    else if (kind == MIXER_MEMO_STRING)
+        ret = cache->backend.set_string(entry->ctl, (const char *)data);
+    else
+        ret = cache->backend.set_array(entry->ctl, data, count);
+
+    cache->stats.writes++;
+
+    /* Only remember values the driver accepted */
+    entry->memo_kind = MIXER_MEMO_NONE;
+    if (ret == 0 && kind != MIXER_MEMO_INT) {
+        void *memo = entry->memo_len >= len ? entry->memo_data : realloc(entry->memo_data, len);
+
+        if (memo != NULL || len == 0) {
+            if (len > 0) {
+                memcpy(memo, data, len);
+                entry->memo_data = memo;
+            }
+            entry->memo_len = len;
+            entry->memo_kind = kind;
+        }
+    } else if (ret == 0) {
+        entry->memo_kind = kind;
+    }
+    entry->memo_int = value;
+
+    return true;
+}
+
+static inline void mixer_cache_flush_batch(struct audio_mixer_cache *cache)
+{
+    for (uint32_t i = 0; i < cache->batch_count; i++) {
+        struct audio_mixer_batch_op *op = &cache->batch[i];
+
+        if (op->entry == NULL)
+            continue;
+        if (mixer_cache_apply(cache, op->entry, op->kind, op->value, op->data, op->count))
+            cache->stats.last_batch_writes++;
+        else
+            cache->stats.last_batch_skipped++;
+    }
+
+    cache->batch_count = 0;
+    cache->arena_used = 0;
+}
+
+static inline struct audio_mixer_batch_op *mixer_cache_pending(struct audio_mixer_cache *cache,
+                                                               struct audio_mixer_cache_entry *entry)
+{
+    if (cache->batch_depth == 0)
+        return NULL;
+
+    for (uint32_t i = 0; i < cache->batch_count; i++) {
+        if (cache->batch[i].entry == entry)
+            return &cache->batch[i];
+    }
+
+    return NULL;
+}
+
+/*
+ * Applies the queued write of a control out of order, for reads the queued
+ * value cannot answer directly (e.g. an int control read as an array)
+ */
+static inline void mixer_cache_apply_pending(struct audio_mixer_cache *cache, struct audio_mixer_batch_op *op)
+{
+    if (mixer_cache_apply(cache, op->entry, op->kind, op->value, op->data, op->count))
+        cache->stats.last_batch_writes++;
+    else
+        cache->stats.last_batch_skipped++;
+    op->entry = NULL;
+}
+
+static inline void mixer_cache_write(struct audio_mixer_cache *cache, const char *name,
+                                     int kind, int value, const void *data, size_t count)
+{
+    struct audio_mixer_cache_entry *entry = mixer_cache_lookup(cache, name);
+
+    if (entry == NULL)
+        return;
+
+    if (cache->batch_depth == 0) {
+        mixer_cache_apply(cache, entry, kind, value, data, count);
+        return;
+    }
+
+    /* A later write to the same control replaces the queued one */
+    struct audio_mixer_batch_op *queued = mixer_cache_pending(cache, entry);
+    if (queued != NULL) {
+        queued->entry = NULL;
+        cache->stats.last_batch_skipped++;
+    }
+
+    if (kind == MIXER_MEMO_STRING)
+        count = strlen((const char *)data) + 1;
+
+    if (cache->batch_count == AUDIO_MIXER_BATCH_MAX ||
+        cache->arena_used + count > AUDIO_MIXER_BATCH_ARENA)
+        mixer_cache_flush_batch(cache);
+
+    if (count > AUDIO_MIXER_BATCH_ARENA) {
+        mixer_cache_apply(cache, entry, kind, value, data, count);
+        return;
+    }
+
+    struct audio_mixer_batch_op *op = &cache->batch[cache->batch_count++];
+    op->entry = entry;
+    op->kind = kind;
+    op->value = value;
+    op->count = (kind == MIXER_MEMO_STRING) ? 0 : count;
+    op->data = NULL;
+    if (kind != MIXER_MEMO_INT) {
+        memcpy(cache->arena + cache->arena_used, data, count);
+        op->data = cache->arena + cache->arena_used;
+        cache->arena_used += count;
+    }
+}
+
+// Mixer Cache Functions
+static inline bool audio_mixer_cache_init(struct audio_mixer_cache *cache,
+                                          const struct audio_mixer_backend *backend)
+{
+    unsigned int num_ctls = backend->get_num_ctls(backend->mixer);
+    size_t capacity = 16;
+
+    pthread_mutexattr_t attr;
+
+    memset(cache, 0, sizeof(*cache));
+    cache->backend = *backend;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&cache->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    while (capacity < (size_t)num_ctls * 2)
+        capacity <<= 1;
+
+    cache->table = (struct audio_mixer_cache_entry *)calloc(capacity, sizeof(*cache->table));
+    if (cache->table == NULL) {
+        pthread_mutex_destroy(&cache->lock);
+        return false;
+    }
+    cache->mask = capacity - 1;
+
+    for (unsigned int id = 0; id < num_ctls; id++) {
+        void *ctl = backend->get_ctl(backend->mixer, id);
+        const char *name = ctl ? backend->get_ctl_name(ctl) : NULL;
+        struct audio_mixer_cache_entry *entry;
+
+        if (name == NULL)
+            continue;
+
+        /* Keep the first control of a duplicated name, like mixer_get_ctl_by_name() */
+        entry = mixer_cache_find(cache, name, true);
+        if (entry != NULL)
+            entry->ctl = ctl;
+    }
+
+    return true;
+}
+
+static inline void audio_mixer_cache_deinit(struct audio_mixer_cache *cache)
+{
+    for (size_t i = 0; i <= cache->mask; i++)
+        free(cache->table[i].memo_data);
+    free(cache->table);
+    cache->table = NULL;
+    pthread_mutex_destroy(&cache->lock);
+}
+
+/* Forgets every remembered value, e.g. after the codec or the DSP was reset */
+static inline void audio_mixer_cache_invalidate(struct audio_mixer_cache *cache)
+{
+    pthread_mutex_lock(&cache->lock);
+    for (size_t i = 0; i <= cache->mask; i++)
+        cache->table[i].memo_kind = MIXER_MEMO_NONE;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+static inline void *audio_mixer_cache_get_ctl(struct audio_mixer_cache *cache, const char *name)
+{
+    struct audio_mixer_cache_entry *entry;
+
+    pthread_mutex_lock(&cache->lock);
+    entry = mixer_cache_lookup(cache, name);
+    pthread_mutex_unlock(&cache->lock);
+
+    return entry ? entry->ctl : NULL;
+}
+
+static inline void audio_mixer_cache_set_int(struct audio_mixer_cache *cache, const char *name, int value)
+{
+    pthread_mutex_lock(&cache->lock);
+    mixer_cache_write(cache, name, MIXER_MEMO_INT, value, NULL, 0);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+static inline void audio_mixer_cache_set_string(struct audio_mixer_cache *cache, const char *name,
+                                                const char *value)
+{
+    pthread_mutex_lock(&cache->lock);
+    mixer_cache_write(cache, name, MIXER_MEMO_STRING, 0, value, 0);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/* count is the size of value in bytes */
+static inline void audio_mixer_cache_set_array(struct audio_mixer_cache *cache, const char *name,
+                                               const void *value, size_t count)
+{
+    pthread_mutex_lock(&cache->lock);
+    mixer_cache_write(cache, name, MIXER_MEMO_ARRAY, 0, value, count);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+static inline int audio_mixer_cache_get_int(struct audio_mixer_cache *cache, const char *name)
+{
+    struct audio_mixer_cache_entry *entry;
+    struct audio_mixer_batch_op *op;
+    int ret = -1;
+
+    pthread_mutex_lock(&cache->lock);
+    entry = mixer_cache_lookup(cache, name);
+    if (entry != NULL) {
+        op = mixer_cache_pending(cache, entry);
+        if (op != NULL && op->kind == MIXER_MEMO_INT) {
+            ret = op->value;
+        } else {
+            if (op != NULL)
+                mixer_cache_apply_pending(cache, op);
+            ret = cache->backend.get_int(entry->ctl);
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return ret;
+}
+
+static inline int audio_mixer_cache_get_array(struct audio_mixer_cache *cache, const char *name,
+                                              void *value, size_t count)
+{
+    struct audio_mixer_cache_entry *entry;
+    struct audio_mixer_batch_op *op;
+    int ret = -1;
+
+    pthread_mutex_lock(&cache->lock);
+    entry = mixer_cache_lookup(cache, name);
+    if (entry != NULL) {
+        op = mixer_cache_pending(cache, entry);
+        if (op != NULL && op->kind == MIXER_MEMO_ARRAY && count <= op->count) {
+            memcpy(value, op->data, count);
+            ret = 0;
+        } else {
+            if (op != NULL)
+                mixer_cache_apply_pending(cache, op);
+            ret = cache->backend.get_array(entry->ctl, value, count);
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return ret;
+}
+
+// Route Change Batch Functions
+static inline void audio_mixer_cache_begin_batch(struct audio_mixer_cache *cache)
+{
+    /* Released by end_batch */
+    pthread_mutex_lock(&cache->lock);
+    if (cache->batch_depth++ > 0)
+        return;
+
+    cache->batch_start_ns = mixer_cache_now_ns();
+    cache->batch_count = 0;
+    cache->arena_used = 0;
+    cache->stats.last_batch_writes = 0;
+    cache->stats.last_batch_skipped = 0;
+}
+
+/* Must pair with a begin_batch on the same thread */
+static inline void audio_mixer_cache_end_batch(struct audio_mixer_cache *cache)
+{
+    int64_t elapsed;
+
+    if (--cache->batch_depth == 0) {
+        mixer_cache_flush_batch(cache);
+
+        elapsed = mixer_cache_now_ns() - cache->batch_start_ns;
+        cache->stats.last_batch_ns = elapsed;
+        if (elapsed > cache->stats.max_batch_ns)
+            cache->stats.max_batch_ns = elapsed;
+        cache->stats.batches++;
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+}
+
+static inline void audio_mixer_cache_dump(struct audio_mixer_cache *cache, int fd)
+{
+    struct audio_mixer_cache_stats stats;
+    const struct audio_mixer_cache_stats *s = &stats;
+
+    pthread_mutex_lock(&cache->lock);
+    stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+
+    dprintf(fd, "\tMixer Cache: lookups %llu (misses %llu), writes %llu, skipped %llu\n",
+            (unsigned long long)s->lookups, (unsigned long long)s->misses,
+            (unsigned long long)s->writes, (unsigned long long)s->skipped);
+    dprintf(fd, "\tRoute Changes: %llu, last %lld us (%u writes, %u skipped), max %lld us\n",
+            (unsigned long long)s->batches, (long long)(s->last_batch_ns / 1000),
+            s->last_batch_writes, s->last_batch_skipped, (long long)(s->max_batch_ns / 1000));
+}
+
+#endif  // __EXYNOS_AUDIOHAL_MIXER_CACHE_H__
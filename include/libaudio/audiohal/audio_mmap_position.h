@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXYNOS_AUDIOHAL_MMAP_POSITION_H__
+#define __EXYNOS_AUDIOHAL_MMAP_POSITION_H__
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Shared MMAP Position Ring
+ *
+ * For ASTREAM_PLAYBACK_MMAP / ASTREAM_CAPTURE_MMAP. The proxy publishes the
+ * DMA position and its timestamp into this block, which lives in memory
+ * shared with the readers (e.g. a memfd mapped next to the MMAP buffer).
+ * Readers then get the position without calling into the proxy:
+ * audio_mmap_position_read() costs a couple of loads and never blocks.
+ *
+ * There is one writer. Each update fills the next slot of a small history
+ * ring under a seqlock; readers retry only if they raced with an update.
+ * The history lets readers estimate the actual rate of the DMA clock.
+ */
+
+#define AUDIO_MMAP_POSITION_MAGIC       0x4D4D5053  // "MMPS"
+#define AUDIO_MMAP_POSITION_VERSION     1
+#define AUDIO_MMAP_POSITION_RING        8           // Power of two
+
+struct audio_mmap_position_slot {
+    atomic_int_least64_t frames;
+    atomic_int_least64_t time_ns;
+};
+
+struct audio_mmap_position_shm {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sample_rate;
+    uint32_t buffer_frames;
+
+    atomic_uint_least32_t seq;          // Odd while an update is in progress
+    atomic_uint_least32_t count;        // Updates published so far
+    struct audio_mmap_position_slot ring[AUDIO_MMAP_POSITION_RING];
+};
+
+static inline void audio_mmap_position_init(struct audio_mmap_position_shm *shm, uint32_t sample_rate,
+                                            uint32_t buffer_frames)
+{
+    memset(shm, 0, sizeof(*shm));
+    shm->magic = AUDIO_MMAP_POSITION_MAGIC;
+    shm->version = AUDIO_MMAP_POSITION_VERSION;
+    shm->sample_rate = sample_rate;
+    shm->buffer_frames = buffer_frames;
+}
+
+// Writer (proxy) Function
+static inline void audio_mmap_position_update(struct audio_mmap_position_shm *shm, int64_t frames, int64_t time_ns)
+{
+    uint32_t seq = atomic_load_explicit(&shm->seq, memory_order_relaxed);
+    uint32_t count = atomic_load_explicit(&shm->count, memory_order_relaxed);
+    struct audio_mmap_position_slot *slot = &shm->ring[count & (AUDIO_MMAP_POSITION_RING - 1)];
+
+    atomic_store_explicit(&shm->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&slot->frames, frames, memory_order_relaxed);
+    atomic_store_explicit(&slot->time_ns, time_ns, memory_order_relaxed);
+    atomic_store_explicit(&shm->count, count + 1, memory_order_relaxed);
+
+    atomic_store_explicit(&shm->seq, seq + 2, memory_order_release);
+}
+
+// Reader Functions
+/* Returns the latest published position, false if none was published yet */
+static inline bool audio_mmap_position_read(struct audio_mmap_position_shm *shm, int64_t *frames, int64_t *time_ns)
+{
+    uint32_t seq, count;
+    int64_t f, t;
+
+    if (shm->magic != AUDIO_MMAP_POSITION_MAGIC)
+        return false;
+
+    do {
+        seq = atomic_load_explicit(&shm->seq, memory_order_acquire);
+        if (seq & 1)
+            continue;
+
+        count = atomic_load_explicit(&shm->count, memory_order_relaxed);
+        if (count == 0)
+            return false;
+
+        const struct audio_mmap_position_slot *slot = &shm->ring[(count - 1) & (AUDIO_MMAP_POSITION_RING - 1)];
+        f = atomic_load_explicit(&slot->frames, memory_order_relaxed);
+        t = atomic_load_explicit(&slot->time_ns, memory_order_relaxed);
+
+        atomic_thread_fence(memory_order_acquire);
+    } while ((seq & 1) || seq != atomic_load_explicit(&shm->seq, memory_order_relaxed));
+
+    *frames = f;
+    *time_ns = t;
+    return true;
+}
+
+/*
+ * Extrapolates the position at now_ns from the latest update, using the rate
+ * measured over the history ring (the nominal rate until it is full).
+ */
+static inline bool audio_mmap_position_estimate(struct audio_mmap_position_shm *shm, int64_t now_ns, int64_t *frames)
+{
+    uint32_t seq, count;
+    int64_t f0, t0, f1, t1;
+    bool measured;
+
+    if (shm->magic != AUDIO_MMAP_POSITION_MAGIC)
+        return false;
+
+    do {
+        seq = atomic_load_explicit(&shm->seq, memory_order_acquire);
+        if (seq & 1)
+            continue;
+
+        count = atomic_load_explicit(&shm->count, memory_order_relaxed);
+        if (count == 0)
+            return false;
+
+        uint32_t last = (count - 1) & (AUDIO_MMAP_POSITION_RING - 1);
+        uint32_t first = (count >= AUDIO_MMAP_POSITION_RING) ? count & (AUDIO_MMAP_POSITION_RING - 1) : 0;
+
+        f1 = atomic_load_explicit(&shm->ring[last].frames, memory_order_relaxed);
+        t1 = atomic_load_explicit(&shm->ring[last].time_ns, memory_order_relaxed);
+        f0 = atomic_load_explicit(&shm->ring[first].frames, memory_order_relaxed);
+        t0 = atomic_load_explicit(&shm->ring[first].time_ns, memory_order_relaxed);
+        measured = count >= AUDIO_MMAP_POSITION_RING;
+
+        atomic_thread_fence(memory_order_acquire);
+    } while ((seq & 1) || seq != atomic_load_explicit(&shm->seq, memory_order_relaxed));
+
+    if (measured && t1 > t0)
+        *frames = f1 + (int64_t)((double)(now_ns - t1) * (f1 - f0) / (t1 - t0));
+    else
+        *frames = f1 + (now_ns - t1) * (int64_t)shm->sample_rate / 1000000000LL;
+
+    return true;
+}
+
+#endif  // __EXYNOS_AUDIOHAL_MMAP_POSITION_H__
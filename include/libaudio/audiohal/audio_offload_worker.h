@@ -0,0 +1,445 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXYNOS_AUDIOHAL_OFFLOAD_WORKER_H__
+#define __EXYNOS_AUDIOHAL_OFFLOAD_WORKER_H__
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "audio_offload.h"
+
+/*
+ * Event Driven Compress Offload Worker
+ *
+ * Replaces the offload message thread that handled one OFFLOAD_MSG_* at a
+ * time. Posting a message sets its bit in an atomic pending mask and only
+ * signals the eventfd when the mask was empty, so the mask works as a
+ * lock-free queue that coalesces repeated messages: ten WAIT_WRITE posts
+ * before the worker runs cost one wakeup and one wait.
+ *
+ * On every wakeup the worker drains the whole mask in stream order (write
+ * wait, then partial drain, then drain), so a gapless partial drain
+ * followed by the next WAIT_WRITE is handled without going back to sleep.
+ * When the compress device fd is pollable, WAIT_WRITE is armed on epoll
+ * instead of blocking.
+ *
+ * The worker itself never blocks in the compress device: drains, and
+ * WAIT_WRITE without a pollable fd, are handed to a waiter thread that runs
+ * them one at a time in the same order. While one of them is in progress
+ * the worker keeps taking messages, a pause or flush can cancel the waits
+ * with audio_offload_worker_cancel(), and EXIT is handled at once. Every
+ * posted message gets a completion: waits that are cancelled, or still
+ * queued at EXIT, complete with -ECANCELED.
+ */
+
+struct audio_offload_ops {
+    void *cookie;
+    int poll_fd;                                // Compress fd for EPOLLOUT, or -1
+    int (*wait_write)(void *cookie);            // Blocking wait, used when poll_fd < 0
+    int (*drain)(void *cookie);
+    int (*partial_drain)(void *cookie);
+    /*
+     * Makes a blocking wait in progress return early, e.g. compress_stop().
+     * Called on cancel and at exit; may be NULL, then they wait for it.
+     */
+    void (*interrupt)(void *cookie);
+    /*
+     * Called when a message completed, from the worker or waiter thread, or
+     * from the thread calling cancel or stop for the waits they cancel
+     */
+    void (*callback)(void *cookie, offload_msg_type msg, int ret);
+};
+
+struct audio_offload_worker_stats {
+    atomic_uint_least64_t posted[OFFLOAD_MSG_MAX];
+    atomic_uint_least64_t handled[OFFLOAD_MSG_MAX];
+    atomic_uint_least64_t cancelled;
+    atomic_uint_least64_t coalesced;
+    atomic_uint_least64_t wakeups;
+    atomic_uint_least64_t spurious;
+    atomic_int_least64_t  max_latency_ns;
+};
+
+/* Internal request to the worker, above the offload_msg_type bits */
+#define OFFLOAD_WORKER_CANCEL_WRITE     (1u << OFFLOAD_MSG_MAX)
+#define OFFLOAD_WORKER_WAIT_MASK        ((1u << OFFLOAD_MSG_WAIT_WRITE) | \
+                                         (1u << OFFLOAD_MSG_WAIT_PARTIAL_DRAIN) | \
+                                         (1u << OFFLOAD_MSG_WAIT_DRAIN))
+
+struct audio_offload_worker {
+    struct audio_offload_ops ops;
+    pthread_t thread;
+    int epoll_fd;
+    int event_fd;
+    bool write_armed;
+
+    atomic_uint pending;                                    // 1 << offload_msg_type
+    atomic_int_least64_t posted_ns[OFFLOAD_MSG_MAX];        // Oldest unhandled post
+
+    /* Waiter thread running the blocking calls */
+    pthread_t waiter;
+    pthread_mutex_t lock;                                   // Guards the fields below
+    pthread_cond_t cond;
+    unsigned int blocking;                                  // Queued for the waiter
+    offload_msg_type in_flight;                             // OFFLOAD_MSG_INVALID when idle
+    bool waiter_exit;
+
+    struct audio_offload_worker_stats stats;
+};
+
+static inline int64_t offload_worker_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline void offload_worker_complete(struct audio_offload_worker *w, offload_msg_type msg, int ret)
+{
+    int64_t posted = atomic_exchange_explicit(&w->posted_ns[msg], 0, memory_order_relaxed);
+    int64_t latency = posted ? offload_worker_now_ns() - posted : 0;
+    int64_t max = atomic_load_explicit(&w->stats.max_latency_ns, memory_order_relaxed);
+
+    if (latency > max)
+        atomic_store_explicit(&w->stats.max_latency_ns, latency, memory_order_relaxed);
+    atomic_fetch_add_explicit(&w->stats.handled[msg], 1, memory_order_relaxed);
+    if (ret == -ECANCELED)
+        atomic_fetch_add_explicit(&w->stats.cancelled, 1, memory_order_relaxed);
+
+    if (w->ops.callback)
+        w->ops.callback(w->ops.cookie, msg, ret);
+}
+
+/* Completes the waits of mask that will not run */
+static inline void offload_worker_cancel_mask(struct audio_offload_worker *w, unsigned int mask)
+{
+    for (int msg = OFFLOAD_MSG_INVALID + 1; msg < OFFLOAD_MSG_MAX; msg++) {
+        if (mask & OFFLOAD_WORKER_WAIT_MASK & (1u << msg))
+            offload_worker_complete(w, (offload_msg_type)msg, -ECANCELED);
+    }
+}
+
+/* Sets bits in the pending mask; returns the previous mask */
+static inline unsigned int offload_worker_signal(struct audio_offload_worker *w, unsigned int bits)
+{
+    unsigned int prev = atomic_fetch_or_explicit(&w->pending, bits, memory_order_release);
+
+    /* The worker drains the whole mask, one signal per batch is enough */
+    if (prev == 0) {
+        uint64_t one = 1;
+        if (write(w->event_fd, &one, sizeof(one)) < 0)
+            return prev;
+    }
+
+    return prev;
+}
+
+static inline void offload_worker_arm_write(struct audio_offload_worker *w, bool arm)
+{
+    struct epoll_event ev;
+
+    if (w->write_armed == arm)
+        return;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLOUT | EPOLLONESHOT;
+    ev.data.fd = w->ops.poll_fd;
+    if (arm)
+        epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->ops.poll_fd, &ev);
+    else
+        epoll_ctl(w->epoll_fd, EPOLL_CTL_DEL, w->ops.poll_fd, NULL);
+    w->write_armed = arm;
+}
+
+static inline void *offload_worker_waiter_loop(void *arg)
+{
+    struct audio_offload_worker *w = (struct audio_offload_worker *)arg;
+    /* Stream order: write wait, then partial drain, then drain */
+    static const offload_msg_type order[] = {
+        OFFLOAD_MSG_WAIT_WRITE, OFFLOAD_MSG_WAIT_PARTIAL_DRAIN, OFFLOAD_MSG_WAIT_DRAIN,
+    };
+
+    pthread_mutex_lock(&w->lock);
+    while (true) {
+        offload_msg_type msg = OFFLOAD_MSG_INVALID;
+        int ret;
+
+        while (!w->waiter_exit && w->blocking == 0)
+            pthread_cond_wait(&w->cond, &w->lock);
+        if (w->waiter_exit)
+            break;
+
+        for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+            if (w->blocking & (1u << order[i])) {
+                msg = order[i];
+                break;
+            }
+        }
+        w->blocking &= ~(1u << msg);
+        w->in_flight = msg;
+        pthread_mutex_unlock(&w->lock);
+
+        if (msg == OFFLOAD_MSG_WAIT_WRITE)
+            ret = w->ops.wait_write(w->ops.cookie);
+        else if (msg == OFFLOAD_MSG_WAIT_PARTIAL_DRAIN)
+            ret = w->ops.partial_drain(w->ops.cookie);
+        else
+            ret = w->ops.drain(w->ops.cookie);
+        offload_worker_complete(w, msg, ret);
+
+        pthread_mutex_lock(&w->lock);
+        w->in_flight = OFFLOAD_MSG_INVALID;
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    return NULL;
+}
+
+/* Stops the waiter: queued waits are cancelled, the one in progress is interrupted */
+static inline void offload_worker_stop_waiter(struct audio_offload_worker *w)
+{
+    unsigned int queued;
+    bool busy;
+
+    pthread_mutex_lock(&w->lock);
+    w->waiter_exit = true;
+    queued = w->blocking;
+    w->blocking = 0;
+    busy = w->in_flight != OFFLOAD_MSG_INVALID;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+
+    offload_worker_cancel_mask(w, queued);
+    if (busy && w->ops.interrupt)
+        w->ops.interrupt(w->ops.cookie);
+
+    pthread_join(w->waiter, NULL);
+}
+
+static inline void *offload_worker_loop(void *arg)
+{
+    struct audio_offload_worker *w = (struct audio_offload_worker *)arg;
+    struct epoll_event events[2];
+    unsigned int pending = 0;
+
+    while (true) {
+        int n = epoll_wait(w->epoll_fd, events, 2, -1);
+        bool write_ready = false;
+        unsigned int blocking;
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            pending = 0;
+            break;
+        }
+
+        atomic_fetch_add_explicit(&w->stats.wakeups, 1, memory_order_relaxed);
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == w->event_fd) {
+                uint64_t value;
+                if (read(w->event_fd, &value, sizeof(value)) < 0)
+                    continue;
+            } else if (events[i].data.fd == w->ops.poll_fd) {
+                write_ready = true;
+            }
+        }
+
+        if (write_ready && w->write_armed) {
+            offload_worker_arm_write(w, false);
+            offload_worker_complete(w, OFFLOAD_MSG_WAIT_WRITE, 0);
+        }
+
+        /* Under the lock so that cancel finds every wait either pending or queued */
+        pthread_mutex_lock(&w->lock);
+        pending = atomic_exchange_explicit(&w->pending, 0, memory_order_acquire);
+        blocking = pending & OFFLOAD_WORKER_WAIT_MASK;
+        if (w->ops.poll_fd >= 0)
+            blocking &= ~(1u << OFFLOAD_MSG_WAIT_WRITE);
+        if (blocking && !(pending & (1u << OFFLOAD_MSG_EXIT))) {
+            w->blocking |= blocking;
+            pthread_cond_signal(&w->cond);
+        }
+        pthread_mutex_unlock(&w->lock);
+
+        if (pending == 0 && !write_ready)
+            atomic_fetch_add_explicit(&w->stats.spurious, 1, memory_order_relaxed);
+
+        if (pending & (1u << OFFLOAD_MSG_EXIT))
+            break;
+
+        if ((pending & OFFLOAD_WORKER_CANCEL_WRITE) && w->write_armed) {
+            offload_worker_arm_write(w, false);
+            offload_worker_complete(w, OFFLOAD_MSG_WAIT_WRITE, -ECANCELED);
+        }
+
+        if ((pending & (1u << OFFLOAD_MSG_WAIT_WRITE)) && w->ops.poll_fd >= 0)
+            offload_worker_arm_write(w, true);
+    }
+
+    /* Every posted wait gets a completion, including those dropped by the exit */
+    if (w->write_armed) {
+        offload_worker_arm_write(w, false);
+        offload_worker_complete(w, OFFLOAD_MSG_WAIT_WRITE, -ECANCELED);
+    }
+    offload_worker_cancel_mask(w, pending);
+    offload_worker_stop_waiter(w);
+
+    return NULL;
+}
+
+// Offload Worker Functions
+static inline void audio_offload_worker_post(struct audio_offload_worker *w, offload_msg_type msg)
+{
+    unsigned int bit = 1u << msg;
+    int64_t expected = 0;
+
+    if (msg <= OFFLOAD_MSG_INVALID || msg >= OFFLOAD_MSG_MAX)
+        return;
+
+    atomic_fetch_add_explicit(&w->stats.posted[msg], 1, memory_order_relaxed);
+    atomic_compare_exchange_strong_explicit(&w->posted_ns[msg], &expected, offload_worker_now_ns(),
+                                            memory_order_relaxed, memory_order_relaxed);
+
+    if (offload_worker_signal(w, bit) & bit)
+        atomic_fetch_add_explicit(&w->stats.coalesced, 1, memory_order_relaxed);
+}
+
+/*
+ * For the stream's pause and flush: completes every wait that has not
+ * started with -ECANCELED and interrupts the one in progress. Messages
+ * posted afterwards are handled normally.
+ */
+static inline void audio_offload_worker_cancel(struct audio_offload_worker *w)
+{
+    unsigned int pending, queued;
+    bool busy;
+
+    pthread_mutex_lock(&w->lock);
+    pending = atomic_fetch_and_explicit(&w->pending, ~OFFLOAD_WORKER_WAIT_MASK, memory_order_acquire);
+    queued = w->blocking;
+    w->blocking = 0;
+    busy = w->in_flight != OFFLOAD_MSG_INVALID;
+    pthread_mutex_unlock(&w->lock);
+
+    offload_worker_cancel_mask(w, pending | queued);
+    if (busy && w->ops.interrupt)
+        w->ops.interrupt(w->ops.cookie);
+
+    /* An armed EPOLLOUT wait belongs to the worker thread */
+    if (w->ops.poll_fd >= 0)
+        offload_worker_signal(w, OFFLOAD_WORKER_CANCEL_WRITE);
+}
+
+static inline int audio_offload_worker_start(struct audio_offload_worker *w, const struct audio_offload_ops *ops)
+{
+    struct epoll_event ev;
+    int ret;
+
+    memset(w, 0, sizeof(*w));
+    w->ops = *ops;
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->cond, NULL);
+
+    w->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    w->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (w->event_fd < 0 || w->epoll_fd < 0) {
+        ret = -errno;
+        goto err;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = w->event_fd;
+    if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->event_fd, &ev) < 0) {
+        ret = -errno;
+        goto err;
+    }
+
+    ret = pthread_create(&w->waiter, NULL, offload_worker_waiter_loop, w);
+    if (ret != 0) {
+        ret = -ret;
+        goto err;
+    }
+
+    ret = pthread_create(&w->thread, NULL, offload_worker_loop, w);
+    if (ret != 0) {
+        ret = -ret;
+        offload_worker_stop_waiter(w);
+        goto err;
+    }
+
+    return 0;
+
+err:
+    if (w->event_fd >= 0)
+        close(w->event_fd);
+    if (w->epoll_fd >= 0)
+        close(w->epoll_fd);
+    w->event_fd = w->epoll_fd = -1;
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->lock);
+    return ret;
+}
+
+static inline void audio_offload_worker_stop(struct audio_offload_worker *w)
+{
+    if (w->event_fd < 0)
+        return;
+
+    audio_offload_worker_post(w, OFFLOAD_MSG_EXIT);
+    pthread_join(w->thread, NULL);
+
+    /* Posts that raced with the exit never reached the worker */
+    offload_worker_cancel_mask(w, atomic_exchange_explicit(&w->pending, 0, memory_order_acquire));
+
+    close(w->event_fd);
+    close(w->epoll_fd);
+    w->event_fd = w->epoll_fd = -1;
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->lock);
+}
+
+static inline void audio_offload_worker_dump(struct audio_offload_worker *w, int fd)
+{
+    struct audio_offload_worker_stats *s = &w->stats;
+
+    dprintf(fd, "\tOffload Worker: wakeups %llu (spurious %llu), coalesced %llu, cancelled %llu, "
+            "max latency %lld us\n",
+            (unsigned long long)atomic_load(&s->wakeups), (unsigned long long)atomic_load(&s->spurious),
+            (unsigned long long)atomic_load(&s->coalesced), (unsigned long long)atomic_load(&s->cancelled),
+            (long long)(atomic_load(&s->max_latency_ns) / 1000));
+    dprintf(fd, "\t\tWAIT_WRITE %llu/%llu, WAIT_PARTIAL_DRAIN %llu/%llu, WAIT_DRAIN %llu/%llu (handled/posted)\n",
+            (unsigned long long)atomic_load(&s->handled[OFFLOAD_MSG_WAIT_WRITE]),
+            (unsigned long long)atomic_load(&s->posted[OFFLOAD_MSG_WAIT_WRITE]),
+            (unsigned long long)atomic_load(&s->handled[OFFLOAD_MSG_WAIT_PARTIAL_DRAIN]),
+            (unsigned long long)atomic_load(&s->posted[OFFLOAD_MSG_WAIT_PARTIAL_DRAIN]),
+            (unsigned long long)atomic_load(&s->handled[OFFLOAD_MSG_WAIT_DRAIN]),
+            (unsigned long long)atomic_load(&s->posted[OFFLOAD_MSG_WAIT_DRAIN]));
+}
+
+#endif  // __EXYNOS_AUDIOHAL_OFFLOAD_WORKER_H__
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXYNOS_AUDIOHAL_PARAM_PARSER_H__
+#define __EXYNOS_AUDIOHAL_PARAM_PARSER_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <hardware/audio.h>
+#include <log/log.h>
+#include <system/audio.h>
+
+#include "audio_definition.h"
+#include "voice_definition.h"
+
+/*
+ * Allocation Free Audio Parameter Parsing
+ *
+ * For proxy_setparam_* / proxy_getparam_* and proxy_set_parameters. The
+ * "key1=value1;key2=value2" string is walked in place: tokens point into
+ * the caller's string and are never copied or NUL terminated, so parsing
+ * does not allocate, unlike str_parms.
+ *
+ * Known keys are listed once in AUDIO_PARAM_KEYS and resolved to an
+ * audio_param_key id through a perfect hash: one hash of the key, one slot
+ * and one compare, whatever the number of keys. C has no constant
+ * expressions over string literals, so the collision free hash seed is
+ * searched on first use (a few microseconds); the key list itself is fixed
+ * at compile time.
+ */
+
+#define AUDIO_PARAM_KEYS(X)                                                 \
+    X(ROUTING,          AUDIO_PARAMETER_STREAM_ROUTING)                     \
+    X(FORMAT,           AUDIO_PARAMETER_STREAM_FORMAT)                      \
+    X(CHANNELS,         AUDIO_PARAMETER_STREAM_CHANNELS)                    \
+    X(FRAME_COUNT,      AUDIO_PARAMETER_STREAM_FRAME_COUNT)                 \
+    X(INPUT_SOURCE,     AUDIO_PARAMETER_STREAM_INPUT_SOURCE)                \
+    X(SAMPLING_RATE,    AUDIO_PARAMETER_STREAM_SAMPLING_RATE)               \
+    X(SUP_FORMATS,      AUDIO_PARAMETER_STREAM_SUP_FORMATS)                 \
+    X(SUP_CHANNELS,     AUDIO_PARAMETER_STREAM_SUP_CHANNELS)                \
+    X(SUP_RATES,        AUDIO_PARAMETER_STREAM_SUP_SAMPLING_RATES)          \
+    X(CONNECT,          AUDIO_PARAMETER_DEVICE_CONNECT)                     \
+    X(DISCONNECT,       AUDIO_PARAMETER_DEVICE_DISCONNECT)                  \
+    X(BT_NREC,          AUDIO_PARAMETER_KEY_BT_NREC)                        \
+    X(BT_SCO_WB,        AUDIO_PARAMETER_KEY_BT_SCO_WB)                      \
+    X(HAC,              AUDIO_PARAMETER_KEY_HAC)                            \
+    X(TTY_MODE,         AUDIO_PARAMETER_KEY_TTY_MODE)                       \
+    X(SCREEN_STATE,     AUDIO_PARAMETER_KEY_SCREEN_STATE)                   \
+    X(FMRADIO_MODE,     AUDIO_PARAMETER_KEY_FMRADIO_MODE)                   \
+    X(FMRADIO_VOLUME,   AUDIO_PARAMETER_KEY_FMRADIO_VOLUME)                 \
+    X(FACTORY_RMS_TEST, AUDIO_PARAMETER_KEY_FACTORY_RMS_TEST)               \
+    X(FACTORY_LOOPBACK, AUDIO_PARAMETER_FACTORY_TEST_LOOPBACK)              \
+    X(FACTORY_TYPE,     AUDIO_PARAMETER_FACTORY_TEST_TYPE)                  \
+    X(FACTORY_PATH,     AUDIO_PARAMETER_FACTORY_TEST_PATH)                  \
+    X(FACTORY_ROUTE,    AUDIO_PARAMETER_FACTORY_TEST_ROUTE)                 \
+    X(SEAMLESS_VOICE,   AUDIO_PARAMETER_SEAMLESS_VOICE)                     \
+    X(EXTRA_VOLUME,     AUDIO_PARAMETER_KEY_EXTRA_VOLUME)                   \
+    X(CALL_FORWARDING,  AUDIO_PARAMETER_KEY_CALL_FORWARDING)                \
+    X(VOLTE_STATUS,     AUDIO_PARAMETER_VOLTE_STATUS)
+
+typedef enum {
+    AUDIO_PARAM_KEY_UNKNOWN = -1,
+#define AUDIO_PARAM_ENUM(id, str) AUDIO_PARAM_KEY_##id,
+    AUDIO_PARAM_KEYS(AUDIO_PARAM_ENUM)
+#undef AUDIO_PARAM_ENUM
+    AUDIO_PARAM_KEY_CNT
+} audio_param_key;
+
+#define AUDIO_PARAM_HASH_SLOTS  128     // Power of two, well above 2 * AUDIO_PARAM_KEY_CNT
+/*
+ * With 27 keys in 128 slots about one seed in 16 is collision free; not
+ * finding one in this many means the key list outgrew the table.
+ */
+#define AUDIO_PARAM_SEED_MAX    65536
+
+struct audio_param_token {
+    const char *key;
+    size_t key_len;
+    const char *value;          // NULL for a bare key, as in getparam key lists
+    size_t value_len;
+    audio_param_key id;
+};
+
+struct audio_param_iter {
+    const char *p;
+};
+
+struct audio_param_key_table {
+    uint32_t seed;
+    int8_t slot[AUDIO_PARAM_HASH_SLOTS];
+    const char *name[AUDIO_PARAM_KEY_CNT];
+    uint8_t len[AUDIO_PARAM_KEY_CNT];
+};
+
+static inline uint32_t audio_param_hash(const char *s, size_t len, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ seed;
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
+    }
+
+    return h ^ (h >> 15);
+}
+
+static inline struct audio_param_key_table *audio_param_key_table_get(void)
+{
+    static struct audio_param_key_table table;
+    return &table;
+}
+
+static inline void audio_param_key_table_build(void)
+{
+    struct audio_param_key_table *t = audio_param_key_table_get();
+    int id = 0;
+
+#define AUDIO_PARAM_NAME(key_id, str) t->name[id] = str; t->len[id] = sizeof(str) - 1; id++;
+    AUDIO_PARAM_KEYS(AUDIO_PARAM_NAME)
+#undef AUDIO_PARAM_NAME
+
+    for (uint32_t seed = 1; seed <= AUDIO_PARAM_SEED_MAX; seed++) {
+        bool collision = false;
+
+        memset(t->slot, -1, sizeof(t->slot));
+        for (id = 0; id < AUDIO_PARAM_KEY_CNT && !collision; id++) {
+            uint32_t s = audio_param_hash(t->name[id], t->len[id], seed) & (AUDIO_PARAM_HASH_SLOTS - 1);
+            if (t->slot[s] >= 0)
+                collision = true;
+            else
+                t->slot[s] = id;
+        }
+
+        if (!collision) {
+            t->seed = seed;
+            return;
+        }
+    }
+
+    LOG_ALWAYS_FATAL("No collision free hash seed for %d parameter keys in %d slots; raise AUDIO_PARAM_HASH_SLOTS",
+                     AUDIO_PARAM_KEY_CNT, AUDIO_PARAM_HASH_SLOTS);
+}
+
+static inline const struct audio_param_key_table *audio_param_key_table(void)
+{
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+    pthread_once(&once, audio_param_key_table_build);
+    return audio_param_key_table_get();
+}
+
+// Key Functions
+static inline audio_param_key audio_param_lookup(const char *key, size_t len)
+{
+    const struct audio_param_key_table *t = audio_param_key_table();
+    int id = t->slot[audio_param_hash(key, len, t->seed) & (AUDIO_PARAM_HASH_SLOTS - 1)];
+
+    if (id < 0 || t->len[id] != len || memcmp(t->name[id], key, len) != 0)
+        return AUDIO_PARAM_KEY_UNKNOWN;
+
+    return (audio_param_key)id;
+}
+
+static inline const char *audio_param_key_name(audio_param_key id)
+{
+    if (id < 0 || id >= AUDIO_PARAM_KEY_CNT)
+        return "unknown";
+    return audio_param_key_table()->name[id];
+}
+
+// Tokenizer Functions
+static inline void audio_param_iter_init(struct audio_param_iter *it, const char *params)
+{
+    it->p = params ? params : "";
+}
+
+/* Returns false at the end of the string; empty pairs are skipped */
+static inline bool audio_param_next(struct audio_param_iter *it, struct audio_param_token *tok)
+{
+    const char *p = it->p;
+
+    while (*p == ';')
+        p++;
+    if (*p == '\0') {
+        it->p = p;
+        return false;
+    }
+
+    tok->key = p;
+    while (*p != '\0' && *p != '=' && *p != ';')
+        p++;
+    tok->key_len = p - tok->key;
+
+    tok->value = NULL;
+    tok->value_len = 0;
+    if (*p == '=') {
+        tok->value = ++p;
+        while (*p != '\0' && *p != ';')
+            p++;
+        tok->value_len = p - tok->value;
+    }
+
+    tok->id = audio_param_lookup(tok->key, tok->key_len);
+    it->p = p;
+
+    return true;
+}
+
+// Value Functions
+static inline bool audio_param_value_is(const struct audio_param_token *tok, const char *str)
+{
+    size_t len = strlen(str);
+
+    return tok->value && tok->value_len == len && memcmp(tok->value, str, len) == 0;
+}
+
+/*
+ * Parses a decimal (or 0x hexadecimal) integer; false if the value is not
+ * one or does not fit in an int64_t
+ */
+static inline bool audio_param_value_int(const struct audio_param_token *tok, int64_t *out)
+{
+    const char *p = tok->value;
+    const char *end = p ? p + tok->value_len : NULL;
+    bool negative = false;
+    unsigned int base = 10;
+    uint64_t limit = INT64_MAX;
+    uint64_t v = 0;
+
+    if (p == NULL || p == end)
+        return false;
+
+    if (*p == '-' || *p == '+') {
+        negative = (*p == '-');
+        if (++p == end)
+            return false;
+    }
+
+    if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        base = 16;
+        p += 2;
+    }
+
+    // The magnitude of INT64_MIN is one more than INT64_MAX
+    if (negative)
+        limit += 1;
+
+    for (; p < end; p++) {
+        unsigned int d;
+
+        if (*p >= '0' && *p <= '9')
+            d = *p - '0';
+        else if (base == 16 && *p >= 'a' && *p <= 'f')
+            d = *p - 'a' + 10;
+        else if (base == 16 && *p >= 'A' && *p <= 'F')
+            d = *p - 'A' + 10;
+        else
+            return false;
+
+        if (v > (limit - d) / base)
+            return false;
+        v = v * base + d;
+    }
+
+    if (negative)
+        *out = (v == limit) ? INT64_MIN : -(int64_t)v;
+    else
+        *out = (int64_t)v;
+    return true;
+}
+
+#endif  // __EXYNOS_AUDIOHAL_PARAM_PARSER_H__
@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXYNOS_AUDIOHAL_PCM_DUMP_H__
+#define __EXYNOS_AUDIOHAL_PCM_DUMP_H__
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <system/audio.h>
+
+/*
+ * Per-Stream PCM Capture Ring
+ *
+ * Keeps the last few seconds of PCM of a proxy stream, in the proxy format,
+ * so proxy_dump_playback_stream()/proxy_dump_capture_stream() can hand out
+ * the audio around a glitch as a WAV file instead of only the stream state.
+ *
+ * The stream thread copies every period into the ring after pcm_write /
+ * pcm_read. The copy uses non-temporal stores where the compiler offers
+ * them, so the ring does not evict the stream working set from the cache,
+ * and publishes the new position with one release store; there is no lock.
+ * The dump side copies the ring out and only keeps the bytes the writer
+ * cannot have overwritten meanwhile, so the stream is never stalled.
+ */
+
+#define AUDIO_PCM_DUMP_ALIGN        64
+
+/* Non-temporal stores for the capture copy: STNP on arm64, MOVNTDQ on x86 */
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_nontemporal_store)
+#define PCM_DUMP_NONTEMPORAL
+#endif
+#endif
+
+struct audio_pcm_dump {
+    uint8_t *buf;
+    size_t size;                        // Whole frames, multiple of AUDIO_PCM_DUMP_ALIGN
+    uint32_t sample_rate;
+    uint32_t channels;
+    audio_format_t format;
+    uint32_t frame_size;
+
+    atomic_uint_least64_t written;      // Total bytes written, never wraps
+    atomic_uint_least32_t max_write;    // Largest single write, bounds the in-flight copy
+};
+
+static inline size_t pcm_dump_gcd(size_t a, size_t b)
+{
+    while (b) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* Returns false if the format is not linear PCM or the ring cannot be allocated */
+static inline bool audio_pcm_dump_init(struct audio_pcm_dump *d, uint32_t seconds, uint32_t sample_rate,
+                                       uint32_t channels, audio_format_t format)
+{
+    size_t unit;
+    void *buf = NULL;
+
+    memset(d, 0, sizeof(*d));
+    d->frame_size = channels * audio_bytes_per_sample(format);
+    if (seconds == 0 || sample_rate == 0 || d->frame_size == 0)
+        return false;
+
+    unit = d->frame_size / pcm_dump_gcd(d->frame_size, AUDIO_PCM_DUMP_ALIGN) * AUDIO_PCM_DUMP_ALIGN;
+    d->size = ((size_t)seconds * sample_rate * d->frame_size + unit - 1) / unit * unit;
+    if (posix_memalign(&buf, AUDIO_PCM_DUMP_ALIGN, d->size) != 0)
+        return false;
+
+    memset(buf, 0, d->size);
+    d->buf = (uint8_t *)buf;
+    d->sample_rate = sample_rate;
+    d->channels = channels;
+    d->format = format;
+
+    return true;
+}
+
+static inline void audio_pcm_dump_release(struct audio_pcm_dump *d)
+{
+    free(d->buf);
+    memset(d, 0, sizeof(*d));
+}
+
+static inline void pcm_dump_copy_nt(uint8_t *dst, const uint8_t *src, size_t bytes)
+{
+#if defined(PCM_DUMP_NONTEMPORAL)
+    typedef uint8_t pcm_dump_vec __attribute__((vector_size(16), aligned(16)));
+    size_t head = (size_t)(-(uintptr_t)dst) & 15;
+
+    if (head > bytes)
+        head = bytes;
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    bytes -= head;
+
+    for (; bytes >= 16; bytes -= 16, dst += 16, src += 16) {
+        pcm_dump_vec v;
+        memcpy(&v, src, sizeof(v));
+        __builtin_nontemporal_store(v, (pcm_dump_vec *)dst);
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_sfence();
+#endif
+#endif
+
+    memcpy(dst, src, bytes);
+}
+
+// Writer (stream thread) Function
+static inline void audio_pcm_dump_write(struct audio_pcm_dump *d, const void *data, size_t bytes)
+{
+    const uint8_t *src = (const uint8_t *)data;
+    uint64_t written;
+    size_t offset, first;
+
+    if (d->buf == NULL || bytes == 0)
+        return;
+
+    /* Only the newest d->size bytes of a large write can be kept */
+    if (bytes > d->size) {
+        src += bytes - d->size;
+        written = atomic_load_explicit(&d->written, memory_order_relaxed) + (bytes - d->size);
+        bytes = d->size;
+    } else {
+        written = atomic_load_explicit(&d->written, memory_order_relaxed);
+    }
+
+    if (bytes > atomic_load_explicit(&d->max_write, memory_order_relaxed))
+        atomic_store_explicit(&d->max_write, (uint32_t)bytes, memory_order_relaxed);
+    /* The dump side must see the bigger in-flight window before the data changes */
+    atomic_thread_fence(memory_order_seq_cst);
+
+    offset = (size_t)(written % d->size);
+    first = d->size - offset;
+    if (first > bytes)
+        first = bytes;
+
+    pcm_dump_copy_nt(d->buf + offset, src, first);
+    pcm_dump_copy_nt(d->buf, src + first, bytes - first);
+
+    atomic_store_explicit(&d->written, written + bytes, memory_order_release);
+}
+
+// Extraction Functions
+static inline void pcm_dump_put_le(uint8_t *p, uint32_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+/* Q8.23 to full scale 32 bit PCM in place, a 32 bit WAV would play it 48 dB too quiet */
+static inline void pcm_dump_q8_23_to_i32(uint8_t *p, size_t bytes)
+{
+    for (size_t i = 0; i + 4 <= bytes; i += 4) {
+        int32_t v;
+
+        memcpy(&v, p + i, sizeof(v));
+        if (v > 0x7FFFFF)
+            v = INT32_MAX;
+        else if (v < -0x800000)
+            v = INT32_MIN;
+        else
+            v = (int32_t)((uint32_t)v << 8);
+        memcpy(p + i, &v, sizeof(v));
+    }
+}
+
+/*
+ * Writes the ring content as a WAV file to fd, oldest frame first.
+ * Returns the number of frames written, or -1 on error.
+ */
+static inline ssize_t audio_pcm_dump_extract_wav(struct audio_pcm_dump *d, int fd)
+{
+    uint8_t header[44];
+    uint8_t *copy;
+    uint64_t before, after, start, inflight;
+    size_t bytes, offset, first;
+    uint16_t bits, tag;
+    ssize_t ret = -1;
+
+    if (d->buf == NULL)
+        return -1;
+
+    copy = (uint8_t *)malloc(d->size);
+    if (copy == NULL)
+        return -1;
+
+    before = atomic_load_explicit(&d->written, memory_order_acquire);
+    memcpy(copy, d->buf, d->size);
+    atomic_thread_fence(memory_order_seq_cst);
+    after = atomic_load_explicit(&d->written, memory_order_relaxed);
+    inflight = atomic_load_explicit(&d->max_write, memory_order_relaxed);
+
+    /* Bytes below after + inflight - size may have been overwritten during the copy */
+    start = before > d->size ? before - d->size : 0;
+    if (after + inflight > d->size && after + inflight - d->size > start)
+        start = after + inflight - d->size;
+    start = (start + d->frame_size - 1) / d->frame_size * d->frame_size;
+    bytes = start < before ? (size_t)(before - start) : 0;
+
+    switch (d->format) {
+    case AUDIO_FORMAT_PCM_FLOAT:
+        tag = 3;        // WAVE_FORMAT_IEEE_FLOAT
+        break;
+    default:
+        tag = 1;        // WAVE_FORMAT_PCM, 8_24 is scaled up to 32 bit below
+        break;
+    }
+    bits = (uint16_t)(audio_bytes_per_sample(d->format) * 8);
+
+    memcpy(header, "RIFF", 4);
+    pcm_dump_put_le(header + 4, (uint32_t)(36 + bytes), 4);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    pcm_dump_put_le(header + 16, 16, 4);
+    pcm_dump_put_le(header + 20, tag, 2);
+    pcm_dump_put_le(header + 22, d->channels, 2);
+    pcm_dump_put_le(header + 24, d->sample_rate, 4);
+    pcm_dump_put_le(header + 28, d->sample_rate * d->frame_size, 4);
+    pcm_dump_put_le(header + 32, d->frame_size, 2);
+    pcm_dump_put_le(header + 34, bits, 2);
+    memcpy(header + 36, "data", 4);
+    pcm_dump_put_le(header + 40, (uint32_t)bytes, 4);
+
+    offset = (size_t)(start % d->size);
+    first = d->size - offset;
+    if (first > bytes)
+        first = bytes;
+
+    if (d->format == AUDIO_FORMAT_PCM_8_24_BIT) {
+        pcm_dump_q8_23_to_i32(copy + offset, first);
+        pcm_dump_q8_23_to_i32(copy, bytes - first);
+    }
+
+    if (write(fd, header, sizeof(header)) == (ssize_t)sizeof(header) &&
+        write(fd, copy + offset, first) == (ssize_t)first &&
+        write(fd, copy, bytes - first) == (ssize_t)(bytes - first))
+        ret = (ssize_t)(bytes / d->frame_size);
+
+    free(copy);
+    return ret;
+}
+
+static inline void audio_pcm_dump_dump(struct audio_pcm_dump *d, int fd)
+{
+    uint64_t written = atomic_load_explicit(&d->written, memory_order_relaxed);
+
+    if (d->buf == NULL) {
+        dprintf(fd, "\tPCM Capture Ring: disabled\n");
+        return;
+    }
+
+    dprintf(fd, "\tPCM Capture Ring: %u Hz, %u ch, format %#x, %zu of %zu frames held, %llu frames written\n",
+            d->sample_rate, d->channels, d->format,
+            (size_t)((written < d->size ? written : d->size) / d->frame_size), d->size / d->frame_size,
+            (unsigned long long)(written / d->frame_size));
+}
+
+#endif  // __EXYNOS_AUDIOHAL_PCM_DUMP_H__
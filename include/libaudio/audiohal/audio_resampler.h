@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXYNOS_AUDIOHAL_RESAMPLER_H__
+#define __EXYNOS_AUDIOHAL_RESAMPLER_H__
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/*
+ * Polyphase Sample Rate Converter
+ *
+ * For USB and BT/voice proxy streams running at another rate than the PCM
+ * device (8/16/32/44.1/48/96/192/384 kHz). The ratio out/in is reduced to
+ * L/M and a Kaiser windowed sinc prototype is split into L phases when the
+ * stream is opened, so processing only does one dot product per output
+ * sample and channel, using NEON when available.
+ *
+ * History is kept per channel (planar) so that every dot product reads
+ * contiguous memory. Input is processed in blocks of at most
+ * AUDIO_RESAMPLER_BLOCK frames; the delay is constant and reported by
+ * audio_resampler_latency_frames(), so the per-period latency is bounded.
+ *
+ * Samples are interleaved float; see audio_format_convert.h for the PCM
+ * format conversions.
+ */
+
+#define AUDIO_RESAMPLER_MAX_CHANNELS    8
+#define AUDIO_RESAMPLER_BLOCK           256
+#define AUDIO_RESAMPLER_TAPS            32      // Per phase, when upsampling
+#define AUDIO_RESAMPLER_MAX_TAPS        512
+#define AUDIO_RESAMPLER_MAX_PHASES      2048
+#define AUDIO_RESAMPLER_KAISER_BETA     8.0     // ~80dB stopband
+
+struct audio_resampler {
+    uint32_t in_rate;
+    uint32_t out_rate;
+    uint32_t channels;
+    uint32_t L;             // Interpolation factor (phases)
+    uint32_t M;             // Decimation factor
+    uint32_t taps;          // Taps per phase
+
+    float *bank;            // [L][taps], reversed in time
+    float *buf;             // [channels][stride]
+    uint32_t stride;
+    uint32_t fill;          // Frames in buf
+    uint32_t pos;           // Input frame of the next output
+    uint32_t phase;         // Fractional position, in 1/L frames
+};
+
+static inline uint32_t resampler_gcd(uint32_t a, uint32_t b)
+{
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static inline double resampler_bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+
+    for (int k = 1; k < 50; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+
+    return sum;
+}
+
+static inline void audio_resampler_release(struct audio_resampler *rs)
+{
+    free(rs->bank);
+    free(rs->buf);
+    memset(rs, 0, sizeof(*rs));
+}
+
+static inline bool audio_resampler_init(struct audio_resampler *rs, uint32_t in_rate, uint32_t out_rate,
+                                        uint32_t channels)
+{
+    uint32_t g, taps;
+    double cutoff, i0_beta, center;
+
+    memset(rs, 0, sizeof(*rs));
+    if (in_rate == 0 || out_rate == 0 || channels == 0 || channels > AUDIO_RESAMPLER_MAX_CHANNELS)
+        return false;
+
+    g = resampler_gcd(in_rate, out_rate);
+    rs->in_rate = in_rate;
+    rs->out_rate = out_rate;
+    rs->channels = channels;
+    rs->L = out_rate / g;
+    rs->M = in_rate / g;
+    if (rs->L > AUDIO_RESAMPLER_MAX_PHASES)
+        return false;
+
+    /* Downsampling widens the filter to keep the same transition band */
+    taps = AUDIO_RESAMPLER_TAPS;
+    if (rs->M > rs->L)
+        taps = (uint32_t)(((uint64_t)AUDIO_RESAMPLER_TAPS * rs->M + rs->L - 1) / rs->L);
+    if (taps > AUDIO_RESAMPLER_MAX_TAPS)
+        taps = AUDIO_RESAMPLER_MAX_TAPS;
+    taps = (taps + 3) & ~3u;
+    rs->taps = taps;
+
+    rs->bank = (float *)malloc(sizeof(float) * rs->L * taps);
+    rs->stride = taps + AUDIO_RESAMPLER_BLOCK;
+    rs->buf = (float *)calloc((size_t)channels * rs->stride, sizeof(float));
+    if (rs->bank == NULL || rs->buf == NULL) {
+        audio_resampler_release(rs);
+        return false;
+    }
+
+    /* Prototype of L * taps taps at L * in_rate, cut 10% below the lower Nyquist */
+    cutoff = 0.45 * (rs->L < rs->M ? (double)rs->L / rs->M : 1.0) / rs->L;
+    i0_beta = resampler_bessel_i0(AUDIO_RESAMPLER_KAISER_BETA);
+    center = ((double)rs->L * taps - 1.0) / 2.0;
+
+    for (uint32_t p = 0; p < rs->L; p++) {
+        float *coef = rs->bank + (size_t)p * taps;
+
+        for (uint32_t j = 0; j < taps; j++) {
+            double k = p + (double)rs->L * j;
+            double t = k - center;
+            double r = t / (center + 0.5);
+            double w = resampler_bessel_i0(AUDIO_RESAMPLER_KAISER_BETA * sqrt(fmax(0.0, 1.0 - r * r))) / i0_beta;
+            double s = (t == 0.0) ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * t) / (M_PI * t);
+
+            coef[taps - 1 - j] = (float)(s * w * rs->L);
+        }
+    }
+
+    /* Prime with silence so output starts right away with a fixed delay */
+    rs->fill = taps - 1;
+
+    return true;
+}
+
+static inline uint32_t audio_resampler_latency_frames(const struct audio_resampler *rs)
+{
+    /* Group delay of the prototype, in input frames */
+    return rs->taps / 2;
+}
+
+/* Upper bound of the output frames produced for in_frames input frames */
+static inline size_t audio_resampler_max_output(const struct audio_resampler *rs, size_t in_frames)
+{
+    return (size_t)(((uint64_t)(in_frames + 1) * rs->L) / rs->M) + 1;
+}
+
+static inline float resampler_dot(const float *x, const float *h, uint32_t n)
+{
+    uint32_t i = 0;
+    float sum;
+
+#if defined(__ARM_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(x + i), vld1q_f32(h + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(x + i + 4), vld1q_f32(h + i + 4));
+    }
+    acc0 = vaddq_f32(acc0, acc1);
+#if defined(__aarch64__)
+    sum = vaddvq_f32(acc0);
+#else
+    float32x2_t s2 = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+    sum = vget_lane_f32(vpadd_f32(s2, s2), 0);
+#endif
+#else
+    float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    for (; i + 4 <= n; i += 4) {
+        acc[0] += x[i] * h[i];
+        acc[1] += x[i + 1] * h[i + 1];
+        acc[2] += x[i + 2] * h[i + 2];
+        acc[3] += x[i + 3] * h[i + 3];
+    }
+    sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+#endif
+
+    for (; i < n; i++)
+        sum += x[i] * h[i];
+
+    return sum;
+}
+
+/*
+ * Consumes every input frame and returns the number of output frames
+ * written; out must hold audio_resampler_max_output(rs, in_frames) frames.
+ */
+static inline size_t audio_resampler_process(struct audio_resampler *rs, const float *in, size_t in_frames,
+                                             float *out)
+{
+    const uint32_t ch = rs->channels;
+    const uint32_t taps = rs->taps;
+    size_t produced = 0;
+
+    while (in_frames > 0) {
+        uint32_t n = rs->stride - rs->fill;
+        if (n > in_frames)
+            n = in_frames;
+
+        /* Deinterleave the block after the history */
+        for (uint32_t c = 0; c < ch; c++) {
+            float *dst = rs->buf + (size_t)c * rs->stride + rs->fill;
+            for (uint32_t f = 0; f < n; f++)
+                dst[f] = in[(size_t)f * ch + c];
+        }
+        rs->fill += n;
+        in += (size_t)n * ch;
+        in_frames -= n;
+
+        while (rs->pos + taps <= rs->fill) {
+            const float *h = rs->bank + (size_t)rs->phase * taps;
+
+            for (uint32_t c = 0; c < ch; c++)
+                out[c] = resampler_dot(rs->buf + (size_t)c * rs->stride + rs->pos, h, taps);
+            out += ch;
+            produced++;
+
+            rs->phase += rs->M;
+            rs->pos += rs->phase / rs->L;
+            rs->phase %= rs->L;
+        }
+
+        /* Keep what the next outputs still need */
+        if (rs->pos > 0) {
+            uint32_t keep = rs->pos < rs->fill ? rs->fill - rs->pos : 0;
+            uint32_t from = rs->fill - keep;
+
+            for (uint32_t c = 0; c < ch; c++) {
+                float *b = rs->buf + (size_t)c * rs->stride;
+                memmove(b, b + from, keep * sizeof(float));
+            }
+            rs->pos -= from;
+            rs->fill = keep;
+        }
+    }
+
+    return produced;
+}
+
+/* Clears the history, e.g. on standby */
+static inline void audio_resampler_reset(struct audio_resampler *rs)
+{
+    memset(rs->buf, 0, sizeof(float) * rs->channels * rs->stride);
+    rs->fill = rs->taps - 1;
+    rs->pos = 0;
+    rs->phase = 0;
+}
+
+#endif  // __EXYNOS_AUDIOHAL_RESAMPLER_H__
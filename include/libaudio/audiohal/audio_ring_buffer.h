@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXYNOS_AUDIOHAL_RING_BUFFER_H__
+#define __EXYNOS_AUDIOHAL_RING_BUFFER_H__
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Lock-free Single Producer / Single Consumer Ring Buffer
+ *
+ * Transport between an audio stream (ASTREAM_PLAYBACK_FAST, LOW_LATENCY, ...)
+ * and the proxy PCM thread, so that the HAL write/read thread never blocks
+ * on the PCM device. One thread only writes and one thread only reads.
+ *
+ * Positions are free running byte counters; each side keeps its own index on
+ * a separate cache line together with a cached copy of the other side's
+ * index, so the shared index is only loaded when the cached one runs out.
+ * The storage is provided by the caller and its size must be a power of two.
+ *
+ * The acquire/commit calls give direct access to the ring memory; the
+ * write/read helpers copy and also account overruns and underruns.
+ */
+
+#define AUDIO_RING_BUFFER_CACHE_LINE    64
+
+struct audio_ring_buffer {
+    /* Producer side */
+    alignas(AUDIO_RING_BUFFER_CACHE_LINE) atomic_size_t write_pos;
+    size_t cached_read_pos;
+    atomic_uint_least64_t overruns;
+
+    /* Consumer side */
+    alignas(AUDIO_RING_BUFFER_CACHE_LINE) atomic_size_t read_pos;
+    size_t cached_write_pos;
+    atomic_uint_least64_t underruns;
+
+    /* Constant after init */
+    alignas(AUDIO_RING_BUFFER_CACHE_LINE) uint8_t *data;
+    size_t size;
+    size_t mask;
+};
+
+static inline bool audio_ring_buffer_init(struct audio_ring_buffer *rb, void *storage, size_t size)
+{
+    if (rb == NULL || storage == NULL || size == 0 || (size & (size - 1)) != 0)
+        return false;
+
+    atomic_init(&rb->write_pos, 0);
+    rb->cached_read_pos = 0;
+    atomic_init(&rb->overruns, 0);
+    atomic_init(&rb->read_pos, 0);
+    rb->cached_write_pos = 0;
+    atomic_init(&rb->underruns, 0);
+    rb->data = (uint8_t *)storage;
+    rb->size = size;
+    rb->mask = size - 1;
+
+    return true;
+}
+
+// Producer Functions
+static inline size_t audio_ring_buffer_writable(struct audio_ring_buffer *rb)
+{
+    size_t wpos = atomic_load_explicit(&rb->write_pos, memory_order_relaxed);
+
+    if (rb->size - (wpos - rb->cached_read_pos) == 0)
+        rb->cached_read_pos = atomic_load_explicit(&rb->read_pos, memory_order_acquire);
+
+    return rb->size - (wpos - rb->cached_read_pos);
+}
+
+/*
+ * Returns a contiguous writable region of at most 'bytes' bytes in *region;
+ * it can be shorter than the free space when the region wraps.
+ */
+static inline size_t audio_ring_buffer_write_acquire(struct audio_ring_buffer *rb, void **region, size_t bytes)
+{
+    size_t wpos = atomic_load_explicit(&rb->write_pos, memory_order_relaxed);
+    size_t space = rb->size - (wpos - rb->cached_read_pos);
+
+    if (space < bytes) {
+        rb->cached_read_pos = atomic_load_explicit(&rb->read_pos, memory_order_acquire);
+        space = rb->size - (wpos - rb->cached_read_pos);
+    }
+
+    size_t offset = wpos & rb->mask;
+    size_t contiguous = rb->size - offset;
+
+    if (bytes > space)
+        bytes = space;
+    if (bytes > contiguous)
+        bytes = contiguous;
+
+    *region = rb->data + offset;
+    return bytes;
+}
+
+static inline void audio_ring_buffer_write_commit(struct audio_ring_buffer *rb, size_t bytes)
+{
+    size_t wpos = atomic_load_explicit(&rb->write_pos, memory_order_relaxed);
+
+    atomic_store_explicit(&rb->write_pos, wpos + bytes, memory_order_release);
+}
+
+// Consumer Functions
+static inline size_t audio_ring_buffer_readable(struct audio_ring_buffer *rb)
+{
+    size_t rpos = atomic_load_explicit(&rb->read_pos, memory_order_relaxed);
+
+    if (rb->cached_write_pos == rpos)
+        rb->cached_write_pos = atomic_load_explicit(&rb->write_pos, memory_order_acquire);
+
+    return rb->cached_write_pos - rpos;
+}
+
+static inline size_t audio_ring_buffer_read_acquire(struct audio_ring_buffer *rb, const void **region, size_t bytes)
+{
+    size_t rpos = atomic_load_explicit(&rb->read_pos, memory_order_relaxed);
+    size_t avail = rb->cached_write_pos - rpos;
+
+    if (avail < bytes) {
+        rb->cached_write_pos = atomic_load_explicit(&rb->write_pos, memory_order_acquire);
+        avail = rb->cached_write_pos - rpos;
+    }
+
+    size_t offset = rpos & rb->mask;
+    size_t contiguous = rb->size - offset;
+
+    if (bytes > avail)
+        bytes = avail;
+    if (bytes > contiguous)
+        bytes = contiguous;
+
+    *region = rb->data + offset;
+    return bytes;
+}
+
+static inline void audio_ring_buffer_read_commit(struct audio_ring_buffer *rb, size_t bytes)
+{
+    size_t rpos = atomic_load_explicit(&rb->read_pos, memory_order_relaxed);
+
+    atomic_store_explicit(&rb->read_pos, rpos + bytes, memory_order_release);
+}
+
+// Copying Helpers
+/* Writes as much as fits and counts an overrun if anything was dropped */
+static inline size_t audio_ring_buffer_write(struct audio_ring_buffer *rb, const void *buffer, size_t bytes)
+{
+    const uint8_t *src = (const uint8_t *)buffer;
+    size_t done = 0;
+
+    while (done < bytes) {
+        void *region;
+        size_t n = audio_ring_buffer_write_acquire(rb, &region, bytes - done);
+        if (n == 0)
+            break;
+        memcpy(region, src + done, n);
+        audio_ring_buffer_write_commit(rb, n);
+        done += n;
+    }
+
+    if (done < bytes)
+        atomic_fetch_add_explicit(&rb->overruns, 1, memory_order_relaxed);
+
+    return done;
+}
+
+/*
+ * Reads 'bytes' bytes; when less is available the remainder is filled with
+ * silence and an underrun is counted. Returns the bytes actually consumed.
+ */
+static inline size_t audio_ring_buffer_read(struct audio_ring_buffer *rb, void *buffer, size_t bytes)
+{
+    uint8_t *dst = (uint8_t *)buffer;
+    size_t done = 0;
+
+    while (done < bytes) {
+        const void *region;
+        size_t n = audio_ring_buffer_read_acquire(rb, &region, bytes - done);
+        if (n == 0)
+            break;
+        memcpy(dst + done, region, n);
+        audio_ring_buffer_read_commit(rb, n);
+        done += n;
+    }
+
+    if (done < bytes) {
+        memset(dst + done, 0, bytes - done);
+        atomic_fetch_add_explicit(&rb->underruns, 1, memory_order_relaxed);
+    }
+
+    return done;
+}
+
+// Statistics Functions (any thread)
+static inline size_t audio_ring_buffer_level(struct audio_ring_buffer *rb)
+{
+    size_t rpos = atomic_load_explicit(&rb->read_pos, memory_order_acquire);
+    size_t level = atomic_load_explicit(&rb->write_pos, memory_order_acquire) - rpos;
+
+    return level > rb->size ? rb->size : level;
+}
+
+static inline uint64_t audio_ring_buffer_overruns(struct audio_ring_buffer *rb)
+{
+    return atomic_load_explicit(&rb->overruns, memory_order_relaxed);
+}
+
+static inline uint64_t audio_ring_buffer_underruns(struct audio_ring_buffer *rb)
+{
+    return atomic_load_explicit(&rb->underruns, memory_order_relaxed);
+}
+
+#endif  // __EXYNOS_AUDIOHAL_RING_BUFFER_H__
@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXYNOS_AUDIOHAL_ROUTE_PLAN_H__
+#define __EXYNOS_AUDIOHAL_ROUTE_PLAN_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "audio_usages.h"
+#include "audio_devices.h"
+#include "audio_mixers.h"
+
+/*
+ * Precompiled Route Transition Plans
+ *
+ * At proxy_init_route, each mixer path is compiled once into a sorted list
+ * of (control, value) pairs and mapped to its (usage, device) or modifier.
+ * Every control also has the value it takes when no path uses it.
+ *
+ * The plan tracks the value currently programmed in every control, so a
+ * transition from one set of active paths to another only writes the
+ * controls whose value actually changes: controls of paths that go away
+ * return to their default first, then controls of new paths are applied.
+ * Whether the current value is known is kept in a separate bitmap, as any
+ * int32_t (including MIXER_CTL_VAL_INVALID) can be a real control value.
+ */
+
+#define AUDIO_ROUTE_MAX_ACTIVE      4
+#define AUDIO_ROUTE_PATH_NONE       -1
+
+struct audio_route_plan_entry {
+    uint32_t ctl;
+    int32_t  value;
+};
+
+struct audio_route_plan_path {
+    uint32_t first;
+    uint32_t count;
+};
+
+struct audio_route_plan_stats {
+    uint64_t transitions;
+    uint64_t writes;
+    uint32_t last_writes;
+    int64_t  last_ns;
+    int64_t  max_ns;
+};
+
+struct audio_route_plan {
+    /* Returns 0 on success; ctl is the handle given to audio_route_plan_set_control */
+    int (*write)(void *cookie, void *ctl, int value);
+    void *cookie;
+
+    uint32_t num_ctls;
+    void **ctls;
+    int32_t *defaults;
+    int32_t *current;
+    uint32_t *current_known;    // Bitmap: current[ctl] is what the control holds
+    int32_t *target;
+    uint32_t *target_gen;
+    uint32_t *visit_gen;
+    uint32_t gen;
+
+    struct audio_route_plan_entry *entries;
+    uint32_t num_entries;
+    uint32_t max_entries;
+
+    struct audio_route_plan_path *paths;
+    uint32_t num_paths;
+    uint32_t max_paths;
+    bool building;
+
+    int16_t usage_device_path[AUSAGE_CNT][DEVICE_CNT];
+    int16_t modifier_path[MODIFIER_CNT];
+
+    int16_t active[AUDIO_ROUTE_MAX_ACTIVE];
+    int num_active;
+
+    struct audio_route_plan_stats stats;
+};
+
+// Internal Utility Functions
+static inline bool route_plan_known(const struct audio_route_plan *plan, uint32_t ctl)
+{
+    return (plan->current_known[ctl / 32] >> (ctl % 32)) & 1;
+}
+
+/* Records the outcome of a write: the value on success, unknown on failure */
+static inline void route_plan_set_current(struct audio_route_plan *plan, uint32_t ctl, int32_t value,
+                                          bool known)
+{
+    plan->current[ctl] = value;
+    if (known)
+        plan->current_known[ctl / 32] |= 1u << (ctl % 32);
+    else
+        plan->current_known[ctl / 32] &= ~(1u << (ctl % 32));
+}
+
+// Compile Functions (proxy_init_route)
+static inline void audio_route_plan_deinit(struct audio_route_plan *plan)
+{
+    free(plan->ctls);
+    free(plan->defaults);
+    free(plan->current);
+    free(plan->current_known);
+    free(plan->target);
+    free(plan->target_gen);
+    free(plan->visit_gen);
+    free(plan->entries);
+    free(plan->paths);
+    memset(plan, 0, sizeof(*plan));
+}
+
+static inline bool audio_route_plan_init(struct audio_route_plan *plan, uint32_t num_ctls,
+                                         int (*write)(void *, void *, int), void *cookie)
+{
+    memset(plan, 0, sizeof(*plan));
+    plan->write = write;
+    plan->cookie = cookie;
+    plan->num_ctls = num_ctls;
+
+    plan->ctls = (void **)calloc(num_ctls, sizeof(*plan->ctls));
+    plan->defaults = (int32_t *)calloc(num_ctls, sizeof(int32_t));
+    plan->current = (int32_t *)calloc(num_ctls, sizeof(int32_t));
+    plan->current_known = (uint32_t *)calloc((num_ctls + 31) / 32, sizeof(uint32_t));
+    plan->target = (int32_t *)calloc(num_ctls, sizeof(int32_t));
+    plan->target_gen = (uint32_t *)calloc(num_ctls, sizeof(uint32_t));
+    plan->visit_gen = (uint32_t *)calloc(num_ctls, sizeof(uint32_t));
+
+    if (!plan->ctls || !plan->defaults || !plan->current || !plan->current_known || !plan->target ||
+        !plan->target_gen || !plan->visit_gen) {
+        audio_route_plan_deinit(plan);
+        return false;
+    }
+
+    for (int u = 0; u < AUSAGE_CNT; u++)
+        for (int d = 0; d < DEVICE_CNT; d++)
+            plan->usage_device_path[u][d] = AUDIO_ROUTE_PATH_NONE;
+    for (int m = 0; m < MODIFIER_CNT; m++)
+        plan->modifier_path[m] = AUDIO_ROUTE_PATH_NONE;
+
+    return true;
+}
+
+static inline void audio_route_plan_set_control(struct audio_route_plan *plan, uint32_t id,
+                                                void *ctl, int32_t default_value)
+{
+    if (id >= plan->num_ctls)
+        return;
+
+    plan->ctls[id] = ctl;
+    plan->defaults[id] = default_value;
+    route_plan_set_current(plan, id, 0, false);
+}
+
+/* Returns the new path id, or AUDIO_ROUTE_PATH_NONE */
+static inline int audio_route_plan_begin_path(struct audio_route_plan *plan)
+{
+    if (plan->building || plan->num_paths >= INT16_MAX)
+        return AUDIO_ROUTE_PATH_NONE;
+
+    if (plan->num_paths == plan->max_paths) {
+        uint32_t max = plan->max_paths ? plan->max_paths * 2 : 32;
+        void *paths = realloc(plan->paths, max * sizeof(*plan->paths));
+        if (paths == NULL)
+            return AUDIO_ROUTE_PATH_NONE;
+        plan->paths = (struct audio_route_plan_path *)paths;
+        plan->max_paths = max;
+    }
+
+    plan->paths[plan->num_paths].first = plan->num_entries;
+    plan->paths[plan->num_paths].count = 0;
+    plan->building = true;
+
+    return plan->num_paths;
+}
+
+/* Fails for controls not registered with audio_route_plan_set_control */
+static inline bool audio_route_plan_add(struct audio_route_plan *plan, uint32_t ctl, int32_t value)
+{
+    if (!plan->building || ctl >= plan->num_ctls || plan->ctls[ctl] == NULL)
+        return false;
+
+    if (plan->num_entries == plan->max_entries) {
+        uint32_t max = plan->max_entries ? plan->max_entries * 2 : 256;
+        void *entries = realloc(plan->entries, max * sizeof(*plan->entries));
+        if (entries == NULL)
+            return false;
+        plan->entries = (struct audio_route_plan_entry *)entries;
+        plan->max_entries = max;
+    }
+
+    plan->entries[plan->num_entries].ctl = ctl;
+    plan->entries[plan->num_entries].value = value;
+    plan->num_entries++;
+
+    return true;
+}
+
+/* Sorts the path by control and keeps the last value given to each control */
+static inline void audio_route_plan_end_path(struct audio_route_plan *plan)
+{
+    struct audio_route_plan_path *path;
+    struct audio_route_plan_entry *e;
+    uint32_t n, out = 0;
+
+    if (!plan->building)
+        return;
+
+    path = &plan->paths[plan->num_paths];
+    e = plan->entries + path->first;
+    n = plan->num_entries - path->first;
+
+    /* Stable insertion sort; paths are short */
+    for (uint32_t i = 1; i < n; i++) {
+        struct audio_route_plan_entry key = e[i];
+        uint32_t j = i;
+
+        while (j > 0 && e[j - 1].ctl > key.ctl) {
+            e[j] = e[j - 1];
+            j--;
+        }
+        e[j] = key;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (out > 0 && e[out - 1].ctl == e[i].ctl)
+            e[out - 1].value = e[i].value;
+        else
+            e[out++] = e[i];
+    }
+
+    path->count = out;
+    plan->num_entries = path->first + out;
+    plan->num_paths++;
+    plan->building = false;
+}
+
+static inline void audio_route_plan_map(struct audio_route_plan *plan, int ausage, int device, int path)
+{
+    if (ausage >= AUSAGE_MIN && ausage < AUSAGE_CNT && device >= DEVICE_MIN && device < DEVICE_CNT)
+        plan->usage_device_path[ausage][device] = path;
+}
+
+static inline void audio_route_plan_map_modifier(struct audio_route_plan *plan, int modifier, int path)
+{
+    if (modifier >= MODIFIER_MIN && modifier < MODIFIER_CNT)
+        plan->modifier_path[modifier] = path;
+}
+
+// Transition Functions
+static inline void route_plan_visit(struct audio_route_plan *plan, int path_id)
+{
+    const struct audio_route_plan_path *path = &plan->paths[path_id];
+
+    for (uint32_t i = 0; i < path->count; i++) {
+        uint32_t ctl = plan->entries[path->first + i].ctl;
+        int32_t want;
+
+        if (plan->visit_gen[ctl] == plan->gen)
+            continue;
+        plan->visit_gen[ctl] = plan->gen;
+
+        want = (plan->target_gen[ctl] == plan->gen) ? plan->target[ctl] : plan->defaults[ctl];
+        if (route_plan_known(plan, ctl) && plan->current[ctl] == want)
+            continue;
+
+        route_plan_set_current(plan, ctl, want, plan->write(plan->cookie, plan->ctls[ctl], want) == 0);
+        plan->stats.last_writes++;
+    }
+}
+
+/* Makes paths[] the active set, writing only the controls that change */
+static inline void audio_route_plan_apply(struct audio_route_plan *plan, const int16_t *paths, int count)
+{
+    struct timespec start, end;
+    int16_t old_active[AUDIO_ROUTE_MAX_ACTIVE];
+    int old_count = plan->num_active;
+    int64_t elapsed;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    memcpy(old_active, plan->active, sizeof(old_active));
+    plan->num_active = 0;
+    plan->stats.last_writes = 0;
+    plan->gen++;
+
+    /* Later paths win when several set the same control */
+    for (int p = 0; p < count && plan->num_active < AUDIO_ROUTE_MAX_ACTIVE; p++) {
+        const struct audio_route_plan_path *path;
+
+        if (paths[p] < 0 || (uint32_t)paths[p] >= plan->num_paths)
+            continue;
+        path = &plan->paths[paths[p]];
+        for (uint32_t i = 0; i < path->count; i++) {
+            const struct audio_route_plan_entry *e = &plan->entries[path->first + i];
+            plan->target[e->ctl] = e->value;
+            plan->target_gen[e->ctl] = plan->gen;
+        }
+        plan->active[plan->num_active++] = paths[p];
+    }
+
+    for (int p = 0; p < old_count; p++)
+        route_plan_visit(plan, old_active[p]);
+    for (int p = 0; p < plan->num_active; p++)
+        route_plan_visit(plan, plan->active[p]);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    elapsed = (int64_t)(end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
+
+    plan->stats.transitions++;
+    plan->stats.writes += plan->stats.last_writes;
+    plan->stats.last_ns = elapsed;
+    if (elapsed > plan->stats.max_ns)
+        plan->stats.max_ns = elapsed;
+}
+
+/* proxy_set_route(): adds or removes the (usage, device) and modifier paths */
+static inline bool audio_route_plan_set(struct audio_route_plan *plan, int ausage, int device,
+                                        int modifier, bool set)
+{
+    int16_t paths[AUDIO_ROUTE_MAX_ACTIVE];
+    int16_t add[2] = { AUDIO_ROUTE_PATH_NONE, AUDIO_ROUTE_PATH_NONE };
+    int count = 0;
+
+    if (ausage >= AUSAGE_MIN && ausage < AUSAGE_CNT && device >= DEVICE_MIN && device < DEVICE_CNT)
+        add[0] = plan->usage_device_path[ausage][device];
+    if (modifier >= MODIFIER_MIN && modifier < MODIFIER_CNT)
+        add[1] = plan->modifier_path[modifier];
+
+    if (add[0] == AUDIO_ROUTE_PATH_NONE && add[1] == AUDIO_ROUTE_PATH_NONE)
+        return false;
+
+    for (int i = 0; i < plan->num_active; i++) {
+        if (plan->active[i] != add[0] && plan->active[i] != add[1])
+            paths[count++] = plan->active[i];
+    }
+
+    if (set) {
+        for (int i = 0; i < 2; i++) {
+            if (add[i] != AUDIO_ROUTE_PATH_NONE && count < AUDIO_ROUTE_MAX_ACTIVE)
+                paths[count++] = add[i];
+        }
+    }
+
+    audio_route_plan_apply(plan, paths, count);
+
+    return true;
+}
+
+/* proxy_update_route(): switches to the (usage, device) path alone */
+static inline bool audio_route_plan_update(struct audio_route_plan *plan, int ausage, int device)
+{
+    int16_t path;
+
+    if (ausage < AUSAGE_MIN || ausage >= AUSAGE_CNT || device < DEVICE_MIN || device >= DEVICE_CNT)
+        return false;
+
+    path = plan->usage_device_path[ausage][device];
+    if (path == AUDIO_ROUTE_PATH_NONE)
+        return false;
+
+    audio_route_plan_apply(plan, &path, 1);
+
+    return true;
+}
+
+/* Writes every default value, e.g. after the codec was reset */
+static inline void audio_route_plan_reset(struct audio_route_plan *plan)
+{
+    for (uint32_t ctl = 0; ctl < plan->num_ctls; ctl++) {
+        if (plan->ctls[ctl] == NULL)
+            continue;
+        route_plan_set_current(plan, ctl, plan->defaults[ctl],
+                               plan->write(plan->cookie, plan->ctls[ctl], plan->defaults[ctl]) == 0);
+    }
+
+    plan->num_active = 0;
+}
+
+#endif  // __EXYNOS_AUDIOHAL_ROUTE_PLAN_H__
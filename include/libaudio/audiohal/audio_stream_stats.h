@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXYNOS_AUDIOHAL_STREAM_STATS_H__
+#define __EXYNOS_AUDIOHAL_STREAM_STATS_H__
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Per-Period Stream Instrumentation
+ *
+ * Collected by the proxy playback/capture paths once per period: duration
+ * of the write/read call, time blocked in the PCM layer, buffer fill level,
+ * xruns and jitter of the period timestamps against the nominal period.
+ *
+ * Only the stream thread records; every counter is a relaxed atomic so
+ * proxy_dump_playback_stream()/proxy_dump_capture_stream() can print the
+ * histograms from any thread without taking the stream lock. Recording a
+ * period costs two clock reads and a few atomic adds.
+ */
+
+#define AUDIO_STATS_BUCKETS         16      // Power of two microsecond buckets, 1us .. 32ms+
+#define AUDIO_STATS_FILL_BUCKETS    10      // 10% fill level buckets
+
+struct audio_latency_histogram {
+    atomic_uint_least32_t buckets[AUDIO_STATS_BUCKETS];
+    atomic_uint_least64_t count;
+    atomic_uint_least64_t sum_us;
+    atomic_uint_least32_t max_us;
+};
+
+struct audio_stream_stats {
+    struct audio_latency_histogram call;        // write/read call duration
+    struct audio_latency_histogram blocked;     // time blocked in pcm_write/pcm_read
+    struct audio_latency_histogram jitter;      // |period interval - nominal period|
+    atomic_uint_least32_t fill[AUDIO_STATS_FILL_BUCKETS];
+    atomic_uint_least64_t periods;
+    atomic_uint_least64_t xruns;
+
+    /* Stream thread only */
+    uint32_t period_us;
+    int64_t last_period_ns;
+};
+
+static inline int64_t audio_stats_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline void audio_latency_histogram_record(struct audio_latency_histogram *h, uint32_t us)
+{
+    int bucket = 0;
+    uint32_t max;
+
+    while (bucket < AUDIO_STATS_BUCKETS - 1 && us >= (2u << bucket))
+        bucket++;
+
+    atomic_fetch_add_explicit(&h->buckets[bucket], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum_us, us, memory_order_relaxed);
+
+    /* Single writer, so a plain compare is enough */
+    max = atomic_load_explicit(&h->max_us, memory_order_relaxed);
+    if (us > max)
+        atomic_store_explicit(&h->max_us, us, memory_order_relaxed);
+}
+
+static inline void audio_stream_stats_init(struct audio_stream_stats *stats, uint32_t period_frames,
+                                           uint32_t sample_rate)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->period_us = sample_rate ? (uint32_t)((uint64_t)period_frames * 1000000 / sample_rate) : 0;
+}
+
+/*
+ * Records one period. start_ns is audio_stats_now_ns() taken when the
+ * write/read call started, blocked_ns the time spent in the PCM call and
+ * fill_frames/buffer_frames the PCM buffer level after it.
+ */
+static inline void audio_stream_stats_period(struct audio_stream_stats *stats, int64_t start_ns,
+                                             int64_t blocked_ns, uint32_t fill_frames, uint32_t buffer_frames)
+{
+    int64_t now = audio_stats_now_ns();
+
+    audio_latency_histogram_record(&stats->call, (uint32_t)((now - start_ns) / 1000));
+    audio_latency_histogram_record(&stats->blocked, (uint32_t)(blocked_ns / 1000));
+
+    if (buffer_frames) {
+        uint32_t bucket = (uint32_t)((uint64_t)fill_frames * AUDIO_STATS_FILL_BUCKETS / buffer_frames);
+        if (bucket >= AUDIO_STATS_FILL_BUCKETS)
+            bucket = AUDIO_STATS_FILL_BUCKETS - 1;
+        atomic_fetch_add_explicit(&stats->fill[bucket], 1, memory_order_relaxed);
+    }
+
+    if (stats->last_period_ns && stats->period_us) {
+        int64_t interval_us = (now - stats->last_period_ns) / 1000;
+        int64_t deviation = interval_us - stats->period_us;
+        audio_latency_histogram_record(&stats->jitter, (uint32_t)(deviation < 0 ? -deviation : deviation));
+    }
+    stats->last_period_ns = now;
+
+    atomic_fetch_add_explicit(&stats->periods, 1, memory_order_relaxed);
+}
+
+static inline void audio_stream_stats_xrun(struct audio_stream_stats *stats)
+{
+    atomic_fetch_add_explicit(&stats->xruns, 1, memory_order_relaxed);
+}
+
+/* Standby breaks the period cadence; do not count the gap as jitter */
+static inline void audio_stream_stats_standby(struct audio_stream_stats *stats)
+{
+    stats->last_period_ns = 0;
+}
+
+static inline void audio_latency_histogram_dump(const struct audio_latency_histogram *h, int fd, const char *name)
+{
+    uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    uint64_t sum = atomic_load_explicit(&h->sum_us, memory_order_relaxed);
+
+    dprintf(fd, "\t\t%s: count %llu, avg %llu us, max %u us\n\t\t  ", name, (unsigned long long)count,
+            (unsigned long long)(count ? sum / count : 0),
+            atomic_load_explicit(&h->max_us, memory_order_relaxed));
+    for (int i = 0; i < AUDIO_STATS_BUCKETS; i++) {
+        uint32_t n = atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+        if (n)
+            dprintf(fd, "[%s%uus] %u  ", i == AUDIO_STATS_BUCKETS - 1 ? ">=" : "<", i == AUDIO_STATS_BUCKETS - 1 ?
+                    1u << i : 2u << i, n);
+    }
+    dprintf(fd, "\n");
+}
+
+static inline void audio_stream_stats_dump(const struct audio_stream_stats *stats, int fd)
+{
+    dprintf(fd, "\tLatency Statistics: periods %llu, xruns %llu, nominal period %u us\n",
+            (unsigned long long)atomic_load_explicit(&stats->periods, memory_order_relaxed),
+            (unsigned long long)atomic_load_explicit(&stats->xruns, memory_order_relaxed), stats->period_us);
+    audio_latency_histogram_dump(&stats->call, fd, "Call Duration");
+    audio_latency_histogram_dump(&stats->blocked, fd, "PCM Blocked");
+    audio_latency_histogram_dump(&stats->jitter, fd, "Period Jitter");
+
+    dprintf(fd, "\t\tFill Level: ");
+    for (int i = 0; i < AUDIO_STATS_FILL_BUCKETS; i++)
+        dprintf(fd, "[%d%%] %u  ", i * 100 / AUDIO_STATS_FILL_BUCKETS,
+                atomic_load_explicit(&stats->fill[i], memory_order_relaxed));
+    dprintf(fd, "\n");
+}
+
+#endif  // __EXYNOS_AUDIOHAL_STREAM_STATS_H__
@@ -18,194 +18,240 @@
 #define __EXYNOS_AUDIOHAL_TABLE_H__
 
 /*
- * Audio Streams Table for readable log messages
+ * Every table is listed once as an X-macro of (enum value, string) and
+ * expanded into a read-only array with designated initializers. The arrays
+ * are weak, so the tables end up once in the linked HAL whatever the number
+ * of translation units including this header, and each list is checked
+ * against the enum at compile time: it must have one entry per value and
+ * name every value in [0, cnt) exactly once. Adding, removing or
+ * renumbering an enum value without updating its table fails the build
+ * instead of logging "(null)" or the wrong string.
  */
-char * stream_table[ASTREAM_CNT] = {
-    [ASTREAM_PLAYBACK_PRIMARY]       = "primary_out",
-    [ASTREAM_PLAYBACK_FAST]          = "fast_out",
-    [ASTREAM_PLAYBACK_DEEP_BUFFER]   = "deep_out",
-    [ASTREAM_PLAYBACK_LOW_LATENCY]   = "low_out",
-    [ASTREAM_PLAYBACK_COMPR_OFFLOAD] = "offload_out",
-    [ASTREAM_PLAYBACK_MMAP]          = "mmap_out",
-    [ASTREAM_PLAYBACK_USB_DEVICE]    = "usb_out",
-    [ASTREAM_PLAYBACK_AUX_DIGITAL]   = "aux_out",
-
-    [ASTREAM_CAPTURE_PRIMARY]        = "primary_in",
-    [ASTREAM_CAPTURE_CALL]           = "callrec_in",
-    [ASTREAM_CAPTURE_LOW_LATENCY]    = "low_in",
-    [ASTREAM_CAPTURE_MMAP]           = "mmap_in",
-    [ASTREAM_CAPTURE_USB_DEVICE]     = "usb_in",
-    [ASTREAM_CAPTURE_FM]             = "fmrec_in",
+#define AUDIOHAL_TABLE              __attribute__((weak, visibility("hidden"))) const char * const
+#define AUDIOHAL_TABLE_ENTRY(id, str)   [id] = str,
+#define AUDIOHAL_TABLE_COUNT(id, str)   + 1
+#define AUDIOHAL_TABLE_BIT(id, str)     | (1ULL << (id))
+
+#define AUDIOHAL_TABLE_CHECK(list, cnt, name)                                                      \
+    _Static_assert((cnt) > 0 && (cnt) <= 64, name " is too long to check");                        \
+    _Static_assert(0 list(AUDIOHAL_TABLE_COUNT) == (cnt), name " needs one entry per enum value"); \
+    _Static_assert((0ULL list(AUDIOHAL_TABLE_BIT)) == (~0ULL >> (64 - (cnt))),                     \
+                   name " does not cover every enum value")
+
 #ifdef SUPPORT_STHAL_INTERFACE
-    [ASTREAM_CAPTURE_HOTWORD]        = "hotword_in",
+#define AUDIOHAL_STHAL_ENTRY(X, id, str)    X(id, str)
+#else
+#define AUDIOHAL_STHAL_ENTRY(X, id, str)
 #endif
 
-    [ASTREAM_NONE]                   = "none"
-};
+static inline const char *audiohal_table_lookup(const char * const *table, int cnt, int id)
+{
+    if (id < 0 || id >= cnt || table[id] == NULL)
+        return "unknown";
+    return table[id];
+}
+
+/*
+ * Audio Streams Table for readable log messages
+ */
+#define AUDIO_STREAM_NAMES(X)                                       \
+    X(ASTREAM_PLAYBACK_PRIMARY,       "primary_out")                \
+    X(ASTREAM_PLAYBACK_FAST,          "fast_out")                   \
+    X(ASTREAM_PLAYBACK_DEEP_BUFFER,   "deep_out")                   \
+    X(ASTREAM_PLAYBACK_LOW_LATENCY,   "low_out")                    \
+    X(ASTREAM_PLAYBACK_COMPR_OFFLOAD, "offload_out")                \
+    X(ASTREAM_PLAYBACK_MMAP,          "mmap_out")                   \
+    X(ASTREAM_PLAYBACK_USB_DEVICE,    "usb_out")                    \
+    X(ASTREAM_PLAYBACK_AUX_DIGITAL,   "aux_out")                    \
+                                                                    \
+    X(ASTREAM_CAPTURE_PRIMARY,        "primary_in")                 \
+    X(ASTREAM_CAPTURE_CALL,           "callrec_in")                 \
+    X(ASTREAM_CAPTURE_LOW_LATENCY,    "low_in")                     \
+    X(ASTREAM_CAPTURE_MMAP,           "mmap_in")                    \
+    X(ASTREAM_CAPTURE_USB_DEVICE,     "usb_in")                     \
+    X(ASTREAM_CAPTURE_FM,             "fmrec_in")                   \
+    AUDIOHAL_STHAL_ENTRY(X, ASTREAM_CAPTURE_HOTWORD, "hotword_in")  \
+                                                                    \
+    X(ASTREAM_NONE,                   "none")
+
+AUDIOHAL_TABLE stream_table[ASTREAM_CNT] = { AUDIO_STREAM_NAMES(AUDIOHAL_TABLE_ENTRY) };
+AUDIOHAL_TABLE_CHECK(AUDIO_STREAM_NAMES, ASTREAM_CNT, "stream_table");
 
 /**
  ** Audio Usage Table for readable log messages
  **/
-char * usage_table[AUSAGE_CNT] = {
-    [AUSAGE_MEDIA]                  = "media",
-    [AUSAGE_RECORDING]              = "recording",
-    [AUSAGE_CAMCORDER]              = "camcoder",
-
-    [AUSAGE_VOICE_CALL_NB]          = "voice_call_nb",
-    [AUSAGE_VOICE_CALL_WB]          = "voice_call_wb",
-    [AUSAGE_VOLTE_CALL_NB]          = "volte_call_nb",
-    [AUSAGE_VOLTE_CALL_WB]          = "volte_call_wb",
-    [AUSAGE_VOLTE_CALL_SWB]         = "volte_vt_call_swb",
-    [AUSAGE_VOLTE_VT_CALL_NB]       = "volte_vt_call_nb",
-    [AUSAGE_VOLTE_VT_CALL_WB]       = "volte_vt_call_wb",
-    [AUSAGE_VOLTE_VT_CALL_SWB]      = "volte_call_swb",
-    [AUSAGE_TTY]                    = "tty_mode",
-
-    [AUSAGE_WIFI_CALL_NB]           = "vowifi_call_nb",
-    [AUSAGE_WIFI_CALL_WB]           = "vowifi_call_wb",
-    [AUSAGE_WIFI_CALL_SWB]          = "vowifi_call_swb",
-    [AUSAGE_VIDEO_CALL]             = "video_call",
-    [AUSAGE_VOIP_CALL]              = "voip_call",
-    [AUSAGE_COMMUNICATION]          = "voip_call",
-    [AUSAGE_AP_TTY]                 = "ap_tty_mode",
-
-    [AUSAGE_INCALL_UPLINK]          = "callrecord_uplink",
-    [AUSAGE_INCALL_DOWNLINK]        = "callrecord_downlink",
-    [AUSAGE_INCALL_UPLINK_DOWNLINK] = "callrecord",
-
-    [AUSAGE_RECOGNITION]            = "recognition",
-
-    [AUSAGE_FM_RADIO]               = "fm_radio",
-
-#ifdef SUPPORT_STHAL_INTERFACE
-    [AUSAGE_HOTWORD_SEAMLESS]       = "hotword_seamless",
-    [AUSAGE_HOTWORD_RECORD]         = "hotword_record",
-#endif
-
-    [AUSAGE_LOOPBACK]               = "factory_loopback",
-    [AUSAGE_LOOPBACK_NODELAY]       = "factory_loopback_nodelay",
-    [AUSAGE_LOOPBACK_REALTIME]      = "factory_loopback_realtime",
-    [AUSAGE_LOOPBACK_CODEC]         = "factory_loopback_codec",
-    [AUSAGE_RMS]                    = "factory_rms",
-
-    [AUSAGE_NONE]                   = "none",
-};
+#define AUDIO_USAGE_NAMES(X)                                                \
+    X(AUSAGE_MEDIA,                  "media")                               \
+    X(AUSAGE_RECORDING,              "recording")                           \
+    X(AUSAGE_CAMCORDER,              "camcoder")                            \
+                                                                            \
+    X(AUSAGE_VOICE_CALL_NB,          "voice_call_nb")                       \
+    X(AUSAGE_VOICE_CALL_WB,          "voice_call_wb")                       \
+    X(AUSAGE_VOLTE_CALL_NB,          "volte_call_nb")                       \
+    X(AUSAGE_VOLTE_CALL_WB,          "volte_call_wb")                       \
+    X(AUSAGE_VOLTE_CALL_SWB,         "volte_call_swb")                      \
+    X(AUSAGE_VOLTE_VT_CALL_NB,       "volte_vt_call_nb")                    \
+    X(AUSAGE_VOLTE_VT_CALL_WB,       "volte_vt_call_wb")                    \
+    X(AUSAGE_VOLTE_VT_CALL_SWB,      "volte_vt_call_swb")                   \
+    X(AUSAGE_TTY,                    "tty_mode")                            \
+                                                                            \
+    X(AUSAGE_WIFI_CALL_NB,           "vowifi_call_nb")                      \
+    X(AUSAGE_WIFI_CALL_WB,           "vowifi_call_wb")                      \
+    X(AUSAGE_WIFI_CALL_SWB,          "vowifi_call_swb")                     \
+    X(AUSAGE_VIDEO_CALL,             "video_call")                          \
+    X(AUSAGE_VOIP_CALL,              "voip_call")                           \
+    X(AUSAGE_COMMUNICATION,          "voip_call")                           \
+    X(AUSAGE_AP_TTY,                 "ap_tty_mode")                         \
+                                                                            \
+    X(AUSAGE_INCALL_UPLINK,          "callrecord_uplink")                   \
+    X(AUSAGE_INCALL_DOWNLINK,        "callrecord_downlink")                 \
+    X(AUSAGE_INCALL_UPLINK_DOWNLINK, "callrecord")                          \
+                                                                            \
+    X(AUSAGE_RECOGNITION,            "recognition")                         \
+                                                                            \
+    X(AUSAGE_FM_RADIO,               "fm_radio")                            \
+                                                                            \
+    AUDIOHAL_STHAL_ENTRY(X, AUSAGE_HOTWORD_SEAMLESS, "hotword_seamless")    \
+    AUDIOHAL_STHAL_ENTRY(X, AUSAGE_HOTWORD_RECORD,   "hotword_record")      \
+                                                                            \
+    X(AUSAGE_LOOPBACK,               "factory_loopback")                    \
+    X(AUSAGE_LOOPBACK_NODELAY,       "factory_loopback_nodelay")            \
+    X(AUSAGE_LOOPBACK_REALTIME,      "factory_loopback_realtime")           \
+    X(AUSAGE_LOOPBACK_CODEC,         "factory_loopback_codec")              \
+    X(AUSAGE_RMS,                    "factory_rms")                         \
+                                                                            \
+    X(AUSAGE_NONE,                   "none")
+
+AUDIOHAL_TABLE usage_table[AUSAGE_CNT] = { AUDIO_USAGE_NAMES(AUDIOHAL_TABLE_ENTRY) };
+AUDIOHAL_TABLE_CHECK(AUDIO_USAGE_NAMES, AUSAGE_CNT, "usage_table");
 
 /**
  ** Usage Path(AP/CP to Codec) Configuration based on Audio Usage
  **/
-char * usage_path_table[AUSAGE_CNT] = {
-    [AUSAGE_MEDIA]                  = "media",
-    [AUSAGE_RECORDING]              = "recording",
-    [AUSAGE_CAMCORDER]              = "camcorder",
-
-    [AUSAGE_VOICE_CALL_NB]          = "incall_nb",
-    [AUSAGE_VOICE_CALL_WB]          = "incall_wb",
-    [AUSAGE_VOLTE_CALL_NB]          = "volte_cp_nb",
-    [AUSAGE_VOLTE_CALL_WB]          = "volte_cp_wb",
-    [AUSAGE_VOLTE_CALL_SWB]         = "volte_cp_evs",
-    [AUSAGE_VOLTE_VT_CALL_NB]       = "volte_vt_cp_nb",
-    [AUSAGE_VOLTE_VT_CALL_WB]       = "volte_vt_cp_wb",
-    [AUSAGE_VOLTE_VT_CALL_SWB]      = "volte_vt_cp_evs",
-    [AUSAGE_TTY]                    = "tty_mode",
-
-    [AUSAGE_WIFI_CALL_NB]           = "wificall_nb",
-    [AUSAGE_WIFI_CALL_WB]           = "wificall_wb",
-    [AUSAGE_WIFI_CALL_SWB]          = "wificall_evs",
-    [AUSAGE_VIDEO_CALL]             = "video_call",
-    [AUSAGE_VOIP_CALL]              = "voip",
-    [AUSAGE_COMMUNICATION]          = "communication",
-    [AUSAGE_AP_TTY]                 = "ap_tty_mode",
-
-    [AUSAGE_INCALL_UPLINK]          = "callrecord_uplink",
-    [AUSAGE_INCALL_DOWNLINK]        = "callrecord_downlink",
-    [AUSAGE_INCALL_UPLINK_DOWNLINK] = "callrecord",
-
-    [AUSAGE_RECOGNITION]            = "recognition",
-
-    [AUSAGE_FM_RADIO]               = "fm_radio",
-
-#ifdef SUPPORT_STHAL_INTERFACE
-    [AUSAGE_HOTWORD_SEAMLESS]       = "hotword_seamless",    //dummy definition not used
-    [AUSAGE_HOTWORD_RECORD]         = "hotword_record",    //dummy definition not used
-#endif
-
-    [AUSAGE_LOOPBACK]               = "loopback_packet",
-    [AUSAGE_LOOPBACK_NODELAY]       = "loopback",
-    [AUSAGE_LOOPBACK_REALTIME]      = "realtimeloopback",
-    [AUSAGE_LOOPBACK_CODEC]         = "loopback_codec",
-    [AUSAGE_RMS]                    = "echo_test",
-
-    [AUSAGE_NONE]                   = "none",
-};
+#define AUDIO_USAGE_PATHS(X)                                                \
+    X(AUSAGE_MEDIA,                  "media")                               \
+    X(AUSAGE_RECORDING,              "recording")                           \
+    X(AUSAGE_CAMCORDER,              "camcorder")                           \
+                                                                            \
+    X(AUSAGE_VOICE_CALL_NB,          "incall_nb")                           \
+    X(AUSAGE_VOICE_CALL_WB,          "incall_wb")                           \
+    X(AUSAGE_VOLTE_CALL_NB,          "volte_cp_nb")                         \
+    X(AUSAGE_VOLTE_CALL_WB,          "volte_cp_wb")                         \
+    X(AUSAGE_VOLTE_CALL_SWB,         "volte_cp_evs")                        \
+    X(AUSAGE_VOLTE_VT_CALL_NB,       "volte_vt_cp_nb")                      \
+    X(AUSAGE_VOLTE_VT_CALL_WB,       "volte_vt_cp_wb")                      \
+    X(AUSAGE_VOLTE_VT_CALL_SWB,      "volte_vt_cp_evs")                     \
+    X(AUSAGE_TTY,                    "tty_mode")                            \
+                                                                            \
+    X(AUSAGE_WIFI_CALL_NB,           "wificall_nb")                         \
+    X(AUSAGE_WIFI_CALL_WB,           "wificall_wb")                         \
+    X(AUSAGE_WIFI_CALL_SWB,          "wificall_evs")                        \
+    X(AUSAGE_VIDEO_CALL,             "video_call")                          \
+    X(AUSAGE_VOIP_CALL,              "voip")                                \
+    X(AUSAGE_COMMUNICATION,          "communication")                       \
+    X(AUSAGE_AP_TTY,                 "ap_tty_mode")                         \
+                                                                            \
+    X(AUSAGE_INCALL_UPLINK,          "callrecord_uplink")                   \
+    X(AUSAGE_INCALL_DOWNLINK,        "callrecord_downlink")                 \
+    X(AUSAGE_INCALL_UPLINK_DOWNLINK, "callrecord")                          \
+                                                                            \
+    X(AUSAGE_RECOGNITION,            "recognition")                         \
+                                                                            \
+    X(AUSAGE_FM_RADIO,               "fm_radio")                            \
+                                                                            \
+    /* dummy definitions, not used */                                       \
+    AUDIOHAL_STHAL_ENTRY(X, AUSAGE_HOTWORD_SEAMLESS, "hotword_seamless")    \
+    AUDIOHAL_STHAL_ENTRY(X, AUSAGE_HOTWORD_RECORD,   "hotword_record")      \
+                                                                            \
+    X(AUSAGE_LOOPBACK,               "loopback_packet")                     \
+    X(AUSAGE_LOOPBACK_NODELAY,       "loopback")                            \
+    X(AUSAGE_LOOPBACK_REALTIME,      "realtimeloopback")                    \
+    X(AUSAGE_LOOPBACK_CODEC,         "loopback_codec")                      \
+    X(AUSAGE_RMS,                    "echo_test")                           \
+                                                                            \
+    X(AUSAGE_NONE,                   "none")
+
+AUDIOHAL_TABLE usage_path_table[AUSAGE_CNT] = { AUDIO_USAGE_PATHS(AUDIOHAL_TABLE_ENTRY) };
+AUDIOHAL_TABLE_CHECK(AUDIO_USAGE_PATHS, AUSAGE_CNT, "usage_path_table");
 
 /**
  ** Device Path(Codec to Device) Configuration based on Audio Input/Output Device
  **/
-char * device_table[DEVICE_CNT] = {
-    // Playback Devices
-    [DEVICE_EARPIECE]               = "handset",
-    [DEVICE_SPEAKER]                = "speaker",
-    [DEVICE_HEADSET]                = "headset",
-    [DEVICE_HEADPHONE]              = "headphone",
-    [DEVICE_SPEAKER_AND_HEADSET]    = "speaker-headset",
-    [DEVICE_SPEAKER_AND_HEADPHONE]  = "speaker-headphone",
-    [DEVICE_BT_HEADSET]             = "bt-sco-headset",
-    [DEVICE_FM_EXTERNAL]            = "external",
-    [DEVICE_SPEAKER_AND_BT_HEADSET] = "speaker-bt-sco-headset",
-    [DEVICE_USB_HEADSET]            = "usb-headset",
-    [DEVICE_AUX_DIGITAL]            = "aux-digital",
-
-    // Special Playback Devices
-    [DEVICE_CALL_FWD]               = "",
-
-    // Capture Devices
-    [DEVICE_MAIN_MIC]               = "mic",
-    [DEVICE_HEADSET_MIC]            = "headset-mic",
-    [DEVICE_HEADSET_MAIN_MIC]       = "headset-main-mic",
-    [DEVICE_BT_HEADSET_MIC]         = "bt-sco-headset-in",
-    [DEVICE_BT_NREC_HEADSET_MIC]    = "bt-sco-nrec-headset-in",
-    [DEVICE_USB_HEADSET_MIC]        = "usb-headset-mic",
-
-    [DEVICE_HANDSET_MIC]            = "handset-mic",
-    [DEVICE_SPEAKER_MIC]            = "speaker-mic",
-    [DEVICE_HEADPHONE_MIC]          = "headphone-mic",
-
-    [DEVICE_SUB_MIC]                = "2nd-mic",
-    [DEVICE_FULL_MIC]               = "full-mic",
-    [DEVICE_HCO_MIC]                = "hco-mic",
-    [DEVICE_VCO_MIC]                = "vco-mic",
-
-    [DEVICE_FM_TUNER]               = "fm-tuner",
-
-    [DEVICE_NONE]                   = "none",
-};
+#define AUDIO_DEVICE_PATHS(X)                                   \
+    /* Playback Devices */                                      \
+    X(DEVICE_EARPIECE,               "handset")                 \
+    X(DEVICE_SPEAKER,                "speaker")                 \
+    X(DEVICE_HEADSET,                "headset")                 \
+    X(DEVICE_HEADPHONE,              "headphone")               \
+    X(DEVICE_SPEAKER_AND_HEADSET,    "speaker-headset")         \
+    X(DEVICE_SPEAKER_AND_HEADPHONE,  "speaker-headphone")       \
+    X(DEVICE_BT_HEADSET,             "bt-sco-headset")          \
+    X(DEVICE_FM_EXTERNAL,            "external")                \
+    X(DEVICE_SPEAKER_AND_BT_HEADSET, "speaker-bt-sco-headset")  \
+    X(DEVICE_USB_HEADSET,            "usb-headset")             \
+    X(DEVICE_AUX_DIGITAL,            "aux-digital")             \
+                                                                \
+    /* Special Playback Devices */                              \
+    X(DEVICE_CALL_FWD,               "")                        \
+                                                                \
+    /* Capture Devices */                                       \
+    X(DEVICE_MAIN_MIC,               "mic")                     \
+    X(DEVICE_HEADSET_MIC,            "headset-mic")             \
+    X(DEVICE_HEADSET_MAIN_MIC,       "headset-main-mic")        \
+    X(DEVICE_BT_HEADSET_MIC,         "bt-sco-headset-in")       \
+    X(DEVICE_BT_NREC_HEADSET_MIC,    "bt-sco-nrec-headset-in")  \
+    X(DEVICE_USB_HEADSET_MIC,        "usb-headset-mic")         \
+                                                                \
+    X(DEVICE_HANDSET_MIC,            "handset-mic")             \
+    X(DEVICE_SPEAKER_MIC,            "speaker-mic")             \
+    X(DEVICE_HEADPHONE_MIC,          "headphone-mic")           \
+                                                                \
+    X(DEVICE_SUB_MIC,                "2nd-mic")                 \
+    X(DEVICE_FULL_MIC,               "full-mic")                \
+    X(DEVICE_HCO_MIC,                "hco-mic")                 \
+    X(DEVICE_VCO_MIC,                "vco-mic")                 \
+                                                                \
+    X(DEVICE_FM_TUNER,               "fm-tuner")                \
+                                                                \
+    X(DEVICE_NONE,                   "none")
+
+AUDIOHAL_TABLE device_table[DEVICE_CNT] = { AUDIO_DEVICE_PATHS(AUDIOHAL_TABLE_ENTRY) };
+AUDIOHAL_TABLE_CHECK(AUDIO_DEVICE_PATHS, DEVICE_CNT, "device_table");
 
 /**
  ** Sampling Rate Modifier Configuration based on Audio Input/Output Device
  **/
-char * modifier_table[MODIFIER_MAX] = {
-    /* RX modifier */
-    [MODIFIER_BT_SCO_RX_NB]  = "set-bt-sco-rx-rate-nb",
-    [MODIFIER_BT_SCO_RX_WB]  = "set-bt-sco-rx-rate-wb",
-
-    /* TX modifier */
-    [MODIFIER_BT_SCO_TX_NB]  = "set-bt-sco-tx-rate-nb",
-    [MODIFIER_BT_SCO_TX_WB]  = "set-bt-sco-tx-rate-wb",
-
-    [MODIFIER_NONE]            = "none",
-};
+#define AUDIO_MODIFIER_PATHS(X)                         \
+    /* RX modifier */                                   \
+    X(MODIFIER_BT_SCO_RX_NB, "set-bt-sco-rx-rate-nb")   \
+    X(MODIFIER_BT_SCO_RX_WB, "set-bt-sco-rx-rate-wb")   \
+                                                        \
+    /* TX modifier */                                   \
+    X(MODIFIER_BT_SCO_TX_NB, "set-bt-sco-tx-rate-nb")   \
+    X(MODIFIER_BT_SCO_TX_WB, "set-bt-sco-tx-rate-wb")   \
+                                                        \
+    X(MODIFIER_NONE,         "none")
+
+AUDIOHAL_TABLE modifier_table[MODIFIER_CNT] = { AUDIO_MODIFIER_PATHS(AUDIOHAL_TABLE_ENTRY) };
+AUDIOHAL_TABLE_CHECK(AUDIO_MODIFIER_PATHS, MODIFIER_CNT, "modifier_table");
 
 /**
  ** Offload Message Table for readable log messages
  **/
-char * offload_msg_table[OFFLOAD_MSG_MAX] = {
-    [OFFLOAD_MSG_INVALID]            = "Offload Message_Invalid",
-    [OFFLOAD_MSG_WAIT_WRITE]         = "Offload Message_Wait to write",
-    [OFFLOAD_MSG_WAIT_DRAIN]         = "Offload Message_Wait to drain",
-    [OFFLOAD_MSG_WAIT_PARTIAL_DRAIN] = "Offload Message_Wait to drain partially",
-    [OFFLOAD_MSG_EXIT]               = "Offload Message_Wait to exit",
-};
-
+#define AUDIO_OFFLOAD_MSG_NAMES(X)                                                  \
+    X(OFFLOAD_MSG_INVALID,            "Offload Message_Invalid")                    \
+    X(OFFLOAD_MSG_WAIT_WRITE,         "Offload Message_Wait to write")              \
+    X(OFFLOAD_MSG_WAIT_DRAIN,         "Offload Message_Wait to drain")              \
+    X(OFFLOAD_MSG_WAIT_PARTIAL_DRAIN, "Offload Message_Wait to drain partially")    \
+    X(OFFLOAD_MSG_EXIT,               "Offload Message_Wait to exit")
+
+AUDIOHAL_TABLE offload_msg_table[OFFLOAD_MSG_MAX] = { AUDIO_OFFLOAD_MSG_NAMES(AUDIOHAL_TABLE_ENTRY) };
+AUDIOHAL_TABLE_CHECK(AUDIO_OFFLOAD_MSG_NAMES, OFFLOAD_MSG_MAX, "offload_msg_table");
+
+/* Bounds checked lookups, "unknown" for out of range values */
+#define audio_stream_name(s)        audiohal_table_lookup(stream_table, ASTREAM_CNT, (s))
+#define audio_usage_name(u)         audiohal_table_lookup(usage_table, AUSAGE_CNT, (u))
+#define audio_device_name(d)        audiohal_table_lookup(device_table, DEVICE_CNT, (d))
+#define audio_offload_msg_name(m)   audiohal_table_lookup(offload_msg_table, OFFLOAD_MSG_MAX, (m))
 
 #endif  // __EXYNOS_AUDIOHAL_TABLE_H__
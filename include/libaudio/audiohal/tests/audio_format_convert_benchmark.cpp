@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include <libaudio/audiohal/audio_format_convert.h>
+
+/*
+ * Cost of each conversion audio_format_convert() performs on the proxy
+ * write/read paths, for one 20 ms period at 48 kHz.
+ */
+namespace {
+
+constexpr size_t kFrames = 960;
+
+struct conversion {
+    const char *name;
+    audio_format_t src_format;
+    uint32_t src_ch;
+    audio_format_t dst_format;
+    uint32_t dst_ch;
+};
+
+const conversion conversions[] = {
+    /* Direct kernels */
+    { "i16_to_i32", AUDIO_FORMAT_PCM_16_BIT, 2, AUDIO_FORMAT_PCM_32_BIT, 2 },
+    { "i32_to_i16", AUDIO_FORMAT_PCM_32_BIT, 2, AUDIO_FORMAT_PCM_16_BIT, 2 },
+    { "i16_to_float", AUDIO_FORMAT_PCM_16_BIT, 2, AUDIO_FORMAT_PCM_FLOAT, 2 },
+    { "float_to_i16", AUDIO_FORMAT_PCM_FLOAT, 2, AUDIO_FORMAT_PCM_16_BIT, 2 },
+    { "mono_to_stereo_i16", AUDIO_FORMAT_PCM_16_BIT, 1, AUDIO_FORMAT_PCM_16_BIT, 2 },
+    { "stereo_to_mono_i16", AUDIO_FORMAT_PCM_16_BIT, 2, AUDIO_FORMAT_PCM_16_BIT, 1 },
+    /* Through the int32 intermediate */
+    { "i16_to_q8_23", AUDIO_FORMAT_PCM_16_BIT, 2, AUDIO_FORMAT_PCM_8_24_BIT, 2 },
+    { "q8_23_to_i16", AUDIO_FORMAT_PCM_8_24_BIT, 2, AUDIO_FORMAT_PCM_16_BIT, 2 },
+    { "i16_to_p24", AUDIO_FORMAT_PCM_16_BIT, 2, AUDIO_FORMAT_PCM_24_BIT_PACKED, 2 },
+    { "p24_to_i16", AUDIO_FORMAT_PCM_24_BIT_PACKED, 2, AUDIO_FORMAT_PCM_16_BIT, 2 },
+    { "float_to_i32", AUDIO_FORMAT_PCM_FLOAT, 2, AUDIO_FORMAT_PCM_32_BIT, 2 },
+    { "i32_to_float", AUDIO_FORMAT_PCM_32_BIT, 2, AUDIO_FORMAT_PCM_FLOAT, 2 },
+    { "stereo_i16_to_5_1_i32", AUDIO_FORMAT_PCM_16_BIT, 2, AUDIO_FORMAT_PCM_32_BIT, 6 },
+    { "5_1_float_to_stereo_i16", AUDIO_FORMAT_PCM_FLOAT, 6, AUDIO_FORMAT_PCM_16_BIT, 2 },
+};
+
+void BM_convert(benchmark::State &state, const conversion &c)
+{
+    std::vector<uint8_t> src(kFrames * c.src_ch * audio_bytes_per_sample(c.src_format));
+    std::vector<uint8_t> dst(kFrames * c.dst_ch * audio_bytes_per_sample(c.dst_format));
+
+    /* Float input must stay within [-1, 1) to take the usual path */
+    if (c.src_format == AUDIO_FORMAT_PCM_FLOAT) {
+        float *f = reinterpret_cast<float *>(src.data());
+        for (size_t i = 0; i < src.size() / sizeof(float); i++)
+            f[i] = static_cast<float>(static_cast<int>(i % 2001) - 1000) / 1024.0f;
+    } else {
+        for (size_t i = 0; i < src.size(); i++)
+            src[i] = static_cast<uint8_t>(i * 131 + 7);
+    }
+
+    for (auto _ : state) {
+        int ret = audio_format_convert(dst.data(), c.dst_format, c.dst_ch,
+                                       src.data(), c.src_format, c.src_ch, kFrames);
+        benchmark::DoNotOptimize(ret);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * kFrames);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * src.size());
+}
+
+int register_benchmarks()
+{
+    for (const auto &c : conversions)
+        benchmark::RegisterBenchmark((std::string("BM_convert/") + c.name).c_str(), BM_convert, c);
+    return 0;
+}
+
+[[maybe_unused]] const int registered = register_benchmarks();
+
+}  // namespace
+
+BENCHMARK_MAIN();
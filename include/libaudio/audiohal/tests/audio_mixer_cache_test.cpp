@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <libaudio/audiohal/audio_mixer_cache.h>
+
+/*
+ * audio_mixer_cache on a fake mixer backend that records every write reaching
+ * the "driver", so tests can tell memoised and batched writes from real ones.
+ */
+namespace {
+
+struct fake_ctl {
+    std::string name;
+    int value = 0;
+    std::string string_value;
+    std::vector<uint8_t> array_value;
+    int writes = 0;
+    int fail_writes = 0;    // Next writes to fail with -EIO
+};
+
+struct fake_mixer {
+    std::vector<fake_ctl> ctls;
+};
+
+fake_ctl *to_ctl(void *ctl)
+{
+    return static_cast<fake_ctl *>(ctl);
+}
+
+int fake_write(void *ctl)
+{
+    fake_ctl *c = to_ctl(ctl);
+    c->writes++;
+    if (c->fail_writes > 0) {
+        c->fail_writes--;
+        return -5;
+    }
+    return 0;
+}
+
+class MixerCacheTest : public ::testing::Test {
+  protected:
+    void SetUp() override
+    {
+        for (const char *name : { "SPK Volume", "HP Volume", "MIC Mux", "EQ Coefs", "SPK Volume" })
+            mixer.ctls.push_back({ name });
+
+        audio_mixer_backend backend = {};
+        backend.mixer = &mixer;
+        backend.get_num_ctls = [](void *m) {
+            return static_cast<unsigned int>(static_cast<fake_mixer *>(m)->ctls.size());
+        };
+        backend.get_ctl = [](void *m, unsigned int id) -> void * {
+            return &static_cast<fake_mixer *>(m)->ctls[id];
+        };
+        backend.get_ctl_name = [](void *ctl) { return to_ctl(ctl)->name.c_str(); };
+        backend.set_int = [](void *ctl, int value) {
+            int ret = fake_write(ctl);
+            if (ret == 0)
+                to_ctl(ctl)->value = value;
+            return ret;
+        };
+        backend.set_string = [](void *ctl, const char *value) {
+            int ret = fake_write(ctl);
+            if (ret == 0)
+                to_ctl(ctl)->string_value = value;
+            return ret;
+        };
+        backend.set_array = [](void *ctl, const void *value, size_t count) {
+            int ret = fake_write(ctl);
+            if (ret == 0) {
+                const uint8_t *bytes = static_cast<const uint8_t *>(value);
+                to_ctl(ctl)->array_value.assign(bytes, bytes + count);
+            }
+            return ret;
+        };
+        backend.get_int = [](void *ctl) { return to_ctl(ctl)->value; };
+        backend.get_array = [](void *ctl, void *value, size_t count) {
+            const std::vector<uint8_t> &bytes = to_ctl(ctl)->array_value;
+            if (count > bytes.size())
+                return -22;
+            memcpy(value, bytes.data(), count);
+            return 0;
+        };
+
+        ASSERT_TRUE(audio_mixer_cache_init(&cache, &backend));
+    }
+
+    void TearDown() override { audio_mixer_cache_deinit(&cache); }
+
+    fake_ctl &ctl(size_t id) { return mixer.ctls[id]; }
+
+    int total_writes() const
+    {
+        int n = 0;
+        for (const fake_ctl &c : mixer.ctls)
+            n += c.writes;
+        return n;
+    }
+
+    fake_mixer mixer;
+    audio_mixer_cache cache;
+};
+
+TEST_F(MixerCacheTest, LooksUpControlsByName)
+{
+    EXPECT_EQ(&ctl(1), audio_mixer_cache_get_ctl(&cache, "HP Volume"));
+    EXPECT_EQ(&ctl(3), audio_mixer_cache_get_ctl(&cache, "EQ Coefs"));
+    EXPECT_EQ(nullptr, audio_mixer_cache_get_ctl(&cache, "HP Volum"));
+    EXPECT_EQ(1u, cache.stats.misses);
+}
+
+TEST_F(MixerCacheTest, DuplicatedNameResolvesToFirstControl)
+{
+    EXPECT_EQ(&ctl(0), audio_mixer_cache_get_ctl(&cache, "SPK Volume"));
+}
+
+TEST_F(MixerCacheTest, SkipsUnchangedInt)
+{
+    audio_mixer_cache_set_int(&cache, "SPK Volume", 10);
+    audio_mixer_cache_set_int(&cache, "SPK Volume", 10);
+    audio_mixer_cache_set_int(&cache, "SPK Volume", 11);
+
+    EXPECT_EQ(2, ctl(0).writes);
+    EXPECT_EQ(11, ctl(0).value);
+    EXPECT_EQ(1u, cache.stats.skipped);
+}
+
+TEST_F(MixerCacheTest, ComparesStringAndArrayBytes)
+{
+    const uint8_t coefs[] = { 1, 2, 3, 4 };
+    const uint8_t other[] = { 1, 2, 3, 5 };
+
+    audio_mixer_cache_set_string(&cache, "MIC Mux", "DMIC1");
+    audio_mixer_cache_set_string(&cache, "MIC Mux", "DMIC1");
+    audio_mixer_cache_set_string(&cache, "MIC Mux", "DMIC2");
+    audio_mixer_cache_set_array(&cache, "EQ Coefs", coefs, sizeof(coefs));
+    audio_mixer_cache_set_array(&cache, "EQ Coefs", coefs, sizeof(coefs));
+    audio_mixer_cache_set_array(&cache, "EQ Coefs", other, sizeof(other));
+
+    EXPECT_EQ(2, ctl(2).writes);
+    EXPECT_EQ("DMIC2", ctl(2).string_value);
+    EXPECT_EQ(2, ctl(3).writes);
+    EXPECT_EQ(std::vector<uint8_t>(other, other + sizeof(other)), ctl(3).array_value);
+}
+
+TEST_F(MixerCacheTest, RetriesFailedWrite)
+{
+    ctl(1).fail_writes = 1;
+    audio_mixer_cache_set_int(&cache, "HP Volume", 5);
+    audio_mixer_cache_set_int(&cache, "HP Volume", 5);
+
+    EXPECT_EQ(2, ctl(1).writes);
+    EXPECT_EQ(5, ctl(1).value);
+}
+
+TEST_F(MixerCacheTest, InvalidateForgetsValues)
+{
+    audio_mixer_cache_set_int(&cache, "HP Volume", 5);
+    audio_mixer_cache_invalidate(&cache);
+    audio_mixer_cache_set_int(&cache, "HP Volume", 5);
+
+    EXPECT_EQ(2, ctl(1).writes);
+}
+
+TEST_F(MixerCacheTest, BatchAppliesLastValueAtEnd)
+{
+    audio_mixer_cache_begin_batch(&cache);
+    audio_mixer_cache_set_int(&cache, "SPK Volume", 1);
+    audio_mixer_cache_set_int(&cache, "SPK Volume", 2);
+    audio_mixer_cache_set_int(&cache, "HP Volume", 3);
+    EXPECT_EQ(0, total_writes());
+    EXPECT_EQ(2, audio_mixer_cache_get_int(&cache, "SPK Volume"));
+    audio_mixer_cache_end_batch(&cache);
+
+    EXPECT_EQ(1, ctl(0).writes);
+    EXPECT_EQ(2, ctl(0).value);
+    EXPECT_EQ(3, ctl(1).value);
+    EXPECT_EQ(1u, cache.stats.batches);
+    EXPECT_EQ(2u, cache.stats.last_batch_writes);
+}
+
+TEST_F(MixerCacheTest, BatchReadsReturnQueuedValues)
+{
+    const uint8_t coefs[] = { 9, 8, 7 };
+    uint8_t read[sizeof(coefs)] = {};
+
+    audio_mixer_cache_begin_batch(&cache);
+    audio_mixer_cache_set_array(&cache, "EQ Coefs", coefs, sizeof(coefs));
+    EXPECT_EQ(0, audio_mixer_cache_get_array(&cache, "EQ Coefs", read, sizeof(read)));
+    EXPECT_EQ(0, memcmp(coefs, read, sizeof(coefs)));
+    audio_mixer_cache_set_int(&cache, "HP Volume", 4);
+    EXPECT_EQ(4, audio_mixer_cache_get_int(&cache, "HP Volume"));
+    audio_mixer_cache_end_batch(&cache);
+
+    EXPECT_EQ(1, ctl(3).writes);
+    EXPECT_EQ(1, ctl(1).writes);
+}
+
+TEST_F(MixerCacheTest, NestedBatchKeepsOuterWrites)
+{
+    audio_mixer_cache_begin_batch(&cache);
+    audio_mixer_cache_set_int(&cache, "SPK Volume", 7);
+
+    audio_mixer_cache_begin_batch(&cache);
+    audio_mixer_cache_set_int(&cache, "HP Volume", 8);
+    audio_mixer_cache_end_batch(&cache);
+
+    /* The inner end does not apply anything, the outer one applies both */
+    EXPECT_EQ(0, total_writes());
+    EXPECT_EQ(0u, cache.stats.batches);
+
+    audio_mixer_cache_end_batch(&cache);
+    EXPECT_EQ(7, ctl(0).value);
+    EXPECT_EQ(8, ctl(1).value);
+    EXPECT_EQ(1u, cache.stats.batches);
+    EXPECT_EQ(2u, cache.stats.last_batch_writes);
+}
+
+TEST_F(MixerCacheTest, FullBatchFlushesEarlyWithoutLosingWrites)
+{
+    audio_mixer_cache_begin_batch(&cache);
+    for (int i = 0; i < AUDIO_MIXER_BATCH_MAX; i++) {
+        audio_mixer_cache_set_int(&cache, "SPK Volume", i);
+        audio_mixer_cache_set_int(&cache, "HP Volume", i);
+    }
+    audio_mixer_cache_set_string(&cache, "MIC Mux", "AMIC");
+    audio_mixer_cache_end_batch(&cache);
+
+    EXPECT_EQ(AUDIO_MIXER_BATCH_MAX - 1, ctl(0).value);
+    EXPECT_EQ(AUDIO_MIXER_BATCH_MAX - 1, ctl(1).value);
+    EXPECT_EQ("AMIC", ctl(2).string_value);
+}
+
+TEST_F(MixerCacheTest, OtherThreadWaitsForBatch)
+{
+    audio_mixer_cache_begin_batch(&cache);
+    audio_mixer_cache_set_int(&cache, "SPK Volume", 1);
+
+    struct reader_args {
+        audio_mixer_cache *cache;
+        int seen;
+    } args = { &cache, -1 };
+    pthread_t thread;
+    ASSERT_EQ(0, pthread_create(&thread, nullptr, [](void *arg) -> void * {
+        reader_args *a = static_cast<reader_args *>(arg);
+        a->seen = audio_mixer_cache_get_int(a->cache, "SPK Volume");
+        return nullptr;
+    }, &args));
+
+    audio_mixer_cache_set_int(&cache, "SPK Volume", 2);
+    audio_mixer_cache_end_batch(&cache);
+    pthread_join(thread, nullptr);
+
+    /* The reader ran after the route change, never in the middle of it */
+    EXPECT_EQ(2, args.seen);
+    EXPECT_EQ(1, ctl(0).writes);
+}
+
+}  // namespace
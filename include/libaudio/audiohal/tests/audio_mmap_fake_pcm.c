@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include <libaudio/audiohal/audio_mmap_position.h>
+
+#include "audio_mmap_fake_pcm.h"
+
+#define FAKE_PCM_BUFFER_PERIODS     4
+
+struct mmap_fake_pcm {
+    struct audio_mmap_position_shm shm;
+    uint32_t period_frames;
+    int64_t period_ns;
+    int64_t now_ns;
+    int64_t periods;            // Period interrupts raised so far
+
+    atomic_bool stop;
+    bool running;
+    pthread_t thread;
+};
+
+struct mmap_fake_pcm *mmap_fake_pcm_create(uint32_t sample_rate, uint32_t period_frames, int32_t drift_ppm)
+{
+    struct mmap_fake_pcm *pcm = (struct mmap_fake_pcm *)calloc(1, sizeof(*pcm));
+    double rate = (double)sample_rate * (1000000.0 + drift_ppm) / 1000000.0;
+
+    if (pcm == NULL)
+        return NULL;
+
+    audio_mmap_position_init(&pcm->shm, sample_rate, period_frames * FAKE_PCM_BUFFER_PERIODS);
+    pcm->period_frames = period_frames;
+    pcm->period_ns = (int64_t)((double)period_frames * 1000000000.0 / rate + 0.5);
+    atomic_init(&pcm->stop, false);
+
+    return pcm;
+}
+
+void mmap_fake_pcm_destroy(struct mmap_fake_pcm *pcm)
+{
+    mmap_fake_pcm_stop(pcm);
+    free(pcm);
+}
+
+void mmap_fake_pcm_advance(struct mmap_fake_pcm *pcm, int64_t ns)
+{
+    pcm->now_ns += ns;
+    while ((pcm->periods + 1) * pcm->period_ns <= pcm->now_ns) {
+        pcm->periods++;
+        audio_mmap_position_update(&pcm->shm, pcm->periods * pcm->period_frames,
+                                   pcm->periods * pcm->period_ns);
+    }
+}
+
+int64_t mmap_fake_pcm_now_ns(const struct mmap_fake_pcm *pcm)
+{
+    return pcm->now_ns;
+}
+
+int64_t mmap_fake_pcm_frames_at(const struct mmap_fake_pcm *pcm, int64_t time_ns)
+{
+    return time_ns / pcm->period_ns * pcm->period_frames +
+           time_ns % pcm->period_ns * pcm->period_frames / pcm->period_ns;
+}
+
+static void *mmap_fake_pcm_dma(void *arg)
+{
+    struct mmap_fake_pcm *pcm = (struct mmap_fake_pcm *)arg;
+
+    while (!atomic_load_explicit(&pcm->stop, memory_order_relaxed))
+        mmap_fake_pcm_advance(pcm, pcm->period_ns);
+
+    return NULL;
+}
+
+bool mmap_fake_pcm_start(struct mmap_fake_pcm *pcm)
+{
+    if (pcm->running)
+        return true;
+
+    atomic_store(&pcm->stop, false);
+    pcm->running = pthread_create(&pcm->thread, NULL, mmap_fake_pcm_dma, pcm) == 0;
+    return pcm->running;
+}
+
+void mmap_fake_pcm_stop(struct mmap_fake_pcm *pcm)
+{
+    if (!pcm->running)
+        return;
+
+    atomic_store(&pcm->stop, true);
+    pthread_join(pcm->thread, NULL);
+    pcm->running = false;
+}
+
+bool mmap_fake_pcm_read(struct mmap_fake_pcm *pcm, int64_t *frames, int64_t *time_ns)
+{
+    return audio_mmap_position_read(&pcm->shm, frames, time_ns);
+}
+
+bool mmap_fake_pcm_estimate(struct mmap_fake_pcm *pcm, int64_t now_ns, int64_t *frames)
+{
+    return audio_mmap_position_estimate(&pcm->shm, now_ns, frames);
+}
+
+void mmap_fake_pcm_corrupt(struct mmap_fake_pcm *pcm)
+{
+    pcm->shm.magic = 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXYNOS_AUDIOHAL_MMAP_FAKE_PCM_H__
+#define __EXYNOS_AUDIOHAL_MMAP_FAKE_PCM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fake MMAP PCM: a DMA pointer running on a simulated clock, with the period
+ * interrupt publishing the position into an audio_mmap_position_shm the way
+ * the proxy does. The DMA runs exactly period_frames every period_ns, so
+ * drift_ppm away from the nominal rate, and the expected position at any
+ * time is known exactly. Kept in C because audio_mmap_position.h uses C11
+ * <stdatomic.h>.
+ */
+struct mmap_fake_pcm;
+
+struct mmap_fake_pcm *mmap_fake_pcm_create(uint32_t sample_rate, uint32_t period_frames, int32_t drift_ppm);
+void mmap_fake_pcm_destroy(struct mmap_fake_pcm *pcm);
+
+/* Moves the simulated clock forward, publishing at every period boundary crossed */
+void mmap_fake_pcm_advance(struct mmap_fake_pcm *pcm, int64_t ns);
+int64_t mmap_fake_pcm_now_ns(const struct mmap_fake_pcm *pcm);
+/* Where the DMA pointer is at time_ns */
+int64_t mmap_fake_pcm_frames_at(const struct mmap_fake_pcm *pcm, int64_t time_ns);
+
+/* Runs the DMA on a thread, publishing periods back to back */
+bool mmap_fake_pcm_start(struct mmap_fake_pcm *pcm);
+void mmap_fake_pcm_stop(struct mmap_fake_pcm *pcm);
+
+/* Readers of the shared position block */
+bool mmap_fake_pcm_read(struct mmap_fake_pcm *pcm, int64_t *frames, int64_t *time_ns);
+bool mmap_fake_pcm_estimate(struct mmap_fake_pcm *pcm, int64_t now_ns, int64_t *frames);
+/* Makes the shared block look uninitialised, as a stale mapping would */
+void mmap_fake_pcm_corrupt(struct mmap_fake_pcm *pcm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __EXYNOS_AUDIOHAL_MMAP_FAKE_PCM_H__
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+
+#include "audio_mmap_fake_pcm.h"
+
+/*
+ * audio_mmap_position on a fake PCM whose DMA pointer runs on a simulated
+ * clock: readers must see the last period published, never a torn update,
+ * and the estimate must follow the DMA clock rather than the nominal rate.
+ */
+namespace {
+
+constexpr uint32_t kRate = 48000;
+constexpr uint32_t kPeriod = 192;               // 4 ms
+constexpr int kRing = 8;                        // AUDIO_MMAP_POSITION_RING
+
+class MmapPositionTest : public ::testing::Test {
+  protected:
+    void TearDown() override
+    {
+        if (pcm)
+            mmap_fake_pcm_destroy(pcm);
+    }
+
+    void create(int32_t drift_ppm)
+    {
+        pcm = mmap_fake_pcm_create(kRate, kPeriod, drift_ppm);
+        ASSERT_NE(nullptr, pcm);
+    }
+
+    mmap_fake_pcm *pcm = nullptr;
+};
+
+TEST_F(MmapPositionTest, NothingPublishedBeforeFirstPeriod)
+{
+    int64_t frames, time_ns;
+
+    create(0);
+    mmap_fake_pcm_advance(pcm, 1000000);
+    EXPECT_FALSE(mmap_fake_pcm_read(pcm, &frames, &time_ns));
+    EXPECT_FALSE(mmap_fake_pcm_estimate(pcm, mmap_fake_pcm_now_ns(pcm), &frames));
+}
+
+TEST_F(MmapPositionTest, ReadReturnsLastPeriod)
+{
+    int64_t frames, time_ns;
+
+    create(0);
+    mmap_fake_pcm_advance(pcm, 10000000);      // 2.5 periods
+    ASSERT_TRUE(mmap_fake_pcm_read(pcm, &frames, &time_ns));
+    EXPECT_EQ(2 * kPeriod, frames);
+    EXPECT_EQ(8000000, time_ns);
+
+    /* Well past the history ring, slots are reused */
+    mmap_fake_pcm_advance(pcm, 400000000);
+    ASSERT_TRUE(mmap_fake_pcm_read(pcm, &frames, &time_ns));
+    EXPECT_EQ(102 * kPeriod, frames);
+    EXPECT_EQ(mmap_fake_pcm_frames_at(pcm, time_ns), frames);
+}
+
+TEST_F(MmapPositionTest, EstimateUsesNominalRateUntilRingFull)
+{
+    int64_t frames;
+
+    create(0);
+    mmap_fake_pcm_advance(pcm, 3 * 4000000 + 1000000);
+    int64_t now = mmap_fake_pcm_now_ns(pcm);
+    ASSERT_TRUE(mmap_fake_pcm_estimate(pcm, now, &frames));
+    EXPECT_EQ(mmap_fake_pcm_frames_at(pcm, now), frames);
+}
+
+TEST_F(MmapPositionTest, EstimateFollowsDriftingDmaClock)
+{
+    int64_t frames, time_ns;
+
+    create(500);
+    mmap_fake_pcm_advance(pcm, (kRing + 4) * 4000000LL);
+    ASSERT_TRUE(mmap_fake_pcm_read(pcm, &frames, &time_ns));
+
+    /* 100 ms past the last period the nominal rate is 2.4 frames behind */
+    int64_t now = time_ns + 100000000;
+    int64_t actual = mmap_fake_pcm_frames_at(pcm, now);
+    int64_t nominal = frames + (now - time_ns) * kRate / 1000000000LL;
+    ASSERT_TRUE(mmap_fake_pcm_estimate(pcm, now, &frames));
+
+    EXPECT_GE(llabs(actual - nominal), 2);
+    EXPECT_LE(llabs(actual - frames), 1);
+}
+
+TEST_F(MmapPositionTest, RejectsUninitialisedBlock)
+{
+    int64_t frames, time_ns;
+
+    create(0);
+    mmap_fake_pcm_advance(pcm, 10000000);
+    mmap_fake_pcm_corrupt(pcm);
+    EXPECT_FALSE(mmap_fake_pcm_read(pcm, &frames, &time_ns));
+    EXPECT_FALSE(mmap_fake_pcm_estimate(pcm, 10000000, &frames));
+}
+
+TEST_F(MmapPositionTest, ConcurrentReadsAreNeverTorn)
+{
+    int64_t frames, time_ns, last = 0;
+    int reads = 0;
+
+    create(-300);
+    ASSERT_TRUE(mmap_fake_pcm_start(pcm));
+    for (int i = 0; i < 200000; i++) {
+        if (!mmap_fake_pcm_read(pcm, &frames, &time_ns))
+            continue;
+
+        /* A pair from two different updates would not sit on the DMA line */
+        ASSERT_EQ(mmap_fake_pcm_frames_at(pcm, time_ns), frames);
+        ASSERT_GE(frames, last);
+        last = frames;
+        reads++;
+    }
+    mmap_fake_pcm_stop(pcm);
+
+    EXPECT_GT(reads, 0);
+    EXPECT_GT(last, 0);
+}
+
+}  // namespace
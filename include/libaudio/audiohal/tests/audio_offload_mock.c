@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libaudio/audiohal/audio_offload_worker.h>
+
+#include "audio_offload_mock.h"
+
+#define OFFLOAD_MOCK_MAX_RESULTS    16
+
+struct offload_mock {
+    struct audio_offload_worker worker;
+    bool running;
+    int pipe_fd[2];
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool blocked[OFFLOAD_MSG_MAX];
+    bool released[OFFLOAD_MSG_MAX];
+    int release_ret[OFFLOAD_MSG_MAX];
+    bool interrupted;
+    int calls[OFFLOAD_MSG_MAX];
+    int completions[OFFLOAD_MSG_MAX];
+    int results[OFFLOAD_MSG_MAX][OFFLOAD_MOCK_MAX_RESULTS];
+};
+
+static int offload_mock_block(struct offload_mock *m, offload_msg_type msg)
+{
+    int ret;
+
+    pthread_mutex_lock(&m->lock);
+    m->calls[msg]++;
+    m->blocked[msg] = true;
+    pthread_cond_broadcast(&m->cond);
+    while (!m->released[msg] && !m->interrupted)
+        pthread_cond_wait(&m->cond, &m->lock);
+
+    if (m->released[msg]) {
+        ret = m->release_ret[msg];
+        m->released[msg] = false;
+    } else {
+        ret = -EINTR;
+    }
+    m->interrupted = false;
+    m->blocked[msg] = false;
+    pthread_mutex_unlock(&m->lock);
+
+    return ret;
+}
+
+static int offload_mock_wait_write(void *cookie)
+{
+    return offload_mock_block((struct offload_mock *)cookie, OFFLOAD_MSG_WAIT_WRITE);
+}
+
+static int offload_mock_drain(void *cookie)
+{
+    return offload_mock_block((struct offload_mock *)cookie, OFFLOAD_MSG_WAIT_DRAIN);
+}
+
+static int offload_mock_partial_drain(void *cookie)
+{
+    return offload_mock_block((struct offload_mock *)cookie, OFFLOAD_MSG_WAIT_PARTIAL_DRAIN);
+}
+
+static void offload_mock_interrupt(void *cookie)
+{
+    struct offload_mock *m = (struct offload_mock *)cookie;
+
+    pthread_mutex_lock(&m->lock);
+    for (int msg = 0; msg < OFFLOAD_MSG_MAX; msg++)
+        m->interrupted |= m->blocked[msg];
+    pthread_cond_broadcast(&m->cond);
+    pthread_mutex_unlock(&m->lock);
+}
+
+static void offload_mock_callback(void *cookie, offload_msg_type msg, int ret)
+{
+    struct offload_mock *m = (struct offload_mock *)cookie;
+
+    pthread_mutex_lock(&m->lock);
+    if (m->completions[msg] < OFFLOAD_MOCK_MAX_RESULTS)
+        m->results[msg][m->completions[msg]] = ret;
+    m->completions[msg]++;
+    pthread_cond_broadcast(&m->cond);
+    pthread_mutex_unlock(&m->lock);
+}
+
+/* Fills the pipe so that the write end polls as full */
+static void offload_mock_fill(struct offload_mock *m)
+{
+    char block[4096];
+
+    memset(block, 0, sizeof(block));
+    while (write(m->pipe_fd[1], block, sizeof(block)) > 0)
+        ;
+}
+
+static void offload_mock_deadline(int timeout_ms, struct timespec *deadline)
+{
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+struct offload_mock *offload_mock_create(bool pollable)
+{
+    struct offload_mock *m = (struct offload_mock *)calloc(1, sizeof(*m));
+    struct audio_offload_ops ops;
+
+    if (m == NULL)
+        return NULL;
+
+    m->pipe_fd[0] = m->pipe_fd[1] = -1;
+    pthread_mutex_init(&m->lock, NULL);
+    pthread_cond_init(&m->cond, NULL);
+
+    if (pollable) {
+        if (pipe(m->pipe_fd) < 0 || fcntl(m->pipe_fd[0], F_SETFL, O_NONBLOCK) < 0 ||
+            fcntl(m->pipe_fd[1], F_SETFL, O_NONBLOCK) < 0) {
+            offload_mock_destroy(m);
+            return NULL;
+        }
+        offload_mock_fill(m);
+    }
+
+    memset(&ops, 0, sizeof(ops));
+    ops.cookie = m;
+    ops.poll_fd = m->pipe_fd[1];
+    ops.wait_write = offload_mock_wait_write;
+    ops.drain = offload_mock_drain;
+    ops.partial_drain = offload_mock_partial_drain;
+    ops.interrupt = offload_mock_interrupt;
+    ops.callback = offload_mock_callback;
+    if (audio_offload_worker_start(&m->worker, &ops) != 0) {
+        offload_mock_destroy(m);
+        return NULL;
+    }
+    m->running = true;
+
+    return m;
+}
+
+void offload_mock_destroy(struct offload_mock *m)
+{
+    offload_mock_stop(m);
+    if (m->pipe_fd[0] >= 0)
+        close(m->pipe_fd[0]);
+    if (m->pipe_fd[1] >= 0)
+        close(m->pipe_fd[1]);
+    pthread_cond_destroy(&m->cond);
+    pthread_mutex_destroy(&m->lock);
+    free(m);
+}
+
+void offload_mock_post(struct offload_mock *m, offload_msg_type msg)
+{
+    audio_offload_worker_post(&m->worker, msg);
+}
+
+void offload_mock_cancel(struct offload_mock *m)
+{
+    audio_offload_worker_cancel(&m->worker);
+}
+
+void offload_mock_stop(struct offload_mock *m)
+{
+    if (!m->running)
+        return;
+    audio_offload_worker_stop(&m->worker);
+    m->running = false;
+}
+
+bool offload_mock_wait_blocked(struct offload_mock *m, offload_msg_type msg, int timeout_ms)
+{
+    struct timespec deadline;
+    bool ret = true;
+
+    offload_mock_deadline(timeout_ms, &deadline);
+    pthread_mutex_lock(&m->lock);
+    while (!m->blocked[msg]) {
+        if (pthread_cond_timedwait(&m->cond, &m->lock, &deadline) == ETIMEDOUT) {
+            ret = m->blocked[msg];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&m->lock);
+
+    return ret;
+}
+
+void offload_mock_release(struct offload_mock *m, offload_msg_type msg, int ret)
+{
+    pthread_mutex_lock(&m->lock);
+    m->released[msg] = true;
+    m->release_ret[msg] = ret;
+    pthread_cond_broadcast(&m->cond);
+    pthread_mutex_unlock(&m->lock);
+}
+
+void offload_mock_consume(struct offload_mock *m)
+{
+    char block[4096];
+
+    while (read(m->pipe_fd[0], block, sizeof(block)) > 0)
+        ;
+}
+
+bool offload_mock_wait_completed(struct offload_mock *m, offload_msg_type msg, int count, int timeout_ms)
+{
+    struct timespec deadline;
+    bool ret = true;
+
+    offload_mock_deadline(timeout_ms, &deadline);
+    pthread_mutex_lock(&m->lock);
+    while (m->completions[msg] < count) {
+        if (pthread_cond_timedwait(&m->cond, &m->lock, &deadline) == ETIMEDOUT) {
+            ret = m->completions[msg] >= count;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&m->lock);
+
+    return ret;
+}
+
+int offload_mock_completed(struct offload_mock *m, offload_msg_type msg, int ret)
+{
+    int count = 0;
+
+    pthread_mutex_lock(&m->lock);
+    for (int i = 0; i < m->completions[msg] && i < OFFLOAD_MOCK_MAX_RESULTS; i++)
+        count += m->results[msg][i] == ret;
+    pthread_mutex_unlock(&m->lock);
+
+    return count;
+}
+
+int offload_mock_calls(struct offload_mock *m, offload_msg_type msg)
+{
+    int count;
+
+    pthread_mutex_lock(&m->lock);
+    count = m->calls[msg];
+    pthread_mutex_unlock(&m->lock);
+
+    return count;
+}
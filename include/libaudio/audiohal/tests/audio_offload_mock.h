@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXYNOS_AUDIOHAL_OFFLOAD_MOCK_H__
+#define __EXYNOS_AUDIOHAL_OFFLOAD_MOCK_H__
+
+#include <stdbool.h>
+
+#include <libaudio/audiohal/audio_offload.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Mock compress device driving an audio_offload_worker. The blocking calls
+ * (drain, partial drain, and the write wait of a device without a pollable
+ * fd) wait until the test releases them or the worker interrupts them, as
+ * compress_stop() would. A pollable device exposes a pipe filled until it
+ * would block; consuming it makes the fd writable, like the DSP taking the
+ * next fragment. Kept in C because audio_offload_worker.h uses C11
+ * <stdatomic.h>.
+ */
+struct offload_mock;
+
+struct offload_mock *offload_mock_create(bool pollable);
+/* Stops the worker if it still runs */
+void offload_mock_destroy(struct offload_mock *m);
+
+void offload_mock_post(struct offload_mock *m, offload_msg_type msg);
+void offload_mock_cancel(struct offload_mock *m);
+void offload_mock_stop(struct offload_mock *m);
+
+/* Waits until a blocking call for msg is in progress */
+bool offload_mock_wait_blocked(struct offload_mock *m, offload_msg_type msg, int timeout_ms);
+/* Lets one blocking call for msg return ret */
+void offload_mock_release(struct offload_mock *m, offload_msg_type msg, int ret);
+/* Makes a pollable device writable */
+void offload_mock_consume(struct offload_mock *m);
+
+/* Waits until msg completed count times in total */
+bool offload_mock_wait_completed(struct offload_mock *m, offload_msg_type msg, int count, int timeout_ms);
+/* Completions of msg with ret so far */
+int offload_mock_completed(struct offload_mock *m, offload_msg_type msg, int ret);
+int offload_mock_calls(struct offload_mock *m, offload_msg_type msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __EXYNOS_AUDIOHAL_OFFLOAD_MOCK_H__
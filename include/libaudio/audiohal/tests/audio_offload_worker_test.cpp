@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <errno.h>
+
+#include "audio_offload_mock.h"
+
+/*
+ * audio_offload_worker on the mock compress device: every posted message must
+ * complete, a blocking drain must not hold back the other messages, and pause,
+ * flush and exit must not wait for the DSP.
+ */
+namespace {
+
+constexpr int kTimeoutMs = 2000;
+
+class OffloadWorkerTest : public ::testing::TestWithParam<bool> {
+  protected:
+    void SetUp() override
+    {
+        mock = offload_mock_create(GetParam());
+        ASSERT_NE(nullptr, mock);
+    }
+
+    void TearDown() override { offload_mock_destroy(mock); }
+
+    /* Lets a WAIT_WRITE in progress finish, whichever way the device waits */
+    void make_writable()
+    {
+        if (GetParam()) {
+            offload_mock_consume(mock);
+        } else {
+            ASSERT_TRUE(offload_mock_wait_blocked(mock, OFFLOAD_MSG_WAIT_WRITE, kTimeoutMs));
+            offload_mock_release(mock, OFFLOAD_MSG_WAIT_WRITE, 0);
+        }
+    }
+
+    struct offload_mock *mock;
+};
+
+TEST_P(OffloadWorkerTest, CompletesWaitWrite)
+{
+    offload_mock_post(mock, OFFLOAD_MSG_WAIT_WRITE);
+    make_writable();
+
+    ASSERT_TRUE(offload_mock_wait_completed(mock, OFFLOAD_MSG_WAIT_WRITE, 1, kTimeoutMs));
+    EXPECT_EQ(1, offload_mock_completed(mock, OFFLOAD_MSG_WAIT_WRITE, 0));
+}
+
+TEST_P(OffloadWorkerTest, WaitWriteRunsWhileDrainBlocks)
+{
+    offload_mock_post(mock, OFFLOAD_MSG_WAIT_PARTIAL_DRAIN);
+    ASSERT_TRUE(offload_mock_wait_blocked(mock, OFFLOAD_MSG_WAIT_PARTIAL_DRAIN, kTimeoutMs));
+
+    offload_mock_post(mock, OFFLOAD_MSG_WAIT_WRITE);
+    if (GetParam()) {
+        /* Armed on epoll by the worker, not queued behind the drain */
+        make_writable();
+        ASSERT_TRUE(offload_mock_wait_completed(mock, OFFLOAD_MSG_WAIT_WRITE, 1, kTimeoutMs));
+        EXPECT_EQ(0, offload_mock_completed(mock, OFFLOAD_MSG_WAIT_PARTIAL_DRAIN, 0));
+    }
+
+    offload_mock_release(mock, OFFLOAD_MSG_WAIT_PARTIAL_DRAIN, 0);
+    if (!GetParam())
+        make_writable();
+
+    ASSERT_TRUE(offload_mock_wait_completed(mock, OFFLOAD_MSG_WAIT_PARTIAL_DRAIN, 1, kTimeoutMs));
+    ASSERT_TRUE(offload_mock_wait_completed(mock, OFFLOAD_MSG_WAIT_WRITE, 1, kTimeoutMs));
+    EXPECT_EQ(1, offload_mock_completed(mock, OFFLOAD_MSG_WAIT_PARTIAL_DRAIN, 0));
+    EXPECT_EQ(1, offload_mock_completed(mock, OFFLOAD_MSG_WAIT_WRITE, 0));
+}
+
+TEST_P(OffloadWorkerTest, CancelInterruptsDrainAndCancelsQueuedWaits)
+{
+    offload_mock_post(mock, OFFLOAD_MSG_WAIT_PARTIAL_DRAIN);
+    ASSERT_TRUE(offload_mock_wait_blocked(mock, OFFLOAD_MSG_WAIT_PARTIAL_DRAIN, kTimeoutMs));
+    offload_mock_post(mock, OFFLOAD_MSG_WAIT_DRAIN);
+    offload_mock_post(mock, OFFLOAD_MSG_WAIT_WRITE);
+
+    /* What pause or flush does, without releasing the device */
+    offload_mock_cancel(mock);
+
+    ASSERT_TRUE(offload_mock_wait_completed(mock, OFFLOAD_MSG_WAIT_PARTIAL_DRAIN, 1, kTimeoutMs));
+    ASSERT_TRUE(offload_mock_wait_completed(mock, OFFLOAD_MSG_WAIT_DRAIN, 1, kTimeoutMs));
+    ASSERT_TRUE(offload_mock_wait_completed(mock, OFFLOAD_MSG_WAIT_WRITE, 1, kTimeoutMs));
+    EXPECT_EQ(1, offload_mock_completed(mock, OFFLOAD_MSG_WAIT_PARTIAL_DRAIN, -EINTR));
+    EXPECT_EQ(1, offload_mock_completed(mock, OFFLOAD_MSG_WAIT_DRAIN, -ECANCELED));
+    EXPECT_EQ(1, offload_mock_completed(mock, OFFLOAD_MSG_WAIT_WRITE, -ECANCELED));
+    EXPECT_EQ(0, offload_mock_calls(mock, OFFLOAD_MSG_WAIT_DRAIN));
+}
+
+TEST_P(OffloadWorkerTest, WorksAfterCancel)
+{
+    offload_mock_post(mock, OFFLOAD_MSG_WAIT_DRAIN);
+    ASSERT_TRUE(offload_mock_wait_blocked(mock, OFFLOAD_MSG_WAIT_DRAIN, kTimeoutMs));
+    offload_mock_cancel(mock);
+    ASSERT_TRUE(offload_mock_wait_completed(mock, OFFLOAD_MSG_WAIT_DRAIN, 1, kTimeoutMs));
+
+    offload_mock_post(mock, OFFLOAD_MSG_WAIT_DRAIN);
+    ASSERT_TRUE(offload_mock_wait_blocked(mock, OFFLOAD_MSG_WAIT_DRAIN, kTimeoutMs));
+    offload_mock_release(mock, OFFLOAD_MSG_WAIT_DRAIN, 0);
+
+    ASSERT_TRUE(offload_mock_wait_completed(mock, OFFLOAD_MSG_WAIT_DRAIN, 2, kTimeoutMs));
+    EXPECT_EQ(1, offload_mock_completed(mock, OFFLOAD_MSG_WAIT_DRAIN, 0));
+}
+
+TEST_P(OffloadWorkerTest, ExitCompletesPendingMessages)
+{
+    offload_mock_post(mock, OFFLOAD_MSG_WAIT_DRAIN);
+    ASSERT_TRUE(offload_mock_wait_blocked(mock, OFFLOAD_MSG_WAIT_DRAIN, kTimeoutMs));
+    offload_mock_post(mock, OFFLOAD_MSG_WAIT_PARTIAL_DRAIN);
+    offload_mock_post(mock, OFFLOAD_MSG_WAIT_WRITE);
+
+    /* Returns although the DSP never finishes the drain */
+    offload_mock_stop(mock);
+
+    EXPECT_EQ(1, offload_mock_completed(mock, OFFLOAD_MSG_WAIT_DRAIN, -EINTR));
+    EXPECT_EQ(1, offload_mock_completed(mock, OFFLOAD_MSG_WAIT_PARTIAL_DRAIN, -ECANCELED));
+    EXPECT_EQ(1, offload_mock_completed(mock, OFFLOAD_MSG_WAIT_WRITE, -ECANCELED));
+}
+
+INSTANTIATE_TEST_SUITE_P(Device, OffloadWorkerTest, ::testing::Values(false, true),
+                         [](const ::testing::TestParamInfo<bool> &info) {
+                             return info.param ? "Pollable" : "Blocking";
+                         });
+
+}  // namespace
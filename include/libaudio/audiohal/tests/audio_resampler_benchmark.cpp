@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <math.h>
+
+#include <string>
+#include <vector>
+
+#include <libaudio/audiohal/audio_resampler.h>
+
+/*
+ * Cost of audio_resampler_process() for one 20 ms period on the rate pairs
+ * of the USB and BT/voice proxies. Besides the time per period,
+ *   realtime  seconds of audio converted per second of CPU
+ *   taps      taps per phase, which the cost follows
+ */
+namespace {
+
+struct conversion {
+    uint32_t in_rate;
+    uint32_t out_rate;
+    uint32_t channels;
+};
+
+const conversion conversions[] = {
+    { 44100, 48000, 2 },
+    { 48000, 44100, 2 },
+    { 16000, 48000, 1 },
+    { 48000, 16000, 1 },
+    { 8000, 48000, 1 },
+    { 48000, 8000, 1 },
+    { 96000, 48000, 2 },
+    { 192000, 48000, 2 },
+    { 48000, 48000, 8 },
+};
+
+void BM_resample(benchmark::State &state, const conversion &c)
+{
+    const size_t frames = c.in_rate / 50;
+    audio_resampler rs;
+
+    if (!audio_resampler_init(&rs, c.in_rate, c.out_rate, c.channels)) {
+        state.SkipWithError("audio_resampler_init failed");
+        return;
+    }
+
+    std::vector<float> in(frames * c.channels);
+    std::vector<float> out(audio_resampler_max_output(&rs, frames) * c.channels);
+    for (size_t i = 0; i < in.size(); i++)
+        in[i] = static_cast<float>(0.5 * sin(2.0 * M_PI * 997.0 * (i / c.channels) / c.in_rate));
+
+    for (auto _ : state) {
+        size_t produced = audio_resampler_process(&rs, in.data(), frames, out.data());
+        benchmark::DoNotOptimize(produced);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * frames);
+    state.counters["realtime"] = benchmark::Counter(static_cast<double>(state.iterations()) * 0.02,
+                                                    benchmark::Counter::kIsRate);
+    state.counters["taps"] = rs.taps;
+    audio_resampler_release(&rs);
+}
+
+int register_benchmarks()
+{
+    for (const auto &c : conversions) {
+        std::string name = "BM_resample/" + std::to_string(c.in_rate) + "_to_" + std::to_string(c.out_rate) +
+                           "/" + std::to_string(c.channels) + "ch";
+        benchmark::RegisterBenchmark(name.c_str(), BM_resample, c);
+    }
+    return 0;
+}
+
+[[maybe_unused]] const int registered = register_benchmarks();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <libaudio/audiohal/audio_resampler.h>
+
+/*
+ * Quality of audio_resampler on the rate pairs the USB and BT/voice proxies
+ * use: a sine is converted and fitted by least squares at the output rate.
+ *   gain  fitted amplitude against the input one
+ *   SNR   fitted sine against everything else (THD+N)
+ *   THD   harmonics 2 to 5 left in the residual
+ * The first frames, while the filter fills, are not measured.
+ */
+namespace {
+
+constexpr double kAmplitude = 0.5;
+
+struct rates {
+    uint32_t in;
+    uint32_t out;
+};
+
+struct sine_fit {
+    double a;
+    double b;
+
+    double power() const { return (a * a + b * b) / 2.0; }
+};
+
+/* Least squares a * sin(w n) + b * cos(w n) over x[first:] */
+sine_fit fit_sine(const std::vector<double> &x, size_t first, double w)
+{
+    double ss = 0.0, sc = 0.0, cc = 0.0, xs = 0.0, xc = 0.0;
+
+    for (size_t n = first; n < x.size(); n++) {
+        double s = sin(w * n), c = cos(w * n);
+        ss += s * s;
+        sc += s * c;
+        cc += c * c;
+        xs += x[n] * s;
+        xc += x[n] * c;
+    }
+
+    double det = ss * cc - sc * sc;
+    return { (xs * cc - xc * sc) / det, (xc * ss - xs * sc) / det };
+}
+
+struct tone_result {
+    std::vector<double> left;           // Left channel output
+    size_t frames;
+    double gain_db;
+    double snr_db;
+    double thd_db;
+    double rms;
+};
+
+/*
+ * Resamples half a second of a stereo sine in blocks of block frames; the
+ * right channel carries the same tone inverted, to catch channel mixups.
+ */
+tone_result run_tone(const rates &r, double freq, size_t block)
+{
+    const size_t in_frames = r.in / 2;
+    audio_resampler rs;
+    std::vector<float> in(in_frames * 2);
+    tone_result res = {};
+    std::vector<double> &left = res.left;
+
+    if (!audio_resampler_init(&rs, r.in, r.out, 2))
+        return res;
+
+    for (size_t n = 0; n < in_frames; n++) {
+        in[2 * n] = static_cast<float>(kAmplitude * sin(2.0 * M_PI * freq * n / r.in));
+        in[2 * n + 1] = -in[2 * n];
+    }
+
+    for (size_t done = 0; done < in_frames; done += block) {
+        size_t n = std::min(block, in_frames - done);
+        std::vector<float> chunk(audio_resampler_max_output(&rs, n) * 2);
+        size_t produced = audio_resampler_process(&rs, &in[done * 2], n, chunk.data());
+
+        for (size_t f = 0; f < produced; f++) {
+            EXPECT_FLOAT_EQ(chunk[2 * f], -chunk[2 * f + 1]);
+            left.push_back(chunk[2 * f]);
+        }
+    }
+    res.frames = left.size();
+
+    /* Twice the filter length, in output frames */
+    const size_t first = static_cast<size_t>(rs.taps) * 2 * r.out / r.in + 16;
+    const double w = 2.0 * M_PI * freq / r.out;
+    audio_resampler_release(&rs);
+    if (left.size() <= first * 2)
+        return res;
+
+    sine_fit tone = fit_sine(left, first, w);
+    std::vector<double> residual(left);
+    double noise = 0.0, total = 0.0, harmonics = 0.0;
+
+    for (size_t n = first; n < left.size(); n++) {
+        residual[n] -= tone.a * sin(w * n) + tone.b * cos(w * n);
+        noise += residual[n] * residual[n];
+        total += left[n] * left[n];
+    }
+    noise /= left.size() - first;
+    for (int k = 2; k <= 5 && k * freq < r.out / 2.0; k++)
+        harmonics += fit_sine(residual, first, k * w).power();
+
+    res.gain_db = 10.0 * log10(tone.power() / (kAmplitude * kAmplitude / 2.0));
+    res.snr_db = 10.0 * log10(tone.power() / noise);
+    res.thd_db = harmonics > 0.0 ? 10.0 * log10(harmonics / tone.power()) : -200.0;
+    res.rms = sqrt(total / (left.size() - first));
+
+    return res;
+}
+
+class ResamplerQualityTest : public ::testing::TestWithParam<rates> {};
+
+TEST_P(ResamplerQualityTest, OutputLengthFollowsRatio)
+{
+    const rates r = GetParam();
+    tone_result res = run_tone(r, 1000.0, AUDIO_RESAMPLER_BLOCK);
+
+    EXPECT_NEAR(static_cast<double>(r.in / 2) * r.out / r.in, static_cast<double>(res.frames), 1.0);
+}
+
+TEST_P(ResamplerQualityTest, CleanAtOneKilohertz)
+{
+    tone_result res = run_tone(GetParam(), 1000.0, AUDIO_RESAMPLER_BLOCK);
+
+    EXPECT_NEAR(0.0, res.gain_db, 0.01);
+    EXPECT_GE(res.snr_db, 88.0);
+    EXPECT_LE(res.thd_db, -100.0);
+}
+
+TEST_P(ResamplerQualityTest, FlatUpToPassbandEdge)
+{
+    const rates r = GetParam();
+    tone_result res = run_tone(r, 0.4 * std::min(r.in, r.out), AUDIO_RESAMPLER_BLOCK);
+
+    EXPECT_NEAR(0.0, res.gain_db, 0.5);
+    EXPECT_GE(res.snr_db, 80.0);
+}
+
+TEST_P(ResamplerQualityTest, RejectsToneAboveOutputNyquist)
+{
+    const rates r = GetParam();
+    if (0.6 * r.out >= r.in / 2.0)
+        GTEST_SKIP() << "no input tone above the output Nyquist and the transition band";
+
+    /* Would fold back to 0.4 * out_rate without the filter */
+    tone_result res = run_tone(r, 0.6 * r.out, AUDIO_RESAMPLER_BLOCK);
+    EXPECT_LE(20.0 * log10(res.rms / (kAmplitude / sqrt(2.0))), -70.0);
+}
+
+TEST_P(ResamplerQualityTest, BlockSizeDoesNotChangeOutput)
+{
+    const rates r = GetParam();
+    tone_result whole = run_tone(r, 1000.0, r.in);
+    tone_result odd = run_tone(r, 1000.0, 37);
+
+    EXPECT_EQ(whole.left, odd.left);
+}
+
+INSTANTIATE_TEST_SUITE_P(Rates, ResamplerQualityTest,
+                         ::testing::Values(rates{ 44100, 48000 }, rates{ 48000, 44100 }, rates{ 8000, 48000 },
+                                           rates{ 16000, 48000 }, rates{ 48000, 16000 }, rates{ 48000, 8000 },
+                                           rates{ 48000, 96000 }, rates{ 96000, 48000 },
+                                           rates{ 192000, 48000 }, rates{ 48000, 48000 }),
+                         [](const ::testing::TestParamInfo<rates> &info) {
+                             return std::to_string(info.param.in) + "_to_" + std::to_string(info.param.out);
+                         });
+
+}  // namespace
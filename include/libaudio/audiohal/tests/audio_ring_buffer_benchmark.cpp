@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "audio_ring_buffer_pingpong.h"
+
+/*
+ * Hand-off latency of audio_ring_buffer between a stream thread and the
+ * proxy PCM thread: a block goes to an echo thread and back through a second
+ * ring, so half the round trip is the one way latency. Every round trip is
+ * timed, and p50_ns, p99_ns and max_ns give its distribution, since a
+ * preempted echo thread shows up in the tail and not in the mean. The copy
+ * benchmark is
+ * the same block written and read on one thread, i.e. the cost without the
+ * cross core hand-off.
+ */
+namespace {
+
+constexpr size_t kRingSize = 16384;
+
+const struct {
+    const char *name;
+    size_t bytes;
+} blocks[] = {
+    { "1frame_16bit_stereo", 4 },
+    { "240frames_16bit_stereo", 960 },
+    { "480frames_24bit_packed_stereo", 2880 },
+    { "960frames_32bit_stereo", 7680 },
+};
+
+void BM_ring_buffer_roundtrip(benchmark::State &state, size_t bytes)
+{
+    struct ring_pingpong *pp = ring_pingpong_create(kRingSize);
+    if (pp == nullptr) {
+        state.SkipWithError("ring_pingpong_create failed");
+        return;
+    }
+
+    std::vector<int64_t> latency_ns;
+    latency_ns.reserve(state.max_iterations);
+
+    for (auto _ : state) {
+        auto start = std::chrono::steady_clock::now();
+        if (!ring_pingpong_roundtrip(pp, bytes)) {
+            state.SkipWithError("round trip failed");
+            break;
+        }
+        latency_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now() - start).count());
+    }
+
+    ring_pingpong_destroy(pp);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * bytes * 2);
+
+    if (latency_ns.empty())
+        return;
+    std::sort(latency_ns.begin(), latency_ns.end());
+    state.counters["p50_ns"] = static_cast<double>(latency_ns[latency_ns.size() / 2]);
+    state.counters["p99_ns"] = static_cast<double>(latency_ns[latency_ns.size() * 99 / 100]);
+    state.counters["max_ns"] = static_cast<double>(latency_ns.back());
+}
+
+void BM_ring_buffer_copy(benchmark::State &state, size_t bytes)
+{
+    struct ring_pingpong *pp = ring_pingpong_create(kRingSize);
+    if (pp == nullptr) {
+        state.SkipWithError("ring_pingpong_create failed");
+        return;
+    }
+
+    for (auto _ : state) {
+        if (!ring_pingpong_copy(pp, bytes)) {
+            state.SkipWithError("copy failed");
+            break;
+        }
+    }
+
+    ring_pingpong_destroy(pp);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * bytes * 2);
+}
+
+int register_benchmarks()
+{
+    for (const auto &block : blocks) {
+        benchmark::RegisterBenchmark((std::string("BM_ring_buffer_roundtrip/") + block.name).c_str(),
+                                     BM_ring_buffer_roundtrip, block.bytes)
+            ->UseRealTime();
+        benchmark::RegisterBenchmark((std::string("BM_ring_buffer_copy/") + block.name).c_str(),
+                                     BM_ring_buffer_copy, block.bytes);
+    }
+    return 0;
+}
+
+[[maybe_unused]] const int registered = register_benchmarks();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libaudio/audiohal/audio_ring_buffer.h>
+
+#include "audio_ring_buffer_pingpong.h"
+
+#define PINGPONG_MAX_BYTES  16384
+
+struct ring_pingpong {
+    struct audio_ring_buffer to_echo;
+    struct audio_ring_buffer from_echo;
+    struct audio_ring_buffer local;     // Written and read by the calling thread only
+    void *to_echo_storage;
+    void *from_echo_storage;
+    void *local_storage;
+    atomic_bool stop;
+    pthread_t echo_thread;
+    uint8_t send[PINGPONG_MAX_BYTES];
+    uint8_t receive[PINGPONG_MAX_BYTES];
+};
+
+static void *ring_pingpong_echo(void *arg)
+{
+    struct ring_pingpong *pp = (struct ring_pingpong *)arg;
+    uint8_t block[PINGPONG_MAX_BYTES];
+
+    while (!atomic_load_explicit(&pp->stop, memory_order_relaxed)) {
+        size_t n = audio_ring_buffer_readable(&pp->to_echo);
+
+        if (n == 0)
+            continue;
+        if (n > sizeof(block))
+            n = sizeof(block);
+        audio_ring_buffer_read(&pp->to_echo, block, n);
+        audio_ring_buffer_write(&pp->from_echo, block, n);
+    }
+
+    return NULL;
+}
+
+struct ring_pingpong *ring_pingpong_create(size_t ring_size)
+{
+    struct ring_pingpong *pp;
+
+    /* The ring indexes are cache line aligned, which calloc does not guarantee */
+    if (posix_memalign((void **)&pp, AUDIO_RING_BUFFER_CACHE_LINE, sizeof(*pp)) != 0)
+        return NULL;
+    memset(pp, 0, sizeof(*pp));
+
+    pp->to_echo_storage = calloc(1, ring_size);
+    pp->from_echo_storage = calloc(1, ring_size);
+    pp->local_storage = calloc(1, ring_size);
+    if (pp->to_echo_storage == NULL || pp->from_echo_storage == NULL || pp->local_storage == NULL ||
+        !audio_ring_buffer_init(&pp->to_echo, pp->to_echo_storage, ring_size) ||
+        !audio_ring_buffer_init(&pp->from_echo, pp->from_echo_storage, ring_size) ||
+        !audio_ring_buffer_init(&pp->local, pp->local_storage, ring_size)) {
+        free(pp->to_echo_storage);
+        free(pp->from_echo_storage);
+        free(pp->local_storage);
+        free(pp);
+        return NULL;
+    }
+
+    atomic_init(&pp->stop, false);
+    if (pthread_create(&pp->echo_thread, NULL, ring_pingpong_echo, pp) != 0) {
+        free(pp->to_echo_storage);
+        free(pp->from_echo_storage);
+        free(pp->local_storage);
+        free(pp);
+        return NULL;
+    }
+
+    return pp;
+}
+
+void ring_pingpong_destroy(struct ring_pingpong *pp)
+{
+    if (pp == NULL)
+        return;
+
+    atomic_store_explicit(&pp->stop, true, memory_order_relaxed);
+    pthread_join(pp->echo_thread, NULL);
+    free(pp->to_echo_storage);
+    free(pp->from_echo_storage);
+    free(pp->local_storage);
+    free(pp);
+}
+
+bool ring_pingpong_roundtrip(struct ring_pingpong *pp, size_t bytes)
+{
+    size_t received = 0;
+
+    if (bytes > PINGPONG_MAX_BYTES || audio_ring_buffer_write(&pp->to_echo, pp->send, bytes) != bytes)
+        return false;
+
+    while (received < bytes) {
+        size_t n = audio_ring_buffer_readable(&pp->from_echo);
+
+        if (n == 0)
+            continue;
+        if (n > bytes - received)
+            n = bytes - received;
+        audio_ring_buffer_read(&pp->from_echo, pp->receive + received, n);
+        received += n;
+    }
+
+    return true;
+}
+
+bool ring_pingpong_copy(struct ring_pingpong *pp, size_t bytes)
+{
+    if (bytes > PINGPONG_MAX_BYTES)
+        return false;
+
+    /* Not from_echo: the echo thread is its only producer */
+    if (audio_ring_buffer_write(&pp->local, pp->send, bytes) != bytes)
+        return false;
+
+    return audio_ring_buffer_read(&pp->local, pp->receive, bytes) == bytes;
+}
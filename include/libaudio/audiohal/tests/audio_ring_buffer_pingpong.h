@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXYNOS_AUDIOHAL_RING_BUFFER_PINGPONG_H__
+#define __EXYNOS_AUDIOHAL_RING_BUFFER_PINGPONG_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Two audio_ring_buffers and an echo thread: what is written to the first
+ * ring is read by the echo thread and written back through the second one.
+ * Kept in C because audio_ring_buffer.h uses C11 <stdatomic.h>.
+ */
+struct ring_pingpong;
+
+struct ring_pingpong *ring_pingpong_create(size_t ring_size);
+void ring_pingpong_destroy(struct ring_pingpong *pp);
+
+/* Sends bytes to the echo thread and spins until they come back */
+bool ring_pingpong_roundtrip(struct ring_pingpong *pp, size_t bytes);
+
+/* Writes then reads bytes on a third ring used by the calling thread only */
+bool ring_pingpong_copy(struct ring_pingpong *pp, size_t bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __EXYNOS_AUDIOHAL_RING_BUFFER_PINGPONG_H__
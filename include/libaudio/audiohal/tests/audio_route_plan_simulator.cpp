@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include <libaudio/audiohal/audio_route_plan.h>
+
+/*
+ * Route transition simulator: a fake codec with a few hundred controls and
+ * mixer paths shaped like mixer_paths.xml (a front end per usage and a back
+ * end per device, sharing DSP and amplifier controls). Each benchmark flips
+ * between two route states and reports the time per transition with
+ *   writes        controls written per route change by the plan
+ *   naive_writes  controls written by resetting the old path and applying
+ *                 the new one, as audio_route does
+ *   max_ns        slowest transition seen by audio_route_plan_stats
+ * The final control values are checked against the paths before timing.
+ */
+namespace {
+
+constexpr uint32_t kNumCtls = 512;
+
+struct fake_codec {
+    std::vector<int> value;
+    uint64_t writes = 0;
+};
+
+struct fake_ctl {
+    fake_codec *codec;
+    uint32_t id;
+};
+
+int fake_write(void *cookie, void *ctl, int value)
+{
+    fake_codec *codec = static_cast<fake_codec *>(cookie);
+    codec->value[static_cast<fake_ctl *>(ctl)->id] = value;
+    codec->writes++;
+    return 0;
+}
+
+struct route_state {
+    int ausage;
+    int device;
+    int modifier;
+};
+
+class simulator {
+  public:
+    simulator() : ctls(kNumCtls)
+    {
+        codec.value.assign(kNumCtls, 0);
+        ok = audio_route_plan_init(&plan, kNumCtls, fake_write, &codec);
+        if (!ok)
+            return;
+
+        for (uint32_t id = 0; id < kNumCtls; id++) {
+            ctls[id] = { &codec, id };
+            audio_route_plan_set_control(&plan, id, &ctls[id], 0);
+        }
+        audio_route_plan_reset(&plan);
+
+        const int usages[] = { AUSAGE_MEDIA, AUSAGE_VOICE_CALL_WB };
+        const int devices[] = { DEVICE_SPEAKER, DEVICE_EARPIECE, DEVICE_HEADSET, DEVICE_BT_HEADSET,
+                                DEVICE_USB_HEADSET };
+        for (int ausage : usages)
+            for (int device : devices)
+                audio_route_plan_map(&plan, ausage, device, add_path(ausage + 1, device + 1));
+        audio_route_plan_map_modifier(&plan, MODIFIER_BT_SCO_RX_WB, add_path(0, MODIFIER_BT_SCO_RX_WB + 100));
+    }
+
+    ~simulator() { audio_route_plan_deinit(&plan); }
+
+    void apply(const route_state &s)
+    {
+        audio_route_plan_update(&plan, s.ausage, s.device);
+        if (s.modifier != MODIFIER_NONE)
+            audio_route_plan_set(&plan, AUSAGE_NONE, DEVICE_NONE, s.modifier, true);
+    }
+
+    /* What audio_route writes for the same transition: reset all of from, apply all of to */
+    uint32_t naive_writes(const route_state &from, const route_state &to) const
+    {
+        return path_size(from) + path_size(to);
+    }
+
+    /* The codec holds the defaults plus the values of the active paths, later paths winning */
+    bool check() const
+    {
+        std::vector<int> expected(kNumCtls, 0);
+        for (int i = 0; i < plan.num_active; i++) {
+            const audio_route_plan_path &path = plan.paths[plan.active[i]];
+            for (uint32_t e = 0; e < path.count; e++)
+                expected[plan.entries[path.first + e].ctl] = plan.entries[path.first + e].value;
+        }
+        return expected == codec.value;
+    }
+
+    bool ok;
+    fake_codec codec;
+    audio_route_plan plan;
+
+  private:
+    /*
+     * Path made of the front end of a usage (controls in [0, 128), the same for
+     * every device) and the back end of a device (controls in [128, kNumCtls)),
+     * so switching device keeps the front end and a call setup changes both.
+     */
+    int add_path(uint32_t front_seed, uint32_t back_seed)
+    {
+        int id = audio_route_plan_begin_path(&plan);
+
+        add_entries(front_seed, 40, 0, 128);
+        add_entries(back_seed, 24, 128, kNumCtls);
+        audio_route_plan_end_path(&plan);
+
+        return id;
+    }
+
+    void add_entries(uint32_t seed, uint32_t count, uint32_t first, uint32_t last)
+    {
+        uint32_t x = seed * 2654435761u;
+        auto next = [&x]() { x = x * 1664525u + 1013904223u; return x >> 8; };
+
+        if (seed == 0)
+            return;
+        for (uint32_t i = 0; i < count; i++)
+            audio_route_plan_add(&plan, first + next() % (last - first), 1 + next() % 8);
+    }
+
+    uint32_t path_size(const route_state &s) const
+    {
+        uint32_t n = plan.paths[plan.usage_device_path[s.ausage][s.device]].count;
+        if (s.modifier != MODIFIER_NONE)
+            n += plan.paths[plan.modifier_path[s.modifier]].count;
+        return n;
+    }
+
+    std::vector<fake_ctl> ctls;
+};
+
+const struct {
+    const char *name;
+    route_state from;
+    route_state to;
+} transitions[] = {
+    { "media_speaker_to_headset", { AUSAGE_MEDIA, DEVICE_SPEAKER, MODIFIER_NONE },
+      { AUSAGE_MEDIA, DEVICE_HEADSET, MODIFIER_NONE } },
+    { "media_speaker_to_usb", { AUSAGE_MEDIA, DEVICE_SPEAKER, MODIFIER_NONE },
+      { AUSAGE_MEDIA, DEVICE_USB_HEADSET, MODIFIER_NONE } },
+    { "media_speaker_to_bt", { AUSAGE_MEDIA, DEVICE_SPEAKER, MODIFIER_NONE },
+      { AUSAGE_MEDIA, DEVICE_BT_HEADSET, MODIFIER_NONE } },
+    { "call_setup_handset", { AUSAGE_MEDIA, DEVICE_SPEAKER, MODIFIER_NONE },
+      { AUSAGE_VOICE_CALL_WB, DEVICE_EARPIECE, MODIFIER_NONE } },
+    { "call_handset_to_bt", { AUSAGE_VOICE_CALL_WB, DEVICE_EARPIECE, MODIFIER_NONE },
+      { AUSAGE_VOICE_CALL_WB, DEVICE_BT_HEADSET, MODIFIER_BT_SCO_RX_WB } },
+    { "same_route", { AUSAGE_MEDIA, DEVICE_SPEAKER, MODIFIER_NONE },
+      { AUSAGE_MEDIA, DEVICE_SPEAKER, MODIFIER_NONE } },
+};
+
+void BM_route_transition(benchmark::State &state, const route_state &from, const route_state &to)
+{
+    simulator sim;
+    if (!sim.ok) {
+        state.SkipWithError("audio_route_plan_init failed");
+        return;
+    }
+
+    sim.apply(from);
+    if (!sim.check()) {
+        state.SkipWithError("codec does not match the first route");
+        return;
+    }
+    sim.apply(to);
+    if (!sim.check()) {
+        state.SkipWithError("codec does not match the second route");
+        return;
+    }
+
+    const uint64_t writes_before = sim.codec.writes;
+    sim.plan.stats.max_ns = 0;
+    bool forward = false;
+    for (auto _ : state) {
+        sim.apply(forward ? to : from);
+        forward = !forward;
+    }
+
+    state.counters["writes"] = benchmark::Counter(static_cast<double>(sim.codec.writes - writes_before),
+                                                  benchmark::Counter::kAvgIterations);
+    state.counters["naive_writes"] = sim.naive_writes(from, to);
+    state.counters["max_ns"] = static_cast<double>(sim.plan.stats.max_ns);
+}
+
+int register_benchmarks()
+{
+    for (const auto &t : transitions)
+        benchmark::RegisterBenchmark((std::string("BM_route_transition/") + t.name).c_str(),
+                                     BM_route_transition, t.from, t.to);
+    return 0;
+}
+
+[[maybe_unused]] const int registered = register_benchmarks();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,522 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ExynosExifWriter"
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <log/log.h>
+
+#include "ExynosExifWriter.h"
+
+/* APP1 marker (2) + segment length (2) + "Exif\0\0" (6) */
+#define APP1_HEADER_SIZE    10
+/* "II" + 0x002A + offset of the 0th IFD */
+#define TIFF_HEADER_SIZE    8
+
+#define MAX_IFD_ENTRIES     40
+
+namespace {
+
+enum {
+    SRC_CONST,          /* value lives in the template only */
+    SRC_U8,
+    SRC_U16,
+    SRC_U32,
+    SRC_RATIONAL,
+    SRC_SRATIONAL,
+    SRC_ASCII,
+    SRC_RAW,
+    SRC_MAKER_NOTE,
+    SRC_USER_COMMENT,
+    SRC_THUMB_LEN,
+};
+
+struct ascii_field {
+    uint16_t offset;
+    uint16_t capacity;
+};
+
+#define ASCII_FIELD(name) { offsetof(exif_attribute_t, name), sizeof(((exif_attribute_t *)0)->name) }
+
+/* Order matches LayoutKey::ascii_len */
+const ascii_field kAsciiFields[] = {
+    ASCII_FIELD(maker),
+    ASCII_FIELD(model),
+    ASCII_FIELD(software),
+    ASCII_FIELD(date_time),
+    ASCII_FIELD(sec_time),
+    ASCII_FIELD(unique_id),
+    ASCII_FIELD(gps_latitude_ref),
+    ASCII_FIELD(gps_longitude_ref),
+    ASCII_FIELD(gps_datestamp),
+    ASCII_FIELD(gps_processing_method),
+};
+
+enum {
+    ASCII_MAKER,
+    ASCII_MODEL,
+    ASCII_SOFTWARE,
+    ASCII_DATE_TIME,
+    ASCII_SEC_TIME,
+    ASCII_UNIQUE_ID,
+    ASCII_GPS_LATITUDE_REF,
+    ASCII_GPS_LONGITUDE_REF,
+    ASCII_GPS_DATESTAMP,
+    ASCII_GPS_PROCESSING_METHOD,
+};
+
+const uint8_t kComponentsConfiguration[4] = { 1, 2, 3, 0 };
+const uint8_t kFlashpixVersion[4] = { '0', '1', '0', '0' };
+const uint8_t kInteropIndex[4] = { 'R', '9', '8', '\0' };
+const uint8_t kInteropVersion[4] = { '0', '1', '0', '0' };
+
+inline void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+inline void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+inline size_t typeSize(uint16_t type)
+{
+    switch (type) {
+    case EXIF_TYPE_SHORT:
+        return 2;
+    case EXIF_TYPE_LONG:
+    case EXIF_TYPE_SLONG:
+        return 4;
+    case EXIF_TYPE_RATIONAL:
+    case EXIF_TYPE_SRATIONAL:
+        return 8;
+    default:
+        return 1;
+    }
+}
+
+struct ifd_entry {
+    uint16_t tag;
+    uint16_t type;
+    uint32_t count;
+    uint8_t kind;
+    uint16_t src;
+    uint32_t value;         /* SRC_CONST scalar, e.g. an IFD offset */
+    const uint8_t *data;    /* SRC_CONST bytes */
+};
+
+class IfdBuilder {
+public:
+    IfdBuilder() : mCount(0), mOverflow(false) {}
+
+    /*
+     * Returns the index of the entry, or -1 once MAX_IFD_ENTRIES is reached;
+     * check overflowed() before using any returned index.
+     */
+    int add(uint16_t tag, uint16_t type, uint32_t count, uint8_t kind, uint16_t src = 0,
+            uint32_t value = 0, const uint8_t *data = NULL)
+    {
+        if (mCount >= MAX_IFD_ENTRIES) {
+            mOverflow = true;
+            return -1;
+        }
+
+        ifd_entry &e = mEntries[mCount];
+        e.tag = tag;
+        e.type = type;
+        e.count = count;
+        e.kind = kind;
+        e.src = src;
+        e.value = value;
+        e.data = data;
+
+        return mCount++;
+    }
+
+    ifd_entry &at(int i) { return mEntries[i]; }
+    size_t count() const { return mCount; }
+    bool overflowed() const { return mOverflow; }
+
+    /* IFD body plus the value area that follows it */
+    size_t size() const
+    {
+        size_t size = NUM_SIZE + IFD_SIZE * mCount + OFFSET_SIZE;
+
+        for (size_t i = 0; i < mCount; i++) {
+            size_t bytes = typeSize(mEntries[i].type) * mEntries[i].count;
+            if (bytes > 4)
+                size += (bytes + 1) & ~1;
+        }
+
+        return size;
+    }
+
+    /*
+     * Writes the IFD at pos of the template and records where each value
+     * has to be patched. Offsets inside the TIFF structure are relative to
+     * the TIFF header.
+     */
+    bool emit(uint8_t *tmpl, size_t pos, uint32_t next,
+              ExynosExifWriter::Patch *patches, size_t *num_patches) const
+    {
+        uint8_t *ifd = tmpl + pos;
+        size_t value_pos = pos + NUM_SIZE + IFD_SIZE * mCount + OFFSET_SIZE;
+
+        put16(ifd, mCount);
+        ifd += NUM_SIZE;
+
+        for (size_t i = 0; i < mCount; i++, ifd += IFD_SIZE) {
+            const ifd_entry &e = mEntries[i];
+            size_t bytes = typeSize(e.type) * e.count;
+            size_t data_pos = pos + NUM_SIZE + IFD_SIZE * i + 8;
+
+            put16(ifd, e.tag);
+            put16(ifd + 2, e.type);
+            put32(ifd + 4, e.count);
+            put32(ifd + 8, 0);
+
+            if (bytes > 4) {
+                put32(ifd + 8, value_pos - APP1_HEADER_SIZE);
+                data_pos = value_pos;
+                value_pos += (bytes + 1) & ~1;
+            }
+
+            if (e.kind == SRC_CONST) {
+                if (e.data)
+                    memcpy(tmpl + data_pos, e.data, bytes);
+                else
+                    put32(tmpl + data_pos, e.value);
+                continue;
+            }
+
+            if (*num_patches >= ExynosExifWriter::MAX_PATCHES)
+                return false;
+
+            ExynosExifWriter::Patch &p = patches[(*num_patches)++];
+            p.pos = data_pos;
+            p.src = e.src;
+            p.count = e.count;
+            p.kind = e.kind;
+        }
+
+        put32(ifd, next);
+
+        return true;
+    }
+
+private:
+    ifd_entry mEntries[MAX_IFD_ENTRIES];
+    size_t mCount;
+    bool mOverflow;
+};
+
+#define SRC(name) offsetof(exif_attribute_t, name)
+
+} // namespace
+
+ExynosExifWriter::ExynosExifWriter()
+    : mValid(false), mFixedSize(0), mThumbOffset(0), mNumPatches(0)
+{
+    memset(&mKey, 0, sizeof(mKey));
+}
+
+void ExynosExifWriter::makeKey(const exif_attribute_t *exif, LayoutKey *key)
+{
+    const char *base = reinterpret_cast<const char *>(exif);
+
+    memset(key, 0, sizeof(*key));
+    key->enableGps = exif->enableGps;
+    key->enableThumb = exif->enableThumb;
+    key->maker_note_size = exif->maker_note ? exif->maker_note_size : 0;
+    key->user_comment_size = exif->user_comment ? exif->user_comment_size : 0;
+
+    for (int i = 0; i < NUM_ASCII_FIELDS; i++)
+        key->ascii_len[i] = strnlen(base + kAsciiFields[i].offset, kAsciiFields[i].capacity - 1);
+}
+
+bool ExynosExifWriter::prepare(const exif_attribute_t *exif)
+{
+    LayoutKey key;
+
+    makeKey(exif, &key);
+    if (mValid && memcmp(&key, &mKey, sizeof(key)) == 0)
+        return true;
+
+    mKey = key;
+    mValid = build();
+
+    return mValid;
+}
+
+bool ExynosExifWriter::build()
+{
+    IfdBuilder ifd0, ifd_exif, ifd_interop, ifd_gps, ifd1;
+    int exif_ptr, gps_ptr = -1, interop_ptr, thumb_ptr = -1;
+    const uint8_t *len = mKey.ascii_len;
+
+#define ASCII(idx) (len[idx] + 1)
+
+    ifd0.add(EXIF_TAG_IMAGE_WIDTH, EXIF_TYPE_LONG, 1, SRC_U32, SRC(width));
+    ifd0.add(EXIF_TAG_IMAGE_HEIGHT, EXIF_TYPE_LONG, 1, SRC_U32, SRC(height));
+    ifd0.add(EXIF_TAG_MAKE, EXIF_TYPE_ASCII, ASCII(ASCII_MAKER), SRC_ASCII, SRC(maker));
+    ifd0.add(EXIF_TAG_MODEL, EXIF_TYPE_ASCII, ASCII(ASCII_MODEL), SRC_ASCII, SRC(model));
+    ifd0.add(EXIF_TAG_ORIENTATION, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(orientation));
+    ifd0.add(EXIF_TAG_SOFTWARE, EXIF_TYPE_ASCII, ASCII(ASCII_SOFTWARE), SRC_ASCII, SRC(software));
+    ifd0.add(EXIF_TAG_DATE_TIME, EXIF_TYPE_ASCII, ASCII(ASCII_DATE_TIME), SRC_ASCII, SRC(date_time));
+    ifd0.add(EXIF_TAG_YCBCR_POSITIONING, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(ycbcr_positioning));
+    exif_ptr = ifd0.add(EXIF_TAG_EXIF_IFD_POINTER, EXIF_TYPE_LONG, 1, SRC_CONST);
+    if (mKey.enableGps)
+        gps_ptr = ifd0.add(EXIF_TAG_GPS_IFD_POINTER, EXIF_TYPE_LONG, 1, SRC_CONST);
+
+    ifd_exif.add(EXIF_TAG_EXPOSURE_TIME, EXIF_TYPE_RATIONAL, 1, SRC_RATIONAL, SRC(exposure_time));
+    ifd_exif.add(EXIF_TAG_FNUMBER, EXIF_TYPE_RATIONAL, 1, SRC_RATIONAL, SRC(fnumber));
+    ifd_exif.add(EXIF_TAG_EXPOSURE_PROGRAM, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(exposure_program));
+    ifd_exif.add(EXIF_TAG_ISO_SPEED_RATING, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(iso_speed_rating));
+    ifd_exif.add(EXIF_TAG_EXIF_VERSION, EXIF_TYPE_UNDEFINED, 4, SRC_RAW, SRC(exif_version));
+    ifd_exif.add(EXIF_TAG_DATE_TIME_ORG, EXIF_TYPE_ASCII, ASCII(ASCII_DATE_TIME), SRC_ASCII, SRC(date_time));
+    ifd_exif.add(EXIF_TAG_DATE_TIME_DIGITIZE, EXIF_TYPE_ASCII, ASCII(ASCII_DATE_TIME), SRC_ASCII, SRC(date_time));
+    ifd_exif.add(EXIF_TAG_COMPONENTS_CONFIGURATION, EXIF_TYPE_UNDEFINED, 4, SRC_CONST, 0, 0,
+                 kComponentsConfiguration);
+    ifd_exif.add(EXIF_TAG_SHUTTER_SPEED, EXIF_TYPE_SRATIONAL, 1, SRC_SRATIONAL, SRC(shutter_speed));
+    ifd_exif.add(EXIF_TAG_APERTURE, EXIF_TYPE_RATIONAL, 1, SRC_RATIONAL, SRC(aperture));
+    ifd_exif.add(EXIF_TAG_BRIGHTNESS, EXIF_TYPE_SRATIONAL, 1, SRC_SRATIONAL, SRC(brightness));
+    ifd_exif.add(EXIF_TAG_EXPOSURE_BIAS, EXIF_TYPE_SRATIONAL, 1, SRC_SRATIONAL, SRC(exposure_bias));
+    ifd_exif.add(EXIF_TAG_MAX_APERTURE, EXIF_TYPE_RATIONAL, 1, SRC_RATIONAL, SRC(max_aperture));
+    ifd_exif.add(EXIF_TAG_METERING_MODE, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(metering_mode));
+    ifd_exif.add(EXIF_TAG_FLASH, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(flash));
+    ifd_exif.add(EXIF_TAG_FOCAL_LENGTH, EXIF_TYPE_RATIONAL, 1, SRC_RATIONAL, SRC(focal_length));
+    if (mKey.maker_note_size)
+        ifd_exif.add(EXIF_TAG_MAKER_NOTE, EXIF_TYPE_UNDEFINED, mKey.maker_note_size, SRC_MAKER_NOTE);
+    if (mKey.user_comment_size)
+        ifd_exif.add(EXIF_TAG_USER_COMMENT, EXIF_TYPE_UNDEFINED, mKey.user_comment_size, SRC_USER_COMMENT);
+    ifd_exif.add(EXIF_TAG_SUBSEC_TIME, EXIF_TYPE_ASCII, ASCII(ASCII_SEC_TIME), SRC_ASCII, SRC(sec_time));
+    ifd_exif.add(EXIF_TAG_SUBSEC_TIME_ORIG, EXIF_TYPE_ASCII, ASCII(ASCII_SEC_TIME), SRC_ASCII, SRC(sec_time));
+    ifd_exif.add(EXIF_TAG_SUBSEC_TIME_DIG, EXIF_TYPE_ASCII, ASCII(ASCII_SEC_TIME), SRC_ASCII, SRC(sec_time));
+    ifd_exif.add(EXIF_TAG_FLASHPIX_VERSION, EXIF_TYPE_UNDEFINED, 4, SRC_CONST, 0, 0, kFlashpixVersion);
+    ifd_exif.add(EXIF_TAG_COLOR_SPACE, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(color_space));
+    ifd_exif.add(EXIF_TAG_PIXEL_X_DIMENSION, EXIF_TYPE_LONG, 1, SRC_U32, SRC(width));
+    ifd_exif.add(EXIF_TAG_PIXEL_Y_DIMENSION, EXIF_TYPE_LONG, 1, SRC_U32, SRC(height));
+    interop_ptr = ifd_exif.add(EXIF_TAG_INTEROPERABILITY, EXIF_TYPE_LONG, 1, SRC_CONST);
+    ifd_exif.add(EXIF_TAG_CUSTOM_RENDERED, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(custom_rendered));
+    ifd_exif.add(EXIF_TAG_EXPOSURE_MODE, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(exposure_mode));
+    ifd_exif.add(EXIF_TAG_WHITE_BALANCE, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(white_balance));
+    ifd_exif.add(EXIF_TAG_DIGITAL_ZOOM_RATIO, EXIF_TYPE_RATIONAL, 1, SRC_RATIONAL, SRC(digital_zoom_ratio));
+    ifd_exif.add(EXIF_TAG_FOCA_LENGTH_IN_35MM_FILM, EXIF_TYPE_SHORT, 1, SRC_U16,
+                 SRC(focal_length_in_35mm_length));
+    ifd_exif.add(EXIF_TAG_SCENCE_CAPTURE_TYPE, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(scene_capture_type));
+    ifd_exif.add(EXIF_TAG_CONTRAST, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(contrast));
+    ifd_exif.add(EXIF_TAG_SATURATION, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(saturation));
+    ifd_exif.add(EXIF_TAG_SHARPNESS, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(sharpness));
+    if (len[ASCII_UNIQUE_ID])
+        ifd_exif.add(EXIF_TAG_IMAGE_UNIQUE_ID, EXIF_TYPE_ASCII, ASCII(ASCII_UNIQUE_ID), SRC_ASCII, SRC(unique_id));
+
+    ifd_interop.add(EXIF_TAG_INTEROPERABILITY_INDEX, EXIF_TYPE_ASCII, 4, SRC_CONST, 0, 0, kInteropIndex);
+    ifd_interop.add(EXIF_TAG_INTEROPERABILITY_VERSION, EXIF_TYPE_UNDEFINED, 4, SRC_CONST, 0, 0, kInteropVersion);
+
+    if (mKey.enableGps) {
+        ifd_gps.add(EXIF_TAG_GPS_VERSION_ID, EXIF_TYPE_BYTE, 4, SRC_RAW, SRC(gps_version_id));
+        ifd_gps.add(EXIF_TAG_GPS_LATITUDE_REF, EXIF_TYPE_ASCII, ASCII(ASCII_GPS_LATITUDE_REF), SRC_ASCII,
+                    SRC(gps_latitude_ref));
+        ifd_gps.add(EXIF_TAG_GPS_LATITUDE, EXIF_TYPE_RATIONAL, 3, SRC_RATIONAL, SRC(gps_latitude));
+        ifd_gps.add(EXIF_TAG_GPS_LONGITUDE_REF, EXIF_TYPE_ASCII, ASCII(ASCII_GPS_LONGITUDE_REF), SRC_ASCII,
+                    SRC(gps_longitude_ref));
+        ifd_gps.add(EXIF_TAG_GPS_LONGITUDE, EXIF_TYPE_RATIONAL, 3, SRC_RATIONAL, SRC(gps_longitude));
+        ifd_gps.add(EXIF_TAG_GPS_ALTITUDE_REF, EXIF_TYPE_BYTE, 1, SRC_U8, SRC(gps_altitude_ref));
+        ifd_gps.add(EXIF_TAG_GPS_ALTITUDE, EXIF_TYPE_RATIONAL, 1, SRC_RATIONAL, SRC(gps_altitude));
+        ifd_gps.add(EXIF_TAG_GPS_TIMESTAMP, EXIF_TYPE_RATIONAL, 3, SRC_RATIONAL, SRC(gps_timestamp));
+        ifd_gps.add(EXIF_TAG_GPS_PROCESSING_METHOD, EXIF_TYPE_ASCII, ASCII(ASCII_GPS_PROCESSING_METHOD),
+                    SRC_ASCII, SRC(gps_processing_method));
+        ifd_gps.add(EXIF_TAG_GPS_DATESTAMP, EXIF_TYPE_ASCII, ASCII(ASCII_GPS_DATESTAMP), SRC_ASCII,
+                    SRC(gps_datestamp));
+    }
+
+    if (mKey.enableThumb) {
+        ifd1.add(EXIF_TAG_IMAGE_WIDTH, EXIF_TYPE_LONG, 1, SRC_U32, SRC(widthThumb));
+        ifd1.add(EXIF_TAG_IMAGE_HEIGHT, EXIF_TYPE_LONG, 1, SRC_U32, SRC(heightThumb));
+        ifd1.add(EXIF_TAG_COMPRESSION_SCHEME, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(compression_scheme));
+        ifd1.add(EXIF_TAG_ORIENTATION, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(orientation));
+        ifd1.add(EXIF_TAG_X_RESOLUTION, EXIF_TYPE_RATIONAL, 1, SRC_RATIONAL, SRC(x_resolution));
+        ifd1.add(EXIF_TAG_Y_RESOLUTION, EXIF_TYPE_RATIONAL, 1, SRC_RATIONAL, SRC(y_resolution));
+        ifd1.add(EXIF_TAG_RESOLUTION_UNIT, EXIF_TYPE_SHORT, 1, SRC_U16, SRC(resolution_unit));
+        thumb_ptr = ifd1.add(EXIF_TAG_JPEG_INTERCHANGE_FORMAT, EXIF_TYPE_LONG, 1, SRC_CONST);
+        ifd1.add(EXIF_TAG_JPEG_INTERCHANGE_FORMAT_LEN, EXIF_TYPE_LONG, 1, SRC_THUMB_LEN);
+    }
+
+#undef ASCII
+
+    /* Every pointer index below was returned by add() on one of these */
+    if (ifd0.overflowed() || ifd_exif.overflowed() || ifd_interop.overflowed() ||
+        ifd_gps.overflowed() || ifd1.overflowed()) {
+        ALOGE("Too many EXIF tags in an IFD (max %d)", MAX_IFD_ENTRIES);
+        return false;
+    }
+
+    /* Segment relative positions of each IFD */
+    size_t pos0 = APP1_HEADER_SIZE + TIFF_HEADER_SIZE;
+    size_t pos_exif = pos0 + ifd0.size();
+    size_t pos_interop = pos_exif + ifd_exif.size();
+    size_t pos_gps = pos_interop + ifd_interop.size();
+    size_t pos1 = pos_gps + (mKey.enableGps ? ifd_gps.size() : 0);
+    size_t end = pos1 + (mKey.enableThumb ? ifd1.size() : 0);
+
+    if (end > sizeof(mTemplate)) {
+        ALOGE("EXIF layout of %zu bytes exceeds the limit of %zu", end, sizeof(mTemplate));
+        return false;
+    }
+
+    ifd0.at(exif_ptr).value = pos_exif - APP1_HEADER_SIZE;
+    ifd_exif.at(interop_ptr).value = pos_interop - APP1_HEADER_SIZE;
+    if (gps_ptr >= 0)
+        ifd0.at(gps_ptr).value = pos_gps - APP1_HEADER_SIZE;
+    if (thumb_ptr >= 0)
+        ifd1.at(thumb_ptr).value = end - APP1_HEADER_SIZE;
+
+    memset(mTemplate, 0, end);
+
+    uint8_t *p = mTemplate;
+    p[0] = 0xFF;
+    p[1] = 0xE1;
+    /* p[2..3] is the segment length, written per shot */
+    memcpy(p + 4, "Exif\0\0", 6);
+    p += APP1_HEADER_SIZE;
+    p[0] = 'I';
+    p[1] = 'I';
+    put16(p + 2, 0x002A);
+    put32(p + 4, TIFF_HEADER_SIZE);
+
+    mNumPatches = 0;
+    bool ok = ifd0.emit(mTemplate, pos0, mKey.enableThumb ? pos1 - APP1_HEADER_SIZE : 0,
+                        mPatches, &mNumPatches) &&
+              ifd_exif.emit(mTemplate, pos_exif, 0, mPatches, &mNumPatches) &&
+              ifd_interop.emit(mTemplate, pos_interop, 0, mPatches, &mNumPatches);
+    if (ok && mKey.enableGps)
+        ok = ifd_gps.emit(mTemplate, pos_gps, 0, mPatches, &mNumPatches);
+    if (ok && mKey.enableThumb)
+        ok = ifd1.emit(mTemplate, pos1, 0, mPatches, &mNumPatches);
+
+    if (!ok) {
+        ALOGE("Too many EXIF values to patch (max %d)", MAX_PATCHES);
+        return false;
+    }
+
+    mFixedSize = end;
+    mThumbOffset = mKey.enableThumb ? end : 0;
+
+    ALOGV("EXIF template: %zu bytes, %zu patches", mFixedSize, mNumPatches);
+
+    return true;
+}
+
+size_t ExynosExifWriter::getSize(const exif_attribute_t *exif, size_t thumbSize)
+{
+    if (!exif || !prepare(exif))
+        return 0;
+
+    size_t size = mFixedSize + (mKey.enableThumb ? thumbSize : 0);
+
+    /* The segment length field covers everything but the marker */
+    return (size - 2 > 0xFFFF) ? 0 : size;
+}
+
+size_t ExynosExifWriter::thumbnailOffset(const exif_attribute_t *exif)
+{
+    if (!exif || !prepare(exif))
+        return 0;
+
+    return mThumbOffset;
+}
+
+ssize_t ExynosExifWriter::write(const exif_attribute_t *exif, const void *thumb, size_t thumbSize,
+                                void *dst, size_t dstSize)
+{
+    if (!exif || !dst)
+        return -EINVAL;
+
+    size_t size = getSize(exif, thumbSize);
+    if (size == 0) {
+        ALOGE("Unable to encode EXIF (thumbnail %zu bytes)", thumbSize);
+        return -E2BIG;
+    }
+
+    if (size > dstSize) {
+        ALOGE("EXIF needs %zu bytes but only %zu are available", size, dstSize);
+        return -ENOSPC;
+    }
+
+    uint8_t *out = static_cast<uint8_t *>(dst);
+    const uint8_t *base = reinterpret_cast<const uint8_t *>(exif);
+
+    memcpy(out, mTemplate, mFixedSize);
+    out[2] = ((size - 2) >> 8) & 0xFF;
+    out[3] = (size - 2) & 0xFF;
+
+    for (size_t i = 0; i < mNumPatches; i++) {
+        const Patch &p = mPatches[i];
+        uint8_t *d = out + p.pos;
+        const uint8_t *s = base + p.src;
+
+        switch (p.kind) {
+        case SRC_U8:
+            *d = *s;
+            break;
+        case SRC_U16:
+            put16(d, *reinterpret_cast<const uint16_t *>(s));
+            break;
+        case SRC_U32:
+            put32(d, *reinterpret_cast<const uint32_t *>(s));
+            break;
+        case SRC_RATIONAL:
+        case SRC_SRATIONAL:
+            /* rational_t and srational_t share the same layout */
+            for (int n = 0; n < p.count; n++, d += 8, s += sizeof(rational_t)) {
+                const rational_t *r = reinterpret_cast<const rational_t *>(s);
+                put32(d, r->num);
+                put32(d + 4, r->den);
+            }
+            break;
+        case SRC_ASCII:
+            memcpy(d, s, p.count - 1);
+            d[p.count - 1] = '\0';
+            break;
+        case SRC_RAW:
+            memcpy(d, s, p.count);
+            break;
+        case SRC_MAKER_NOTE:
+            memcpy(d, exif->maker_note, p.count);
+            break;
+        case SRC_USER_COMMENT:
+            memcpy(d, exif->user_comment, p.count);
+            break;
+        case SRC_THUMB_LEN:
+            put32(d, thumbSize);
+            break;
+        }
+    }
+
+    if (mKey.enableThumb && thumb && thumbSize)
+        memcpy(out + mThumbOffset, thumb, thumbSize);
+
+    return size;
+}
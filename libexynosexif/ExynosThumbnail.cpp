@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ExynosThumbnail"
+
+#include <errno.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <log/log.h>
+
+#include "ExynosThumbnail.h"
+
+/* Largest number of source rows summed into one uint16_t accumulator */
+#define MAX_ROWS_PER_OUTPUT 257
+
+namespace {
+
+inline const uint8_t *plane(const exynos_thumbnail_image_t *img, int idx)
+{
+    return static_cast<const uint8_t *>(img->base[idx]) + img->offset[idx];
+}
+
+inline uint8_t *plane_rw(const exynos_thumbnail_image_t *img, int idx)
+{
+    return static_cast<uint8_t *>(img->base[idx]) + img->offset[idx];
+}
+
+/* acc[i] += row[i] for n bytes */
+void accumulate_row(uint16_t *acc, const uint8_t *row, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8(row + i);
+        uint16x8_t lo = vld1q_u16(acc + i);
+        uint16x8_t hi = vld1q_u16(acc + i + 8);
+        vst1q_u16(acc + i, vaddw_u8(lo, vget_low_u8(v)));
+        vst1q_u16(acc + i + 8, vaddw_u8(hi, vget_high_u8(v)));
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i + 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i), _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i + 8), _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero)));
+    }
+#endif
+
+    for (; i < n; i++)
+        acc[i] += row[i];
+}
+
+/* Source span [*s0, *s1) of output index i when mapping n source samples to m */
+inline void span(uint32_t i, uint32_t n, uint32_t m, uint32_t *s0, uint32_t *s1)
+{
+    *s0 = static_cast<uint64_t>(i) * n / m;
+    *s1 = static_cast<uint64_t>(i + 1) * n / m;
+    if (*s1 <= *s0)
+        *s1 = *s0 + 1;
+}
+
+/*
+ * Scales one plane. components is 1 for luma and 2 for interleaved chroma;
+ * sw/sh/dw/dh are in samples per component.
+ */
+void scale_plane(const uint8_t *src, uint32_t src_stride, uint32_t sw, uint32_t sh,
+                 uint8_t *dst, uint32_t dst_stride, uint32_t dw, uint32_t dh,
+                 int components, bool swap, uint16_t *acc)
+{
+    const size_t row_bytes = static_cast<size_t>(sw) * components;
+
+    for (uint32_t y = 0; y < dh; y++) {
+        uint32_t y0, y1;
+        span(y, sh, dh, &y0, &y1);
+
+        memset(acc, 0, row_bytes * sizeof(*acc));
+        for (uint32_t sy = y0; sy < y1; sy++)
+            accumulate_row(acc, src + static_cast<size_t>(sy) * src_stride, row_bytes);
+
+        uint8_t *out = dst + static_cast<size_t>(y) * dst_stride;
+        const uint32_t rows = y1 - y0;
+
+        for (uint32_t x = 0; x < dw; x++) {
+            uint32_t x0, x1;
+            span(x, sw, dw, &x0, &x1);
+
+            const uint32_t n = (x1 - x0) * rows;
+            for (int c = 0; c < components; c++) {
+                uint32_t sum = 0;
+                for (uint32_t sx = x0; sx < x1; sx++)
+                    sum += acc[sx * components + c];
+
+                int oc = swap ? components - 1 - c : c;
+                out[x * components + oc] = (sum + n / 2) / n;
+            }
+        }
+    }
+}
+
+} // namespace
+
+int ExynosThumbnailScaler::scale(const exynos_thumbnail_image_t *src, const exynos_thumbnail_crop_t *crop,
+                                 const exynos_thumbnail_image_t *dst)
+{
+    if (!src || !dst || !src->base[0] || !src->base[1] || !dst->base[0] || !dst->base[1])
+        return -EINVAL;
+
+    exynos_thumbnail_crop_t c = { 0, 0, src->width, src->height };
+    if (crop) {
+        c = *crop;
+        c.width += c.left & 1;
+        c.height += c.top & 1;
+        c.left &= ~1;
+        c.top &= ~1;
+    }
+
+    if (c.width < 2 || c.height < 2 || c.left + c.width > src->width || c.top + c.height > src->height) {
+        ALOGE("Invalid crop %ux%u+%u+%u of %ux%u", c.width, c.height, c.left, c.top, src->width, src->height);
+        return -EINVAL;
+    }
+
+    if (dst->width < 2 || dst->height < 2 || (dst->width | dst->height) & 1) {
+        ALOGE("Invalid thumbnail size %ux%u", dst->width, dst->height);
+        return -EINVAL;
+    }
+
+    if (c.height / dst->height + 1 > MAX_ROWS_PER_OUTPUT) {
+        ALOGE("Downscale ratio %u:%u is too large", c.height, dst->height);
+        return -EINVAL;
+    }
+
+    if (mAccum.size() < c.width)
+        mAccum.resize(c.width);
+
+    const uint8_t *src_y = plane(src, 0) + static_cast<size_t>(c.top) * src->stride[0] + c.left;
+    const uint8_t *src_uv = plane(src, 1) + static_cast<size_t>(c.top / 2) * src->stride[1] + c.left;
+
+    scale_plane(src_y, src->stride[0], c.width, c.height,
+                plane_rw(dst, 0), dst->stride[0], dst->width, dst->height,
+                1, false, mAccum.data());
+    scale_plane(src_uv, src->stride[1], c.width / 2, c.height / 2,
+                plane_rw(dst, 1), dst->stride[1], dst->width / 2, dst->height / 2,
+                2, src->nv21 != dst->nv21, mAccum.data());
+
+    return 0;
+}
+
+ExynosThumbnailWorker::ExynosThumbnailWorker()
+    : mQueued(false), mBusy(false), mPending(false), mExit(false), mResult(0), mHasCrop(false)
+{
+    memset(&mSrc, 0, sizeof(mSrc));
+    memset(&mDst, 0, sizeof(mDst));
+    memset(&mCrop, 0, sizeof(mCrop));
+
+    mThread = std::thread(&ExynosThumbnailWorker::threadLoop, this);
+}
+
+ExynosThumbnailWorker::~ExynosThumbnailWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mCond.notify_all();
+    mThread.join();
+}
+
+int ExynosThumbnailWorker::start(const exynos_thumbnail_image_t *src, const exynos_thumbnail_crop_t *crop,
+                                 const exynos_thumbnail_image_t *dst)
+{
+    if (!src || !dst)
+        return -EINVAL;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mPending)
+            return -EBUSY;
+
+        mSrc = *src;
+        mDst = *dst;
+        mHasCrop = crop != NULL;
+        if (crop)
+            mCrop = *crop;
+        mQueued = true;
+        mBusy = true;
+        mPending = true;
+    }
+    mCond.notify_all();
+
+    return 0;
+}
+
+int ExynosThumbnailWorker::wait()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+
+    if (!mPending)
+        return -EINVAL;
+
+    mCond.wait(lock, [this] { return !mBusy; });
+    mPending = false;
+
+    return mResult;
+}
+
+void ExynosThumbnailWorker::threadLoop()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+
+    while (true) {
+        mCond.wait(lock, [this] { return mQueued || mExit; });
+        if (mExit)
+            break;
+
+        mQueued = false;
+        lock.unlock();
+
+        int ret = mScaler.scale(&mSrc, mHasCrop ? &mCrop : NULL, &mDst);
+        ALOGV("Thumbnail %ux%u -> %ux%u: %d", mSrc.width, mSrc.height, mDst.width, mDst.height, ret);
+
+        lock.lock();
+        mResult = ret;
+        mBusy = false;
+        mCond.notify_all();
+    }
+}
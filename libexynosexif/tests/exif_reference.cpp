@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+
+#include <libexif/exif-data.h>
+#include <libexif/exif-utils.h>
+
+#include "exif_reference.h"
+
+namespace {
+
+const ExifIfd kIfds[] = {
+    EXIF_IFD_0,
+    EXIF_IFD_EXIF,
+    EXIF_IFD_GPS,
+    EXIF_IFD_INTEROPERABILITY,
+    EXIF_IFD_1,
+};
+
+ExifEntry *find(ExifData *data, ReferenceExif::Ifd ifd, uint16_t tag)
+{
+    if (!data)
+        return NULL;
+
+    return exif_content_get_entry(data->ifd[kIfds[ifd]], static_cast<ExifTag>(tag));
+}
+
+} // namespace
+
+ReferenceExif::ReferenceExif(const void *data, size_t size)
+{
+    mData = exif_data_new();
+    if (!mData)
+        return;
+
+    /* Keep exactly what was written: no dropped or added tags */
+    exif_data_unset_option(mData, EXIF_DATA_OPTION_IGNORE_UNKNOWN_TAGS);
+    exif_data_unset_option(mData, EXIF_DATA_OPTION_FOLLOW_SPECIFICATION);
+    exif_data_load_data(mData, static_cast<const unsigned char *>(data), size);
+}
+
+ReferenceExif::~ReferenceExif()
+{
+    if (mData)
+        exif_data_unref(mData);
+}
+
+bool ReferenceExif::valid() const
+{
+    return mData && mData->ifd[EXIF_IFD_0] && mData->ifd[EXIF_IFD_0]->count > 0;
+}
+
+bool ReferenceExif::has(Ifd ifd, uint16_t tag) const
+{
+    return find(mData, ifd, tag) != NULL;
+}
+
+uint16_t ReferenceExif::type(Ifd ifd, uint16_t tag) const
+{
+    ExifEntry *entry = find(mData, ifd, tag);
+
+    return entry ? entry->format : 0;
+}
+
+uint32_t ReferenceExif::components(Ifd ifd, uint16_t tag) const
+{
+    ExifEntry *entry = find(mData, ifd, tag);
+
+    return entry ? entry->components : 0;
+}
+
+uint32_t ReferenceExif::integer(Ifd ifd, uint16_t tag, unsigned int index) const
+{
+    ExifEntry *entry = find(mData, ifd, tag);
+    if (!entry || index >= entry->components)
+        return UINT32_MAX;
+
+    ExifByteOrder order = exif_data_get_byte_order(mData);
+    switch (entry->format) {
+    case EXIF_FORMAT_BYTE:
+        return entry->data[index];
+    case EXIF_FORMAT_SHORT:
+        return exif_get_short(entry->data + 2 * index, order);
+    case EXIF_FORMAT_LONG:
+        return exif_get_long(entry->data + 4 * index, order);
+    default:
+        return UINT32_MAX;
+    }
+}
+
+bool ReferenceExif::rational(Ifd ifd, uint16_t tag, unsigned int index, uint32_t *num,
+                             uint32_t *den) const
+{
+    ExifEntry *entry = find(mData, ifd, tag);
+    if (!entry || entry->format != EXIF_FORMAT_RATIONAL || index >= entry->components)
+        return false;
+
+    ExifRational r = exif_get_rational(entry->data + 8 * index, exif_data_get_byte_order(mData));
+    *num = r.numerator;
+    *den = r.denominator;
+
+    return true;
+}
+
+bool ReferenceExif::srational(Ifd ifd, uint16_t tag, unsigned int index, int32_t *num,
+                              int32_t *den) const
+{
+    ExifEntry *entry = find(mData, ifd, tag);
+    if (!entry || entry->format != EXIF_FORMAT_SRATIONAL || index >= entry->components)
+        return false;
+
+    ExifSRational r = exif_get_srational(entry->data + 8 * index, exif_data_get_byte_order(mData));
+    *num = r.numerator;
+    *den = r.denominator;
+
+    return true;
+}
+
+std::string ReferenceExif::string(Ifd ifd, uint16_t tag) const
+{
+    ExifEntry *entry = find(mData, ifd, tag);
+    if (!entry || !entry->data)
+        return std::string();
+
+    const char *data = reinterpret_cast<const char *>(entry->data);
+    return std::string(data, strnlen(data, entry->size));
+}
+
+std::vector<uint8_t> ReferenceExif::bytes(Ifd ifd, uint16_t tag) const
+{
+    ExifEntry *entry = find(mData, ifd, tag);
+    if (!entry || !entry->data)
+        return std::vector<uint8_t>();
+
+    return std::vector<uint8_t>(entry->data, entry->data + entry->size);
+}
+
+std::vector<uint8_t> ReferenceExif::thumbnail() const
+{
+    if (!mData || !mData->data)
+        return std::vector<uint8_t>();
+
+    return std::vector<uint8_t>(mData->data, mData->data + mData->size);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HARDWARE_EXYNOS_EXIF_REFERENCE_H__
+#define __HARDWARE_EXYNOS_EXIF_REFERENCE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+struct _ExifData;
+
+/*
+ * An APP1 segment parsed by libexif, the reference the writer is checked
+ * against. Kept apart from the tests because the libexif tag enumerators
+ * have the same names as the ExynosExif.h tag macros.
+ */
+class ReferenceExif {
+public:
+    enum Ifd {
+        IFD_0,
+        IFD_EXIF,
+        IFD_GPS,
+        IFD_INTEROPERABILITY,
+        IFD_1,
+    };
+
+    ReferenceExif(const void *data, size_t size);
+    ~ReferenceExif();
+
+    /* True when libexif found a 0th IFD */
+    bool valid() const;
+
+    bool has(Ifd ifd, uint16_t tag) const;
+    /* EXIF type of the entry, 0 when it is missing */
+    uint16_t type(Ifd ifd, uint16_t tag) const;
+    uint32_t components(Ifd ifd, uint16_t tag) const;
+
+    /* Component index of a BYTE, SHORT or LONG entry */
+    uint32_t integer(Ifd ifd, uint16_t tag, unsigned int index = 0) const;
+    bool rational(Ifd ifd, uint16_t tag, unsigned int index, uint32_t *num, uint32_t *den) const;
+    bool srational(Ifd ifd, uint16_t tag, unsigned int index, int32_t *num, int32_t *den) const;
+    /* ASCII entry up to the first NUL */
+    std::string string(Ifd ifd, uint16_t tag) const;
+    std::vector<uint8_t> bytes(Ifd ifd, uint16_t tag) const;
+
+    /* Data at JPEGInterchangeFormat of the 1st IFD */
+    std::vector<uint8_t> thumbnail() const;
+
+private:
+    struct _ExifData *mData;
+};
+
+#endif /* __HARDWARE_EXYNOS_EXIF_REFERENCE_H__ */
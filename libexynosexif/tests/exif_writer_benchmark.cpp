@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "ExynosExifWriter.h"
+
+/*
+ * Cost of writing the APP1 segment per shot. BM_exif_write is the steady
+ * state, where only the per-shot values are patched into the cached
+ * template; BM_exif_write_rebuild drops the template first, which is what
+ * every shot paid before the template was cached.
+ */
+namespace {
+
+void fillAttribute(exif_attribute_t *exif, bool gps)
+{
+    memset(exif, 0, sizeof(*exif));
+
+    exif->enableGps = gps;
+    exif->enableThumb = true;
+    strcpy(exif->maker, "Google");
+    strcpy(exif->model, "Pixel");
+    strcpy(exif->software, "HDR+ 1.0");
+    memcpy(exif->exif_version, "0220", 4);
+    strcpy(exif->date_time, "2020:07:01 12:34:56");
+    strcpy(exif->sec_time, "123");
+    strcpy(exif->unique_id, "0123456789abcdef");
+    exif->width = 4032;
+    exif->height = 3024;
+    exif->widthThumb = 320;
+    exif->heightThumb = 240;
+    exif->exposure_time = { 1, 120 };
+    exif->fnumber = { 180, 100 };
+    strcpy(exif->gps_latitude_ref, "N");
+    strcpy(exif->gps_longitude_ref, "W");
+    strcpy(exif->gps_datestamp, "2020:07:01");
+    strcpy(exif->gps_processing_method, "GPS");
+}
+
+void BM_exif_write(benchmark::State &state, bool gps, bool rebuild)
+{
+    exif_attribute_t exif;
+    fillAttribute(&exif, gps);
+
+    const size_t thumbSize = 16 * 1024;
+    std::vector<uint8_t> thumb(thumbSize, 0x5A);
+    std::vector<uint8_t> out(EXIF_FILE_SIZE + thumbSize);
+    ExynosExifWriter writer;
+
+    for (auto _ : state) {
+        if (rebuild)
+            writer.reset();
+        /* A new value every shot, as the camera HAL does */
+        exif.iso_speed_rating++;
+        ssize_t written = writer.write(&exif, thumb.data(), thumb.size(), out.data(), out.size());
+        if (written < 0) {
+            state.SkipWithError("write failed");
+            break;
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+
+int register_benchmarks()
+{
+    for (bool gps : { false, true }) {
+        const char *layout = gps ? "gps" : "no_gps";
+        benchmark::RegisterBenchmark((std::string("BM_exif_write/") + layout).c_str(), BM_exif_write, gps,
+                                     false);
+        benchmark::RegisterBenchmark((std::string("BM_exif_write_rebuild/") + layout).c_str(), BM_exif_write,
+                                     gps, true);
+    }
+    return 0;
+}
+
+[[maybe_unused]] const int registered = register_benchmarks();
+
+} // namespace
+
+BENCHMARK_MAIN();
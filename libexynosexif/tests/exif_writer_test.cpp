@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ExynosExifWriter.h"
+#include "exif_reference.h"
+
+/*
+ * Writes exif_attribute_t with ExynosExifWriter and reads it back with
+ * libexif: every tag must come back with the value and type written.
+ */
+namespace {
+
+const uint8_t kMakerNote[] = { 'M', 'N', 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 };
+const uint8_t kUserComment[] = { 'A', 'S', 'C', 'I', 'I', 0, 0, 0, 'h', 'i' };
+
+void fillAttribute(exif_attribute_t *exif, bool gps, bool thumb)
+{
+    memset(exif, 0, sizeof(*exif));
+
+    exif->enableGps = gps;
+    exif->enableThumb = thumb;
+
+    strcpy(exif->maker, "Google");
+    strcpy(exif->model, "Pixel");
+    strcpy(exif->software, "HDR+ 1.0");
+    memcpy(exif->exif_version, "0220", 4);
+    strcpy(exif->date_time, "2020:07:01 12:34:56");
+    strcpy(exif->sec_time, "123");
+    exif->maker_note = const_cast<uint8_t *>(kMakerNote);
+    exif->maker_note_size = sizeof(kMakerNote);
+    exif->user_comment = const_cast<uint8_t *>(kUserComment);
+    exif->user_comment_size = sizeof(kUserComment);
+
+    exif->width = 4032;
+    exif->height = 3024;
+    exif->widthThumb = 320;
+    exif->heightThumb = 240;
+
+    exif->orientation = EXIF_ORIENTATION_90;
+    exif->ycbcr_positioning = 1;
+    exif->exposure_program = 2;
+    exif->iso_speed_rating = 400;
+    exif->metering_mode = EXIF_METERING_CENTER;
+    exif->flash = 0x10;
+    exif->color_space = 1;
+    exif->custom_rendered = 1;
+    exif->contrast = 0;
+    exif->saturation = 1;
+    exif->sharpness = 2;
+    exif->exposure_mode = EXIF_EXPOSURE_AUTO;
+    exif->white_balance = 0;
+    exif->focal_length_in_35mm_length = 27;
+    exif->scene_capture_type = EXIF_SCENE_PORTRAIT;
+    strcpy(exif->unique_id, "0123456789abcdef");
+
+    exif->exposure_time = { 1, 120 };
+    exif->fnumber = { 180, 100 };
+    exif->aperture = { 170, 100 };
+    exif->max_aperture = { 170, 100 };
+    exif->focal_length = { 438, 100 };
+    exif->digital_zoom_ratio = { 100, 100 };
+    exif->shutter_speed = { 691, 100 };
+    exif->brightness = { -25, 10 };
+    exif->exposure_bias = { -1, 3 };
+
+    strcpy(exif->gps_latitude_ref, "N");
+    strcpy(exif->gps_longitude_ref, "W");
+    exif->gps_version_id[0] = 2;
+    exif->gps_version_id[1] = 2;
+    exif->gps_altitude_ref = 1;
+    exif->gps_latitude[0] = { 37, 1 };
+    exif->gps_latitude[1] = { 25, 1 };
+    exif->gps_latitude[2] = { 1980, 100 };
+    exif->gps_longitude[0] = { 122, 1 };
+    exif->gps_longitude[1] = { 5, 1 };
+    exif->gps_longitude[2] = { 3300, 100 };
+    exif->gps_altitude = { 15, 1 };
+    exif->gps_timestamp[0] = { 19, 1 };
+    exif->gps_timestamp[1] = { 34, 1 };
+    exif->gps_timestamp[2] = { 56, 1 };
+    strcpy(exif->gps_datestamp, "2020:07:01");
+    strcpy(exif->gps_processing_method, "GPS");
+
+    exif->x_resolution = { 72, 1 };
+    exif->y_resolution = { 72, 1 };
+    exif->resolution_unit = 2;
+    exif->compression_scheme = 6;
+}
+
+std::vector<uint8_t> makeThumbnail(size_t size)
+{
+    std::vector<uint8_t> thumb(size);
+
+    for (size_t i = 0; i < size; i++)
+        thumb[i] = static_cast<uint8_t>(i * 7 + 3);
+    thumb[0] = 0xFF;
+    thumb[1] = 0xD8;
+
+    return thumb;
+}
+
+std::vector<uint8_t> writeSegment(ExynosExifWriter &writer, const exif_attribute_t &exif,
+                                  const std::vector<uint8_t> &thumb)
+{
+    std::vector<uint8_t> out(EXIF_FILE_SIZE + thumb.size());
+    ssize_t written = writer.write(&exif, thumb.data(), thumb.size(), out.data(), out.size());
+    if (written < 0)
+        return std::vector<uint8_t>();
+
+    out.resize(written);
+    return out;
+}
+
+void expectRational(const ReferenceExif &ref, ReferenceExif::Ifd ifd, uint16_t tag,
+                    unsigned int index, const rational_t &value)
+{
+    uint32_t num = 0, den = 0;
+
+    ASSERT_TRUE(ref.rational(ifd, tag, index, &num, &den)) << "tag 0x" << std::hex << tag;
+    EXPECT_EQ(value.num, num) << "tag 0x" << std::hex << tag;
+    EXPECT_EQ(value.den, den) << "tag 0x" << std::hex << tag;
+}
+
+void expectSRational(const ReferenceExif &ref, ReferenceExif::Ifd ifd, uint16_t tag,
+                     const srational_t &value)
+{
+    int32_t num = 0, den = 0;
+
+    ASSERT_TRUE(ref.srational(ifd, tag, 0, &num, &den)) << "tag 0x" << std::hex << tag;
+    EXPECT_EQ(value.num, num) << "tag 0x" << std::hex << tag;
+    EXPECT_EQ(value.den, den) << "tag 0x" << std::hex << tag;
+}
+
+void expectPerShotValues(const ReferenceExif &ref, const exif_attribute_t &exif)
+{
+    EXPECT_EQ(exif.width, ref.integer(ReferenceExif::IFD_0, EXIF_TAG_IMAGE_WIDTH));
+    EXPECT_EQ(exif.height, ref.integer(ReferenceExif::IFD_0, EXIF_TAG_IMAGE_HEIGHT));
+    EXPECT_EQ(exif.orientation, ref.integer(ReferenceExif::IFD_0, EXIF_TAG_ORIENTATION));
+    EXPECT_EQ(exif.date_time, ref.string(ReferenceExif::IFD_0, EXIF_TAG_DATE_TIME));
+    EXPECT_EQ(exif.iso_speed_rating, ref.integer(ReferenceExif::IFD_EXIF, EXIF_TAG_ISO_SPEED_RATING));
+    EXPECT_EQ(exif.sec_time, ref.string(ReferenceExif::IFD_EXIF, EXIF_TAG_SUBSEC_TIME));
+    expectRational(ref, ReferenceExif::IFD_EXIF, EXIF_TAG_EXPOSURE_TIME, 0, exif.exposure_time);
+    expectSRational(ref, ReferenceExif::IFD_EXIF, EXIF_TAG_BRIGHTNESS, exif.brightness);
+}
+
+TEST(ExynosExifWriter, RoundTripsEveryTag)
+{
+    exif_attribute_t exif;
+    fillAttribute(&exif, true, true);
+    const std::vector<uint8_t> thumb = makeThumbnail(1000);
+
+    ExynosExifWriter writer;
+    std::vector<uint8_t> segment = writeSegment(writer, exif, thumb);
+    ASSERT_FALSE(segment.empty());
+    EXPECT_EQ(writer.getSize(&exif, thumb.size()), segment.size());
+
+    /* APP1 marker and a length that covers the rest of the segment */
+    ASSERT_GE(segment.size(), 4u);
+    EXPECT_EQ(0xFF, segment[0]);
+    EXPECT_EQ(0xE1, segment[1]);
+    EXPECT_EQ(segment.size() - 2, static_cast<size_t>((segment[2] << 8) | segment[3]));
+
+    ReferenceExif ref(segment.data(), segment.size());
+    ASSERT_TRUE(ref.valid());
+
+    /* 0th IFD */
+    EXPECT_EQ(EXIF_TYPE_LONG, ref.type(ReferenceExif::IFD_0, EXIF_TAG_IMAGE_WIDTH));
+    EXPECT_EQ(exif.maker, ref.string(ReferenceExif::IFD_0, EXIF_TAG_MAKE));
+    EXPECT_EQ(exif.model, ref.string(ReferenceExif::IFD_0, EXIF_TAG_MODEL));
+    EXPECT_EQ(exif.software, ref.string(ReferenceExif::IFD_0, EXIF_TAG_SOFTWARE));
+    EXPECT_EQ(EXIF_TYPE_SHORT, ref.type(ReferenceExif::IFD_0, EXIF_TAG_ORIENTATION));
+    EXPECT_EQ(exif.ycbcr_positioning, ref.integer(ReferenceExif::IFD_0, EXIF_TAG_YCBCR_POSITIONING));
+    expectPerShotValues(ref, exif);
+
+    /* Exif IFD */
+    expectRational(ref, ReferenceExif::IFD_EXIF, EXIF_TAG_FNUMBER, 0, exif.fnumber);
+    EXPECT_EQ(exif.exposure_program, ref.integer(ReferenceExif::IFD_EXIF, EXIF_TAG_EXPOSURE_PROGRAM));
+    EXPECT_EQ(std::vector<uint8_t>(exif.exif_version, exif.exif_version + 4),
+              ref.bytes(ReferenceExif::IFD_EXIF, EXIF_TAG_EXIF_VERSION));
+    EXPECT_EQ(exif.date_time, ref.string(ReferenceExif::IFD_EXIF, EXIF_TAG_DATE_TIME_ORG));
+    EXPECT_EQ(exif.date_time, ref.string(ReferenceExif::IFD_EXIF, EXIF_TAG_DATE_TIME_DIGITIZE));
+    EXPECT_EQ(std::vector<uint8_t>({ 1, 2, 3, 0 }),
+              ref.bytes(ReferenceExif::IFD_EXIF, EXIF_TAG_COMPONENTS_CONFIGURATION));
+    expectSRational(ref, ReferenceExif::IFD_EXIF, EXIF_TAG_SHUTTER_SPEED, exif.shutter_speed);
+    expectRational(ref, ReferenceExif::IFD_EXIF, EXIF_TAG_APERTURE, 0, exif.aperture);
+    expectSRational(ref, ReferenceExif::IFD_EXIF, EXIF_TAG_EXPOSURE_BIAS, exif.exposure_bias);
+    expectRational(ref, ReferenceExif::IFD_EXIF, EXIF_TAG_MAX_APERTURE, 0, exif.max_aperture);
+    EXPECT_EQ(exif.metering_mode, ref.integer(ReferenceExif::IFD_EXIF, EXIF_TAG_METERING_MODE));
+    EXPECT_EQ(exif.flash, ref.integer(ReferenceExif::IFD_EXIF, EXIF_TAG_FLASH));
+    expectRational(ref, ReferenceExif::IFD_EXIF, EXIF_TAG_FOCAL_LENGTH, 0, exif.focal_length);
+    EXPECT_EQ(std::vector<uint8_t>(kMakerNote, kMakerNote + sizeof(kMakerNote)),
+              ref.bytes(ReferenceExif::IFD_EXIF, EXIF_TAG_MAKER_NOTE));
+    EXPECT_EQ(std::vector<uint8_t>(kUserComment, kUserComment + sizeof(kUserComment)),
+              ref.bytes(ReferenceExif::IFD_EXIF, EXIF_TAG_USER_COMMENT));
+    EXPECT_EQ(exif.sec_time, ref.string(ReferenceExif::IFD_EXIF, EXIF_TAG_SUBSEC_TIME_ORIG));
+    EXPECT_EQ(exif.sec_time, ref.string(ReferenceExif::IFD_EXIF, EXIF_TAG_SUBSEC_TIME_DIG));
+    EXPECT_EQ(std::vector<uint8_t>({ '0', '1', '0', '0' }),
+              ref.bytes(ReferenceExif::IFD_EXIF, EXIF_TAG_FLASHPIX_VERSION));
+    EXPECT_EQ(exif.color_space, ref.integer(ReferenceExif::IFD_EXIF, EXIF_TAG_COLOR_SPACE));
+    EXPECT_EQ(exif.width, ref.integer(ReferenceExif::IFD_EXIF, EXIF_TAG_PIXEL_X_DIMENSION));
+    EXPECT_EQ(exif.height, ref.integer(ReferenceExif::IFD_EXIF, EXIF_TAG_PIXEL_Y_DIMENSION));
+    EXPECT_EQ(exif.custom_rendered, ref.integer(ReferenceExif::IFD_EXIF, EXIF_TAG_CUSTOM_RENDERED));
+    EXPECT_EQ(exif.exposure_mode, ref.integer(ReferenceExif::IFD_EXIF, EXIF_TAG_EXPOSURE_MODE));
+    EXPECT_EQ(exif.white_balance, ref.integer(ReferenceExif::IFD_EXIF, EXIF_TAG_WHITE_BALANCE));
+    expectRational(ref, ReferenceExif::IFD_EXIF, EXIF_TAG_DIGITAL_ZOOM_RATIO, 0, exif.digital_zoom_ratio);
+    EXPECT_EQ(exif.focal_length_in_35mm_length,
+              ref.integer(ReferenceExif::IFD_EXIF, EXIF_TAG_FOCA_LENGTH_IN_35MM_FILM));
+    EXPECT_EQ(exif.scene_capture_type, ref.integer(ReferenceExif::IFD_EXIF, EXIF_TAG_SCENCE_CAPTURE_TYPE));
+    EXPECT_EQ(exif.contrast, ref.integer(ReferenceExif::IFD_EXIF, EXIF_TAG_CONTRAST));
+    EXPECT_EQ(exif.saturation, ref.integer(ReferenceExif::IFD_EXIF, EXIF_TAG_SATURATION));
+    EXPECT_EQ(exif.sharpness, ref.integer(ReferenceExif::IFD_EXIF, EXIF_TAG_SHARPNESS));
+    EXPECT_EQ(exif.unique_id, ref.string(ReferenceExif::IFD_EXIF, EXIF_TAG_IMAGE_UNIQUE_ID));
+
+    /* Interoperability IFD */
+    EXPECT_EQ("R98", ref.string(ReferenceExif::IFD_INTEROPERABILITY, EXIF_TAG_INTEROPERABILITY_INDEX));
+    EXPECT_EQ(std::vector<uint8_t>({ '0', '1', '0', '0' }),
+              ref.bytes(ReferenceExif::IFD_INTEROPERABILITY, EXIF_TAG_INTEROPERABILITY_VERSION));
+
+    /* GPS IFD */
+    EXPECT_EQ(std::vector<uint8_t>(exif.gps_version_id, exif.gps_version_id + 4),
+              ref.bytes(ReferenceExif::IFD_GPS, EXIF_TAG_GPS_VERSION_ID));
+    EXPECT_EQ(exif.gps_latitude_ref, ref.string(ReferenceExif::IFD_GPS, EXIF_TAG_GPS_LATITUDE_REF));
+    EXPECT_EQ(exif.gps_longitude_ref, ref.string(ReferenceExif::IFD_GPS, EXIF_TAG_GPS_LONGITUDE_REF));
+    for (unsigned int i = 0; i < 3; i++) {
+        expectRational(ref, ReferenceExif::IFD_GPS, EXIF_TAG_GPS_LATITUDE, i, exif.gps_latitude[i]);
+        expectRational(ref, ReferenceExif::IFD_GPS, EXIF_TAG_GPS_LONGITUDE, i, exif.gps_longitude[i]);
+        expectRational(ref, ReferenceExif::IFD_GPS, EXIF_TAG_GPS_TIMESTAMP, i, exif.gps_timestamp[i]);
+    }
+    EXPECT_EQ(exif.gps_altitude_ref, ref.integer(ReferenceExif::IFD_GPS, EXIF_TAG_GPS_ALTITUDE_REF));
+    expectRational(ref, ReferenceExif::IFD_GPS, EXIF_TAG_GPS_ALTITUDE, 0, exif.gps_altitude);
+    EXPECT_EQ(exif.gps_processing_method,
+              ref.string(ReferenceExif::IFD_GPS, EXIF_TAG_GPS_PROCESSING_METHOD));
+    EXPECT_EQ(exif.gps_datestamp, ref.string(ReferenceExif::IFD_GPS, EXIF_TAG_GPS_DATESTAMP));
+
+    /* 1st IFD and thumbnail */
+    EXPECT_EQ(exif.widthThumb, ref.integer(ReferenceExif::IFD_1, EXIF_TAG_IMAGE_WIDTH));
+    EXPECT_EQ(exif.heightThumb, ref.integer(ReferenceExif::IFD_1, EXIF_TAG_IMAGE_HEIGHT));
+    EXPECT_EQ(exif.compression_scheme, ref.integer(ReferenceExif::IFD_1, EXIF_TAG_COMPRESSION_SCHEME));
+    expectRational(ref, ReferenceExif::IFD_1, EXIF_TAG_X_RESOLUTION, 0, exif.x_resolution);
+    expectRational(ref, ReferenceExif::IFD_1, EXIF_TAG_Y_RESOLUTION, 0, exif.y_resolution);
+    EXPECT_EQ(exif.resolution_unit, ref.integer(ReferenceExif::IFD_1, EXIF_TAG_RESOLUTION_UNIT));
+    EXPECT_EQ(thumb, ref.thumbnail());
+    EXPECT_EQ(0, memcmp(segment.data() + writer.thumbnailOffset(&exif), thumb.data(), thumb.size()));
+}
+
+TEST(ExynosExifWriter, OmitsDisabledBlocks)
+{
+    exif_attribute_t exif;
+    fillAttribute(&exif, false, false);
+    exif.maker_note = NULL;
+    exif.user_comment = NULL;
+    exif.unique_id[0] = '\0';
+
+    ExynosExifWriter writer;
+    std::vector<uint8_t> segment = writeSegment(writer, exif, std::vector<uint8_t>());
+    ASSERT_FALSE(segment.empty());
+    EXPECT_EQ(0u, writer.thumbnailOffset(&exif));
+
+    ReferenceExif ref(segment.data(), segment.size());
+    ASSERT_TRUE(ref.valid());
+    EXPECT_FALSE(ref.has(ReferenceExif::IFD_0, EXIF_TAG_GPS_IFD_POINTER));
+    EXPECT_FALSE(ref.has(ReferenceExif::IFD_GPS, EXIF_TAG_GPS_LATITUDE));
+    EXPECT_FALSE(ref.has(ReferenceExif::IFD_1, EXIF_TAG_IMAGE_WIDTH));
+    EXPECT_FALSE(ref.has(ReferenceExif::IFD_EXIF, EXIF_TAG_MAKER_NOTE));
+    EXPECT_FALSE(ref.has(ReferenceExif::IFD_EXIF, EXIF_TAG_USER_COMMENT));
+    EXPECT_FALSE(ref.has(ReferenceExif::IFD_EXIF, EXIF_TAG_IMAGE_UNIQUE_ID));
+    EXPECT_TRUE(ref.thumbnail().empty());
+    expectPerShotValues(ref, exif);
+}
+
+TEST(ExynosExifWriter, ReusesTheLayoutForNewValues)
+{
+    exif_attribute_t exif;
+    fillAttribute(&exif, true, true);
+    const std::vector<uint8_t> thumb = makeThumbnail(512);
+
+    ExynosExifWriter writer;
+    ASSERT_FALSE(writeSegment(writer, exif, thumb).empty());
+
+    /* Same layout: only the patched values change */
+    exif.width = 1920;
+    exif.height = 1080;
+    exif.orientation = EXIF_ORIENTATION_180;
+    exif.iso_speed_rating = 3200;
+    exif.exposure_time = { 1, 30 };
+    exif.brightness = { 13, 10 };
+    strcpy(exif.date_time, "2021:01:02 03:04:05");
+    strcpy(exif.sec_time, "999");
+
+    std::vector<uint8_t> segment = writeSegment(writer, exif, thumb);
+    ASSERT_FALSE(segment.empty());
+    ReferenceExif same(segment.data(), segment.size());
+    ASSERT_TRUE(same.valid());
+    expectPerShotValues(same, exif);
+
+    /* A longer string changes the layout and rebuilds the template */
+    strcpy(exif.model, "Pixel with a much longer name");
+    segment = writeSegment(writer, exif, thumb);
+    ASSERT_FALSE(segment.empty());
+    ReferenceExif rebuilt(segment.data(), segment.size());
+    ASSERT_TRUE(rebuilt.valid());
+    EXPECT_EQ(exif.model, rebuilt.string(ReferenceExif::IFD_0, EXIF_TAG_MODEL));
+    expectPerShotValues(rebuilt, exif);
+    EXPECT_EQ(thumb, rebuilt.thumbnail());
+}
+
+TEST(ExynosExifWriter, ReservesTheThumbnailArea)
+{
+    exif_attribute_t exif;
+    fillAttribute(&exif, false, true);
+
+    ExynosExifWriter writer;
+    const size_t thumbSize = 2048;
+    const size_t size = writer.getSize(&exif, thumbSize);
+    const size_t offset = writer.thumbnailOffset(&exif);
+    ASSERT_GT(size, thumbSize);
+    ASSERT_EQ(size - thumbSize, offset);
+
+    std::vector<uint8_t> out(size, 0xA5);
+    ASSERT_EQ(static_cast<ssize_t>(size), writer.write(&exif, NULL, thumbSize, out.data(), out.size()));
+    for (size_t i = offset; i < size; i++)
+        ASSERT_EQ(0xA5, out[i]) << "at " << i;
+
+    ReferenceExif ref(out.data(), out.size());
+    ASSERT_TRUE(ref.valid());
+    EXPECT_EQ(thumbSize, ref.thumbnail().size());
+}
+
+TEST(ExynosExifWriter, RejectsSmallDestination)
+{
+    exif_attribute_t exif;
+    fillAttribute(&exif, true, false);
+
+    ExynosExifWriter writer;
+    const size_t size = writer.getSize(&exif, 0);
+    ASSERT_GT(size, 0u);
+
+    std::vector<uint8_t> out(size - 1);
+    EXPECT_EQ(-ENOSPC, writer.write(&exif, NULL, 0, out.data(), out.size()));
+    EXPECT_EQ(-EINVAL, writer.write(NULL, NULL, 0, out.data(), out.size()));
+}
+
+} // namespace
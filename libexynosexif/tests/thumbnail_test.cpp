@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include "ExynosThumbnail.h"
+
+/*
+ * Scales NV12/NV21 images held in memfd mappings, the way gralloc buffers
+ * are mapped (separate fds per plane, plane offsets, padded strides), and
+ * compares the result with a plain per-pixel area average.
+ */
+namespace {
+
+class MappedBuffer {
+public:
+    explicit MappedBuffer(size_t size) : mSize(size), mFd(-1), mBase(MAP_FAILED)
+    {
+        mFd = memfd_create("exynos_thumbnail_test", MFD_CLOEXEC);
+        if (mFd < 0 || ftruncate(mFd, size) != 0)
+            return;
+        mBase = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+    }
+
+    ~MappedBuffer()
+    {
+        if (mBase != MAP_FAILED)
+            munmap(mBase, mSize);
+        if (mFd >= 0)
+            close(mFd);
+    }
+
+    bool valid() const { return mBase != MAP_FAILED; }
+    uint8_t *data() const { return static_cast<uint8_t *>(mBase); }
+
+private:
+    size_t mSize;
+    int mFd;
+    void *mBase;
+};
+
+struct Image {
+    exynos_thumbnail_image_t desc;
+    std::unique_ptr<MappedBuffer> planes[2];
+};
+
+/* Two fds with an offset on each plane and strides padded past the width */
+void makeImage(Image *img, uint32_t width, uint32_t height, bool nv21, uint32_t padding)
+{
+    memset(&img->desc, 0, sizeof(img->desc));
+    img->desc.width = width;
+    img->desc.height = height;
+    img->desc.nv21 = nv21;
+
+    const uint32_t plane_height[2] = { height, height / 2 };
+    for (int i = 0; i < 2; i++) {
+        img->desc.stride[i] = width + padding;
+        img->desc.offset[i] = 64 * (i + 1);
+        img->planes[i].reset(new MappedBuffer(img->desc.offset[i] +
+                                              static_cast<size_t>(img->desc.stride[i]) * plane_height[i]));
+        img->desc.base[i] = img->planes[i]->valid() ? img->planes[i]->data() : NULL;
+    }
+}
+
+uint8_t *row(const Image &img, int plane, uint32_t y)
+{
+    return static_cast<uint8_t *>(img.desc.base[plane]) + img.desc.offset[plane] +
+           static_cast<size_t>(y) * img.desc.stride[plane];
+}
+
+void fillPattern(const Image &img)
+{
+    for (uint32_t y = 0; y < img.desc.height; y++)
+        for (uint32_t x = 0; x < img.desc.width; x++)
+            row(img, 0, y)[x] = static_cast<uint8_t>((x * 3 + y * 5) ^ (x * y));
+
+    for (uint32_t y = 0; y < img.desc.height / 2; y++)
+        for (uint32_t x = 0; x < img.desc.width; x++)
+            row(img, 1, y)[x] = static_cast<uint8_t>(x & 1 ? 255 - x - y : x * 2 + y);
+}
+
+/* Source span of output index i when mapping n samples to m */
+void span(uint32_t i, uint32_t n, uint32_t m, uint32_t *s0, uint32_t *s1)
+{
+    *s0 = static_cast<uint64_t>(i) * n / m;
+    *s1 = std::max<uint32_t>(static_cast<uint64_t>(i + 1) * n / m, *s0 + 1);
+}
+
+uint8_t average(const Image &src, int plane, uint32_t left, uint32_t top, uint32_t x0, uint32_t x1,
+                uint32_t y0, uint32_t y1, int components, int c)
+{
+    uint32_t sum = 0, n = 0;
+
+    for (uint32_t y = y0; y < y1; y++) {
+        for (uint32_t x = x0; x < x1; x++, n++)
+            sum += row(src, plane, top + y)[left + x * components + c];
+    }
+
+    return (sum + n / 2) / n;
+}
+
+void expectScaled(const Image &src, const exynos_thumbnail_crop_t &crop, const Image &dst)
+{
+    const uint32_t dw = dst.desc.width, dh = dst.desc.height;
+
+    for (uint32_t y = 0; y < dh; y++) {
+        uint32_t y0, y1;
+        span(y, crop.height, dh, &y0, &y1);
+        for (uint32_t x = 0; x < dw; x++) {
+            uint32_t x0, x1;
+            span(x, crop.width, dw, &x0, &x1);
+            ASSERT_EQ(average(src, 0, crop.left, crop.top, x0, x1, y0, y1, 1, 0), row(dst, 0, y)[x])
+                << "luma " << x << "," << y;
+        }
+    }
+
+    const bool swap = src.desc.nv21 != dst.desc.nv21;
+    for (uint32_t y = 0; y < dh / 2; y++) {
+        uint32_t y0, y1;
+        span(y, crop.height / 2, dh / 2, &y0, &y1);
+        for (uint32_t x = 0; x < dw / 2; x++) {
+            uint32_t x0, x1;
+            span(x, crop.width / 2, dw / 2, &x0, &x1);
+            for (int c = 0; c < 2; c++) {
+                ASSERT_EQ(average(src, 1, crop.left, crop.top / 2, x0, x1, y0, y1, 2, c),
+                          row(dst, 1, y)[x * 2 + (swap ? 1 - c : c)])
+                    << "chroma " << x << "," << y << " component " << c;
+            }
+        }
+    }
+}
+
+TEST(ExynosThumbnail, ScalesMemfdBuffers)
+{
+    Image src, dst;
+    makeImage(&src, 1008, 756, false, 48);
+    makeImage(&dst, 320, 240, false, 64);
+    ASSERT_NE(nullptr, src.desc.base[0]);
+    ASSERT_NE(nullptr, src.desc.base[1]);
+    ASSERT_NE(nullptr, dst.desc.base[0]);
+    ASSERT_NE(nullptr, dst.desc.base[1]);
+    fillPattern(src);
+
+    ExynosThumbnailScaler scaler;
+    ASSERT_EQ(0, scaler.scale(&src.desc, NULL, &dst.desc));
+    expectScaled(src, { 0, 0, src.desc.width, src.desc.height }, dst);
+}
+
+TEST(ExynosThumbnail, ScalesCropAndSwapsChroma)
+{
+    Image src, dst;
+    makeImage(&src, 640, 480, true, 0);
+    makeImage(&dst, 96, 72, false, 32);
+    ASSERT_NE(nullptr, src.desc.base[1]);
+    ASSERT_NE(nullptr, dst.desc.base[1]);
+    fillPattern(src);
+
+    /* Odd origin: rounded down to even, the size grows to keep the edge */
+    const exynos_thumbnail_crop_t crop = { 33, 21, 400, 300 };
+    ExynosThumbnailScaler scaler;
+    ASSERT_EQ(0, scaler.scale(&src.desc, &crop, &dst.desc));
+    expectScaled(src, { 32, 20, 401, 301 }, dst);
+}
+
+TEST(ExynosThumbnail, RejectsInvalidArguments)
+{
+    Image src, dst;
+    makeImage(&src, 640, 480, false, 0);
+    makeImage(&dst, 161, 120, false, 0);
+
+    ExynosThumbnailScaler scaler;
+    EXPECT_EQ(-EINVAL, scaler.scale(&src.desc, NULL, &dst.desc));
+
+    dst.desc.width = 160;
+    const exynos_thumbnail_crop_t crop = { 600, 0, 100, 100 };
+    EXPECT_EQ(-EINVAL, scaler.scale(&src.desc, &crop, &dst.desc));
+    EXPECT_EQ(-EINVAL, scaler.scale(NULL, NULL, &dst.desc));
+}
+
+TEST(ExynosThumbnail, WorkerMatchesScaler)
+{
+    Image src, dst, expected;
+    makeImage(&src, 1280, 720, false, 16);
+    makeImage(&dst, 256, 144, true, 0);
+    makeImage(&expected, 256, 144, true, 0);
+    ASSERT_NE(nullptr, dst.desc.base[1]);
+    ASSERT_NE(nullptr, expected.desc.base[1]);
+    fillPattern(src);
+
+    ExynosThumbnailScaler scaler;
+    ASSERT_EQ(0, scaler.scale(&src.desc, NULL, &expected.desc));
+
+    ExynosThumbnailWorker worker;
+    ASSERT_EQ(0, worker.start(&src.desc, NULL, &dst.desc));
+    ASSERT_EQ(0, worker.wait());
+    for (int i = 0; i < 2; i++) {
+        const size_t size = static_cast<size_t>(dst.desc.stride[i]) * dst.desc.height / (i + 1);
+        EXPECT_EQ(0, memcmp(row(expected, i, 0), row(dst, i, 0), size)) << "plane " << i;
+    }
+}
+
+TEST(ExynosThumbnail, WorkerIsBusyUntilWaitedFor)
+{
+    Image src, dst;
+    makeImage(&src, 640, 480, false, 0);
+    makeImage(&dst, 160, 120, false, 0);
+    fillPattern(src);
+
+    ExynosThumbnailWorker worker;
+    EXPECT_EQ(-EINVAL, worker.wait());
+
+    ASSERT_EQ(0, worker.start(&src.desc, NULL, &dst.desc));
+    /* Finished or not, the job stays pending until its result is taken */
+    EXPECT_EQ(-EBUSY, worker.start(&src.desc, NULL, &dst.desc));
+    EXPECT_EQ(0, worker.wait());
+    EXPECT_EQ(-EINVAL, worker.wait());
+
+    /* A failed job reports its own result, not the previous one */
+    dst.desc.width = 161;
+    ASSERT_EQ(0, worker.start(&src.desc, NULL, &dst.desc));
+    EXPECT_EQ(-EINVAL, worker.wait());
+    dst.desc.width = 160;
+    ASSERT_EQ(0, worker.start(&src.desc, NULL, &dst.desc));
+    EXPECT_EQ(0, worker.wait());
+}
+
+} // namespace
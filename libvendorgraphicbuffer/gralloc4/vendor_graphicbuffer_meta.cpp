@@ -185,6 +185,7 @@ GRALLOC_META_GETTER(int, height, height);
 GRALLOC_META_GETTER(uint32_t, stride, stride);
 GRALLOC_META_GETTER(uint32_t, stride_in_bytes, plane_info[0].byte_stride);
 GRALLOC_META_GETTER(uint32_t, vstride, plane_info[0].alloc_height);
+GRALLOC_META_GETTER(uint32_t, layer_count, layer_count);
 
 GRALLOC_META_GETTER(uint64_t, producer_usage, producer_usage);
 GRALLOC_META_GETTER(uint64_t, consumer_usage, consumer_usage);
@@ -413,6 +414,74 @@ int VendorGraphicBufferMeta::free_buffer(buffer_handle_t hnd)
 	return 0;
 }
 
+/* GchipsMetadataType::LOCK_LAYER, see hidl_common/MapperMetadata.h */
+static const MapperMetadataType MetadataType_LockLayer = { "vendor.google.gchips.GchipsMetadataType", 0x10000 + 5 };
+
+int VendorGraphicBufferMeta::lock_layer(buffer_handle_t hnd, uint64_t usage, const android::Rect &bounds,
+		uint32_t layer, void **vaddr)
+{
+	native_handle_t* handle = const_cast<native_handle_t*>(hnd);
+	if (!handle || !vaddr) {
+		return -EINVAL;
+	}
+
+	/*
+	 * The selection is per thread and taken by the next lock, so both calls must go to the
+	 * same (passthrough) mapper instance from this thread.
+	 */
+	const int32_t value = static_cast<int32_t>(layer);
+	const uint8_t *begin = reinterpret_cast<const uint8_t *>(&value);
+	android::hardware::hidl_vec<uint8_t> vec(begin, begin + sizeof(value));
+	Error error = get_mapper()->set(handle, MetadataType_LockLayer, vec);
+	if (error != Error::NONE) {
+		ALOGE("[%s] Failed to select layer %u", __FUNCTION__, layer);
+		return -EINVAL;
+	}
+
+	const IMapper::Rect region = { bounds.left, bounds.top, bounds.width(), bounds.height() };
+	get_mapper()->lock(handle, usage, region, android::hardware::hidl_handle(),
+			[&](const auto& tmpError, const auto& tmpData) {
+				error = tmpError;
+				if (error != Error::NONE) {
+					return;
+				}
+				*vaddr = tmpData;
+			});
+
+	if (error != Error::NONE) {
+		ALOGE("[%s] Failed to lock layer %u", __FUNCTION__, layer);
+		/* Do not leave the selection to a later lock of this thread */
+		const int32_t all = -1;
+		const uint8_t *all_begin = reinterpret_cast<const uint8_t *>(&all);
+		get_mapper()->set(handle, MetadataType_LockLayer,
+		                  android::hardware::hidl_vec<uint8_t>(all_begin, all_begin + sizeof(all)));
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int VendorGraphicBufferMeta::unlock(buffer_handle_t hnd)
+{
+	native_handle_t* handle = const_cast<native_handle_t*>(hnd);
+	if (!handle) {
+		return -EINVAL;
+	}
+
+	/* Unlock here completes synchronously, it never returns a release fence */
+	Error error = Error::NONE;
+	get_mapper()->unlock(handle, [&](const auto& tmpError, const auto& /*tmpFence*/) {
+				error = tmpError;
+			});
+
+	if (error != Error::NONE) {
+		ALOGE("[%s] Failed to unlock buffer", __FUNCTION__);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 VendorGraphicBufferMeta::VendorGraphicBufferMeta(buffer_handle_t handle)
 {
 	init(handle);
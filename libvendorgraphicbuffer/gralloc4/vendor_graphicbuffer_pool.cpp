@@ -0,0 +1,385 @@
+/*
+ * Copyright (C) 2020 Samsung Electronics Co. Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VendorGraphicBufferPool"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <log/log.h>
+#include <utils/String8.h>
+
+#include "VendorGraphicBufferPool.h"
+
+using namespace android;
+using namespace vendor::graphics;
+
+static constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+
+std::unique_ptr<VendorGraphicBufferPool> VendorGraphicBufferPool::create(const Config &config)
+{
+	if (config.max_count == 0 || config.min_count > config.max_count ||
+	    config.width == 0 || config.height == 0 || config.layer_count == 0) {
+		ALOGE("[%s] %s: invalid config %ux%u format %d, count %u..%u", __FUNCTION__, config.name.c_str(),
+		      config.width, config.height, config.format, config.min_count, config.max_count);
+		return nullptr;
+	}
+
+	return std::unique_ptr<VendorGraphicBufferPool>(new VendorGraphicBufferPool(config));
+}
+
+VendorGraphicBufferPool::VendorGraphicBufferPool(const Config &config)
+	: mConfig(config),
+	  mSlots(new Slot[config.max_count]),
+	  mFreeHead(INVALID_SLOT),
+	  mLastAcquire(systemTime(SYSTEM_TIME_MONOTONIC))
+{
+	mEmptySlots.reserve(mConfig.max_count);
+	for (uint32_t id = mConfig.max_count; id > 0; id--)
+		mEmptySlots.push_back(id - 1);
+
+	mWorker = std::thread(&VendorGraphicBufferPool::worker, this);
+}
+
+VendorGraphicBufferPool::~VendorGraphicBufferPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+		mExit = true;
+	}
+	mWorkerCond.notify_one();
+	mFreeCond.notify_all();
+	mWorker.join();
+
+	uint32_t outstanding = 0;
+	for (uint32_t id = 0; id < mConfig.max_count; id++) {
+		switch (mSlots[id].state.load(std::memory_order_acquire)) {
+		case SLOT_FREE:
+			free_slot(id);
+			break;
+		case SLOT_ACQUIRED:
+			outstanding++;
+			break;
+		default:
+			break;
+		}
+	}
+
+	/* Still in use by the pipeline: leaking is safer than freeing under it */
+	if (outstanding)
+		ALOGW("[%s] %s: destroyed with %u buffers still acquired", __FUNCTION__, mConfig.name.c_str(),
+		      outstanding);
+}
+
+uint32_t VendorGraphicBufferPool::pop_free()
+{
+	uint64_t head = mFreeHead.load(std::memory_order_acquire);
+
+	for (;;) {
+		uint32_t id = static_cast<uint32_t>(head);
+		if (id == INVALID_SLOT)
+			return INVALID_SLOT;
+
+		/* Slots are never deallocated, so reading a stale next is harmless; the tag catches it */
+		uint64_t next = ((head >> 32) + 1) << 32 | mSlots[id].next.load(std::memory_order_relaxed);
+		if (mFreeHead.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+			mFreeCount.fetch_sub(1, std::memory_order_relaxed);
+			return id;
+		}
+	}
+}
+
+void VendorGraphicBufferPool::push_free(uint32_t id)
+{
+	uint64_t head = mFreeHead.load(std::memory_order_relaxed);
+	uint64_t next;
+
+	/* Counted before publishing so a racing pop_free() cannot wrap the count */
+	mFreeCount.fetch_add(1, std::memory_order_relaxed);
+	do {
+		mSlots[id].next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+		next = ((head >> 32) + 1) << 32 | id;
+	} while (!mFreeHead.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void VendorGraphicBufferPool::request_grow()
+{
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+		mGrowRequested = true;
+	}
+	mWorkerCond.notify_one();
+}
+
+void VendorGraphicBufferPool::notify_waiters()
+{
+	if (mWaiters.load(std::memory_order_acquire) == 0)
+		return;
+
+	/* Taking the lock orders the wake up against a waiter about to sleep */
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+	}
+	mFreeCond.notify_all();
+}
+
+int VendorGraphicBufferPool::acquire(Buffer *out, nsecs_t timeout)
+{
+	uint32_t id = pop_free();
+
+	mLastAcquire.store(systemTime(SYSTEM_TIME_MONOTONIC), std::memory_order_relaxed);
+	mAcquires.fetch_add(1, std::memory_order_relaxed);
+
+	if (id == INVALID_SLOT) {
+		mMisses.fetch_add(1, std::memory_order_relaxed);
+		request_grow();
+		if (timeout <= 0)
+			return -EAGAIN;
+
+		std::unique_lock<std::mutex> lock(mLock);
+		mWaiters.fetch_add(1, std::memory_order_acq_rel);
+		mFreeCond.wait_for(lock, std::chrono::nanoseconds(timeout), [&]() {
+			id = pop_free();
+			return id != INVALID_SLOT || mExit;
+		});
+		mWaiters.fetch_sub(1, std::memory_order_relaxed);
+
+		if (id == INVALID_SLOT)
+			return -ETIMEDOUT;
+	} else if (mFreeCount.load(std::memory_order_relaxed) < mConfig.low_watermark &&
+		   mAllocated.load(std::memory_order_relaxed) < mConfig.max_count) {
+		/* Grow ahead of the next miss */
+		request_grow();
+	}
+
+	Slot &slot = mSlots[id];
+	slot.state.store(SLOT_ACQUIRED, std::memory_order_relaxed);
+	out->handle = slot.handle;
+	out->stride = slot.stride;
+	out->id = id;
+
+	return 0;
+}
+
+int VendorGraphicBufferPool::release(const Buffer &buffer)
+{
+	uint8_t expected = SLOT_ACQUIRED;
+
+	if (buffer.id >= mConfig.max_count || mSlots[buffer.id].handle != buffer.handle ||
+	    !mSlots[buffer.id].state.compare_exchange_strong(expected, SLOT_FREE, std::memory_order_release)) {
+		ALOGE("[%s] %s: buffer %u was not acquired from this pool", __FUNCTION__, mConfig.name.c_str(), buffer.id);
+		return -EINVAL;
+	}
+
+	push_free(buffer.id);
+	notify_waiters();
+
+	return 0;
+}
+
+bool VendorGraphicBufferPool::matches_config(buffer_handle_t handle) const
+{
+	const uint32_t width = VendorGraphicBufferMeta::get_width(handle);
+	const uint32_t height = VendorGraphicBufferMeta::get_height(handle);
+	const uint64_t format = VendorGraphicBufferMeta::get_frameworkFormat(handle);
+	const uint32_t layer_count = VendorGraphicBufferMeta::get_layer_count(handle);
+	const uint64_t usage = VendorGraphicBufferMeta::get_usage(handle);
+
+	/* Extra usage bits are fine, acquirers only rely on the configured ones */
+	if (width != mConfig.width || height != mConfig.height ||
+	    format != static_cast<uint64_t>(mConfig.format) || layer_count != mConfig.layer_count ||
+	    (usage & mConfig.usage) != mConfig.usage) {
+		ALOGE("[%s] %s: buffer %ux%u format %" PRIu64 " layers %u usage 0x%" PRIx64
+		      " does not match %ux%u format %d layers %u usage 0x%" PRIx64, __FUNCTION__,
+		      mConfig.name.c_str(), width, height, format, layer_count, usage, mConfig.width,
+		      mConfig.height, mConfig.format, mConfig.layer_count, mConfig.usage);
+		return false;
+	}
+
+	return true;
+}
+
+int VendorGraphicBufferPool::adopt(buffer_handle_t raw_handle, uint32_t stride)
+{
+	uint32_t id;
+
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+		if (mEmptySlots.empty())
+			return -ENOSPC;
+		id = mEmptySlots.back();
+		mEmptySlots.pop_back();
+	}
+
+	buffer_handle_t handle = VendorGraphicBufferMeta::import_buffer(raw_handle);
+	if (handle != nullptr && !matches_config(handle)) {
+		VendorGraphicBufferMeta::free_buffer(handle);
+		handle = nullptr;
+	}
+	if (handle == nullptr) {
+		std::lock_guard<std::mutex> lock(mLock);
+		mEmptySlots.push_back(id);
+		return -EINVAL;
+	}
+
+	Slot &slot = mSlots[id];
+	slot.handle = handle;
+	slot.stride = stride;
+	slot.imported = true;
+	slot.state.store(SLOT_FREE, std::memory_order_relaxed);
+	mAllocated.fetch_add(1, std::memory_order_relaxed);
+
+	push_free(id);
+	notify_waiters();
+
+	return 0;
+}
+
+bool VendorGraphicBufferPool::wait_for_free(uint32_t count, nsecs_t timeout)
+{
+	if (count > mConfig.max_count)
+		return false;
+
+	std::unique_lock<std::mutex> lock(mLock);
+	mTargetFree.store(count, std::memory_order_relaxed);
+	mGrowRequested = true;
+	mWorkerCond.notify_one();
+
+	mWaiters.fetch_add(1, std::memory_order_acq_rel);
+	bool ready = mFreeCond.wait_for(lock, std::chrono::nanoseconds(timeout), [&]() {
+		return mFreeCount.load(std::memory_order_relaxed) >= count || mExit;
+	});
+	mWaiters.fetch_sub(1, std::memory_order_relaxed);
+	mTargetFree.store(0, std::memory_order_relaxed);
+
+	return ready && !mExit;
+}
+
+bool VendorGraphicBufferPool::grow()
+{
+	bool grew = false;
+
+	for (;;) {
+		uint32_t allocated = mAllocated.load(std::memory_order_relaxed);
+		uint32_t target = std::max(mConfig.low_watermark, mTargetFree.load(std::memory_order_relaxed));
+		uint32_t id;
+
+		if (allocated >= mConfig.min_count && mFreeCount.load(std::memory_order_relaxed) >= target)
+			break;
+
+		{
+			std::lock_guard<std::mutex> lock(mLock);
+			if (mExit || mEmptySlots.empty())
+				break;
+			id = mEmptySlots.back();
+			mEmptySlots.pop_back();
+		}
+
+		Slot &slot = mSlots[id];
+		buffer_handle_t handle = nullptr;
+		uint32_t stride = 0;
+		status_t err = VendorGraphicBufferAllocator::get().allocate(mConfig.width, mConfig.height,
+				mConfig.format, mConfig.layer_count, mConfig.usage, &handle, &stride, mConfig.name);
+		if (err != NO_ERROR || handle == nullptr) {
+			ALOGE("[%s] %s: allocation failed (%d) with %u buffers", __FUNCTION__, mConfig.name.c_str(), err,
+			      allocated);
+			std::lock_guard<std::mutex> lock(mLock);
+			mEmptySlots.push_back(id);
+			break;
+		}
+
+		slot.handle = handle;
+		slot.stride = stride;
+		slot.imported = false;
+		slot.state.store(SLOT_FREE, std::memory_order_relaxed);
+		mAllocated.fetch_add(1, std::memory_order_relaxed);
+		mGrown.fetch_add(1, std::memory_order_relaxed);
+
+		push_free(id);
+		notify_waiters();
+		grew = true;
+	}
+
+	return grew;
+}
+
+void VendorGraphicBufferPool::free_slot(uint32_t id)
+{
+	Slot &slot = mSlots[id];
+
+	if (slot.imported)
+		VendorGraphicBufferMeta::free_buffer(slot.handle);
+	else
+		VendorGraphicBufferAllocator::get().free(slot.handle);
+
+	slot.handle = nullptr;
+	slot.stride = 0;
+	slot.imported = false;
+	slot.state.store(SLOT_EMPTY, std::memory_order_relaxed);
+}
+
+void VendorGraphicBufferPool::shrink_if_idle()
+{
+	nsecs_t idle = systemTime(SYSTEM_TIME_MONOTONIC) - mLastAcquire.load(std::memory_order_relaxed);
+
+	if (mConfig.idle_timeout <= 0 || idle < mConfig.idle_timeout)
+		return;
+
+	while (mAllocated.load(std::memory_order_relaxed) > mConfig.min_count) {
+		uint32_t id = pop_free();
+		if (id == INVALID_SLOT)
+			break;
+
+		free_slot(id);
+		mAllocated.fetch_sub(1, std::memory_order_relaxed);
+		mShrunk.fetch_add(1, std::memory_order_relaxed);
+
+		std::lock_guard<std::mutex> lock(mLock);
+		mEmptySlots.push_back(id);
+	}
+}
+
+void VendorGraphicBufferPool::worker()
+{
+	std::unique_lock<std::mutex> lock(mLock);
+
+	while (!mExit) {
+		mGrowRequested = false;
+		lock.unlock();
+
+		grow();
+		shrink_if_idle();
+
+		lock.lock();
+		if (mExit || mGrowRequested)
+			continue;
+
+		if (mConfig.idle_timeout > 0)
+			mWorkerCond.wait_for(lock, std::chrono::nanoseconds(mConfig.idle_timeout));
+		else
+			mWorkerCond.wait(lock);
+	}
+}
+
+std::string VendorGraphicBufferPool::dump() const
+{
+	return std::string(String8::format("%s: %ux%u format %d usage %#" PRIx64 ", %u/%u allocated (min %u), %u free, "
+			"acquires %" PRIu64 " (misses %" PRIu64 "), grown %" PRIu64 ", shrunk %" PRIu64 "\n",
+			mConfig.name.c_str(), mConfig.width, mConfig.height, mConfig.format, mConfig.usage,
+			allocated_count(), mConfig.max_count, mConfig.min_count, free_count(),
+			mAcquires.load(std::memory_order_relaxed), mMisses.load(std::memory_order_relaxed),
+			mGrown.load(std::memory_order_relaxed), mShrunk.load(std::memory_order_relaxed)).c_str());
+}
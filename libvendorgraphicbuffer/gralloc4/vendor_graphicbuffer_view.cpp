@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2020 Samsung Electronics Co. Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VendorGraphicBufferView"
+
+#include <BufferAllocator/BufferAllocator.h>
+#include <cinttypes>
+#include <cutils/native_handle.h>
+#include <log/log.h>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "VendorGraphicBufferView.h"
+#include "mali_gralloc_buffer.h"
+#include "mali_gralloc_formats.h"
+#include "hidl_common/SharedMetadata_struct.h"
+#include "exynos_format.h"
+
+using namespace android;
+using namespace vendor::graphics;
+
+using arm::mapper::common::shared_metadata;
+
+static const char kMetadataHeapName[] = "system";
+
+/* Usages that size or interpret the metadata region of the parent */
+static constexpr uint64_t kParentOnlyUsage = VendorGraphicBufferUsage::ROIINFO;
+
+uint32_t VendorGraphicBufferView::bytes_per_pixel(int32_t format)
+{
+	switch (format) {
+	case MALI_GRALLOC_FORMAT_INTERNAL_R_8:
+	case MALI_GRALLOC_FORMAT_INTERNAL_Y8:
+	case MALI_GRALLOC_FORMAT_INTERNAL_BLOB:
+		return 1;
+	case MALI_GRALLOC_FORMAT_INTERNAL_Y16:
+	case MALI_GRALLOC_FORMAT_INTERNAL_RAW16:
+		return 2;
+	case MALI_GRALLOC_FORMAT_INTERNAL_RGB_888:
+		return 3;
+	case MALI_GRALLOC_FORMAT_INTERNAL_RGBA_8888:
+	case MALI_GRALLOC_FORMAT_INTERNAL_RGBX_8888:
+	case MALI_GRALLOC_FORMAT_INTERNAL_BGRA_8888:
+	case MALI_GRALLOC_FORMAT_INTERNAL_RGBA_1010102:
+		return 4;
+	case MALI_GRALLOC_FORMAT_INTERNAL_RGBA_16161616:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+/* Allocates and initializes the view's own metadata region, returns its fd */
+static int alloc_view_metadata(uint64_t size, const std::string &name)
+{
+	static BufferAllocator allocator;
+
+	int fd = allocator.Alloc(kMetadataHeapName, size);
+	if (fd < 0) {
+		ALOGE("[%s] metadata allocation of %" PRIu64 " bytes failed: %d", __FUNCTION__, size, fd);
+		return -1;
+	}
+
+	void *vaddr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (vaddr == MAP_FAILED) {
+		ALOGE("[%s] metadata mmap failed", __FUNCTION__);
+		close(fd);
+		return -1;
+	}
+
+	memset(vaddr, 0, size);
+	new (vaddr) shared_metadata(name);
+	munmap(vaddr, size);
+
+	return fd;
+}
+
+native_handle_t *VendorGraphicBufferView::create(buffer_handle_t parent, const Config &config)
+{
+	if (private_handle_t::validate(parent) < 0) {
+		ALOGE("[%s] invalid parent handle %p", __FUNCTION__, parent);
+		return nullptr;
+	}
+	const auto *hnd = static_cast<const private_handle_t *>(parent);
+
+	if ((hnd->alloc_format & MALI_GRALLOC_INTFMT_EXT_MASK) != 0 ||
+	    is_sbwc_format(hnd->alloc_format & MALI_GRALLOC_INTFMT_FMT_MASK)) {
+		ALOGE("[%s] %s: cannot alias a compressed parent (format %#" PRIx64 ")", __FUNCTION__,
+		      config.name.c_str(), hnd->alloc_format);
+		return nullptr;
+	}
+
+	if (config.plane >= MAX_PLANES || hnd->plane_info[config.plane].byte_stride == 0 ||
+	    hnd->plane_info[config.plane].fd_idx >= (uint32_t)hnd->fd_count) {
+		ALOGE("[%s] %s: parent has no plane %u", __FUNCTION__, config.name.c_str(), config.plane);
+		return nullptr;
+	}
+	const plane_info_t &parent_plane = hnd->plane_info[config.plane];
+
+	const uint32_t bpp = bytes_per_pixel(config.format);
+	const uint32_t byte_stride = config.byte_stride ? config.byte_stride : parent_plane.byte_stride;
+	const uint64_t row_size = static_cast<uint64_t>(config.width) * bpp;
+	if (bpp == 0 || config.width == 0 || config.height == 0 || byte_stride < row_size) {
+		ALOGE("[%s] %s: invalid view %ux%u format %d stride %u", __FUNCTION__, config.name.c_str(),
+		      config.width, config.height, config.format, byte_stride);
+		return nullptr;
+	}
+
+	/* The whole view, last row without its padding, must lie within the parent plane */
+	const uint64_t parent_size = parent_plane.size ? parent_plane.size
+	                                               : static_cast<uint64_t>(parent_plane.byte_stride) *
+	                                                 parent_plane.alloc_height;
+	const uint64_t view_size = static_cast<uint64_t>(config.height - 1) * byte_stride + row_size;
+	if (config.offset > parent_size || view_size > parent_size - config.offset ||
+	    parent_plane.offset + config.offset + view_size > hnd->alloc_sizes[parent_plane.fd_idx]) {
+		ALOGE("[%s] %s: view of %" PRIu64 " bytes at %" PRIu64 " is outside plane %u (%" PRIu64 " bytes)",
+		      __FUNCTION__, config.name.c_str(), view_size, config.offset, config.plane, parent_size);
+		return nullptr;
+	}
+
+	plane_info_t plane_info[MAX_PLANES] = {};
+	plane_info[0].offset = parent_plane.offset + config.offset;
+	plane_info[0].fd_idx = parent_plane.fd_idx;
+	plane_info[0].size = view_size;
+	plane_info[0].byte_stride = byte_stride;
+	plane_info[0].alloc_width = byte_stride / bpp;
+	plane_info[0].alloc_height = config.height;
+
+	/* Share every data fd so the fd layout and sizes still match the dmabufs */
+	int fds[MAX_FDS];
+	memset(fds, -1, sizeof(fds));
+	for (int i = 0; i < hnd->fd_count; i++) {
+		fds[i] = dup(hnd->fds[i]);
+		if (fds[i] < 0) {
+			ALOGE("[%s] %s: failed to dup fd %d", __FUNCTION__, config.name.c_str(), i);
+			for (int j = 0; j < i; j++)
+				close(fds[j]);
+			return nullptr;
+		}
+	}
+
+	const uint64_t attr_size = sizeof(shared_metadata);
+	fds[hnd->fd_count] = alloc_view_metadata(attr_size, config.name);
+	if (fds[hnd->fd_count] < 0) {
+		for (int i = 0; i < hnd->fd_count; i++)
+			close(fds[i]);
+		return nullptr;
+	}
+
+	const uint64_t usage = (config.usage ? config.usage : hnd->get_usage()) & ~kParentOnlyUsage;
+	uint64_t alloc_sizes[MAX_BUFFER_FDS];
+	memcpy(alloc_sizes, hnd->alloc_sizes, sizeof(alloc_sizes));
+
+	const int num_ints = NUM_INTS_IN_PRIVATE_HANDLE - (hnd->fd_count + 1);
+	native_handle_t *handle = native_handle_create(hnd->fd_count + 1, num_ints);
+	if (handle == nullptr) {
+		for (int i = 0; i <= hnd->fd_count; i++)
+			close(fds[i]);
+		return nullptr;
+	}
+
+	const int flags = hnd->flags | private_handle_t::PRIV_FLAGS_VIEW;
+	auto *view = new (handle) private_handle_t(flags, alloc_sizes, usage, usage, fds, hnd->fd_count,
+	                                           config.format, config.format, config.width, config.height,
+	                                           plane_info[0].alloc_width, 1, plane_info);
+	view->incr_numfds(1);
+	view->attr_size = attr_size;
+	view->reserved_region_size = 0;
+	view->backing_store_id = hnd->backing_store_id;
+	view->imapper_version = hnd->imapper_version;
+
+	return view;
+}
+
+native_handle_t *VendorGraphicBufferView::create_plane(buffer_handle_t parent, uint32_t plane, int32_t format,
+                                                       uint32_t width, uint32_t height)
+{
+	Config config;
+	config.plane = plane;
+	config.format = format;
+	config.width = width;
+	config.height = height;
+
+	return create(parent, config);
+}
+
+native_handle_t *VendorGraphicBufferView::create_crop(buffer_handle_t parent, uint32_t left, uint32_t top,
+                                                      uint32_t width, uint32_t height)
+{
+	if (private_handle_t::validate(parent) < 0)
+		return nullptr;
+	const auto *hnd = static_cast<const private_handle_t *>(parent);
+
+	const int32_t format = static_cast<int32_t>(hnd->alloc_format & MALI_GRALLOC_INTFMT_FMT_MASK);
+	const uint32_t bpp = bytes_per_pixel(format);
+	if (hnd->is_multi_plane() || bpp == 0 ||
+	    left + static_cast<uint64_t>(width) > static_cast<uint64_t>(hnd->width) ||
+	    top + static_cast<uint64_t>(height) > static_cast<uint64_t>(hnd->height)) {
+		ALOGE("[%s] crop %ux%u at %u,%u does not fit in %dx%d format %d", __FUNCTION__,
+		      width, height, left, top, hnd->width, hnd->height, format);
+		return nullptr;
+	}
+
+	Config config;
+	config.offset = static_cast<uint64_t>(top) * hnd->plane_info[0].byte_stride + static_cast<uint64_t>(left) * bpp;
+	config.format = format;
+	config.width = width;
+	config.height = height;
+
+	return create(parent, config);
+}
+
+void VendorGraphicBufferView::destroy(native_handle_t *view)
+{
+	if (!view)
+		return;
+
+	native_handle_close(view);
+	native_handle_delete(view);
+}
@@ -50,6 +50,7 @@ enum VendorGraphicBufferUsage {
 	PRIVATE_NONSECURE               = 1ULL << 59,
 	VIDEO_PRIVATE_DATA              = 1ULL << 60,
 /* Google-specific usages */
+	CONTENT_FINGERPRINT             = 1ULL << 48,  /* identical to GRALLOC_USAGE_CONTENT_FINGERPRINT */
 	CAMERA_STATS                    = 1ULL << 30,
 	TPU_OUTPUT                      = 1ULL << 31,
 	TPU_INPUT                       = 1ULL << 62
@@ -66,6 +67,7 @@ public:
 	{
 		PRIV_FLAGS_USES_2PRIVATE_DATA = 1U << 4,
 		PRIV_FLAGS_USES_3PRIVATE_DATA = 1U << 5,
+		PRIV_FLAGS_VIEW = 1U << 6,
 	};
 
 	union {
@@ -131,6 +133,7 @@ public:
 	static uint32_t get_stride(buffer_handle_t);
 	static uint32_t get_stride_in_bytes(buffer_handle_t);
 	static uint32_t get_vstride(buffer_handle_t);
+	static uint32_t get_layer_count(buffer_handle_t);
 	static uint64_t get_producer_usage(buffer_handle_t);
 	static uint64_t get_consumer_usage(buffer_handle_t);
 	static uint64_t get_flags(buffer_handle_t);
@@ -155,6 +158,15 @@ public:
 
 	static buffer_handle_t import_buffer(buffer_handle_t);
 	static int free_buffer(buffer_handle_t);
+
+	/*
+	 * CPU lock of one layer of an imported single fd multi-layer buffer: maps only that
+	 * layer and returns its address. Safe to call from several threads at once, each
+	 * locking its own layer. Release with unlock().
+	 */
+	static int lock_layer(buffer_handle_t, uint64_t usage, const android::Rect &bounds,
+	                      uint32_t layer, void **vaddr);
+	static int unlock(buffer_handle_t);
 };
 
 typedef class android::GraphicBufferMapper VendorGraphicBufferMapper;
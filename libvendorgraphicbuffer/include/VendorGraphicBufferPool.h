@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2020 Samsung Electronics Co. Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VENDOR_GRAPHIC_BUFFER_POOL_H_
+#define VENDOR_GRAPHIC_BUFFER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <utils/Timers.h>
+
+#include "VendorGraphicBuffer.h"
+
+namespace vendor {
+namespace graphics {
+
+/*
+ * A pool of identical gralloc buffers for a camera/video pipeline stage.
+ *
+ * acquire() and release() pop and push a lock-free free list and never
+ * call into the allocator. A background thread allocates min_count buffers
+ * up front, allocates more (up to max_count) when fewer than low_watermark
+ * buffers are free, and frees the extra ones once the pool has not been
+ * used for idle_timeout. Buffers allocated elsewhere can be handed to the
+ * pool with adopt().
+ */
+class VendorGraphicBufferPool {
+public:
+	struct Config {
+		uint32_t width = 0;
+		uint32_t height = 0;
+		int32_t format = 0;
+		uint32_t layer_count = 1;
+		uint64_t usage = 0;
+
+		uint32_t min_count = 0;
+		uint32_t max_count = 0;
+		uint32_t low_watermark = 1;
+		nsecs_t idle_timeout = ms2ns(2000);
+
+		std::string name = "VendorGraphicBufferPool";
+	};
+
+	struct Buffer {
+		buffer_handle_t handle = nullptr;
+		uint32_t stride = 0;
+		uint32_t id = UINT32_MAX;
+	};
+
+	/* Returns nullptr if the configuration is invalid */
+	static std::unique_ptr<VendorGraphicBufferPool> create(const Config &config);
+
+	~VendorGraphicBufferPool();
+
+	/*
+	 * Takes a free buffer. With timeout 0 returns -EAGAIN right away when
+	 * none is free, otherwise waits up to timeout for a release or for the
+	 * pool to grow and returns -ETIMEDOUT.
+	 */
+	int acquire(Buffer *out, nsecs_t timeout = 0);
+	int release(const Buffer &buffer);
+
+	/*
+	 * Imports a buffer from another process or HAL into the pool; it is
+	 * freed with the pool. Returns -ENOSPC when max_count is reached and
+	 * -EINVAL when the buffer cannot be imported or its width, height,
+	 * format or layer count differ from the Config, or it lacks some of
+	 * the Config usage bits.
+	 */
+	int adopt(buffer_handle_t raw_handle, uint32_t stride);
+
+	/* Blocks until at least count buffers are free or timeout expires */
+	bool wait_for_free(uint32_t count, nsecs_t timeout);
+
+	uint32_t allocated_count() const { return mAllocated.load(std::memory_order_relaxed); }
+	uint32_t free_count() const { return mFreeCount.load(std::memory_order_relaxed); }
+
+	std::string dump() const;
+
+private:
+	enum SlotState : uint8_t {
+		SLOT_EMPTY,
+		SLOT_FREE,
+		SLOT_ACQUIRED,
+	};
+
+	struct Slot {
+		buffer_handle_t handle = nullptr;
+		uint32_t stride = 0;
+		bool imported = false;
+		std::atomic<uint32_t> next{UINT32_MAX};
+		std::atomic<uint8_t> state{SLOT_EMPTY};
+	};
+
+	explicit VendorGraphicBufferPool(const Config &config);
+
+	bool matches_config(buffer_handle_t handle) const;
+
+	uint32_t pop_free();
+	void push_free(uint32_t id);
+
+	void request_grow();
+	void notify_waiters();
+	bool grow();
+	void shrink_if_idle();
+	void free_slot(uint32_t id);
+	void worker();
+
+	const Config mConfig;
+	std::unique_ptr<Slot[]> mSlots;
+
+	/* Free list head: ABA tag in the upper 32 bits, slot id in the lower */
+	std::atomic<uint64_t> mFreeHead;
+	std::atomic<uint32_t> mFreeCount{0};
+	std::atomic<uint32_t> mAllocated{0};
+	std::atomic<uint32_t> mWaiters{0};
+	std::atomic<uint32_t> mTargetFree{0};       // Raised by wait_for_free()
+	std::atomic<nsecs_t> mLastAcquire;
+
+	std::atomic<uint64_t> mAcquires{0};
+	std::atomic<uint64_t> mMisses{0};
+	std::atomic<uint64_t> mGrown{0};
+	std::atomic<uint64_t> mShrunk{0};
+
+	/* Protects mEmptySlots and the worker wake up conditions */
+	mutable std::mutex mLock;
+	std::condition_variable mWorkerCond;
+	std::condition_variable mFreeCond;
+	std::vector<uint32_t> mEmptySlots;
+	bool mGrowRequested = false;
+	bool mExit = false;
+	std::thread mWorker;
+};
+
+} /* namespace graphics */
+} /* namespace vendor */
+
+#endif /* VENDOR_GRAPHIC_BUFFER_POOL_H_ */
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2020 Samsung Electronics Co. Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VENDOR_GRAPHIC_BUFFER_VIEW_H_
+#define VENDOR_GRAPHIC_BUFFER_VIEW_H_
+
+#include <cstdint>
+#include <string>
+
+#include "VendorGraphicBuffer.h"
+
+namespace vendor {
+namespace graphics {
+
+/*
+ * Zero-copy views of a gralloc buffer.
+ *
+ * A view is a new single plane buffer handle sharing the dmabuf fds of its
+ * parent, with its own format, dimensions, offset and stride, e.g. the Y
+ * plane of an NV12 frame as R_8 for the TPU or a crop of a RAW16 frame. It
+ * gets its own (empty) metadata, so setting metadata on a view does not
+ * affect the parent.
+ *
+ * The returned handle is raw, like a freshly allocated one: import it with
+ * VendorGraphicBufferMeta::import_buffer() or send it to another process,
+ * and release it with destroy(). Views are marked with PRIV_FLAGS_VIEW and
+ * CPU lock returns the first pixel of the view. The PlaneLayout offset stays
+ * relative to the shared dmabuf for device access; do not add it to the
+ * lock address.
+ */
+class VendorGraphicBufferView {
+public:
+	struct Config {
+		uint32_t plane = 0;         /* Parent plane the view lies in */
+		uint64_t offset = 0;        /* Byte offset of the first pixel within that plane */
+		uint32_t width = 0;
+		uint32_t height = 0;
+		int32_t format = 0;         /* Uncompressed single plane format with whole bytes per pixel */
+		uint32_t byte_stride = 0;   /* 0: the parent plane stride */
+		uint64_t usage = 0;         /* 0: the parent usage */
+		std::string name = "VendorGraphicBufferView";
+	};
+
+	/* Returns nullptr if the view does not fit in the parent plane */
+	static native_handle_t *create(buffer_handle_t parent, const Config &config);
+
+	/*
+	 * The top left width x height pixels of a parent plane in another format, keeping its
+	 * stride, e.g. plane 0 of an NV12 frame as R_8 with the frame width and height.
+	 */
+	static native_handle_t *create_plane(buffer_handle_t parent, uint32_t plane, int32_t format,
+	                                     uint32_t width, uint32_t height);
+
+	/* The given rectangle of a single plane parent, in its own format */
+	static native_handle_t *create_crop(buffer_handle_t parent, uint32_t left, uint32_t top,
+	                                    uint32_t width, uint32_t height);
+
+	/* Closes the fds of a handle returned by create*() and frees it */
+	static void destroy(native_handle_t *view);
+
+	/* Bytes per pixel of formats a view can have, 0 for the others */
+	static uint32_t bytes_per_pixel(int32_t format);
+};
+
+} /* namespace graphics */
+} /* namespace vendor */
+
+#endif /* VENDOR_GRAPHIC_BUFFER_VIEW_H_ */